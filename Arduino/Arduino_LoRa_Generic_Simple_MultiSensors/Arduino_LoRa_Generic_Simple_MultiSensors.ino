@@ -21,7 +21,7 @@
  * first version of generic sensor
  * nicolas.bertuol@etud.univ-pau.fr
  * 
- * last update: Jan 15th, 2019 by C. Pham
+ * last update: Oct 19th, 2026 by C. Pham
  */
 
 // IMPORTANT
@@ -118,6 +118,9 @@ const uint32_t DEFAULT_CHANNEL=CH_00_433;
 //#define WITH_ACK
 //this will enable a receive window after every transmission
 //#define WITH_RCVW
+//this will send the sensor values in the binary format of SensorCodec.h instead of text
+//the gateway converts them back to the \!TC1/27.79/HU1/56.50 text format
+//#define BINARY_PAYLOAD
 ///////////////////////////////////////////////////////////////////
 
 ///////////////////////////////////////////////////////////////////
@@ -284,20 +287,6 @@ long getCmdValue(int &i, char* strBuff=NULL) {
 // array containing sensors pointers
 Sensor* sensor_ptrs[number_of_sensors];
 
-char *ftoa(char *a, double f, int precision)
-{
- long p[] = {0,10,100,1000,10000,100000,1000000,10000000,100000000};
- 
- char *ret = a;
- long heiltal = (long)f;
- itoa(heiltal, a, 10);
- while (*a != '\0') a++;
- *a++ = '.';
- long desimal = abs((long)((f - heiltal) * p[precision]));
- itoa(desimal, a, 10);
- return ret;
-}
-
 /*****************************
  _____      _               
 /  ___|    | |              
@@ -556,40 +545,47 @@ void loop(void)
       memcpy(message,my_appKey,app_key_offset);
 #endif
 
-      uint8_t r_size;
-    
+      uint8_t r_size=0;
+#ifndef BINARY_PAYLOAD    
       char final_str[80] = "\\!";
-      char aux[6] = "";
+      char aux[SENSOR_MAX_DATA_LENGTH+1] = "";
+      uint8_t final_len=2;
+#endif
 
-      //this is how we can wake up some sensors in advance in case they need a longer warmup time
-      //digitalWrite(sensor_ptrs[4]->get_pin_power(),HIGH);
+      // all the sensors are powered at the same time and each one is read as soon as its warmup time is over
+      // so that we wait for the longest warmup time instead of the sum of the warmup times
+      update_sensors(sensor_ptrs, number_of_sensors);
 
       // main loop for sensors, actually, you don't have to edit anything here
       // just add a predefined sensor if needed or provide a new sensor class instance for a handle a new physical sensor
       for (int i=0; i<number_of_sensors; i++) {
 
           if (sensor_ptrs[i]->get_is_connected() || sensor_ptrs[i]->has_fake_data()) {
-            
-              ftoa(aux, sensor_ptrs[i]->get_value(), 2);
-          
-              if (i==0) {
-                  //sprintf(final_str, "%s%s/%s", final_str, nomenclatures_array[i], aux);
-                  sprintf(final_str, "%s%s/%s", final_str, sensor_ptrs[i]->get_nomenclature(), aux);
-                  
-              } 
-              else {
-                  sprintf(final_str, "%s/%s/%s", final_str, sensor_ptrs[i]->get_nomenclature(), aux);
-              }
+#ifdef BINARY_PAYLOAD
+              if (app_key_offset+r_size+SENSOR_CODEC_MAX_FIELD_SIZE <= sizeof(message))
+                  r_size+=sensor_ptrs[i]->encode_data(message+app_key_offset+r_size);
+#else            
+              // the sensors keep their data in fixed point, see set_decimals()
+              sensor_ptrs[i]->format_data(aux);
+
+              // append at the end of the string instead of printing the whole string again
+              if (final_len+strlen(sensor_ptrs[i]->get_nomenclature())+strlen(aux)+3 < sizeof(final_str))
+                  final_len+=sprintf(final_str+final_len, "%s%s/%s", final_len>2 ? "/" : "", sensor_ptrs[i]->get_nomenclature(), aux);
+#endif
           }
           //else
           //  strcpy(aux,"");
       }
-      
+
+#ifdef BINARY_PAYLOAD
+      PRINT_CSTSTR("%s","Sending binary sensor values\n");
+#else      
       r_size=sprintf((char*)message+app_key_offset, final_str);
 
       PRINT_CSTSTR("%s","Sending ");
       PRINT_STR("%s",(char*)(message+app_key_offset));
       PRINTLN;
+#endif
       
       PRINT_CSTSTR("%s","Real payload size is ");
       PRINT_VALUE("%d", r_size);
@@ -601,7 +597,11 @@ void loop(void)
       
       startSend=millis();
 
+#ifdef BINARY_PAYLOAD
+      uint8_t p_type=PKT_TYPE_DATA_BIN;
+#else
       uint8_t p_type=PKT_TYPE_DATA;
+#endif
       
 #ifdef WITH_APPKEY
       // indicate that we have an appkey
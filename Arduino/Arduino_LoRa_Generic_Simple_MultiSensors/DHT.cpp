@@ -7,10 +7,27 @@ written by Adafruit Industries
 #include "DHT.h"
 
 #define MIN_INTERVAL 2000
+// The response and the 40 bits take at most 80+80+40*(55+75) microseconds.
+#define FRAME_TIME 6
+
+// readStep() states
+#define DHT_IDLE 0
+#define DHT_FRAME 1
+#define DHT_RETRY 2
+
+DHT* DHT::_first = NULL;
+DHT* volatile DHT::_capturing = NULL;
+volatile uint8_t DHT::_n_falls = 0;
+volatile bool DHT::_level = LOW;
+volatile uint16_t DHT::_falls[DHT_MAX_EDGES];
 
 DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
   _pin = pin;
   _type = type;
+  _lastresult = false;
+  _state = DHT_IDLE;
+  _retries = 0;
+  _next = NULL;
   #ifdef __AVR
     _bit = digitalPinToBitMask(pin);
     _port = digitalPinToPort(pin);
@@ -127,6 +144,19 @@ boolean DHT::read(bool force) {
   if (!force && ((currenttime - _lastreadtime) < 2000)) {
     return _lastresult; // return last correct measurement
   }
+
+  if (canCapture()) {
+    uint16_t ms;
+
+    // So that readStep() starts a new reading.
+    _lastreadtime = currenttime - MIN_INTERVAL;
+
+    while ((ms = readStep()))
+      delay(ms);
+
+    return _lastresult;
+  }
+
   _lastreadtime = currenttime;
 
   // Reset 40 bits of received data to zero.
@@ -257,3 +287,201 @@ uint32_t DHT::expectPulse(bool level) {
 
   return count;
 }
+
+DHT* DHT::onPin(uint8_t pin, uint8_t type) {
+  DHT* d;
+
+  for (d = _first; d; d = d->_next)
+    if (d->_pin == pin)
+      return d;
+
+  d = new DHT(pin, type);
+  d->_next = _first;
+  _first = d;
+
+  return d;
+}
+
+uint16_t DHT::readStep() {
+  uint32_t now = millis();
+
+  // Another sensor on the same DHT is reading it, e.g. the temperature for the humidity.
+  if (_state != DHT_IDLE && (int32_t)(now - _due) < 0)
+    return _due - now;
+
+  switch (_state) {
+  case DHT_IDLE:
+    // Use the last reading as read() does.
+    if (now - _lastreadtime < MIN_INTERVAL)
+      return 0;
+
+    if (!canCapture()) {
+      read(true);
+      return 0;
+    }
+
+    _retries = 0;
+    // fall through
+
+  case DHT_RETRY:
+    _lastreadtime = now;
+
+    // Send start signal, the data sheet says "at least 1ms" for the DHT22 and 18ms for the DHT11.
+    // This is the only part where the MCU waits.
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+    if (_type == DHT11)
+      delay(20);
+    else
+      delayMicroseconds(1100);
+
+    // The sensor answers 20 to 40 microseconds after the line is released, then the falling
+    // edges are timestamped by the interrupt.
+    startCapture();
+    _state = DHT_FRAME;
+    _due = now + FRAME_TIME;
+    return FRAME_TIME;
+
+  case DHT_FRAME:
+    stopCapture();
+
+    _lastresult = decode((const uint16_t*)_falls, _n_falls, data);
+
+    // Read again when a frame was received but is wrong, e.g. a bit disturbed by another
+    // interrupt, not when the sensor does not answer.
+    if (!_lastresult && _n_falls && _retries < DHT_RETRIES) {
+      DEBUG_PRINTLN(F("Wrong frame, reading again."));
+      _retries++;
+      // The sensor needs 2 seconds between 2 readings.
+      _state = DHT_RETRY;
+      _due = now + MIN_INTERVAL;
+      return MIN_INTERVAL;
+    }
+
+    _state = DHT_IDLE;
+    return 0;
+  }
+
+  return 0;
+}
+
+bool DHT::decode(const uint16_t* falls, uint8_t n, uint8_t* bytes) {
+
+  if (n < 41 || n > DHT_MAX_EDGES)
+    return false;
+
+  // Without the response of the sensor if it was missed.
+  falls += n - 41;
+
+  for (uint8_t i = 0; i < 5; i++)
+    bytes[i] = 0;
+
+  for (uint8_t i = 0; i < 40; i++) {
+    // A bit is a 50 microseconds low pulse then a 26-28 microseconds high pulse for a 0 and
+    // a 70 microseconds one for a 1. Subtracting 16-bit times also works when micros() wraps.
+    uint16_t period = falls[i+1] - falls[i];
+
+    if (period < 50 || period > 170)
+      return false;
+
+    bytes[i/8] <<= 1;
+    if (period > 100)
+      bytes[i/8] |= 1;
+  }
+
+  return bytes[4] == ((bytes[0] + bytes[1] + bytes[2] + bytes[3]) & 0xFF);
+}
+
+bool DHT::canCapture() {
+#ifdef DHT_CAPTURE
+  #ifdef digitalPinToInterrupt
+    if (digitalPinToInterrupt(_pin) != NOT_AN_INTERRUPT)
+      return true;
+  #endif
+  #if defined __AVR && defined DHT_PCINT && defined PCICR
+    if (digitalPinToPCICR(_pin) && digitalPinToPCICRbit(_pin) == DHT_PCINT)
+      return true;
+  #endif
+#endif
+  return false;
+}
+
+bool DHT::readPin() {
+  #ifdef __AVR
+    return *portInputRegister(_port) & _bit;
+  #else
+    return digitalRead(_pin);
+  #endif
+}
+
+void DHT::startCapture() {
+  _n_falls = 0;
+  // The line is still low, the interrupt is enabled before it is released so that the
+  // response of the sensor is not missed.
+  _level = LOW;
+  _capturing = this;
+
+  #ifdef digitalPinToInterrupt
+  if (digitalPinToInterrupt(_pin) != NOT_AN_INTERRUPT)
+    attachInterrupt(digitalPinToInterrupt(_pin), captureEdge, CHANGE);
+  else
+  #endif
+  {
+  #if defined __AVR && defined DHT_PCINT && defined PCICR
+    *digitalPinToPCMSK(_pin) |= bit(digitalPinToPCMSKbit(_pin));
+    PCIFR = bit(digitalPinToPCICRbit(_pin));
+    PCICR |= bit(digitalPinToPCICRbit(_pin));
+  #endif
+  }
+
+  pinMode(_pin, INPUT_PULLUP);
+}
+
+void DHT::stopCapture() {
+  #ifdef digitalPinToInterrupt
+  if (digitalPinToInterrupt(_pin) != NOT_AN_INTERRUPT)
+    detachInterrupt(digitalPinToInterrupt(_pin));
+  else
+  #endif
+  {
+  #if defined __AVR && defined DHT_PCINT && defined PCICR
+    *digitalPinToPCMSK(_pin) &= ~bit(digitalPinToPCMSKbit(_pin));
+  #endif
+  }
+
+  _capturing = NULL;
+}
+
+void DHT::captureEdge() {
+  uint16_t t = micros();
+  DHT* d = _capturing;
+
+  if (!d)
+    return;
+
+  // With the pin change interrupts, the interrupt can also be for another pin of the port.
+  bool level = d->readPin();
+
+  if (_level && !level) {
+    // One more to know that there were too many edges.
+    if (_n_falls < DHT_MAX_EDGES)
+      _falls[_n_falls] = t;
+    if (_n_falls <= DHT_MAX_EDGES)
+      _n_falls++;
+  }
+
+  _level = level;
+}
+
+#if defined __AVR && defined DHT_CAPTURE && defined DHT_PCINT
+  // Only the vector of the port of the DHT pin, the others are left to the other libraries.
+  #if DHT_PCINT == 0 && defined PCINT0_vect
+    ISR(PCINT0_vect) { DHT::captureEdge(); }
+  #elif DHT_PCINT == 1 && defined PCINT1_vect
+    ISR(PCINT1_vect) { DHT::captureEdge(); }
+  #elif DHT_PCINT == 2 && defined PCINT2_vect
+    ISR(PCINT2_vect) { DHT::captureEdge(); }
+  #elif DHT_PCINT == 3 && defined PCINT3_vect
+    ISR(PCINT3_vect) { DHT::captureEdge(); }
+  #endif
+#endif
@@ -28,6 +28,19 @@ written by Adafruit Industries
   #define DEBUG_PRINTLN(...) {}
 #endif
 
+// The frame is timestamped by an interrupt on each edge of the data line instead of being
+// read with the interrupts disabled for 5ms, comment to always use the busy-wait.
+#define DHT_CAPTURE
+// On AVR, pins without external interrupt (e.g. A2 on the Uno) can use the pin change interrupts
+// of their port: uncomment with the number of the PCINT vector defined by DHT.cpp, e.g. 1 for
+// A0-A5, 0 for D8-D13 and 2 for D0-D7 on the Uno. The vector must not be defined by another
+// library, such as SoftwareSerial that defines all of them. The other pins use the busy-wait.
+//#define DHT_PCINT 1
+// Number of new readings when the frame is wrong
+#define DHT_RETRIES 2
+// Falling edges of a frame: the response then the start and the end of each of the 40 bits
+#define DHT_MAX_EDGES 42
+
 // Define types of sensors.
 #define DHT11 11
 #define DHT22 22
@@ -46,6 +59,22 @@ class DHT {
    float readHumidity(bool force=false);
    boolean read(bool force=false);
 
+   // Same as read() without waiting: return the time in ms before the next call, or 0 when
+   // the reading is done and readTemperature() and readHumidity() give its result.
+   // The MCU is free during the start signal and while the frame is captured.
+   uint16_t readStep();
+
+   // The same DHT for the sensors on a pin, so that the temperature and the humidity come
+   // from a single reading.
+   static DHT* onPin(uint8_t pin, uint8_t type);
+
+   // Decode the 40 bits from the times in us of the falling edges of the data line, the last
+   // 41 ones being the start and the end of each bit, and check the checksum.
+   static bool decode(const uint16_t* falls, uint8_t n, uint8_t* bytes);
+
+   // Called by the interrupt on the edges of the data line.
+   static void captureEdge();
+
  private:
   uint8_t data[5];
   uint8_t _pin, _type;
@@ -56,8 +85,23 @@ class DHT {
   #endif
   uint32_t _lastreadtime, _maxcycles;
   bool _lastresult;
+  // readStep() state, millis() of the next step and number of retries
+  uint8_t _state, _retries;
+  uint32_t _due;
+  DHT* _next;
+
+  // one frame is captured at a time
+  static DHT* _first;
+  static DHT* volatile _capturing;
+  static volatile uint8_t _n_falls;
+  static volatile bool _level;
+  static volatile uint16_t _falls[DHT_MAX_EDGES];
 
   uint32_t expectPulse(bool level);
+  bool canCapture();
+  void startCapture();
+  void stopCapture();
+  bool readPin();
 
 };
 
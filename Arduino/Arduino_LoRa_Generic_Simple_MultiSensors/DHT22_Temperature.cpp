@@ -12,7 +12,8 @@ DHT22_Temperature::DHT22_Temperature(char* nomenclature, bool is_analog, bool is
   if (get_is_connected()){
     // start library DHT
     // dht = new DHT22(get_pin_read());
-    dht = new DHT(get_pin_read(), DHT22);
+    // the temperature and the humidity sensors share the readings of the DHT
+    dht = DHT::onPin(get_pin_read(), DHT22);
     
     pinMode(get_pin_power(),OUTPUT);
     
@@ -25,19 +26,26 @@ DHT22_Temperature::DHT22_Temperature(char* nomenclature, bool is_analog, bool is
   }
 }
 
-void DHT22_Temperature::update_data()
+void DHT22_Temperature::power_on()
 {
-  if (get_is_connected()) {
-  	
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);  	
+  Sensor::power_on();
 
+  if (get_is_connected())
     dht->begin();
-    
-    // wait
-    delay(get_warmup_time());
+}
 
+bool DHT22_Temperature::read_data()
+{
+  if (get_is_connected()) {
+    
+    // the frame is captured by an interrupt while the MCU sleeps, see DHT::readStep()
+    uint16_t ms = dht->readStep();
+    
+    if (ms) {
+      set_ready_time(millis()+ms);
+      return false;
+    }
+    
     double t = dht->readTemperature();
 
     if (isnan(t))
@@ -56,8 +64,6 @@ void DHT22_Temperature::update_data()
 	  //	set_data((double)-1.0);
 	  //}
 
-    if (get_is_low_power())		
-        digitalWrite(get_pin_power(),LOW);   
   }
   else {
   	// if not connected, set a random value (for testing)  	
@@ -65,6 +71,7 @@ void DHT22_Temperature::update_data()
     	set_data((double)random(-20, 40));
   }
 
+  return true;
 }
 
 double DHT22_Temperature::get_value(){
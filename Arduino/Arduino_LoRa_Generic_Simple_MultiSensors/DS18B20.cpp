@@ -7,12 +7,18 @@
 #include "DS18B20.h"
 
 DS18B20::DS18B20(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power):Sensor(nomenclature, is_analog, is_connected, is_low_power, pin_read, pin_power){
+  _converting=false;
+  _resolution=0;
+  _n_probes=0;
+  
   if (get_is_connected()){
     // start OneWire
     ds = new OneWire(get_pin_read());
 
     // Pass our oneWire reference to Dallas Temperature 
     sensors = new DallasTemperature(ds);
+    // requestTemperatures() returns without waiting for the conversion
+    sensors->setWaitForConversion(false);
     
     // to power the DS18B20
     pinMode(get_pin_power(),OUTPUT);
@@ -87,40 +93,70 @@ DS18B20::DS18B20(char* nomenclature, bool is_analog, bool is_connected, bool is_
 } */
 
 // New version based on DallasTemperature library
-void DS18B20::update_data()
+void DS18B20::power_on()
+{
+  Sensor::power_on();
+  _converting=false;
+}
+
+// the first call starts the conversion in all the probes of the bus and returns false,
+// update_sensors() or update_data() then sleep during the conversion time, and the second
+// call reads all the probes
+bool DS18B20::read_data()
 {		
-  double temp=-1.0;
-  
   if (get_is_connected()) {
-  	
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);  	
 
-    // wait
-    delay(get_warmup_time());
+    if (!_converting) {
+      // the addresses and the resolution of the probes do not change when they are powered off,
+      // so the bus is only enumerated again when no probe was found
+      if (!sensors->getDeviceCount()) {
+        sensors->begin();
+        
+        if (_resolution)
+          sensors->setResolution(_resolution);
+      }
+      
+      // skip-ROM command, all the probes convert at the same time
+      sensors->requestTemperatures();
+      _converting=true;
+      
+      // from 94ms in 9 bits to 750ms in 12 bits
+      set_ready_time(millis()+sensors->millisToWaitForConversion());
+      return false;
+    }
 
-    // Start up the library 
-    sensors->begin(); 
+    _converting=false;
+    // a single search of the bus instead of one search per index
+    _n_probes=sensors->getAllTemps(_probes, DS18B20_MAX_PROBES);
     
-    // call sensors.requestTemperatures() to issue a global temperature 
- 	  // request to all devices on the bus 
-    sensors->requestTemperatures(); // Send the command to get temperature readings  
-    temp = sensors->getTempCByIndex(0); // Why "byIndex"?  
-    // You can have more than one DS18B20 on the same bus.  
-    // 0 refers to the first IC on the wire 
-    //delay(1000);  
-	
-    if (get_is_low_power())
-        digitalWrite(get_pin_power(),LOW);
-        
-	  set_data(temp);
+    // the first probe, as getTempCByIndex(0)
+	  set_data(get_probe_data(0));
   }
   else { 
   	// if not connected, set a random value (for testing)  	
   	if (has_fake_data())
   		set_data((double)random(-20, 40));
   }
+
+  return true;
+}
+
+void DS18B20::set_resolution(uint8_t bits)
+{
+  _resolution=bits;
+}
+
+uint8_t DS18B20::get_n_probes()
+{
+  return _n_probes;
+}
+
+double DS18B20::get_probe_data(uint8_t i)
+{
+  if (i>=_n_probes)
+    return (double)DEVICE_DISCONNECTED_C;
+    
+  return (double)DallasTemperature::rawToCelsius(_probes[i]);
 }
 
 double DS18B20::get_value()
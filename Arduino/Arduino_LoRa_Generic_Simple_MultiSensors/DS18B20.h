@@ -12,16 +12,29 @@
 #include "DallasTemperature.h"
 
 #define DS18B20_addr 0x28
+// probes read on the same bus
+#define DS18B20_MAX_PROBES 8
 
 class DS18B20 : public Sensor {
   public:
     DS18B20(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power);
     double get_value();
-    void update_data();
+    void power_on();
+    bool read_data();
+    // 9 to 12 bits, written once in the EEPROM of the probes, 0 keeps their resolution
+    void set_resolution(uint8_t bits);
+    // get_data() gives the first probe of the bus
+    uint8_t get_n_probes();
+    double get_probe_data(uint8_t i);
     
   private:
     OneWire* ds = NULL;
     DallasTemperature* sensors = NULL;
+    bool _converting;
+    uint8_t _resolution;
+    uint8_t _n_probes;
+    // in 1/128 degrees C
+    int16_t _probes[DS18B20_MAX_PROBES];
 };
 
 #endif
@@ -25,7 +25,7 @@ HCSR04::HCSR04(char* nomenclature, bool is_analog, bool is_connected, bool is_lo
   }
 }
 
-void HCSR04::update_data()
+bool HCSR04::read_data()
 {
   if (get_is_connected()) {
   	
@@ -33,13 +33,6 @@ void HCSR04::update_data()
     double aux_distance = 0;
     double distance = 0;
     
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);     
-    
-    // wait
-    delay(get_warmup_time());
-   
     for(int i=0; i<get_n_sample(); i++) {
     	
 	   	digitalWrite(get_pin_trigger(), HIGH);
@@ -55,9 +48,6 @@ void HCSR04::update_data()
         delay(10);
     }
     
-    if (get_is_low_power())    
-        digitalWrite(get_pin_power(),LOW);
-  
     // getting the average
     set_data(distance / (double)get_n_sample());
   }
@@ -66,6 +56,8 @@ void HCSR04::update_data()
   		// if not connected, set a random value (for testing)  	
     	set_data((double)random(30, 100));
   }
+
+  return true;
 }
 
 double HCSR04::get_value()
@@ -15,7 +15,7 @@
 class HCSR04 : public Sensor {
   public:    
     HCSR04(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power, int pin_trigger);
-    void update_data();
+    bool read_data();
     double get_value();
 };
 
@@ -21,20 +21,13 @@ HRLV::HRLV(char* nomenclature, bool is_analog, bool is_connected, bool is_low_po
   }
 }
 
-void HRLV::update_data()
+bool HRLV::read_data()
 {
   if (get_is_connected()) {
   	
     double aux_dist = 0;
     double distance = 0;
     
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);     
-    
-    // wait
-    delay(get_warmup_time());
-   
     for(int i=0; i<get_n_sample(); i++) {
     	
 	    if (get_is_analog()) {
@@ -46,9 +39,6 @@ void HRLV::update_data()
         delay(10);
     }
     
-    if (get_is_low_power())    
-        digitalWrite(get_pin_power(),LOW);
-  
     	// getting the average
 		set_data(distance / (double)get_n_sample());
 	}
@@ -57,6 +47,8 @@ void HRLV::update_data()
   		if (has_fake_data())
     		set_data((double)random(30, 100));
 	}
+
+  return true;
 }
 
 double HRLV::get_value()
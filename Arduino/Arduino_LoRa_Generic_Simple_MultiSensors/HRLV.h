@@ -13,7 +13,7 @@
 class HRLV : public Sensor {
   public:    
     HRLV(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power);
-    void update_data();
+    bool read_data();
     double get_value();
 };
 
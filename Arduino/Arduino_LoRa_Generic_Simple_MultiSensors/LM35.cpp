@@ -23,45 +23,32 @@ LM35::LM35(char* nomenclature, bool is_analog, bool is_connected, bool is_low_po
   }
 }
 
-void LM35::update_data()
+bool LM35::read_data()
 {
   if (get_is_connected()) {
   	
-    double aux_temp = 0;
-    double temperature = 0;
+    uint32_t sum = 0;
     
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);     
-    
-    // wait
-    delay(get_warmup_time());
-   
     for(int i=0; i<get_n_sample(); i++) {
     	
     	// a bit useless to test for analog as we know it is analog
     	// remove this test?
-	    if (get_is_analog()) {
-	      aux_temp = analogRead(get_pin_read());
-	      aux_temp = aux_temp * TEMP_SCALE/1024;
-	      aux_temp = aux_temp / 10.0;
-	    }
+	    if (get_is_analog())
+	      sum += analogRead(get_pin_read());
     
-        temperature += aux_temp;
         delay(10);
     }
     
-    if (get_is_low_power())    
-        digitalWrite(get_pin_power(),LOW);
-  
-    // getting the average
-    set_data(temperature/(double)get_n_sample()); 
+    // getting the average, TEMP_SCALE mV for 1024 steps and 10mV per degree
+    set_fixed_data(scale_sum(sum, get_n_sample(), TEMP_SCALE*get_scale(), 1024*10L)); 
 	}
 	else {
   		// if not connected, set a random value (for testing)  	
   		if (has_fake_data())
-    		set_data((double)random(-10, 30));
+    		set_fixed_data(random(-10, 30)*get_scale());
 	}
+
+  return true;
 }
 
 double LM35::get_value()
@@ -23,35 +23,27 @@ LeafWetness::LeafWetness(char* nomenclature, bool is_analog, bool is_connected,
   }
 }
 
-void LeafWetness::update_data()
+bool LeafWetness::read_data()
 {
   if (get_is_connected()) {
-  	
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);  	
 
-    // wait
-    delay(get_warmup_time());
-      
     // TO MODIFY, IT SHALL RETURN VALUE BETWEEN 0 - 15 NOT A VOLTAGE
     if(get_is_analog()){
-    	// *LW_SCALE because of 5v or 3.3v depending on arduino and /1024 because of 10bits analog value, so 1024 in decimal
-    	set_data(((double)analogRead(get_pin_read()) * LW_SCALE / 1024.0));
+    	// *LW_SCALE because of 5000mV or 3300mV depending on arduino and /1024 because of 10bits analog value, so 1024 in decimal
+    	set_fixed_data(scale_sum(analogRead(get_pin_read()), 1, LW_SCALE*get_scale(), 1024*1000L));
     }
     else {
-    	set_data(((double)digitalRead(get_pin_read())));
+    	set_fixed_data(digitalRead(get_pin_read())*(int32_t)get_scale());
     }
         
-    if (get_is_low_power())      
-        digitalWrite(get_pin_power(),LOW);
-        
   }
   else{
   	// if not connected, set a random value (for testing)  	
   	if (has_fake_data())
-    	set_data((double) (random(0, 30) / 2.0));
+    	set_fixed_data(random(0, 30)*(int32_t)get_scale()/2);
   }
+
+  return true;
 }
 
 double LeafWetness::get_value(){
@@ -8,12 +8,12 @@
 #define LEAFWETNESS_H
 #include "Sensor.h"
 
-#define LW_SCALE _BOARD_VOLT_SCALE
+#define LW_SCALE _BOARD_MVOLT
 
 class LeafWetness : public Sensor {
   public:
     LeafWetness(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power);
-    void update_data();
+    bool read_data();
     double get_value();
 };
 
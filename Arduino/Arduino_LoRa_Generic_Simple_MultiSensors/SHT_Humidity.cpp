@@ -27,16 +27,9 @@ SHT_Humidity::SHT_Humidity(char* nomenclature, bool is_analog, bool is_connected
   }
 }
 
-void SHT_Humidity::update_data()
+bool SHT_Humidity::read_data()
 {
   if (get_is_connected()) {
-  	
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);  	
-
-    // wait
-    delay(get_warmup_time());
 
     float t;
     float h;
@@ -56,14 +49,14 @@ void SHT_Humidity::update_data()
     else
       set_data((double)-100.0);
       
-    if (get_is_low_power())		
-      digitalWrite(get_pin_power(),LOW);   
   }
   else {
   	// if not connected, set a random value (for testing)  	
   	if (has_fake_data()) 	
     	set_data((double)random(15, 90));
   }
+
+  return true;
 }
 
 double SHT_Humidity::get_value()
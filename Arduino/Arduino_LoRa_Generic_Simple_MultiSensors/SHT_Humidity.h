@@ -17,7 +17,7 @@ class SHT_Humidity : public Sensor {
   public:    
     SHT_Humidity(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power, uint8_t pin_trigger);
     double get_value();
-    void update_data();
+    bool read_data();
   private:    
     Sensirion* sht = NULL;
 };
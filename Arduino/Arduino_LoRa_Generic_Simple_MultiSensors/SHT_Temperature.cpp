@@ -27,17 +27,10 @@ SHT_Temperature::SHT_Temperature(char* nomenclature, bool is_analog, bool is_con
   }
 }
 
-void SHT_Temperature::update_data()
+bool SHT_Temperature::read_data()
 {
   if (get_is_connected()) {
-  	
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);  	
 
-    // wait
-    delay(get_warmup_time());
-        
     float t;
     float h;
     int ret;
@@ -56,8 +49,6 @@ void SHT_Temperature::update_data()
     else 
       set_data((double)-100.0);
       
-    if (get_is_low_power())		
-        digitalWrite(get_pin_power(),LOW);   
   }
   else {
   	// if not connected, set a random value (for testing)  	
@@ -65,6 +56,7 @@ void SHT_Temperature::update_data()
     	set_data((double)random(-20, 40));
   }
 
+  return true;
 }
 
 double SHT_Temperature::get_value(){
@@ -18,7 +18,7 @@ class SHT_Temperature : public Sensor {
     SHT_Temperature(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power, uint8_t pin_trigger);
     double get_value();
     double get_value(float *data = NULL, float *data1 = NULL, float *data2 = NULL);
-    void update_data();
+    bool read_data();
   private:  
     Sensirion* sht = NULL;  
 };
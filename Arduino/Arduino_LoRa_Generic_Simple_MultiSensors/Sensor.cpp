@@ -7,6 +7,10 @@
 */
 
 #include "Sensor.h"
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
     
 Sensor::Sensor(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power, int pin_trigger){
   
@@ -24,10 +28,16 @@ Sensor::Sensor(char* nomenclature, bool is_analog, bool is_connected, bool is_lo
   set_pin_read(pin_read);
   set_pin_power(pin_power);
   set_pin_trigger(pin_trigger);
+  // before set_data() which tests them
+  set_fake_data(false);
+  // same precision as the text payload
+  set_decimals(2);
+  set_calibration(0);
   set_data(0);
   set_warmup_time(0);
-  set_fake_data(false);
   set_n_sample(5);
+  set_field_id(sensorCodecFieldId(_nomenclature));
+  set_ready_time(0);
   
   /*if(_pin_power != -1){
     set_power_set("LOW");
@@ -71,9 +81,23 @@ int Sensor::get_pin_trigger(){
 }*/
 
 double Sensor::get_data(){
+  return (double)_data/get_scale();
+}
+
+int32_t Sensor::get_fixed_data(){
   return _data;
 }
 
+uint32_t Sensor::get_scale(){
+
+  uint32_t scale=1;
+  
+  for (uint8_t i=0; i<_decimals; i++)
+    scale*=10;
+    
+  return scale;
+}
+
 uint16_t Sensor::get_warmup_time(){
   return _warmup_time;
 }
@@ -89,6 +113,14 @@ bool Sensor::has_pin_trigger(){
 uint8_t Sensor::get_n_sample(){
   return _n_sample;
 }
+
+uint8_t Sensor::get_field_id(){
+  return _field_id;
+}
+
+uint8_t Sensor::get_decimals(){
+  return _decimals;
+}
 /////////////
 // SETTERS //
 /////////////
@@ -126,10 +158,29 @@ void Sensor::set_pin_trigger(int u){
 
 void Sensor::set_data(double d) {
 
-	if (_is_connected || _with_fake_data)		
-  		_data = d;
+  for (uint8_t i=0; i<_decimals; i++)
+    d*=10.0;
+  
+  // round to the nearest, as the value is truncated otherwise
+  set_fixed_data((int32_t)(d<0 ? d-0.5 : d+0.5));
+}
+
+void Sensor::set_fixed_data(int32_t v) {
+
+	if (_is_connected || _with_fake_data) {
+	
+		if (_gain!=SENSOR_GAIN_ONE) {
+			// v*gain/SENSOR_GAIN_ONE in 2 parts so that it does not overflow
+			int32_t q=v/SENSOR_GAIN_ONE;
+			int32_t r=v%SENSOR_GAIN_ONE;
+			
+			v=q*_gain+r*(int32_t)_gain/SENSOR_GAIN_ONE;
+		}
+		
+  		_data = v+_offset;
+  	}
   	else
-  		_data = -1.0;	
+  		_data = -(int32_t)get_scale();	
 }
 
 void Sensor::set_warmup_time(uint16_t t){
@@ -144,11 +195,189 @@ void Sensor::set_n_sample(uint8_t n) {
   _n_sample=n;
 }   
 
+void Sensor::set_field_id(uint8_t id) {
+  _field_id=id;
+}
+
+void Sensor::set_decimals(uint8_t n) {
+  // more decimals do not fit in an int32_t
+  _decimals=(n>SENSOR_CODEC_MAX_DECIMALS) ? SENSOR_CODEC_MAX_DECIMALS : n;
+}
+
+void Sensor::set_calibration(int32_t offset, uint16_t gain) {
+  _offset=offset;
+  _gain=gain;
+}
+
+uint8_t Sensor::encode_data(uint8_t* buf) {
+  return sensorCodecPut(buf, _field_id, _nomenclature, _data, _decimals);
+}
+
+uint8_t Sensor::format_data(char* buf) {
+
+  uint32_t a=_data<0 ? -(uint32_t)_data : (uint32_t)_data;
+  uint32_t scale=get_scale();
+  uint32_t i=a/scale;
+  uint32_t f=a%scale;
+  char digits[10];
+  uint8_t n=0, k=0;
+  
+  if (_data<0)
+    buf[n++]='-';
+  
+  do {
+    digits[k++]='0'+i%10;
+    i/=10;
+  } while (i);
+  
+  while (k)
+    buf[n++]=digits[--k];
+  
+  if (_decimals) {
+    buf[n++]='.';
+    
+    // the leading zeros of the decimals are kept, e.g. 27.05
+    for (k=_decimals; k; k--) {
+      buf[n+k-1]='0'+f%10;
+      f/=10;
+    }
+    
+    n+=_decimals;
+  }
+  
+  buf[n]='\0';
+  
+  return n;
+}
+
+int32_t Sensor::scale_sum(uint32_t sum, uint8_t n, uint32_t mul, uint32_t div) {
+
+  // the constants of the sensors have common factors of 2, e.g. 5000*100/(1024*10) is 15625/320
+  while (mul && !(mul & 1) && !(div & 1)) {
+    mul>>=1;
+    div>>=1;
+  }
+  
+  uint32_t p;
+  
+  // a single 32-bit division when the product fits, 64-bit arithmetic is slow on AVR
+  if (div<0x1000000 && !__builtin_mul_overflow(sum, mul, &p) && !__builtin_add_overflow(p, n*div/2, &p))
+    return p/(n*div);
+  
+  return ((uint64_t)sum*mul+(uint64_t)n*div/2)/((uint64_t)n*div);
+}
+
+unsigned long Sensor::get_ready_time() {
+  return _ready_time;
+}
+
+void Sensor::set_ready_time(unsigned long t) {
+  _ready_time=t;
+}
+
+bool Sensor::is_ready() {
+  // works when millis() wraps around
+  return (long)(millis()-_ready_time) >= 0;
+}
+
+void Sensor::wait_ready() {
+
+#ifdef __AVR__
+  // instead of the busy loop of delay(), the CPU is stopped until the next interrupt
+  // the idle mode keeps the timer of millis(), which wakes up the CPU every ms
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  
+  while (!is_ready())
+    sleep_mode();
+#else
+  long wait=(long)(_ready_time-millis());
+  
+  if (wait>0)
+    delay(wait);
+#endif
+}
+
+void Sensor::power_on() {
+
+  // if we use a digital pin to power the sensor...
+  if (_is_connected && _is_low_power)
+    digitalWrite(_pin_power,HIGH);
+  
+  // a sensor that is not connected only has fake data
+  set_ready_time(millis()+(_is_connected ? _warmup_time : 0));
+}
+
+void Sensor::power_off() {
+
+  if (_is_connected && _is_low_power)
+    digitalWrite(_pin_power,LOW);
+}
+
+bool Sensor::read_data() {
+  return true;
+}
+
+void Sensor::update_data() {
 
-void Sensor::update_data(){
+  power_on();
+  
+  unsigned long deadline=get_ready_time()+SENSOR_READ_TIMEOUT;
   
+  do {
+    wait_ready();
+  } while (!read_data() && (long)(millis()-deadline) < 0);
+  
+  power_off();
 }
 
 double Sensor::get_value(){
   return 0.0;
 }
+
+void update_sensors(Sensor* sensors[], uint8_t n) {
+
+  // bit i is set when sensor i has been read
+  uint32_t done=0;
+  uint32_t all;
+  
+  if (n>32)
+    n=32;
+  
+  all=(n==32) ? 0xFFFFFFFF : ((uint32_t)1 << n)-1;
+  
+  unsigned long start=millis();
+  
+  for (uint8_t i=0; i<n; i++)
+    sensors[i]->power_on();
+  
+  while (done!=all) {
+  
+    int8_t next=-1;
+    
+    // the sensor that is ready first, in the order of the array for the same time
+    for (uint8_t i=0; i<n; i++)
+      if (!(done & ((uint32_t)1 << i)) && 
+          (next<0 || (long)(sensors[i]->get_ready_time()-sensors[next]->get_ready_time()) < 0))
+        next=i;
+    
+    sensors[next]->wait_ready();
+    
+    // a sensor that is still not read SENSOR_READ_TIMEOUT after its warm-up time keeps its previous data
+    if (!sensors[next]->read_data() &&
+        (long)(millis()-(start+sensors[next]->get_warmup_time()+SENSOR_READ_TIMEOUT)) < 0)
+      continue;
+    
+    done|=(uint32_t)1 << next;
+    
+    // the DHT22 or the SHT give 2 sensors on the same power pin, the last one read powers it off
+    bool shared=false;
+    
+    for (uint8_t i=0; i<n; i++)
+      if (!(done & ((uint32_t)1 << i)) && sensors[i]->get_is_connected() && sensors[i]->get_is_low_power() &&
+          sensors[i]->get_pin_power()==sensors[next]->get_pin_power())
+        shared=true;
+    
+    if (!shared)
+      sensors[next]->power_off();
+  }
+}
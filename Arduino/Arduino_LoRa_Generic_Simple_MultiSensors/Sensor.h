@@ -15,6 +15,8 @@
  #include "WProgram.h"
 #endif
 
+#include "SensorCodec.h"
+
 #define IS_ANALOG true
 #define IS_NOT_ANALOG false
 #define IS_CONNECTED true
@@ -24,6 +26,14 @@
 
 #define MAX_NOMENCLATURE_LENGTH 5
 
+// gain of 1 for set_calibration()
+#define SENSOR_GAIN_ONE 1024
+// longest string written by format_data(), without the terminating 0
+#define SENSOR_MAX_DATA_LENGTH 12
+// time in ms after the warm-up time after which a sensor whose read_data() keeps returning false
+// is left with its previous data by update_data() and update_sensors()
+#define SENSOR_READ_TIMEOUT 10000
+
 #if defined ARDUINO_AVR_PRO || defined ARDUINO_AVR_MINI || defined __MK20DX256__  || defined __MKL26Z64__ || defined __SAMD21G18A__
   // these boards work in 3.3V
   // Nexus board from Ideetron is a Mini
@@ -32,15 +42,19 @@
   // __SAMD21G18A__ is for Zero/M0 and FeatherM0 (Cortex-M0)
   #define _BOARD_MVOLT_SCALE  3300.0
   #define _BOARD_VOLT_SCALE  3.3  
+  #define _BOARD_MVOLT  3300
 #else // ARDUINO_AVR_NANO || defined ARDUINO_AVR_UNO || defined ARDUINO_AVR_MEGA2560
   // also for all other boards, so change here if required.
   #define _BOARD_MVOLT_SCALE  5000.0 
   #define _BOARD_VOLT_SCALE  5.0   
+  #define _BOARD_MVOLT  5000
 #endif
 
 class Sensor {
   public:  
     Sensor(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power, int pin_trigger=-1);
+    // the sensors are deleted through Sensor pointers
+    virtual ~Sensor() {}
     
     // getters
     //////////
@@ -53,10 +67,16 @@ class Sensor {
     int get_pin_trigger();
     //char* get_power_set();
     double get_data();       
+    // the data as an integer with get_decimals() decimals, e.g. 2351 for 23.51 with 2 decimals
+    int32_t get_fixed_data();
+    // 10^get_decimals()
+    uint32_t get_scale();
     uint16_t get_warmup_time();
     bool has_fake_data();
     bool has_pin_trigger();
     uint8_t get_n_sample();
+    uint8_t get_field_id();
+    uint8_t get_decimals();
         
     //setters
     /////////
@@ -68,13 +88,47 @@ class Sensor {
     void set_pin_trigger(int u);    
     //void set_power_set(char* c);
     void set_data(double d);      
+    // same as set_data() without floating point
+    void set_fixed_data(int32_t v);
     void set_warmup_time(uint16_t t);
     void set_fake_data(bool b);
     void set_n_sample(uint8_t n);
+    void set_field_id(uint8_t id);
+    // set it before the first reading, the data is kept with this number of decimals
+    void set_decimals(uint8_t n);
+    // the data becomes data*gain/SENSOR_GAIN_ONE+offset, the offset has get_decimals() decimals
+    void set_calibration(int32_t offset, uint16_t gain=SENSOR_GAIN_ONE);
+    
+    // write the data with get_decimals() decimals, e.g. -4.05, without floating point
+    // return the length of the string, at most SENSOR_MAX_DATA_LENGTH
+    uint8_t format_data(char* buf);
+    
+    // return sum*mul/(n*div) rounded, sum being n values, e.g. n_sample analog reads
+    // the average of the n values keeps its fractional part, this is the oversampling
+    static int32_t scale_sum(uint32_t sum, uint8_t n, uint32_t mul, uint32_t div);
     
+    // write the last data read by get_value() or update_sensors() in the binary format of SensorCodec.h
+    // return the number of bytes written, at most SENSOR_CODEC_MAX_FIELD_SIZE
+    uint8_t encode_data(uint8_t* buf);
+    
+    // power the sensor, wait for the warm-up time, read and power off the sensor
+    // update_sensors() does the same steps for all the sensors at the same time
     virtual void update_data();
     virtual double get_value();
     
+    // power the sensor if it is low power, it can be read at get_ready_time()
+    virtual void power_on();
+    // read the sensor, which is powered and ready, and set the data
+    // return false if it must be called again at the new get_ready_time(), e.g. after a conversion,
+    // it is not called again after SENSOR_READ_TIMEOUT
+    virtual bool read_data();
+    void power_off();
+    unsigned long get_ready_time();
+    void set_ready_time(unsigned long t);
+    bool is_ready();
+    // wait until the sensor is ready, the CPU sleeps in idle mode on the AVR boards
+    void wait_ready();
+    
   private:
   	char _nomenclature[MAX_NOMENCLATURE_LENGTH+1];
     bool _is_analog;
@@ -85,10 +139,24 @@ class Sensor {
     int _pin_trigger;
     bool _with_fake_data;
     //char* _power_set = NULL;
-    double _data;       
+    // with _decimals decimals, floating point is slow on AVR
+    int32_t _data;       
     // delay in ms before reading data, sensor is powered
     uint16_t _warmup_time;
     uint8_t _n_sample;
+    // id in the SensorCodec schema, found from the nomenclature
+    uint8_t _field_id;
+    // number of decimals kept in the binary format
+    uint8_t _decimals;
+    int32_t _offset;
+    uint16_t _gain;
+    // millis() at which read_data() can be called
+    unsigned long _ready_time;
 };
 
+// power all the sensors, then read each one as soon as it is ready so that the warm-up times overlap:
+// it takes the longest warm-up time instead of their sum, for at most 32 sensors
+// a sensor is powered off when it has been read or has timed out, unless an unread sensor has the same power pin
+void update_sensors(Sensor* sensors[], uint8_t n);
+
 #endif
@@ -8,12 +8,12 @@
 #define TMP36_H
 #include "Sensor.h"
 
-#define TEMP_SCALE _BOARD_MVOLT_SCALE 
+#define TEMP_SCALE _BOARD_MVOLT
 
 class TMP36 : public Sensor {
   public:    
     TMP36(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power);
-    void update_data();
+    bool read_data();
     double get_value();
 };
 
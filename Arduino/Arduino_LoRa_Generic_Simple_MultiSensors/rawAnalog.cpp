@@ -22,41 +22,30 @@ rawAnalog::rawAnalog(char* nomenclature, bool is_analog, bool is_connected, bool
   }
 }
 
-void rawAnalog::update_data()
+bool rawAnalog::read_data()
 {	
   if (get_is_connected()) {
   	
-    int aux_value = 0;
-    int value = 0;
-    
-    // if we use a digital pin to power the sensor...
-    if (get_is_low_power())
-    	digitalWrite(get_pin_power(),HIGH);
+    uint32_t value = 0;
     	
-    // wait
-    delay(get_warmup_time());
-   
     for(int i=0; i<get_n_sample(); i++) {
     	
-    	if (get_is_analog()) {
-        	aux_value = analogRead(get_pin_read());
-      	}
+    	if (get_is_analog())
+        	value += analogRead(get_pin_read());
     
-        value += aux_value;
         delay(10);
 	}
 	
-    if (get_is_low_power())        
-        digitalWrite(get_pin_power(),LOW);
-        
     // getting the average
-    set_data(value/(double)get_n_sample());        
+    set_fixed_data(scale_sum(value, get_n_sample(), get_scale(), 1));        
   }
   else {
   		// if not connected, set a random value (for testing)  	
   		if (has_fake_data())
-    		set_data((double)random(0,1024));
+    		set_fixed_data(random(0,1024)*get_scale());
   }
+
+  return true;
 }
 
 double rawAnalog::get_value()
@@ -8,12 +8,12 @@
 #define RAWANALOG_H
 #include "Sensor.h"
 
-#define RAWANALOG_SCALE _BOARD_MVOLT_SCALE
+#define RAWANALOG_SCALE _BOARD_MVOLT
 
 class rawAnalog : public Sensor {
   public:    
     rawAnalog(char* nomenclature, bool is_analog, bool is_connected, bool is_low_power, uint8_t pin_read, uint8_t pin_power);
-    void update_data();
+    bool read_data();
     double get_value();
 };
 
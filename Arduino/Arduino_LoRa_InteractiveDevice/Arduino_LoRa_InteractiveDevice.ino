@@ -18,7 +18,7 @@
  *
  ***************************************************************************** 
  * 
- *  Version:                1.8a
+ *  Version:                1.9
  *  Design:                 C. Pham
  *  Implementation:         C. Pham
  *
@@ -87,6 +87,11 @@
 */
 
 /*  Change logs
+ *  Oct, 19th, 2026. v1.9
+ *        Add a wake-on-radio mode, uncomment #define WAKE_ON_RADIO. Change value of WAKE_ON_RADIO to the CAD period in ms
+ *          - instead of the receive window, the device performs one CAD every WAKE_ON_RADIO ms with sx1272.wakeOnRadio()
+ *            and the MCU and the radio module sleep in between
+ *          - the gateway reaches the device with a long preamble: add "wor" : WAKE_ON_RADIO to the downlink request
  *  Feb, 1st, 2019. v1.8a 
  *        Add support of a small OLED screen in both CAD_TEST and PERIODIC_SENDER mode
  *  June, 29th, 2017. v1.8
@@ -246,6 +251,11 @@
 //#define SHOW_FREEMEMORY
 //#define CAD_TEST
 //#define PERIODIC_SENDER 35000
+// CAD period in ms, on AVR it is one of 250, 500, 1000, 2000, 4000 or 8000 (watchdog timer)
+// commands from the serial port are not read while the MCU sleeps
+//#define WAKE_ON_RADIO 2000
+// the MCU also sleeps until CadDone and RxDone with DIO0 wired to a pin with an interrupt
+//#define DIO0_PIN 2
 //#define LORA_LAS
 //#define WITH_SEND_LED
 #define WITH_AES
@@ -375,6 +385,24 @@ uint32_t loraChannelArray[MAX_NB_CHANNEL]={CH_00_433,CH_01_433,CH_02_433,CH_03_4
 // to unlock remote configuration feature
 #define UNLOCK_PIN 1234
 
+#if defined WAKE_ON_RADIO && defined __AVR__
+#include "LowPower.h"
+
+#if WAKE_ON_RADIO >= 8000
+#define WOR_SLEEP SLEEP_8S
+#elif WAKE_ON_RADIO >= 4000
+#define WOR_SLEEP SLEEP_4S
+#elif WAKE_ON_RADIO >= 2000
+#define WOR_SLEEP SLEEP_2S
+#elif WAKE_ON_RADIO >= 1000
+#define WOR_SLEEP SLEEP_1S
+#elif WAKE_ON_RADIO >= 500
+#define WOR_SLEEP SLEEP_500MS
+#else
+#define WOR_SLEEP SLEEP_250MS
+#endif
+#endif
+
 #ifdef LORA_LAS
 #include "LoRaActivitySharing.h"
 // acting as an end-device
@@ -1079,6 +1107,10 @@ void setup()
   PRINT_VALUE("%d", e);
   PRINTLN;
 
+#ifdef DIO0_PIN
+  sx1272.setDIO0Pin(DIO0_PIN);
+#endif
+
   e = sx1272.getSyncWord();
 
   if (!e) {
@@ -1379,6 +1411,19 @@ void loop(void)
       // INIT & UPDT messages
       e=1;
 #ifndef CAD_TEST        
+#ifdef WAKE_ON_RADIO
+      // one CAD, a packet is received only when the gateway sends it with a long preamble
+      e = sx1272.wakeOnRadio(WAKE_ON_RADIO);
+
+      if (e) {
+        FLUSHOUTPUT;
+#ifdef __AVR__
+        LowPower.powerDown(WOR_SLEEP, ADC_OFF, BOD_OFF);
+#else
+        delay(WAKE_ON_RADIO);
+#endif
+      }
+#else
       // open a receive window
       uint16_t w_timer=1000;
       
@@ -1386,6 +1431,7 @@ void loop(void)
         w_timer=2500;
         
       e = sx1272.receivePacketTimeout(w_timer);
+#endif
 #endif 
 ///////////////////////////////////////////////////////////////////
 
@@ -18,7 +18,7 @@
  *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
  *
  *****************************************************************************
- * last update: March 26th, 2019 by C. Pham
+ * last update: Oct 19th, 2026 by C. Pham
  * 
  * This version uses the same structure than the Arduino_LoRa_Demo_Sensor where
  * the sensor-related code is in a separate file
@@ -71,6 +71,16 @@
 //#define WITH_ACK
 //this will enable a receive window after every transmission
 //#define WITH_RCVW
+//if DIO0 and DIO1 of the radio module are wired to pins with an external interrupt, the MCU sleeps
+//while a packet is sent and during the receive window instead of polling the radio module
+//#define DIO0_PIN 2
+//#define DIO1_PIN 3
+//this will keep the readings and send them by 6 in the binary format of SensorCodec.h
+//only with the native packet format and without encryption, see below
+//#define BATCH_SAMPLES 6
+//this will replace the loop of 8s sleeps by the SleepScheduler library, which chains the longest
+//sleeps of the board and corrects the drift of the watchdog oscillator on AVR
+//#define SLEEP_SCHEDULER
 ///////////////////////////////////////////////////////////////////
 
 ///////////////////////////////////////////////////////////////////
@@ -84,6 +94,15 @@
 #endif
 ///////////////////////////////////////////////////////////////////
 
+#ifndef LOW_POWER
+#undef SLEEP_SCHEDULER
+#endif
+
+// the gateway decodes the binary payload, it cannot when the post-processing stage decrypts it
+#if defined BATCH_SAMPLES && (defined WITH_AES || defined WITH_LSC || defined LORAWAN)
+#error "BATCH_SAMPLES needs the native packet format without encryption"
+#endif
+
 // IMPORTANT SETTINGS
 ///////////////////////////////////////////////////////////////////
 // please uncomment only 1 choice
@@ -253,6 +272,30 @@ uint8_t LSC_Nonce[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB,
 uint8_t message[80];
 ///////////////////////////////////////////////////////////////////
 
+#ifdef SLEEP_SCHEDULER
+#include "SleepScheduler.h"
+
+// its clock counts the time in low power mode
+SleepScheduler scheduler;
+#endif
+
+#ifdef BATCH_SAMPLES
+#include "SensorCodec.h"
+
+// the RAM is kept in low power mode so the readings wait here for the next transmission
+sensorCodecBatch batch;
+// millis() does not count the time in low power mode
+unsigned long sleptTime=0;
+
+unsigned long sampleTime() {
+#ifdef SLEEP_SCHEDULER
+  return scheduler.now()/1000;
+#else
+  return sleptTime+millis()/1000;
+#endif
+}
+#endif
+
 /*****************************
  _____           _      
 /  __ \         | |     
@@ -508,6 +551,13 @@ void setup()
   // Power ON the module
   sx1272.ON();
 
+#ifdef DIO0_PIN
+  sx1272.setDIO0Pin(DIO0_PIN);
+#endif
+#ifdef DIO1_PIN
+  sx1272.setDIO1Pin(DIO1_PIN);
+#endif
+
 #ifdef WITH_EEPROM
   // get config from EEPROM
   EEPROM.get(0, my_sx1272config);
@@ -660,6 +710,17 @@ void setup()
   LSC_session_init();
 #endif
   
+#ifdef BATCH_SAMPLES
+  sensorCodecBatchInit(&batch);
+#endif
+
+#ifdef SLEEP_SCHEDULER
+  // calibrates the watchdog on AVR, the first transmission is in loop()
+  scheduler.begin();
+  // plus up to 16s to avoid collision, as the 2 or 3 additional cycles of the loop of 8s sleeps
+  scheduler.setTask(0, (unsigned long)idlePeriodInMin*60*1000, (unsigned long)idlePeriodInMin*60*1000, 16000);
+#endif
+  
   // Print a success message
   PRINT_CSTSTR("%s","SX1272 successfully configured\n");
 
@@ -724,6 +785,19 @@ void loop(void)
 
       //for testing
       //temp = 22.5;
+
+#ifdef BATCH_SAMPLES
+      // 2 decimals as with the text format, rounded to the nearest
+      sensorCodecBatchSample(&batch, sampleTime());
+      sensorCodecBatchPut(&batch, sensorCodecFieldId(nomenclature_str), nomenclature_str, (int32_t)(temp*100.0+(temp<0 ? -0.5 : 0.5)), 2);
+
+      PRINT_CSTSTR("%s","Samples in batch ");
+      PRINT_VALUE("%d", batch.n);
+      PRINTLN;
+
+      // the radio is only used for one packet every BATCH_SAMPLES readings
+      if (batch.n>=BATCH_SAMPLES || sensorCodecBatchFull(&batch)) {
+#endif
       
 #if defined WITH_APPKEY && not defined LORAWAN
       app_key_offset = sizeof(my_appKey);
@@ -733,6 +807,12 @@ void loop(void)
 
       uint8_t r_size;
 
+#ifdef BATCH_SAMPLES
+      r_size=sensorCodecBatchEnd(&batch, sampleTime(), message+app_key_offset);
+      sensorCodecBatchInit(&batch);
+      
+      PRINT_CSTSTR("%s","Sending batch of samples\n");
+#else
       // the recommended format if now \!TC/22.5
 #ifdef STRING_LIB
       r_size=sprintf((char*)message+app_key_offset,"\\!%s/%s",nomenclature_str,String(temp).c_str());
@@ -751,6 +831,7 @@ void loop(void)
       PRINT_CSTSTR("%s","Sending ");
       PRINT_STR("%s",(char*)(message+app_key_offset));
       PRINTLN;
+#endif
       
       PRINT_CSTSTR("%s","Real payload size is ");
       PRINT_VALUE("%d", r_size);
@@ -758,7 +839,11 @@ void loop(void)
       
       int pl=r_size+app_key_offset;
 
+#ifdef BATCH_SAMPLES
+      uint8_t p_type=PKT_TYPE_DATA_BIN;
+#else
       uint8_t p_type=PKT_TYPE_DATA;
+#endif
       
 #if defined WITH_AES || defined WITH_LSC
       // indicate that payload is encrypted
@@ -1178,6 +1263,10 @@ void loop(void)
                       PRINT_VALUE("%d", idlePeriodInMin);  
                       PRINTLN;         
 
+#ifdef SLEEP_SCHEDULER
+                      scheduler.setTask(0, (unsigned long)idlePeriodInMin*60*1000, (unsigned long)idlePeriodInMin*60*1000, 16000);
+#endif
+
 #ifdef WITH_EEPROM
                       // save new node_addr in case of reboot
                       my_sx1272config.idle_period=idlePeriodInMin;
@@ -1205,6 +1294,10 @@ void loop(void)
         PRINT_CSTSTR("%s","No packet\n");
 #endif
 
+#ifdef BATCH_SAMPLES
+      }
+#endif
+
 #if defined LOW_POWER && not defined _VARIANT_ARDUINO_DUE_X_
       PRINT_CSTSTR("%s","Switch to power saving mode\n");
 
@@ -1218,7 +1311,12 @@ void loop(void)
       FLUSHOUTPUT
       delay(50);
       
-#ifdef __SAMD21G18A__
+#ifdef SLEEP_SCHEDULER
+      // until the next transmission, from the schedule
+      scheduler.sleep();
+      PRINT_CSTSTR("%s","Wakes up from the sleep scheduler\n");
+      FLUSHOUTPUT
+#elif defined __SAMD21G18A__
       // For Arduino M0 or Zero we use the built-in RTC
       rtc.setTime(17, 0, 0);
       rtc.setDate(1, 1, 2000);
@@ -1231,14 +1329,18 @@ void loop(void)
       
       LowPower.standby();
 
+#ifdef BATCH_SAMPLES
+      sleptTime+=idlePeriodInMin*60;
+#endif
       PRINT_CSTSTR("%s","SAMD21G18A wakes up from standby\n");      
       FLUSHOUTPUT
 #else
       nCycle = idlePeriodInMin*60/LOW_POWER_PERIOD + random(2,4);
 
 #if defined __MK20DX256__ || defined __MKL26Z64__ || defined __MK64FX512__ || defined __MK66FX1M0__
+      uint16_t sleepPeriod=LOW_POWER_PERIOD*1000 + random(1,5)*1000;
       // warning, setTimer accepts value from 1ms to 65535ms max
-      timer.setTimer(LOW_POWER_PERIOD*1000 + random(1,5)*1000);// milliseconds
+      timer.setTimer(sleepPeriod);// milliseconds
 
       nCycle = idlePeriodInMin*60/LOW_POWER_PERIOD;
 #endif
@@ -1248,12 +1350,18 @@ void loop(void)
 #if defined ARDUINO_AVR_PRO || defined ARDUINO_AVR_NANO || defined ARDUINO_AVR_UNO || defined ARDUINO_AVR_MINI || defined __AVR_ATmega32U4__         
           // ATmega328P, ATmega168, ATmega32U4
           LowPower.powerDown(SLEEP_8S, ADC_OFF, BOD_OFF);
+#ifdef BATCH_SAMPLES
+          sleptTime+=LOW_POWER_PERIOD;
+#endif
           
           //LowPower.idle(SLEEP_8S, ADC_OFF, TIMER2_OFF, TIMER1_OFF, TIMER0_OFF, 
           //              SPI_OFF, USART0_OFF, TWI_OFF);
 #elif defined ARDUINO_AVR_MEGA2560
           // ATmega2560
           LowPower.powerDown(SLEEP_8S, ADC_OFF, BOD_OFF);
+#ifdef BATCH_SAMPLES
+          sleptTime+=LOW_POWER_PERIOD;
+#endif
           
           //LowPower.idle(SLEEP_8S, ADC_OFF, TIMER5_OFF, TIMER4_OFF, TIMER3_OFF, 
           //      TIMER2_OFF, TIMER1_OFF, TIMER0_OFF, SPI_OFF, USART3_OFF, 
@@ -1265,6 +1373,9 @@ void loop(void)
 #else            
           Snooze.deepSleep(sleep_config);
 #endif  
+#ifdef BATCH_SAMPLES
+          sleptTime+=sleepPeriod/1000;
+#endif
 #else
           // use the delay function
           delay(LOW_POWER_PERIOD*1000);
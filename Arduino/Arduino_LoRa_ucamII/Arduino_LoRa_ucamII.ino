@@ -30,7 +30,7 @@
  *  IMPORTANT: change FINAL_DEST_MAC_ADDR (XBee 802.15.4) or LORA_DEST_ADDR (default is 1) according to the address of your receiving gateway
  *             or change it at run time by issuing a "/@D" command
  *
- *  Version:                1.8
+ *  Version:                1.9
  *  Design:                 C. Pham
  *  Implementation:         C. Pham
  *
@@ -93,6 +93,26 @@
  */
 
 /*  Change logs
+ *  Oct, 19th, 2026. v1.9
+ *        Add STRIP_ENCODING: the image is read and encoded 8 lines at a time, the quantized blocks are kept
+ *          run-length coded for the interleaved packets, see jpeg_strip.h. No inImage array
+ *        PERIODIC_IMG_TRANSMIT reads the raw data of the new image before encoding it
+ *        Add CONDITIONAL_REPLENISHMENT: on intrusion, only the 8x8 blocks that changed from the reference
+ *          image (SAD above BLOCK_SAD_THRES) are sent, and the reference image is updated with these blocks.
+ *          decode_to_bmp puts them in the previous image of the camera
+ *        Add PROGRESSIVE_ENCODING: the DC coefficients of all the blocks are sent first, then 4 bands of AC
+ *          coefficients, the scan is in bits 12-14 of the packet offset. decode_to_bmp keeps the other bands
+ *        Add LIMIT_TOA: sx1272.limitToA() is called and SendPacket() stops the image at the first packet
+ *          that does not fit in getRemainingToA()
+ *        Add WITH_FEC: FEC_PARITY_PACKETS Reed-Solomon parity packets after each group of FEC_GROUP_SIZE
+ *          image packets, see packet_fec.h. decode_to_bmp recovers the lost packets of each group
+ *        The DCT and the quantization are moved in jpeg_dct.h of the uCam library
+ *        Add FIXED_POINT_DCT: the quantization multiplies by reciprocals computed by QTinitialization()
+ *          instead of a float division and round(), and the old CRAN encoding uses a 32-bit integer DCT
+ *        Add RATE_CONTROL: the quality factor and the MSS of each image are computed from the LoRa mode so that
+ *          the image fits in RATE_TARGET_TOA and the remaining time on air, see jpeg_rate.h
+ *        FillPacket() stops a block that does not fit in the packet before going past the MQC_NUMCTXS bytes of buffer,
+ *          as with high quality factors
  *  June, 29th, 2017. v1.8
  *        Add CarrierSense selection method to perform tests
  *          - CarrierSense0 does nothing -> pure ALOHA
@@ -303,6 +323,26 @@
 #define USEREFIMAGE
 // use the new image encoding scheme, DO NOT CHANGE
 #define CRAN_NEW_CODING
+// no float operation in the DCT and the quantization, see jpeg_dct.h in the uCam library
+#define FIXED_POINT_DCT
+// read and encode the image 8 lines at a time, without the inImage array, see jpeg_strip.h in the uCam library
+// the quantized blocks are kept in STRIP_STORE_SIZE bytes, only without reference image
+//#define STRIP_ENCODING
+// on intrusion, only send the 8x8 blocks that changed from the reference image, see jpeg_replenish.h in the uCam library
+// the gateway puts them in its previous image of the camera, needs a reference image
+//#define CONDITIONAL_REPLENISHMENT
+// send the DC coefficients of all the blocks first, then the bands of AC coefficients, a partially received image
+// is a coarse image instead of an image with missing blocks
+//#define PROGRESSIVE_ENCODING
+// duty-cycle limitation of the SX1272 library (MAX_DUTY_CYCLE_PER_HOUR), the image stops at the first packet that
+// does not fit in the remaining time on air, better with PROGRESSIVE_ENCODING
+//#define LIMIT_TOA
+// send Reed-Solomon parity packets after each group of image packets, the gateway recovers the lost packets of the
+// group, see packet_fec.h in the uCam library
+//#define WITH_FEC
+// the quality factor and the MSS of each image are computed for the LoRa mode, the image fits in RATE_TARGET_TOA
+// and getRemainingToA(), see jpeg_rate.h in the uCam library. Replaces the quality factor of the commands
+//#define RATE_CONTROL
 //#define QUALITY_TEST
 #define DISPLAY_PKT
 //#define DISPLAY_FILLPKT
@@ -347,6 +387,59 @@
 ////////////////////////////////////////////////////////
 #define SHORT_COMPUTATION
 
+#if defined STRIP_ENCODING && (defined USEREFIMAGE || defined QUALITY_TEST || not defined CRAN_NEW_CODING)
+#undef STRIP_ENCODING
+#endif
+
+#if defined CONDITIONAL_REPLENISHMENT && (not defined USEREFIMAGE || not defined CRAN_NEW_CODING)
+#undef CONDITIONAL_REPLENISHMENT
+#endif
+
+#if defined PROGRESSIVE_ENCODING && (defined CONDITIONAL_REPLENISHMENT || not defined CRAN_NEW_CODING)
+#undef PROGRESSIVE_ENCODING
+#endif
+
+#if defined LIMIT_TOA && not defined LORA_UCAM
+#undef LIMIT_TOA
+#endif
+
+#if defined WITH_FEC && not defined CRAN_NEW_CODING
+#undef WITH_FEC
+#endif
+
+#if defined RATE_CONTROL && (not defined LORA_UCAM || not defined CRAN_NEW_CODING || defined STRIP_ENCODING || defined QUALITY_TEST)
+#undef RATE_CONTROL
+#endif
+
+#ifdef RATE_CONTROL
+// time on air in ms of an image, the 1% duty-cycle of an hour
+#define RATE_TARGET_TOA 36000L
+#endif
+
+#ifdef WITH_FEC
+// any 8 of the 10 packets give back the group, i.e. 25% more packets
+#define FEC_GROUP_SIZE 8
+#define FEC_PARITY_PACKETS 2
+#endif
+
+#ifdef CONDITIONAL_REPLENISHMENT
+// a block has changed when the sum of its 64 pixel differences is above, i.e. 8 per pixel on average
+#define BLOCK_SAD_THRES 512
+// the whole image when more than 50% of the blocks have changed
+#define CR_MAX_CHANGED 50
+// and after 10 images with the changed blocks only, in case the gateway missed packets
+#define CR_FULL_IMAGE_PERIOD 10
+#endif
+
+#ifdef STRIP_ENCODING
+// about 7.5KB at Q=50 and 2.6KB at Q=10 for a 128x128 image
+#define STRIP_STORE_SIZE 8192
+// these ones need the inImage array
+#undef LUM_HISTO
+#undef DISPLAY_PGM
+#undef DISPLAY_BLOCK
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 // END of compilation #define statements
@@ -1143,191 +1236,100 @@ void CarrierSense3() {
 }
 #endif
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////
-// NEW CRAN ENCODING, WITH PACKET CREATION ON THE FLY
-///////////////////////////////////////////////////////////////////////////////////////////////////////////
-#ifdef CRAN_NEW_CODING
+// the DCT and the quantization of the new and old CRAN encoding
+#include "jpeg_dct.h"
 
-float CordicLoefflerScalingFactor[8]={0.35355339, 0.35355339, 0.31551713, 0.5, 0.35355339, 0.5, 0.31551713, 0.35355339};
-
-short OriginalLuminanceJPEGTable[8][8] = {
-  16,  11,  10,  16,  24,  40,  51,  61,
-  12,  12,  14,  19,  26,  58,  60,  55,
-  14,  13,  16,  24,  40,  57,  69,  56,
-  14,  17,  22,  29,  51,  87,  80,  62,
-  18,  22,  37,  56,  68, 109, 103,  77,
-  24,  35,  55,  64,  81, 104, 113,  92,
-  49,  64,  78,  87, 103, 121, 120, 101,
-  72,  92,  95,  98, 112, 100, 103,  99
-};
-
-short LuminanceJPEGTable[8][8] = {
-  16,  11,  10,  16,  24,  40,  51,  61,
-  12,  12,  14,  19,  26,  58,  60,  55,
-  14,  13,  16,  24,  40,  57,  69,  56,
-  14,  17,  22,  29,  51,  87,  80,  62,
-  18,  22,  37,  56,  68, 109, 103,  77,
-  24,  35,  55,  64,  81, 104, 113,  92,
-  49,  64,  78,  87, 103, 121, 120, 101,
-  72,  92,  95,  98, 112, 100, 103,  99
-};
+#ifdef STRIP_ENCODING
+#include "jpeg_strip.h"
+#endif
 
-opj_mqc_t mqobjet, mqbckobjet, *objet=NULL;
-uint8_t buffer[MQC_NUMCTXS], bckbuffer[MQC_NUMCTXS];
-uint8_t packet[MQC_NUMCTXS];
-int packetsize, packetoffset, buffersize;
+#ifdef CONDITIONAL_REPLENISHMENT
+#include "jpeg_replenish.h"
+
+// only the changed blocks are encoded
+boolean replenishing=false;
+// the last encoded image has been transmitted
+boolean lastImageSent=false;
+// the gateway has the reference image of the camera
+boolean gwHasRefImage[NB_UCAM];
+// images sent with the changed blocks only since the last whole image
+uint8_t crImageCount[NB_UCAM];
+#endif
 
-void QTinitialization(int Quality)
-{
- float Qs, scale;
+#ifdef PROGRESSIVE_ENCODING
+#define PROGRESSIVE_SCANS 5
+// scan n has the coefficients ProgressiveBands[n-1] to ProgressiveBands[n]-1 in zig-zag order
+const uint8_t ProgressiveBands[PROGRESSIVE_SCANS+1]={0, 1, 6, 15, 28, 64};
+// 0 for the whole blocks, in bits 12-14 of the offset of the packets
+uint8_t scanNumber=0;
+// blocks in the packet, its first byte
+uint8_t packetBlocks=0;
+#endif
 
- if (Quality <= 0)  Quality = 1;
- if (Quality > 100) Quality = 100;
- if (Quality < 50)   Qs = 50.0 / (float) Quality;
- 	else	     Qs = 2.0 - (float) Quality/50.0;
+#ifdef LIMIT_TOA
+// the remaining time on air does not allow the next packet of the image
+boolean toaExhausted=false;
+#endif
 
- // Calcul des coefficients de la table de quantification
- for (int u=0; u<8; u++)
-   for (int v=0; v<8; v++)
-	{
-	 scale = (float) OriginalLuminanceJPEGTable[u][v] * Qs;
+#ifdef WITH_FEC
+#include "packet_fec.h"
 
-	 if (scale < 1.0) scale=1.0;
+// the parity packets are not added to the group
+boolean sendingParity=false;
+#endif
 
-	 LuminanceJPEGTable[u][v] = (short) round (scale / (CordicLoefflerScalingFactor[u]*CordicLoefflerScalingFactor[v]));
-	}
+#ifdef RATE_CONTROL
+#include "jpeg_rate.h"
 
- return;
+uint16_t rateToA(uint8_t pl) {
+    return sx1272.getToA(pl);
 }
 
-void JPEGencoding(int Block[8][8])
-{
- int tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
- int tmp10, tmp11, tmp12, tmp13, tmp20, tmp23;
- int z11, z12, z21, z22;
- 
-    // On calcule la DCT, puis on quantifie
-    for (int u=0; u<8; u++)
-      {
-       tmp0=Block[u][0]+Block[u][7];
-       tmp7=Block[u][0]-Block[u][7];
-       tmp1=Block[u][1]+Block[u][6];
-       tmp6=Block[u][1]-Block[u][6];
-       tmp2=Block[u][2]+Block[u][5];
-       tmp5=Block[u][2]-Block[u][5];
-       tmp3=Block[u][3]+Block[u][4];
-       tmp4=Block[u][3]-Block[u][4];
-       
-       tmp10=tmp0+tmp3;
-       tmp13=tmp0-tmp3;
-       tmp11=tmp1+tmp2;
-       tmp12=tmp1-tmp2;
-
-       Block[u][0]=tmp10+tmp11;
-       Block[u][4]=tmp10-tmp11;
-       z11=tmp13+tmp12;	
-       z12=tmp13-tmp12;
-       z21=z11+(z12>>1);
-       z22=z12-(z11>>1);
-       Block[u][2]=z21-(z22>>4);
-       Block[u][6]=z22+(z21>>4);
-
-       z11=tmp4+(tmp7>>1);
-       z12=tmp7-(tmp4>>1);
-       z21=z11+(z12>>3);
-       z22=z12-(z11>>3);
-       z21=z21-(z21>>3);
-       z22=z22-(z22>>3);
-       tmp10=z21+(z21>>6);
-       tmp13=z22+(z22>>6);
-       z11=tmp5+(tmp6>>3);
-       z12=tmp6-(tmp5>>3);
-       tmp11=z11+(z12>>4);
-       tmp12=z12-(z11>>4);
-
-       tmp20=tmp10+tmp12;
-       Block[u][5]=tmp10-tmp12;
-       tmp23=tmp13+tmp11;
-       Block[u][3]=tmp13-tmp11;
-       Block[u][1]=tmp23+tmp20;
-       Block[u][7]=tmp23-tmp20;
-    }		
-
-    // On attaque ensuite colonne par colonne
-    for (int v=0; v<8; v++)
-      {
-       // 1Ëre Ètape
-       tmp0= Block[0][v]+Block[7][v];
-       tmp7= Block[0][v]-Block[7][v];
-       tmp1= Block[1][v]+Block[6][v];
-       tmp6= Block[1][v]-Block[6][v];
-       tmp2= Block[2][v]+Block[5][v];
-       tmp5= Block[2][v]-Block[5][v];
-       tmp3= Block[3][v]+Block[4][v];
-       tmp4= Block[3][v]-Block[4][v];
-
-       tmp10=tmp0+tmp3;
-       tmp13=tmp0-tmp3;
-       tmp11=tmp1+tmp2;
-       tmp12=tmp1-tmp2;
-
-       Block[0][v]=tmp10+tmp11;
-       Block[4][v]=tmp10-tmp11;
-       z11=tmp13+tmp12;	
-       z12=tmp13-tmp12;
-       z21=z11+(z12>>1);
-       z22=z12-(z11>>1);
-       Block[2][v]=z21-(z22>>4);
-       Block[6][v]=z22+(z21>>4);
-
-       z11=tmp4+(tmp7>>1);
-       z12=tmp7-(tmp4>>1);
-       z21=z11+(z12>>3);
-       z22=z12-(z11>>3);
-       z21=z21-(z21>>3);
-       z22=z22-(z22>>3);
-
-       tmp10=z21+(z21>>6);
-       tmp13=z22+(z22>>6);
-       z11=tmp5+(tmp6>>3);
-       z12=tmp6-(tmp5>>3);
-       tmp11=z11+(z12>>4);
-       tmp12=z12-(z11>>4);
-
-       tmp20=tmp10+tmp12;
-       Block[5][v]=tmp10-tmp12;
-       tmp23=tmp13+tmp11;
-       Block[3][v]=tmp13-tmp11;
-       Block[1][v]=tmp23+tmp20;
-       Block[7][v]=tmp23-tmp20;
-    }
+// the quality factor and the MSS of the image for the LoRa mode and the remaining time on air
+void rateControl() {
+    long target=sx1272.getRemainingToA();
+    long startRateTime=millis();
 
-    // on centre sur l'interval [-128, 127]
-    Block[0][0]-=8192;
+    if (target > RATE_TARGET_TOA)
+        target=RATE_TARGET_TOA;
 
-    // Quantification
-#ifdef DISPLAY_BLOCK
-    Serial.println(F("JPEGencoding:"));
-    
-    for (int u=0; u<8; u++) {
-       for (int v=0; v<8; v++) {
-          Block[u][v] = (int)round((float)Block[u][v] / (float)LuminanceJPEGTable[u][v]);
-
-          Serial.print(Block[u][v]);
-          Serial.print(F("\t"));
-       }   
-       Serial.println("");
-    }   
-#else
+    // the estimate can be a few % above the packets of the image
+    target-=target/16;
 
-    for (int u=0; u<8; u++)
-       for (int v=0; v<8; v++)
-	   Block[u][v] = (int)round((float)Block[u][v] / (float)LuminanceJPEGTable[u][v]);
+    if (target < 0)
+        target=0;
 
+    RateToA=rateToA;
+    RateOverhead=(with_framing_bytes ? sizeof(pktPreamble) : 0) + OFFSET_PAYLOADLENGTH;
+#ifdef WITH_FEC
+    RateFECgroupSize=FEC_GROUP_SIZE;
+    RateFECparity=FEC_PARITY_PACKETS;
 #endif
 
-   return;
+    QualityFactor[currentCam]=RateControl(&inImage, target, DEFAULT_LORA_MSS);
+    MSS=RateMSS;
+
+    Serial.print(F("Rate control for "));
+    Serial.print(target);
+    Serial.print(F("ms: "));
+    Serial.print(RateEstimatedBytes);
+    Serial.print(F("B in "));
+    Serial.print(RateEstimatedToA);
+    Serial.print(F("ms, "));
+    Serial.print(millis()-startRateTime);
+    Serial.println(F("ms"));
 }
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// NEW CRAN ENCODING, WITH PACKET CREATION ON THE FLY
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef CRAN_NEW_CODING
+
+opj_mqc_t mqobjet, mqbckobjet, *objet=NULL;
+uint8_t buffer[MQC_NUMCTXS], bckbuffer[MQC_NUMCTXS];
+uint8_t packet[MQC_NUMCTXS];
+int packetsize, packetoffset, buffersize;
 
 void CreateNewPacket(unsigned int BlockOffset)
 {
@@ -1339,6 +1341,14 @@ void CreateNewPacket(unsigned int BlockOffset)
    mqc_init_enc(objet, buffer);
    mqc_resetstates(objet);
    packetoffset = BlockOffset;
+#ifdef CONDITIONAL_REPLENISHMENT
+   if (replenishing)
+     packetoffset |= CR_PACKET_FLAG;
+#endif
+#ifdef PROGRESSIVE_ENCODING
+   packetoffset |= scanNumber << 12;
+   packetBlocks = 0;
+#endif
    packetsize = 0;
    mqc_backup(objet, &mqbckobjet, bckbuffer);
    mqc_flush(objet);
@@ -1349,6 +1359,19 @@ void SendPacket()
    if (packetsize == 0) 
      return;
 
+#ifdef LIMIT_TOA
+   // the next packets of the image are not sent either, with PROGRESSIVE_ENCODING the gateway has a coarse image
+   if (toaExhausted || sx1272.getRemainingToA() < 
+       sx1272.getToA((with_framing_bytes ? sizeof(pktPreamble) : 0) + 2 + packetsize + OFFSET_PAYLOADLENGTH)) {
+     if (!toaExhausted) {
+       Serial.print(F("Not enough ToA, image stopped at packet "));
+       Serial.println(packetcount);
+     }
+     toaExhausted=true;
+     return;
+   }
+#endif
+
 #ifdef DISPLAY_PKT     
    Serial.print(F("00"));
    Serial.print(packetsize + 2, HEX);
@@ -1554,38 +1577,118 @@ void SendPacket()
 #endif        
    }   
 
+#ifdef WITH_FEC
+   if (!sendingParity)
+#endif
    count += packetsize;
    packetcount++;
+
+#ifdef WITH_FEC
+   // the parity packets follow the last packet of the group
+   if (!sendingParity && FECaddPacket(packetoffset, packet, packetsize))
+     SendParityPackets();
+#endif
+}
+
+#ifdef WITH_FEC
+void SendParityPackets()
+{
+   uint16_t offset;
+
+   sendingParity=true;
+
+   for (uint8_t j=0; j<FEC_PARITY_PACKETS; j++) {
+     packetsize=FECparityPacket(j, packet, &offset);
+     packetoffset=offset;
+     SendPacket();
+   }
+
+   sendingParity=false;
+   // the caller creates a new packet
+   packetsize=0;
+   FECgroup++;
+   FECbegin();
+}
+#endif
+
+// Golomb code of q ones, a zero and r. Returns false as soon as the packet has more than room bytes: a block
+// at a high quality factor can take more than the MQC_NUMCTXS-MSS bytes left in buffer, and an MQ symbol
+// writes at most 2 bytes
+boolean FillGolomb(unsigned int q, unsigned int r, int room)
+{
+   for (int x=0; x<q; x++) {
+     mqc_encode(objet, 1);
+
+     if (mqc_numbytes(objet) > room)
+       return false;
+   }
+
+   mqc_encode(objet, 0);
+   mqc_encode(objet, r);
+
+   return mqc_numbytes(objet) <= room;
 }
 
-int FillPacket(int Block[8][8], boolean *full)
+// skip is the number of unchanged blocks before this one, -1 when all the blocks are sent
+int FillPacket(int Block[8][8], int skip, boolean *full)
 {
    unsigned int index, q, r, K;
+   // the coefficients of the scan, in zig-zag order
+   uint8_t first=0, last=64;
+   unsigned int mss=MSS;
+
+#ifdef WITH_FEC
+   // room for the offsets of the group in the parity packets
+   mss-=FEC_OVERHEAD(FEC_GROUP_SIZE);
+#endif
+
+#ifdef PROGRESSIVE_ENCODING
+   if (scanNumber) {
+     first=ProgressiveBands[scanNumber-1];
+     last=ProgressiveBands[scanNumber];
+   }
+#endif
 
    mqc_restore(objet, &mqbckobjet, bckbuffer);
    
    long startFillPacket=millis();
+
+   // the number of unchanged blocks, coded as K
+   if (skip >= 0) {
+     q=skip / 2;
+     r=skip % 2;
+
+     if (!FillGolomb(q, r, mss-2)) {
+       totalPacketizationTime+=millis()-startFillPacket;
+       return -1;
+     }
+   }
    
    // On cherche où se trouve le dernier coef <> 0 selon le zig-zag
-   K=63;   
+   K=last-1;   
    
-   while ((Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]==0) && (K>0)) 
+   while ((Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]==0) && (K>first)) 
      K--;
    
-   K++;
+   // at least 1 for the whole block, 0 for an AC band without coefficient
+   if (Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]!=0 || first==0)
+     K++;
 
-   // On code la valeur de K, nombre de coefs encodé dans le bloc
-   q=K / 2;	
-   r=K % 2;
+   K-=first;
+
+   // On code la valeur de K, nombre de coefs encodé dans le bloc, sauf pour le DC seul
+   if (last-first > 1) {
+     q=K / 2;	
+     r=K % 2;
    
-   for (int x=0; x<q; x++) 
-     mqc_encode(objet, 1);
-     
-   mqc_encode(objet, 0);
-   mqc_encode(objet, r);
+     if (!FillGolomb(q, r, mss-2)) {
+       totalPacketizationTime+=millis()-startFillPacket;
+       return -1;
+     }
+   }
 
    // On code chaque coef significatif par Golomb-Rice puis par MQ
-   for (int x=0; x<K; x++) {
+   for (int x=first; x<first+K; x++) {
 
       if (Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]>=0) { 
         index=2*Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]; 
@@ -1598,20 +1701,37 @@ int FillPacket(int Block[8][8], boolean *full)
       q=index / 2;
       r=index % 2;
       
-      for (int x=0; x<q; x++) 
-        mqc_encode(objet, 1);
-
-      mqc_encode(objet, 0);
-      mqc_encode(objet, r);
+      // the block does not fit in the packet, before going past buffer
+      if (!FillGolomb(q, r, mss-2)) {
+        totalPacketizationTime+=millis()-startFillPacket;
+        return -1;
+      }
    } 
 
    // On regarde si le paquet est plein
    mqc_backup(objet, &mqbckobjet, bckbuffer);
+
+   // the end of the packet, no skip and K=0, as K is at least 1 for a block. The gateway would
+   // otherwise decode one more block after the last one. mqc_backup() does not keep the state
+   // of the context
+   opj_mqc_state_t *ctxstate=*objet->curctx;
+
+   if (skip >= 0)
+     for (int x=0; x<4; x++)
+       mqc_encode(objet, 0);
+
    mqc_flush(objet);
+   *objet->curctx=ctxstate;
    buffersize=mqc_numbytes(objet);
+
+#ifdef PROGRESSIVE_ENCODING
+   // the number of blocks before the data
+   if (scanNumber)
+     buffersize++;
+#endif
    
    // On déborde (il faut tenir compte du champ offset (2 octets) dans le paquet
-   if (buffersize > (MSS-2)) {
+   if (buffersize > (mss-2)) {
      totalPacketizationTime+=millis()-startFillPacket;
      return -1;  
    } 
@@ -1636,13 +1756,27 @@ int FillPacket(int Block[8][8], boolean *full)
    Serial.println("");
 #endif 
 
-   if (buffersize < (MSS - 6)) {  
+#ifdef PROGRESSIVE_ENCODING
+   if (scanNumber) {
+     for (int x=packetsize-1; x>0; x--)
+       packet[x]=buffer[x-1];
+
+     packet[0]=++packetBlocks;
+   }
+#endif
+
+   if (buffersize < (mss - 6)) {  
      *full = false; 
    }  
    else { 
      *full = true; 
    }
 
+#ifdef PROGRESSIVE_ENCODING
+   if (packetBlocks == 255)
+     *full = true;
+#endif
+
    totalPacketizationTime+=millis()-startFillPacket;
    
    return 0;
@@ -1653,173 +1787,6 @@ int FillPacket(int Block[8][8], boolean *full)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 #else 
 
-#define a4   1.38703984532215
-#define a7  -0.275899379282943
-#define a47  0.831469612302545
-#define a5   1.17587560241936
-#define a6  -0.785694958387102
-#define a56  0.98078528040323
-#define a2   1.84775906502257
-#define a3   0.765366864730179
-#define a23  0.541196100146197
-#define a32  1.306562964876376
-#define rc2  1.414213562373095
-
-float OriginalLuminanceJPEGTable[8][8] = {
-  16.0,  11.0,  10.0,  16.0,  24.0,  40.0,  51.0,  61.0,
-  12.0,  12.0,  14.0,  19.0,  26.0,  58.0,  60.0,  55.0,
-  14.0,  13.0,  16.0,  24.0,  40.0,  57.0,  69.0,  56.0,
-  14.0,  17.0,  22.0,  29.0,  51.0,  87.0,  80.0,  62.0,
-  18.0,  22.0,  37.0,  56.0,  68.0, 109.0, 103.0,  77.0,
-  24.0,  35.0,  55.0,  64.0,  81.0, 104.0, 113.0,  92.0,
-  49.0,  64.0,  78.0,  87.0, 103.0, 121.0, 120.0, 101.0,
-  72.0,  92.0,  95.0,  98.0, 112.0, 100.0, 103.0,  99.0
-};
-
-float LuminanceJPEGTable[8][8] = {
-  16.0,  11.0,  10.0,  16.0,  24.0,  40.0,  51.0,  61.0,
-  12.0,  12.0,  14.0,  19.0,  26.0,  58.0,  60.0,  55.0,
-  14.0,  13.0,  16.0,  24.0,  40.0,  57.0,  69.0,  56.0,
-  14.0,  17.0,  22.0,  29.0,  51.0,  87.0,  80.0,  62.0,
-  18.0,  22.0,  37.0,  56.0,  68.0, 109.0, 103.0,  77.0,
-  24.0,  35.0,  55.0,  64.0,  81.0, 104.0, 113.0,  92.0,
-  49.0,  64.0,  78.0,  87.0, 103.0, 121.0, 120.0, 101.0,
-  72.0,  92.0,  95.0,  98.0, 112.0, 100.0, 103.0,  99.0
-};
-
-void QTinitialization(int Quality)
-{
- float Qs;
-
- if (Quality <= 0)  Quality = 1;
- if (Quality > 100) Quality = 100;
- if (Quality < 50)   Qs = 50.0 / (float) Quality;
- 	else	     Qs = 2.0 - (float) Quality/50.0;
-
-
- // Calcul des coefficients de la table de quantification
- for (int u=0; u<8; u++)
-   for (int v=0; v<8; v++)
-	{
-	 LuminanceJPEGTable[u][v] = OriginalLuminanceJPEGTable[u][v] * Qs;
-	 if (LuminanceJPEGTable[u][v] < 1.0) LuminanceJPEGTable[u][v]=1.0;
-	 if (LuminanceJPEGTable[u][v] > 255.0) LuminanceJPEGTable[u][v]=255.0;
-	}
-
- return;
-}
-
-void JPEGencoding(InImageStruct *InputImage , OutImageStruct *OutputImage)
-{
-   float Block[8][8];
-   float tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
-   float tmp10, tmp11, tmp12, tmp13, tmp20, tmp23;
-   float tmp;
-
-   // Encodage bloc par bloc
-   for (int i=0; i<InputImage->imageVsize; i=i+8)
-     for (int j=0; j<InputImage->imageHsize; j=j+8) {
-       
-	  for (int u=0; u<8; u++)
-	   for (int v=0; v<8; v++) Block[u][v]=InputImage->data[i+u][j+v];
-
-          // On calcule la DCT, puis on quantifie
-          for (int u=0; u<8; u++)
-            {
-             // 1ère étape
-             tmp0=Block[u][0]+Block[u][7];
-             tmp7=Block[u][0]-Block[u][7];
-             tmp1=Block[u][1]+Block[u][6];
-             tmp6=Block[u][1]-Block[u][6];		// soit 8 ADD
-             tmp2=Block[u][2]+Block[u][5];
-             tmp5=Block[u][2]-Block[u][5];
-             tmp3=Block[u][3]+Block[u][4];
-             tmp4=Block[u][3]-Block[u][4];
-             // 2ème étape: Partie paire
-             tmp10=tmp0+tmp3;
-             tmp13=tmp0-tmp3;			// soit 4 ADD
-             tmp11=tmp1+tmp2;
-             tmp12=tmp1-tmp2;
-             // 3ème étape: Partie paire
-             Block[u][0]=tmp10+tmp11;
-             Block[u][4]=tmp10-tmp11;
-             tmp=(tmp12+tmp13)*a23;		// soit 3 MULT et 5 ADD
-             Block[u][2]=tmp+(a3*tmp13);
-             Block[u][6]=tmp-(a2*tmp12);
-             // 2ème étape: Partie impaire
-             tmp=(tmp4+tmp7)*a47;
-             tmp10=tmp+(a7*tmp7);
-             tmp13=tmp-(a4*tmp4);
-             tmp=(tmp5+tmp6)*a56;		// soit 6 MULT et 6 ADD
-             tmp11=tmp+(a6*tmp6);
-             tmp12=tmp-(a5*tmp5);
-             // 3ème étape: Partie impaire
-             tmp20=tmp10+tmp12;
-             tmp23=tmp13+tmp11;
-             Block[u][7]=tmp23-tmp20;		// soit 2 MULT et 6 ADD
-             Block[u][1]=tmp23+tmp20;
-             Block[u][3]=(tmp13-tmp11)*rc2;
-             Block[u][5]=(tmp10-tmp12)*rc2;
-            }                
-
-          for (int v=0; v<8; v++)
-            {
-             // 1ère étape
-             tmp0=Block[0][v]+Block[7][v];
-             tmp1=Block[1][v]+Block[6][v];
-             tmp2=Block[2][v]+Block[5][v];
-             tmp3=Block[3][v]+Block[4][v];
-             tmp4=Block[3][v]-Block[4][v];
-             tmp5=Block[2][v]-Block[5][v];
-             tmp6=Block[1][v]-Block[6][v];
-             tmp7=Block[0][v]-Block[7][v];
-             // 2ème étape: Partie paire
-             tmp10=tmp0+tmp3;
-             tmp13=tmp0-tmp3;
-             tmp11=tmp1+tmp2;
-             tmp12=tmp1-tmp2;
-             // 3ème étape: Partie paire
-             Block[0][v]=tmp10+tmp11;
-             Block[4][v]=tmp10-tmp11;
-             tmp=(tmp12+tmp13)*a23;
-             Block[2][v]=tmp+(a3*tmp13);
-             Block[6][v]=tmp-(a2*tmp12);
-             // 2ème étape: Partie impaire
-             tmp=(tmp4+tmp7)*a47;
-             tmp10=tmp+(a7*tmp7);
-             tmp13=tmp-(a4*tmp4);
-             tmp=(tmp5+tmp6)*a56;
-             tmp11=tmp+(a6*tmp6);
-             tmp12=tmp-(a5*tmp5);
-             // 3ème étape: Partie impaire
-             tmp20=tmp10+tmp12;
-             tmp23=tmp13+tmp11;
-             Block[7][v]=tmp23-tmp20;
-             Block[1][v]=tmp23+tmp20;
-             Block[3][v]=(tmp13-tmp11)*rc2;
-             Block[5][v]=(tmp10-tmp12)*rc2;
-            }
-
-          // on centre sur l'interval [-128, 127]
-          Block[0][0]-=8192.0;
-      
-          // Quantification
-          for (int u=0; u<8; u++)
-             for (int v=0; v<8; v++)
-      	       Block[u][v] = round(Block[u][v] / (LuminanceJPEGTable[u][v] * 8.0));
-          
-          // On range le résultat dans l'image de sortie
-      	  for (int u=0; u<8; u++)
-      	     for (int v=0; v<8; v++)
-#ifdef SHORT_COMPUTATION
-      		OutputImage->data[i+u][j+v]=(short)Block[u][v];
-#else
-      		OutputImage->data[i+u][j+v]=Block[u][v];
-#endif      
-   }
-   return;
-}
-
 unsigned int JPEGpacketization(OutImageStruct *InputImage, unsigned int BlockOffset)
 {
    int Block[8][8], row, col, row_mix, col_mix;
@@ -2366,11 +2333,21 @@ void get_raw_picture_data() {
 
       Serial.println(F("Waiting for image raw data"));
       
+#ifdef STRIP_ENCODING
+      // the blocks are quantized while the image is read
+      QTinitialization(QualityFactor[currentCam]);
+      StripBegin();
+#endif
+
       startCamDataTime=millis();
       
       // we have to read the raw data here and send it over serial for instance	
       while (ucamArray[currentCam]->available()) {
+#ifdef STRIP_ENCODING
+          StripLines[(y%8)*CAMDATA_PGM_LINE_SIZE+x] = ucamArray[currentCam]->read();
+#else
 	  inImage.data[x][y] = ucamArray[currentCam]->read();
+#endif
 
           x++;
           totalBytes++;
@@ -2381,6 +2358,10 @@ void get_raw_picture_data() {
               x=0;
               // next line
               y++;
+#ifdef STRIP_ENCODING
+              if (y%8==0)
+                  StripEncode(8);
+#endif
           }
           
           // in this way, we always have the last timestamp
@@ -2390,6 +2371,12 @@ void get_raw_picture_data() {
            ; 
       }
 
+#ifdef STRIP_ENCODING
+      // a last strip of less than 8 lines
+      if (y%8)
+          StripEncode(y%8);
+#endif
+
       Serial.print(F("\nTotal bytes read: "));
       Serial.println(totalBytes);
       
@@ -2435,6 +2422,8 @@ int encode_ucam_file_data() {
     int Block[8][8];
     int row, col, row_mix, col_mix, N;
     int i, j, w;    
+    // unchanged blocks since the last one in the packet, -1 to send all the blocks
+    int skip=-1;
     
     long startCamGlobalEncodeTime=0;
     long stopCamGlobalEncodeTime=0;
@@ -2442,6 +2431,10 @@ int encode_ucam_file_data() {
     long totalEncodeTime=0;
     totalPacketizationTime=0;    
 
+#ifdef RATE_CONTROL
+    rateControl();
+#endif
+
     Serial.print(F("Encoding picture data, Quality Factor is : "));
     Serial.println(QualityFactor[currentCam]);
   
@@ -2468,6 +2461,20 @@ int encode_ucam_file_data() {
 
     Serial.println(F("QT ok"));
 
+#ifdef CONDITIONAL_REPLENISHMENT
+    if (replenishing)
+        skip=0;
+#endif
+
+#ifdef LIMIT_TOA
+    toaExhausted=false;
+#endif
+
+#ifdef WITH_FEC
+    FECgroup=0;
+    FECbegin();
+#endif
+
 #if defined RANDOM_NODE_ID || defined RANDOM_CAM_ID
      // node id between 10 and 16
      randNodeId=random(10,16);
@@ -2477,6 +2484,18 @@ int encode_ucam_file_data() {
 
     // N=16 for 128x128 image
     N = CAMDATA_PGM_LINE_SIZE / 8;
+
+#ifdef PROGRESSIVE_ENCODING
+    // all the blocks for each scan, the DC coefficients first
+    for (scanNumber = 1; scanNumber <= PROGRESSIVE_SCANS; scanNumber++) {
+
+#ifdef LIMIT_TOA
+    if (toaExhausted)
+        break;
+#endif
+    offset=0;
+    CreateNewPacket(offset);
+#endif
     
     for (row = 0; row < N; row++)
         // for a given row, we will have 2 main row_mix*8 values separated by 64 lines
@@ -2492,6 +2511,19 @@ int encode_ucam_file_data() {
                 row_mix = row_mix*8;
                 col_mix = col_mix*8;
 
+#ifdef LIMIT_TOA
+                if (toaExhausted)
+                        break;
+#endif
+
+#ifdef CONDITIONAL_REPLENISHMENT
+                if (replenishing && !BlockChanged(row_mix/8, col_mix/8)) {
+                        skip++;
+                        offset++;
+                        continue;
+                }
+#endif
+
 #ifdef DISPLAY_BLOCK                
 		for (i=0; i<8; i++) {
 		  for (j=0; j<8; j++) {
@@ -2505,6 +2537,8 @@ int encode_ucam_file_data() {
                   }
                   Serial.println("");
                 }
+#elif defined STRIP_ENCODING
+                startEncodeTime=millis();
 #else
                 startEncodeTime=millis();
                 
@@ -2512,8 +2546,14 @@ int encode_ucam_file_data() {
 		  for (j=0; j<8; j++) 
                     Block[i][j] = (int)inImage.data[row_mix+i][col_mix+j];  
 #endif
+
+#ifdef STRIP_ENCODING
+                // already quantized when the image was read
+                StripGetBlock(row_mix/8, col_mix/8, Block);
+#else
 		// Encodage JPEG du bloc 8x8
 		JPEGencoding(Block);
+#endif
 
                 totalEncodeTime+=millis()-startEncodeTime;
 
@@ -2529,7 +2569,7 @@ int encode_ucam_file_data() {
                 }   
 
 #endif
-	        err = FillPacket(Block, &RTS);
+	        err = FillPacket(Block, skip, &RTS);
 
 	        if (err == -1) {
 #ifdef DISPLAY_FILLPKT  
@@ -2537,11 +2577,15 @@ int encode_ucam_file_data() {
 #endif                        
 			SendPacket();
 			CreateNewPacket(offset);
-			FillPacket(Block, &RTS);
+			// the new packet starts at this block
+			FillPacket(Block, (skip<0) ? -1 : 0, &RTS);
 		}
 
 	        offset++;
 
+	        if (skip>0)
+	                skip=0;
+
 	        if (RTS == true) {
 			SendPacket();
 			CreateNewPacket(offset);
@@ -2551,6 +2595,18 @@ int encode_ucam_file_data() {
 
      SendPacket();
 
+#ifdef PROGRESSIVE_ENCODING
+    }
+
+    scanNumber=0;
+#endif
+
+#ifdef WITH_FEC
+     // the last group of the image
+     if (FECcount)
+             SendParityPackets();
+#endif
+
      stopCamGlobalEncodeTime=millis();
 
 #ifdef XBEE_POWER_SAVING   
@@ -2564,6 +2620,12 @@ int encode_ucam_file_data() {
      Serial.println(totalEncodeTime);	
      Serial.print(F("Total pkt time : "));
      Serial.println(totalPacketizationTime);
+#ifdef STRIP_ENCODING
+     Serial.print(F("Strip store : "));
+     Serial.print(StripStoreUsed);
+     Serial.print(F(" DC only : "));
+     Serial.println(StripTruncatedBlocks);
+#endif
      
      CompressionRate = (float) count * 8.0 / (CAMDATA_PGM_LINE_SIZE * CAMDATA_PGM_LINE_SIZE);
      Serial.print(F("Compression rate (bpp) : "));
@@ -2586,6 +2648,10 @@ int encode_ucam_file_data() {
      Serial.println(CAMDATA_PGM_LINE_SIZE, HEX);     
      Serial.print(F("Real encoded image file size : "));
      Serial.println(count);	
+
+#ifdef CONDITIONAL_REPLENISHMENT
+     lastImageSent=transmitting_data;
+#endif
     
      // reset
      packetcount=0L;
@@ -3061,9 +3127,20 @@ void immediateSendPicture(int delay_before_send, int delay_after_send) {
 void copy_in_refImage() {
 
         if (useRefImage) {
+#ifdef CONDITIONAL_REPLENISHMENT
+              // the gateway has only received the changed blocks
+              if (replenishing)
+                    CopyChangedBlocks(&inImage, &refImage[currentCam]);
+              else
+#endif
               for (int x=0; x<CAMDATA_PGM_LINE_SIZE; x++)
                     for (int y=0; y<CAMDATA_PGM_LINE_SIZE; y++)
                           refImage[currentCam].data[x][y]=inImage.data[x][y];  
+
+#ifdef CONDITIONAL_REPLENISHMENT
+              gwHasRefImage[currentCam]=lastImageSent;
+              replenishing=false;
+#endif
                           
 #ifdef LUM_HISTO
               computeHistogram(histoRefImage[currentCam], refImage[currentCam].data);
@@ -3072,6 +3149,33 @@ void copy_in_refImage() {
         }
 }
 
+#ifdef CONDITIONAL_REPLENISHMENT
+
+void find_changed_blocks() {
+
+        unsigned int changed=FindChangedBlocks(&inImage, &refImage[currentCam], BLOCK_SAD_THRES);
+        unsigned int nblocks=ChangedHblocks*ChangedVblocks;
+
+        replenishing = gwHasRefImage[currentCam] && crImageCount[currentCam] < CR_FULL_IMAGE_PERIOD 
+                       && changed*100 <= CR_MAX_CHANGED*nblocks;
+
+        if (replenishing)
+              crImageCount[currentCam]++;
+        else
+              crImageCount[currentCam]=0;
+
+        Serial.print(F("Changed blocks : "));
+        Serial.print(changed);
+        Serial.print(F("/"));
+        Serial.println(nblocks);
+        
+        if (replenishing)
+              Serial.println(F("Send the changed blocks only"));
+        else
+              Serial.println(F("Send the whole image"));
+}
+#endif
+
 #ifdef CRITICALITY_SCHEDULING
 
 float getCaptureRate(float r0, int sizeofCoverset) {
@@ -3226,6 +3330,8 @@ void immediateComparePicture(int delay_before_send, int delay_after_send) {
         
         if (camDataReady) {
 #ifdef PERIODIC_IMG_TRANSMIT
+            // no comparison but the image still has to be read
+            get_raw_picture_data();
             // we always set nbPixDiff so that an intrusion is detected
             long nbPixDiff=INTRUSION_THRES+1;
 #else
@@ -3248,13 +3354,21 @@ void immediateComparePicture(int delay_before_send, int delay_after_send) {
                   setCaptureRate();
 #endif                  
                   if (send_image_on_intrusion) {
+#ifdef CONDITIONAL_REPLENISHMENT
+                        find_changed_blocks();
+#endif
                         // activate encoding and transmission on inImage
                         transmitting_data = true;
                         encode_ucam_file_data();
                         transmitting_data = false;
+#ifdef CONDITIONAL_REPLENISHMENT
+                        // the reference image must be the image of the gateway
+                        copy_in_refImage();
+#else
                         // we have to define a new reference image
                         if (new_ref_on_intrusion)
                           copy_in_refImage();   
+#endif
                         
                   }
             } else 
@@ -3407,6 +3521,11 @@ void startLoraConfig() {
     Serial.print(loraAddr);
     Serial.print(F(" : state "));
     Serial.println(e, DEC);
+
+#ifdef LIMIT_TOA
+    Serial.print(F("Limit ToA, remaining ToA is "));
+    Serial.println(sx1272.limitToA());
+#endif
 }
 #endif
 
@@ -3620,11 +3739,21 @@ void setup() {
         inImage.imageVsize=inImage.imageHsize=CAMDATA_PGM_LINE_SIZE;
         outImage.imageVsize=outImage.imageHsize=CAMDATA_PGM_LINE_SIZE;
         
+#ifdef STRIP_ENCODING
+        // 8 lines and the quantized blocks instead of the image
+        inImage.data=NULL;
+
+        if (!StripAllocate(inImage.imageHsize, inImage.imageVsize, STRIP_STORE_SIZE)) {
+              Serial.println(F("Error malloc strip"));
+              ok_to_read_picture_data=false;
+        }
+#else
         // allocate memory to store the image from ucam
         if ((inImage.data = AllocateUintMemSpace(inImage.imageHsize, inImage.imageVsize))==NULL) {
               Serial.println(F("Error calloc inImage"));
               ok_to_read_picture_data=false;
         }
+#endif
         
         for (int k=0; k<NB_UCAM; k++)
               if (useRefImage) {
@@ -3638,6 +3767,20 @@ void setup() {
               else
                  refImage[k].data=NULL;     
 
+#ifdef CONDITIONAL_REPLENISHMENT
+        if (useRefImage && !ChangedAllocate(CAMDATA_PGM_LINE_SIZE, CAMDATA_PGM_LINE_SIZE)) {
+              Serial.println(F("Error calloc changed blocks"));
+              ok_to_read_picture_data=false;
+        }
+#endif
+
+#ifdef WITH_FEC
+        if (!FECallocate(FEC_GROUP_SIZE, FEC_PARITY_PACKETS, MQC_NUMCTXS)) {
+              Serial.println(F("Error malloc FEC parity packets"));
+              ok_to_encode_picture_data=false;
+        }
+#endif
+
         Serial.println(F("InImage memory allocation passed"));
 
 #ifndef CRAN_NEW_CODING
@@ -38,6 +38,10 @@
 *
 * Firmware Version 3.1
 * Now using AppSkey in Encrypt Payload function
+*
+* Firmware Version 3.2
+* Added MIC context: K1/K2 are derived once per key and the MIC can be computed
+* incrementally over several buffers (header, payload) without copying them
 ****************************************************************************************/
 
 /*
@@ -60,6 +64,20 @@ extern unsigned char AppSkey[16];
 extern unsigned char DevAddr[4];
 
 void Encrypt_Payload(unsigned char *Data, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction)
+{
+	Encrypt_Payload_Key(Data, Data_Length, Frame_Counter, Direction, AppSkey, DevAddr);
+}
+
+/*
+*****************************************************************************************
+* Description : Same as Encrypt_Payload but with an explicit key and device address, e.g.
+*               for a gateway that handles several devices
+*
+* Arguments   : *Key            16 byte long key (AppSkey)
+*               *Dev_Addr       4 byte long device address, msb first
+*****************************************************************************************
+*/
+void Encrypt_Payload_Key(unsigned char *Data, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction, unsigned char *Key, unsigned char *Dev_Addr)
 {
 	unsigned char i = 0x00;
 	unsigned char j;
@@ -86,10 +104,10 @@ void Encrypt_Payload(unsigned char *Data, unsigned char Data_Length, unsigned in
 
 		Block_A[5] = Direction;
 
-		Block_A[6] = DevAddr[3];
-		Block_A[7] = DevAddr[2];
-		Block_A[8] = DevAddr[1];
-		Block_A[9] = DevAddr[0];
+		Block_A[6] = Dev_Addr[3];
+		Block_A[7] = Dev_Addr[2];
+		Block_A[8] = Dev_Addr[1];
+		Block_A[9] = Dev_Addr[0];
 
 		Block_A[10] = (Frame_Counter & 0x00FF);
 		Block_A[11] = ((Frame_Counter >> 8) & 0x00FF);
@@ -102,7 +120,7 @@ void Encrypt_Payload(unsigned char *Data, unsigned char Data_Length, unsigned in
 		Block_A[15] = i;
 
 		//Calculate S
-		AES_Encrypt(Block_A,AppSkey);
+		AES_Encrypt(Block_A,Key);
 
 		//Check for last block
 		if(i != Number_of_Blocks)
@@ -128,33 +146,79 @@ void Encrypt_Payload(unsigned char *Data, unsigned char Data_Length, unsigned in
 	}
 }
 
+/*
+*****************************************************************************************
+* Description : Calculates the LoRaWAN MIC of Data with the NwkSkey. The K1/K2 subkeys are
+*               kept in a static MIC context and only derived again when NwkSkey changes
+*****************************************************************************************
+*/
 void Calculate_MIC(unsigned char *Data, unsigned char *Final_MIC, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction)
 {
+	static MIC_Context NwkSkey_MIC;
+	static unsigned char NwkSkey_MIC_Valid = 0;
 	unsigned char i;
-	unsigned char Block_B[16];
-	unsigned char Key_K1[16] = {
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-	};
-	unsigned char Key_K2[16] = {
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-	};
-
-	//unsigned char Data_Copy[16];
-
-	unsigned char Old_Data[16] = {
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-	};
-	unsigned char New_Data[16] = {
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-	};
 
-	unsigned char Number_of_Blocks = 0x00;
-	unsigned char Incomplete_Block_Size = 0x00;
-	unsigned char Block_Counter = 0x01;
+	//Derive K1 and K2 only for the first call or for a new NwkSkey
+	if(NwkSkey_MIC_Valid == 1)
+	{
+		for(i = 0; i < 16; i++)
+		{
+			if(NwkSkey_MIC.Key[i] != NwkSkey[i])
+			{
+				NwkSkey_MIC_Valid = 0;
+				break;
+			}
+		}
+	}
+
+	if(NwkSkey_MIC_Valid == 0)
+	{
+		MIC_Init(&NwkSkey_MIC, NwkSkey);
+		NwkSkey_MIC_Valid = 1;
+	}
+
+	MIC_Start(&NwkSkey_MIC, DevAddr, Data_Length, Frame_Counter, Direction);
+	MIC_Update(&NwkSkey_MIC, Data, Data_Length);
+	MIC_Final(&NwkSkey_MIC, Final_MIC);
+}
+
+/*
+*****************************************************************************************
+* Description : Stores the key and derives the K1 and K2 subkeys of the MIC context.
+*               Only needs to be called again when the key changes
+*
+* Arguments   : *Ctx    MIC context
+*               *Key    16 byte long key (NwkSkey)
+*****************************************************************************************
+*/
+void MIC_Init(MIC_Context *Ctx, unsigned char *Key)
+{
+	unsigned char i;
+
+	for(i = 0; i < 16; i++)
+	{
+		Ctx->Key[i] = Key[i];
+	}
+
+	Generate_Subkeys(Ctx->Key, Ctx->Key_K1, Ctx->Key_K2);
+
+	Ctx->Block_Fill = 0;
+}
+
+/*
+*****************************************************************************************
+* Description : Starts a new MIC calculation by processing Block B0
+*
+* Arguments   : *Ctx            MIC context initialized with MIC_Init
+*               *Dev_Addr       4 byte long device address, msb first
+*               Data_Length     total number of bytes that will be given to MIC_Update
+*               Frame_Counter   frame counter
+*               Direction       0x00 for uplink, 0x01 for downlink
+*****************************************************************************************
+*/
+void MIC_Start(MIC_Context *Ctx, unsigned char *Dev_Addr, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction)
+{
+	unsigned char *Block_B = Ctx->Old_Data;
 
 	//Create Block_B
 	Block_B[0] = 0x49;
@@ -165,10 +229,10 @@ void Calculate_MIC(unsigned char *Data, unsigned char *Final_MIC, unsigned char
 
 	Block_B[5] = Direction;
 
-	Block_B[6] = DevAddr[3];
-	Block_B[7] = DevAddr[2];
-	Block_B[8] = DevAddr[1];
-	Block_B[9] = DevAddr[0];
+	Block_B[6] = Dev_Addr[3];
+	Block_B[7] = Dev_Addr[2];
+	Block_B[8] = Dev_Addr[1];
+	Block_B[9] = Dev_Addr[0];
 
 	Block_B[10] = (Frame_Counter & 0x00FF);
 	Block_B[11] = ((Frame_Counter >> 8) & 0x00FF);
@@ -179,159 +243,129 @@ void Calculate_MIC(unsigned char *Data, unsigned char *Final_MIC, unsigned char
 	Block_B[14] = 0x00;
 	Block_B[15] = Data_Length;
 
-	//Calculate number of Blocks and blocksize of last block
-	Number_of_Blocks = Data_Length / 16;
-	Incomplete_Block_Size = Data_Length % 16;
-
-	if(Incomplete_Block_Size != 0)
-	{
-		Number_of_Blocks++;
-	}
-
-	Generate_Keys(Key_K1, Key_K2);
-
-	//Preform Calculation on Block B0
+	//Preform AES encryption on Block B0, result is the first chaining value
+	AES_Encrypt(Block_B,Ctx->Key);
 
-	//Preform AES encryption
-	AES_Encrypt(Block_B,NwkSkey);
+	Ctx->Block_Fill = 0;
+}
 
-	//Copy Block_B to Old_Data
-	for(i = 0; i < 16; i++)
-	{
-		Old_Data[i] = Block_B[i];
-	}
+/*
+*****************************************************************************************
+* Description : Adds Data to the MIC calculation. Can be called several times, e.g. once
+*               for the header and once for the payload, the data is not copied
+*
+* Arguments   : *Ctx            MIC context started with MIC_Start
+*               *Data           data to add
+*               Data_Length     number of bytes in Data
+*****************************************************************************************
+*/
+void MIC_Update(MIC_Context *Ctx, unsigned char *Data, unsigned char Data_Length)
+{
+	unsigned char i;
 
-	//Preform full calculating until n-1 messsage blocks
-	while(Block_Counter < Number_of_Blocks)
+	while(Data_Length > 0)
 	{
-		//Copy data into array
-		for(i = 0; i < 16; i++)
+		//The last block needs K1 or K2, so a full block is only processed when more data follows
+		if(Ctx->Block_Fill == 16)
 		{
-			New_Data[i] = *Data;
-			Data++;
-		}
+			XOR(Ctx->New_Data,Ctx->Old_Data);
+			AES_Encrypt(Ctx->New_Data,Ctx->Key);
 
-		//Preform XOR with old data
-		XOR(New_Data,Old_Data);
-
-		//Preform AES encryption
-		AES_Encrypt(New_Data,NwkSkey);
+			//Copy New_Data to Old_Data
+			for(i = 0; i < 16; i++)
+			{
+				Ctx->Old_Data[i] = Ctx->New_Data[i];
+			}
 
-		//Copy New_Data to Old_Data
-		for(i = 0; i < 16; i++)
-		{
-			Old_Data[i] = New_Data[i];
+			Ctx->Block_Fill = 0;
 		}
 
-		//Raise Block counter
-		Block_Counter++;
+		Ctx->New_Data[Ctx->Block_Fill] = *Data;
+		Ctx->Block_Fill++;
+		Data++;
+		Data_Length--;
 	}
+}
 
-	//Perform calculation on last block
-	//Check if Datalength is a multiple of 16
-	if(Incomplete_Block_Size == 0)
-	{
-		//Copy last data into array
-		for(i = 0; i < 16; i++)
-		{
-			New_Data[i] = *Data;
-			Data++;
-		}
+/*
+*****************************************************************************************
+* Description : Processes the last block and returns the 4 byte MIC
+*
+* Arguments   : *Ctx            MIC context
+*               *Final_MIC      4 byte long array receiving the MIC
+*****************************************************************************************
+*/
+void MIC_Final(MIC_Context *Ctx, unsigned char *Final_MIC)
+{
+	unsigned char i;
 
+	//Check if the last block is complete
+	if(Ctx->Block_Fill == 16)
+	{
 		//Preform XOR with Key 1
-		XOR(New_Data,Key_K1);
-
-		//Preform XOR with old data
-		XOR(New_Data,Old_Data);
-
-		//Preform last AES routine
-		AES_Encrypt(New_Data,NwkSkey);
+		XOR(Ctx->New_Data,Ctx->Key_K1);
 	}
 	else
 	{
-		//Copy the remaining data and fill the rest
-		for(i =  0; i < 16; i++)
+		//Pad the remaining bytes
+		Ctx->New_Data[Ctx->Block_Fill] = 0x80;
+		for(i = Ctx->Block_Fill + 1; i < 16; i++)
 		{
-			if(i < Incomplete_Block_Size)
-			{
-				New_Data[i] = *Data;
-				Data++;
-			}
-			if(i == Incomplete_Block_Size)
-			{
-				New_Data[i] = 0x80;
-			}
-			if(i > Incomplete_Block_Size)
-			{
-				New_Data[i] = 0x00;
-			}
+			Ctx->New_Data[i] = 0x00;
 		}
 
 		//Preform XOR with Key 2
-		XOR(New_Data,Key_K2);
+		XOR(Ctx->New_Data,Ctx->Key_K2);
+	}
 
-		//Preform XOR with Old data
-		XOR(New_Data,Old_Data);
+	//Preform XOR with old data
+	XOR(Ctx->New_Data,Ctx->Old_Data);
 
-		//Preform last AES routine
-		AES_Encrypt(New_Data,NwkSkey);
-	}
+	//Preform last AES routine
+	AES_Encrypt(Ctx->New_Data,Ctx->Key);
+
+	Final_MIC[0] = Ctx->New_Data[0];
+	Final_MIC[1] = Ctx->New_Data[1];
+	Final_MIC[2] = Ctx->New_Data[2];
+	Final_MIC[3] = Ctx->New_Data[3];
 
-	Final_MIC[0] = New_Data[0];
-	Final_MIC[1] = New_Data[1];
-	Final_MIC[2] = New_Data[2];
-	Final_MIC[3] = New_Data[3];
+	Ctx->Block_Fill = 0;
 }
 
 void Generate_Keys(unsigned char *K1, unsigned char *K2)
 {
-	unsigned char i;
-	unsigned char MSB_Key;
+	Generate_Subkeys(NwkSkey, K1, K2);
+}
 
-	//Encrypt the zeros in K1 with the NwkSkey
-	AES_Encrypt(K1,NwkSkey);
+void Generate_Subkeys(unsigned char *Key, unsigned char *K1, unsigned char *K2)
+{
+	unsigned char i;
 
-	//Create K1
-	//Check if MSB is 1
-	if((K1[0] & 0x80) == 0x80)
-	{
-		MSB_Key = 1;
-	}
-	else
+	//Encrypt zeros with the Key
+	for(i = 0; i < 16; i++)
 	{
-		MSB_Key = 0;
+		K1[i] = 0x00;
 	}
 
-	//Shift K1 one bit left
-	Shift_Left(K1);
+	AES_Encrypt(K1,Key);
 
-	//if MSB was 1
-	if(MSB_Key == 1)
+	//Create K1: shift K1 one bit left and XOR with 0x87 if MSB was 1
+	i = K1[0] & 0x80;
+	Shift_Left(K1);
+	if(i == 0x80)
 	{
 		K1[15] = K1[15] ^ 0x87;
 	}
 
-	//Copy K1 to K2
-	for( i = 0; i < 16; i++)
+	//Create K2 from K1 in the same way
+	for(i = 0; i < 16; i++)
 	{
 		K2[i] = K1[i];
 	}
 
-	//Check if MSB is 1
-	if((K2[0] & 0x80) == 0x80)
-	{
-		MSB_Key = 1;
-	}
-	else
-	{
-		MSB_Key = 0;
-	}
-
-	//Shift K2 one bit left
+	i = K2[0] & 0x80;
 	Shift_Left(K2);
-
-	//Check if MSB was 1
-	if(MSB_Key == 1)
+	if(i == 0x80)
 	{
 		K2[15] = K2[15] ^ 0x87;
 	}
@@ -340,32 +374,14 @@ void Generate_Keys(unsigned char *K1, unsigned char *K2)
 void Shift_Left(unsigned char *Data)
 {
 	unsigned char i;
-	unsigned char Overflow = 0;
-	//unsigned char High_Byte, Low_Byte;
 
-	for(i = 0; i < 16; i++)
+	//Shift one left, carrying the upper bit of the next byte
+	for(i = 0; i < 15; i++)
 	{
-		//Check for overflow on next byte except for the last byte
-		if(i < 15)
-		{
-			//Check if upper bit is one
-			if((Data[i+1] & 0x80) == 0x80)
-			{
-				Overflow = 1;
-			}
-			else
-			{
-				Overflow = 0;
-			}
-		}
-		else
-		{
-			Overflow = 0;
-		}
-
-		//Shift one left
-		Data[i] = (Data[i] << 1) + Overflow;
+		Data[i] = (Data[i] << 1) | (Data[i+1] >> 7);
 	}
+
+	Data[15] = Data[15] << 1;
 }
 
 void XOR(unsigned char *New_Data,unsigned char *Old_Data)
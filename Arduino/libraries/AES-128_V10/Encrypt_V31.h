@@ -38,11 +38,31 @@
 *
 * Firmware Version 3.1
 * Now using AppSkey in Encrypt Payload function
+*
+* Firmware Version 3.2
+* Added MIC context: K1/K2 are derived once per key and the MIC can be computed
+* incrementally over several buffers (header, payload) without copying them
 ****************************************************************************************/
 
 #ifndef ENCRYPT_V31_H
 #define ENCRYPT_V31_H
 
+/*
+*****************************************************************************************
+* TYPE DEFINITIONS
+*****************************************************************************************
+*/
+
+typedef struct
+{
+	unsigned char Key[16];
+	unsigned char Key_K1[16];
+	unsigned char Key_K2[16];
+	unsigned char Old_Data[16];	//CBC chaining value
+	unsigned char New_Data[16];	//block being filled by MIC_Update
+	unsigned char Block_Fill;	//number of bytes in New_Data
+} MIC_Context;
+
 /*
 *****************************************************************************************
 * FUNCTION PROTOTYPES
@@ -51,7 +71,15 @@
 
 void Calculate_MIC(unsigned char *Data, unsigned char *Final_MIC, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction);
 void Encrypt_Payload(unsigned char *Data, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction);
+void Encrypt_Payload_Key(unsigned char *Data, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction, unsigned char *Key, unsigned char *Dev_Addr);
 void Generate_Keys(unsigned char *K1, unsigned char *K2);
+void Generate_Subkeys(unsigned char *Key, unsigned char *K1, unsigned char *K2);
+
+void MIC_Init(MIC_Context *Ctx, unsigned char *Key);
+void MIC_Start(MIC_Context *Ctx, unsigned char *Dev_Addr, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction);
+void MIC_Update(MIC_Context *Ctx, unsigned char *Data, unsigned char Data_Length);
+void MIC_Final(MIC_Context *Ctx, unsigned char *Final_MIC);
+
 void Shift_Left(unsigned char *Data);
 void XOR(unsigned char *New_Data,unsigned char *Old_Data);
 
@@ -358,7 +358,7 @@ void DallasTemperature::blockTillConversionComplete(uint8_t bitResolution){
     int delms = millisToWaitForConversion(bitResolution);
     if (checkForConversion && !parasite){
         unsigned long now = millis();
-        while(!isConversionComplete() && (millis() - delms < now));
+        while(!isConversionComplete() && (millis() - now < (unsigned long)delms));
     } else {
         delay(delms);
     }
@@ -381,6 +381,12 @@ int16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution){
 
 }
 
+// returns number of milliseconds to wait till conversion is complete on all devices,
+// e.g. to sleep after requestTemperatures() with waitForConversion set to false
+int16_t DallasTemperature::millisToWaitForConversion(){
+    return millisToWaitForConversion(bitResolution);
+}
+
 
 // sends command for one device to perform a temp conversion by index
 bool DallasTemperature::requestTemperaturesByIndex(uint8_t deviceIndex){
@@ -404,6 +410,25 @@ float DallasTemperature::getTempCByIndex(uint8_t deviceIndex){
 
 }
 
+// Fetch raw temperature of all devices, in 1/128 degrees C or DEVICE_DISCONNECTED_RAW
+// getTempCByIndex() searches the bus from the start for each index, so reading n
+// devices that way takes n*(n+1)/2 searches instead of n
+uint8_t DallasTemperature::getAllTemps(int16_t* temps, uint8_t count){
+
+    DeviceAddress deviceAddress;
+    uint8_t index = 0;
+
+    _wire->reset_search();
+
+    // the search state is kept by the OneWire object while the scratchpads are read
+    while (index < count && _wire->search(deviceAddress)){
+        if (validAddress(deviceAddress)) temps[index++] = getTemp(deviceAddress);
+    }
+
+    return index;
+
+}
+
 // Fetch temperature for device index
 float DallasTemperature::getTempFByIndex(uint8_t deviceIndex){
 
@@ -124,6 +124,11 @@ public:
     // sends command for all devices on the bus to perform a temperature conversion
     void requestTemperatures(void);
 
+    // returns number of milliseconds to wait till conversion is complete
+    // for the given resolution, or for the highest resolution on the bus
+    int16_t millisToWaitForConversion(uint8_t);
+    int16_t millisToWaitForConversion(void);
+
     // sends command for one device to perform a temperature conversion by address
     bool requestTemperaturesByAddress(const uint8_t*);
 
@@ -142,6 +147,10 @@ public:
     // Get temperature for device index (slow)
     float getTempCByIndex(uint8_t);
 
+    // reads the raw temperature of all devices with a single search of the bus,
+    // in the order of the indexes, returns the number of devices read, at most the given count
+    uint8_t getAllTemps(int16_t*, uint8_t);
+
     // Get temperature for device index (slow)
     float getTempFByIndex(uint8_t);
 
@@ -251,8 +260,6 @@ private:
     // reads scratchpad and returns the raw temperature
     int16_t calculateTemperature(const uint8_t*, uint8_t*);
 
-    int16_t millisToWaitForConversion(uint8_t);
-
     void	blockTillConversionComplete(uint8_t);
 
 #if REQUIRESALARMS
@@ -28,8 +28,21 @@
 
 #include "SX1272.h"
 #include <SPI.h>
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
 
 /*  CHANGE LOGS by C. Pham
+ *	October 19th, 2026
+ *		- add startSend()/startSendPacket(), isSendDone() and endSend() to send without waiting for the end of the transmission
+ *		- call setDIO0Pin(2) for instance to use the TxDone interrupt on DIO0: isSendDone() does not read the radio module
+ *		  anymore and sendWithTimeout() puts the MCU in idle mode (AVR) until the packet is sent instead of polling REG_IRQ_FLAGS
+ *		- add receiveWindow() that receives in Rx single mode with a symbol timeout, the radio module goes back to standby mode
+ *		  after RxDone or RxTimeout. With setDIO0Pin(), receivePacketTimeout() and sendPacketTimeoutACK() use it and the MCU
+ *		  sleeps until RxDone, and until RxTimeout with setDIO1Pin(), instead of polling REG_IRQ_FLAGS during the whole window
+ *		- add wakeOnRadio() that performs one CAD and receives the packet only if there is activity on the channel, the radio
+ *		  module is in sleep mode otherwise. The sender uses a preamble of getWakeOnRadioPreamble(period) symbols to reach a
+ *		  device calling wakeOnRadio() every period ms. setPreambleLength() now also updates _preamblelength
  *	August 28th, 2018
  *		- add a small delay in the availableData() loop that decreases the CPU load of a gateway program to 4~5% instead of nearly 100%
  *		- suggested by rertini (https://github.com/CongducPham/LowCostLoRaGw/issues/211)
@@ -119,6 +132,18 @@
 uint8_t sx1272_SIFS_value[11]={0, 183, 94, 44, 47, 23, 24, 12, 12, 7, 4};
 uint8_t sx1272_CAD_value[11]={0, 62, 31, 16, 16, 8, 9, 5, 3, 1, 1};
 
+// set by the interrupt on DIO0 (TxDone or RxDone) and on DIO1 (RxTimeout)
+static volatile bool sx1272_dio0=false;
+static volatile bool sx1272_dio1=false;
+
+static void sx1272_dio0ISR() {
+    sx1272_dio0=true;
+}
+
+static void sx1272_dio1ISR() {
+    sx1272_dio1=true;
+}
+
 //#define LIMIT_TOA
 // 0.1% for testing
 //#define MAX_DUTY_CYCLE_PER_HOUR 3600L
@@ -139,6 +164,9 @@ SX1272::SX1272()
 {
 	//set the Chip Select pin
 	_SX1272_SS=SX1272_SS;
+	_dio0Pin=SX1272_NO_DIO;
+	_dio1Pin=SX1272_NO_DIO;
+	_wakeOnRadio=false;
 	
     // Initialize class variables
     _bandwidth = BW_125;
@@ -3120,6 +3148,7 @@ uint8_t SX1272::setPreambleLength(uint16_t l)
         writeRegister(REG_PREAMBLE_LSB_FSK, p_length);
     }
 
+    _preamblelength = l;
     state = 0;
 #if (SX1272_debug_mode > 1)
     Serial.print(F("## Preamble length "));
@@ -4090,10 +4119,14 @@ uint8_t SX1272::receivePacketTimeout(uint16_t wait)
     Serial.println(F("Starting 'receivePacketTimeout'"));
 #endif
 
-    state = receive();
+    // with DIO0, receiveWindow() sets the Rx single mode and the MCU sleeps during the window
+    // wakeOnRadio() also uses it as the preamble is already on the channel
+    boolean window = ((_dio0Pin != SX1272_NO_DIO || _wakeOnRadio) && _modem == LORA);
+
+    state = window ? 0 : receive();
     if( state == 0 )
     {
-        if( availableData(wait) )
+        if( window ? receiveWindow(wait) : availableData(wait) )
         {
             state = getPacket();
         }
@@ -4175,10 +4208,14 @@ uint8_t SX1272::receivePacketTimeout(uint16_t wait)
     Serial.println(F("Starting 'receivePacketTimeout'"));
 #endif
 
-    state = receive();
+    // with DIO0, receiveWindow() sets the Rx single mode and the MCU sleeps during the window
+    // wakeOnRadio() also uses it as the preamble is already on the channel
+    boolean window = ((_dio0Pin != SX1272_NO_DIO || _wakeOnRadio) && _modem == LORA);
+
+    state = window ? 0 : receive();
     if( state == 0 )
     {
-        if( availableData(wait) )
+        if( window ? receiveWindow(wait) : availableData(wait) )
         {
             // If packet received, getPacket
             state_f = getPacket();
@@ -4502,69 +4539,213 @@ boolean	SX1272::availableData(uint16_t wait)
     // We use _hreceived because we need to ensure that _destination value is correctly
     // updated and is not the _destination value from the previously packet
     if( _hreceived == true )
-    { // Checking destination
+    {
+        forme = checkDestination();
+    }
+
+    // added by C. Pham
+    if (_hreceived==false || forme==false) {
+        if( _modem == LORA )	// STANDBY PARA MINIMIZAR EL CONSUMO
+        { // LoRa mode
+            writeRegister(REG_OP_MODE, LORA_STANDBY_MODE);	// Setting standby LoRa mode
+        }
+        else
+        { //  FSK mode
+            writeRegister(REG_OP_MODE, FSK_STANDBY_MODE);	// Setting standby FSK mode
+        }
+    }
+
+    return forme;
+}
+
+/*
+ Function: Checks the destination (and the net key) of the packet whose first bytes have been read.
+ Returns: Boolean that's 'true' if the packet is for the module and
+          it's 'false' if the packet is not for the module.
+*/
+boolean SX1272::checkDestination()
+{
+    boolean forme = false;
+
 #if (SX1272_debug_mode > 0)
-        Serial.println(F("## Checking destination ##"));
+    Serial.println(F("## Checking destination ##"));
 #endif
 
-        // added by C. Pham
+    // added by C. Pham
 #ifdef W_NET_KEY
-        forme=true;
-
-        // if we wait for an ACK, then we do not check for net key
-        if (_requestACK==0)
-            if (_the_net_key_0!=_my_netkey[0] || _the_net_key_1!=_my_netkey[1]) {
-                //#if (SX1272_debug_mode > 0)
-                Serial.println(F("## Wrong net key ##"));
-                //#endif
-                forme=false;
-            }
-            else
-            {
-                //#if (SX1272_debug_mode > 0)
-                Serial.println(F("## Good net key ##"));
-                //#endif
-            }
+    forme=true;
+
+    // if we wait for an ACK, then we do not check for net key
+    if (_requestACK==0)
+        if (_the_net_key_0!=_my_netkey[0] || _the_net_key_1!=_my_netkey[1]) {
+            //#if (SX1272_debug_mode > 0)
+            Serial.println(F("## Wrong net key ##"));
+            //#endif
+            forme=false;
+        }
+        else
+        {
+            //#if (SX1272_debug_mode > 0)
+            Serial.println(F("## Good net key ##"));
+            //#endif
+        }
 
 
-        if( forme && ((_destination == _nodeAddress) || (_destination == BROADCAST_0)) )
+    if( forme && ((_destination == _nodeAddress) || (_destination == BROADCAST_0)) )
 #else
-        // modified by C. Pham
-        // if _rawFormat, accept all
-        if( (_destination == _nodeAddress) || (_destination == BROADCAST_0) || _rawFormat)
+    // modified by C. Pham
+    // if _rawFormat, accept all
+    if( (_destination == _nodeAddress) || (_destination == BROADCAST_0) || _rawFormat)
 #endif
-        { // LoRa or FSK mode
-            forme = true;
+    { // LoRa or FSK mode
+        forme = true;
 #if (SX1272_debug_mode > 0)
-            Serial.println(F("## Packet received is for me ##"));
+        Serial.println(F("## Packet received is for me ##"));
 #endif
-        }
-        else
-        {
-            forme = false;
+    }
+    else
+    {
+        forme = false;
 #if (SX1272_debug_mode > 0)
-            Serial.println(F("## Packet received is not for me ##"));
-            Serial.println();
+        Serial.println(F("## Packet received is not for me ##"));
+        Serial.println();
 #endif
 
 #ifdef SX1272_led_send_receive
-            digitalWrite(SX1272_led_receive, LOW);
+        digitalWrite(SX1272_led_receive, LOW);
 #endif
-        }
     }
+    return forme;
+}
 
-    // added by C. Pham
-    if (_hreceived==false || forme==false) {
-        if( _modem == LORA )	// STANDBY PARA MINIMIZAR EL CONSUMO
-        { // LoRa mode
-            writeRegister(REG_OP_MODE, LORA_STANDBY_MODE);	// Setting standby LoRa mode
+/*
+ Function: Receives a packet in Rx single mode: the radio module stops listening after a symbol timeout
+           and is set again in Rx single mode until 'wait' expires. With setDIO0Pin() the MCU sleeps
+           until RxDone, and until RxTimeout with setDIO1Pin(). LoRa mode only.
+ Returns: Boolean that's 'true' if a packet for the module has been received, it can be read with
+          getPacket() or getACK(), and it's 'false' if the packet is not for the module or there is none.
+ Parameters:
+   wait: time to wait while there is no preamble received.
+*/
+boolean SX1272::receiveWindow(uint16_t wait)
+{
+    byte value = 0x00;
+    boolean forme = false;
+    unsigned long start = millis();
+    unsigned long armed;
+    unsigned long elapsed;
+    uint32_t symbolTime;
+    uint32_t symbols;
+    uint16_t windowTime;
+
+#if (SX1272_debug_mode > 0)
+    Serial.println();
+    Serial.println(F("Starting 'receiveWindow'"));
+#endif
+
+    // same settings as receive(), without the delay of setPacketLength()
+    memset( &packet_received, 0x00, sizeof(packet_received) );
+    packet_received.data=packet_data;
+
+    writeRegister(REG_OP_MODE, LORA_STANDBY_MODE);
+    writeRegister(REG_PA_RAMP, 0x08);
+    writeRegister(REG_LNA, LNA_MAX_GAIN);
+    writeRegister(REG_FIFO_ADDR_PTR, 0x00);
+    writeRegister(REG_FIFO_RX_BYTE_ADDR, 0x00);
+    writeRegister(REG_PAYLOAD_LENGTH_LORA, MAX_LENGTH);
+
+    // DIO0 is RxDone (00) and DIO1 is RxTimeout (00)
+    writeRegister(REG_DIO_MAPPING1, readRegister(REG_DIO_MAPPING1) & B00001111);
+
+    symbolTime = getSymbolTime();
+
+    do
+    {
+        elapsed = millis() - start;
+        symbols = elapsed < wait ? (wait - elapsed) * 1000UL / symbolTime : 0;
+
+        // the symbol timeout is coded on 10 bits, at least 4 symbols to detect the preamble
+        if (symbols > 1023)
+            symbols = 1023;
+
+        if (symbols < 4)
+        {
+            if (elapsed)
+                break;
+            symbols = 4;
         }
-        else
-        { //  FSK mode
-            writeRegister(REG_OP_MODE, FSK_STANDBY_MODE);	// Setting standby FSK mode
+
+        writeRegister(REG_MODEM_CONFIG2, (readRegister(REG_MODEM_CONFIG2) & B11111100) | (symbols >> 8));
+        writeRegister(REG_SYMB_TIMEOUT_LSB, symbols & 0xFF);
+        clearFlags();
+        sx1272_dio0 = false;
+        sx1272_dio1 = false;
+
+        windowTime = symbols * symbolTime / 1000 + 1;
+        armed = millis();
+        writeRegister(REG_OP_MODE, LORA_RXSINGLE_MODE);
+
+        // Wait until RxDone or RxTimeout, REG_IRQ_FLAGS is read when an interrupt says
+        // which one, otherwise after the symbol timeout or while a packet is received
+        value = 0x00;
+
+        while ((value & B11000000) == 0 && millis() - start < (unsigned long)wait + MAX_TIMEOUT)
+        {
+            if (sx1272_dio0 || sx1272_dio1 || (_dio0Pin == SX1272_NO_DIO && _dio1Pin == SX1272_NO_DIO)
+                || millis() - armed >= windowTime)
+                value = readRegister(REG_IRQ_FLAGS);
+
+            if ((value & B11000000) == 0)
+            {
+#ifdef __AVR__
+                // the CPU is stopped until an interrupt on DIO0/DIO1 or the next tick of millis()
+                if (_dio0Pin != SX1272_NO_DIO)
+                {
+                    set_sleep_mode(SLEEP_MODE_IDLE);
+                    sleep_mode();
+                }
+#elif defined ARDUINO_ESP8266_ESP01 || defined ARDUINO_ESP8266_NODEMCU || defined ESP32
+                yield();
+#endif
+            }
+        }
+    } while (bitRead(value, 7) == 1 && bitRead(value, 6) == 0 && millis() - start < wait);
+
+    if( bitRead(value, 6) == 1 )
+    { // packet received, the radio module is back in standby mode
+        _starttime=millis();
+
+#if (SX1272_debug_mode > 0)
+        Serial.println(F("## Packet received in Rx single mode ##"));
+#endif
+
+#ifdef SX1272_led_send_receive
+        digitalWrite(SX1272_led_receive, HIGH);
+#endif
+        writeRegister(REG_FIFO_ADDR_PTR, 0x00);
+
+#ifdef W_NET_KEY
+        // if we actually wait for an ACK, there is no net key before ACK data
+        if (_requestACK==0) {
+            _the_net_key_0 = readRegister(REG_FIFO);
+            _the_net_key_1 = readRegister(REG_FIFO);
         }
+#endif
+        _destination = readRegister(REG_FIFO);
+
+        forme = checkDestination();
+    }
+    else
+    {
+#if (SX1272_debug_mode > 0)
+        Serial.println(F("** The timeout has expired **"));
+        Serial.println();
+#endif
     }
 
+    if (forme==false)
+        writeRegister(REG_OP_MODE, LORA_STANDBY_MODE);	// Setting standby LoRa mode
+
     return forme;
 }
 
@@ -4756,7 +4937,8 @@ int8_t SX1272::getPacket(uint16_t wait)
         if (!_rawFormat) {
             packet_received.type = readRegister(REG_FIFO);		// Reading second byte of the received packet
             // check packet type to discard unknown packet type
-            if ( ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_DATA) && ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_ACK) ) {
+            if ( ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_DATA) && ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_DATA_BIN)
+            	&& ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_ACK) ) {
                 _reception = INCORRECT_PACKET_TYPE;
                 state = 3;
 #if (SX1272_debug_mode > 0)
@@ -5690,70 +5872,138 @@ uint8_t SX1272::sendWithTimeout()
 */
 uint8_t SX1272::sendWithTimeout(uint16_t wait)
 {
-    uint8_t state = 2;
-    byte value = 0x00;
-    //unsigned long previous;
-    unsigned long exitTime;
-
 #if (SX1272_debug_mode > 1)
     Serial.println();
     Serial.println(F("Starting 'sendWithTimeout'"));
 #endif
 
+    startSend(wait);
+
+    // Wait until the packet is sent (TX Done flag) or the timeout expires
+    while (!isSendDone())
+    {
+#ifdef __AVR__
+        // the CPU is stopped until the TxDone interrupt or the next tick of millis()
+        if (_dio0Pin != SX1272_NO_DIO)
+        {
+            set_sleep_mode(SLEEP_MODE_IDLE);
+            sleep_mode();
+        }
+#endif
+    }
+
+    return endSend();
+}
+
+/*
+ Function: Starts the transmission of the packet stored in FIFO, the timeout is checked by isSendDone().
+ Returns: Integer that determines if there has been any error
+   state = 1  --> There has been an error while executing the command
+   state = 0  --> The command has been executed with no errors
+*/
+uint8_t SX1272::startSend(uint16_t wait)
+{
 #ifdef SX1272_led_send_receive
     digitalWrite(SX1272_led_send, HIGH);
 #endif
-    // clearFlags();	// Initializing flags
 
-    // wait to TxDone flag
-    //previous = millis();
-    exitTime = millis() + (unsigned long)wait;
+    _sendStart = millis();
+    _sendWait = wait;
+    sx1272_dio0 = false;
+
     if( _modem == LORA )
     { // LoRa mode
         clearFlags();	// Initializing flags
 
+        // DIO0 is TxDone (01) instead of RxDone (00)
+        if (_dio0Pin != SX1272_NO_DIO)
+            writeRegister(REG_DIO_MAPPING1, (readRegister(REG_DIO_MAPPING1) & B00111111) | B01000000);
+
         writeRegister(REG_OP_MODE, LORA_TX_MODE);  // LORA mode - Tx
 
 #if (SX1272_debug_mode > 1)
-        value = readRegister(REG_OP_MODE);
+        byte value = readRegister(REG_OP_MODE);
 
         if (value & LORA_TX_MODE == LORA_TX_MODE)
             Serial.println(F("OK"));
         else
             Serial.println(F("ERROR"));
 #endif
-        value = readRegister(REG_IRQ_FLAGS);
-        // Wait until the packet is sent (TX Done flag) or the timeout expires
-        //while ((bitRead(value, 3) == 0) && (millis() - previous < wait))
-        while ((bitRead(value, 3) == 0) && (millis() < exitTime))
-        {
-            value = readRegister(REG_IRQ_FLAGS);
-            // Condition to avoid an overflow (DO NOT REMOVE)
-            //if( millis() < previous )
-            //{
-            //    previous = millis();
-            //}
-        }
-        state = 1;
     }
     else
     { // FSK mode
+        // DIO0 is PacketSent (00) in Tx
+        if (_dio0Pin != SX1272_NO_DIO)
+            writeRegister(REG_DIO_MAPPING1, readRegister(REG_DIO_MAPPING1) & B00111111);
+
         writeRegister(REG_OP_MODE, FSK_TX_MODE);  // FSK mode - Tx
+    }
 
-        value = readRegister(REG_IRQ_FLAGS2);
-        // Wait until the packet is sent (Packet Sent flag) or the timeout expires
-        //while ((bitRead(value, 3) == 0) && (millis() - previous < wait))
-        while ((bitRead(value, 3) == 0) && (millis() < exitTime))
-        {
-            value = readRegister(REG_IRQ_FLAGS2);
-            // Condition to avoid an overflow (DO NOT REMOVE)
-            //if( millis() < previous )
-            //{
-            //    previous = millis();
-            //}
-        }
-        state = 1;
+    return 0;
+}
+
+/*
+ Function: Starts the transmission of a packet with 'dest' destination.
+ Returns: Integer that determines if there has been any error
+   state = 2  --> The command has not been executed
+   state = 1  --> There has been an error while executing the command
+   state = 0  --> The command has been executed with no errors
+*/
+uint8_t SX1272::startSendPacket(uint8_t dest, uint8_t *payload, uint16_t length16)
+{
+    uint8_t state = 2;
+    uint8_t state_f = 2;
+
+#if (SX1272_debug_mode > 1)
+    Serial.println();
+    Serial.println(F("Starting 'startSendPacket'"));
+#endif
+
+    state = truncPayload(length16);
+
+    if( state == 0 )
+    {
+        state_f = setPacket(dest, payload);	// Setting a packet with 'dest' destination
+    }												// and writing it in FIFO.
+    else
+    {
+        state_f = state;
     }
+    if( state_f == 0 )
+    {
+        setTimeout();
+        state_f = startSend(_sendTime);	// Sending the packet
+    }
+    return state_f;
+}
+
+/*
+ Function: Checks whether the packet started by startSend() is sent or the timeout has expired.
+ Returns: true when endSend() can be called
+*/
+bool SX1272::isSendDone()
+{
+    if (_dio0Pin != SX1272_NO_DIO)
+    {
+        if (sx1272_dio0)
+            return true;
+    }
+    else if (bitRead(readRegister(_modem == LORA ? REG_IRQ_FLAGS : REG_IRQ_FLAGS2), 3))
+        return true;
+
+    return millis() - _sendStart >= _sendWait;
+}
+
+/*
+ Function: Ends the transmission started by startSend().
+ Returns: Integer that determines if there has been any error
+   state = 1  --> The packet has not been sent before the timeout
+   state = 0  --> The packet has been sent
+*/
+uint8_t SX1272::endSend()
+{
+    uint8_t state = 1;
+    byte value = readRegister(_modem == LORA ? REG_IRQ_FLAGS : REG_IRQ_FLAGS2);
 
 #ifdef SX1272_led_send_receive
     digitalWrite(SX1272_led_send, LOW);
@@ -5773,20 +6023,10 @@ uint8_t SX1272::sendWithTimeout(uint16_t wait)
     }
     else
     {
-        if( state == 1 )
-        {
 #if (SX1272_debug_mode > 1)
-            Serial.println(F("** Timeout has expired **"));
-            Serial.println();
-#endif
-        }
-        else
-        {
-#if (SX1272_debug_mode > 1)
-            Serial.println(F("** There has been an error and packet has not been sent **"));
-            Serial.println();
+        Serial.println(F("** Timeout has expired **"));
+        Serial.println();
 #endif
-        }
     }
 
     clearFlags();		// Initializing flags
@@ -6068,8 +6308,11 @@ uint8_t SX1272::sendPacketTimeoutACK(uint8_t dest, uint8_t *payload, uint16_t le
     // Sending packet to 'dest' destination
     state = sendPacketTimeout(dest, payload, length16);
 
+    // with DIO0, receiveWindow() sets the Rx single mode and the MCU sleeps until the ACK
+    boolean window = (_dio0Pin != SX1272_NO_DIO && _modem == LORA);
+
     // Trying to receive the ACK
-    if( state == 0 )
+    if( state == 0 && !window )
     {
         state = receive();	// Setting Rx mode to wait an ACK
     }
@@ -6082,7 +6325,7 @@ uint8_t SX1272::sendPacketTimeoutACK(uint8_t dest, uint8_t *payload, uint16_t le
         // added by C. Pham
         Serial.println(F("wait for ACK"));
 
-        if( availableData() )
+        if( window ? receiveWindow(MAX_TIMEOUT) : availableData() )
         {
             state_f = getACK();	// Getting ACK
         }
@@ -6819,6 +7062,93 @@ uint8_t SX1272::doCAD(uint8_t counter)
     return state;
 }
 
+/*
+ Function: Listens for a packet sent with a long preamble: performs one CAD and receives the packet
+           only if there is activity on the channel. The radio module is in sleep mode otherwise, the
+           MCU and the radio module can sleep 'period' ms before the next call. With setDIO0Pin(),
+           the MCU sleeps until CadDone. LoRa mode only.
+ Returns: Integer that determines if there has been any error
+   state = 3  --> There is no activity on the channel
+   state = 0  --> A packet has been received, same other values as receivePacketTimeout()
+ Parameters:
+   period: time between two calls, the sender uses a preamble of getWakeOnRadioPreamble(period) symbols.
+*/
+uint8_t SX1272::wakeOnRadio(uint16_t period)
+{
+    uint8_t state = 3;
+    byte value = 0x00;
+    unsigned long start;
+
+    if( _modem != LORA )
+        return 1;
+
+    writeRegister(REG_OP_MODE, LORA_STANDBY_MODE);
+
+    // DIO0 is CadDone (10)
+    writeRegister(REG_DIO_MAPPING1, (readRegister(REG_DIO_MAPPING1) & B00111111) | B10000000);
+    clearFlags();
+    sx1272_dio0 = false;
+
+    start = millis();
+    writeRegister(REG_OP_MODE, LORA_CAD_MODE);
+
+    // Wait until CAD ends (CAD Done flag) or the timeout expires, same timeout as doCAD()
+    while (bitRead(value, 2) == 0 && millis() - start < 100)
+    {
+        if (_dio0Pin == SX1272_NO_DIO || sx1272_dio0)
+            value = readRegister(REG_IRQ_FLAGS);
+#ifdef __AVR__
+        else
+        {
+            set_sleep_mode(SLEEP_MODE_IDLE);
+            sleep_mode();
+        }
+#endif
+    }
+
+    clearFlags();
+
+    // look for the CAD detected bit
+    if (bitRead(value, 0) == 1)
+    {
+#if (SX1272_debug_mode > 0)
+        Serial.println(F("## Activity detected, waking up ##"));
+#endif
+        // the rest of the preamble lasts at most period ms, 8 symbols more to detect it
+        _wakeOnRadio = true;
+        state = receivePacketTimeout(period + 8 * getSymbolTime() / 1000 + 1);
+        _wakeOnRadio = false;
+    }
+
+    if (state != 0)
+        writeRegister(REG_OP_MODE, LORA_SLEEP_MODE);
+
+    return state;
+}
+
+/*
+ Function: Gets the preamble length to reach a device calling wakeOnRadio(period): the preamble lasts
+           period ms plus 10%, for the clock drift, and 10 symbols for the CAD and the preamble detection.
+ Returns: The preamble length in symbols, to be set with setPreambleLength().
+ Parameters:
+   period: time between two calls to wakeOnRadio() at the receiver.
+*/
+uint16_t SX1272::getWakeOnRadioPreamble(uint16_t period)
+{
+    uint32_t symbols = (uint32_t)period * 1100UL / getSymbolTime() + 10;
+
+    return (symbols > 0xFFFF) ? 0xFFFF : (uint16_t)symbols;
+}
+
+/*
+ Function: Gets the time of a LoRa symbol with the current SF and BW.
+ Returns: The time of a symbol in us.
+*/
+uint32_t SX1272::getSymbolTime()
+{
+    return ((uint32_t)1 << _spreadingFactor) * 1000 / ((_bandwidth==BW_125)?125:((_bandwidth==BW_250)?250:500));
+}
+
 //#define DEBUG_GETTOA
 
 #ifdef DEBUG_GETTOA
@@ -7596,4 +7926,24 @@ void SX1272::setCSPin(uint8_t cs) {
 	_SX1272_SS=cs;
 }
 
+void SX1272::setDIO0Pin(uint8_t dio0) {
+	// the pin must have an interrupt, otherwise the TxDone flag is read from the radio module
+	if (digitalPinToInterrupt(dio0) == NOT_AN_INTERRUPT)
+		return;
+
+	_dio0Pin=dio0;
+	pinMode(_dio0Pin, INPUT);
+	attachInterrupt(digitalPinToInterrupt(_dio0Pin), sx1272_dio0ISR, RISING);
+}
+
+void SX1272::setDIO1Pin(uint8_t dio1) {
+	// without interrupt on DIO1, RxTimeout is read from the radio module after the symbol timeout
+	if (digitalPinToInterrupt(dio1) == NOT_AN_INTERRUPT)
+		return;
+
+	_dio1Pin=dio1;
+	pinMode(_dio1Pin, INPUT);
+	attachInterrupt(digitalPinToInterrupt(_dio1Pin), sx1272_dio1ISR, RISING);
+}
+
 SX1272 sx1272 = SX1272();
@@ -69,6 +69,11 @@
 #define SX1272_SS 10
 #endif
 
+// DIO0 of the radio module raises the TxDone/RxDone interrupts and DIO1 the RxTimeout interrupt,
+// it is not mandatory to wire them. Call setDIO0Pin()/setDIO1Pin() with pins that have an interrupt,
+// e.g. 2 and 3 on the Uno, to sleep during transmission and reception
+#define SX1272_NO_DIO 0xFF
+
 #define SX1272Chip  0
 #define SX1276Chip  1
 // end
@@ -325,6 +330,7 @@ const uint8_t LORA_SLEEP_MODE = 0x80;
 const uint8_t LORA_STANDBY_MODE = 0x81;
 const uint8_t LORA_TX_MODE = 0x83;
 const uint8_t LORA_RX_MODE = 0x85;
+const uint8_t LORA_RXSINGLE_MODE = 0x86;
 
 // added by C. Pham
 const uint8_t LORA_CAD_MODE = 0x87;
@@ -385,6 +391,9 @@ const uint8_t INCORRECT_PACKET_TYPE = 2;
 
 #define PKT_TYPE_DATA   0x10
 #define PKT_TYPE_ACK    0x20
+// data in the binary format of SensorCodec.h, the flags are the same as for PKT_TYPE_DATA
+// 0x30 is left unchanged when the send functions OR the type with PKT_TYPE_DATA
+#define PKT_TYPE_DATA_BIN   0x30
 
 #define PKT_FLAG_ACK_REQ            0x08
 #define PKT_FLAG_DATA_ENCRYPTED     0x04
@@ -913,6 +922,22 @@ public:
 	 */
 	boolean	availableData(uint16_t wait);
 
+	//! It receives a packet in Rx single mode and checks its destination before a timeout.
+  	/*!
+	The radio module stops listening after a symbol timeout, it is set again in Rx single mode
+	until 'wait' expires. With setDIO0Pin(), the MCU sleeps until RxDone, and until RxTimeout
+	with setDIO1Pin(). The packet is then read with getPacket() or getACK(). LoRa mode only.
+  	\param uint16_t wait : time to wait while there is no preamble received.
+	\return 'true' on success, 'false' otherwise
+	 */
+	boolean	receiveWindow(uint16_t wait);
+
+	//! It checks the destination of the packet whose first bytes have been read.
+  	/*!
+	\return 'true' if the packet is for the module, 'false' otherwise
+	 */
+	boolean	checkDestination();
+
 	//! It writes a packet in FIFO in order to send it.
 	/*!
 	\param uint8_t dest : packet destination.
@@ -972,6 +997,37 @@ public:
 	*/
 	uint8_t sendWithTimeout(uint16_t wait);
 
+	//! It starts sending the packet stored in FIFO and returns at once.
+	/*!
+	Call isSendDone() until it returns true, then endSend(). With setDIO0Pin(), the MCU
+	can sleep in between as the TxDone interrupt wakes it up.
+	\param uint16_t wait : time to wait to send the packet.
+	\return '0' on success, '1' otherwise
+	*/
+	uint8_t startSend(uint16_t wait);
+
+	//! It starts sending the packet wich payload is a parameter and returns at once, see startSend().
+	/*!
+	\param uint8_t dest : packet destination.
+	\param uint8_t *payload : packet payload.
+	\param uint16_t length : payload buffer length.
+	\return '0' on success, '1' otherwise
+	*/
+	uint8_t startSendPacket(uint8_t dest, uint8_t *payload, uint16_t length16);
+
+	//! It tells whether the packet started by startSend() is sent or the timeout has expired.
+	/*!
+	With setDIO0Pin(), it only reads the flag set by the TxDone interrupt, without SPI access.
+	\return true when endSend() can be called
+	*/
+	bool isSendDone();
+
+	//! It ends the transmission started by startSend().
+	/*!
+	\return '0' if the packet has been sent, '1' otherwise
+	*/
+	uint8_t endSend();
+
 	//! It tries to send the packet wich payload is a parameter before ending MAX_TIMEOUT.
 	/*!
 	\param uint8_t dest : packet destination.
@@ -1186,6 +1242,9 @@ public:
     void setPacketType(uint8_t type);
     void RxChainCalibration();
     uint8_t doCAD(uint8_t counter);
+    uint8_t wakeOnRadio(uint16_t period);
+    uint16_t getWakeOnRadioPreamble(uint16_t period);
+    uint32_t getSymbolTime();
     uint16_t getToA(uint8_t pl);
     void CarrierSense(uint8_t cs=1);
     void CarrierSense1();
@@ -1200,12 +1259,21 @@ public:
     long removeToA(uint16_t toa);
     int8_t setFreqHopOn();
     void setCSPin(uint8_t cs);
+    void setDIO0Pin(uint8_t dio0);
+    void setDIO1Pin(uint8_t dio1);
 
     // SX1272 or SX1276?
     uint8_t _board;
     uint8_t _syncWord;
     uint8_t _defaultSyncWord;
     uint8_t _SX1272_SS;
+    uint8_t _dio0Pin;
+    uint8_t _dio1Pin;
+    // receivePacketTimeout() called by wakeOnRadio()
+    bool _wakeOnRadio;
+    // millis() at startSend() and its timeout
+    unsigned long _sendStart;
+    uint16_t _sendWait;
     unsigned long _starttime;
     unsigned long _stoptime;
     unsigned long _startDoCad;
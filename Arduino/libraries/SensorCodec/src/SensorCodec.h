@@ -0,0 +1,133 @@
+/*
+ *  Compact binary encoding of the nomenclature/value sensor data
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  The same file is used by the end-devices (Arduino/libraries/SensorCodec) and
+ *  by the gateway (gw_full_latest). A packet of type PKT_TYPE_DATA_BIN carries,
+ *  after the optional 4-byte app key, a sequence of fields:
+ *
+ *    header(1B) = id(6 bits) | decimals(2 bits)
+ *    [decimals(1B)]             if the 2-bit decimals is 3, for 3 to 9 decimals
+ *    [length(1B) | name]        if id is SENSOR_CODEC_NAMED_FIELD
+ *    value(1-5B)                zigzag varint of the fixed-point value
+ *
+ *  The value is value/10^decimals, e.g. TC/23.51 is id 0, 2 decimals, 2351,
+ *  which takes 3 bytes instead of 9 characters. The id is the index of the
+ *  nomenclature in the schema below, other nomenclatures are sent by name.
+ *
+ *  The schema can only be appended to: the devices and the gateway must agree
+ *  on the index of a nomenclature.
+ *
+ *  A device can also send several samples of the same fields, taken at different
+ *  times, in a single packet. The payload is then a batch:
+ *
+ *    header(1B) = SENSOR_CODEC_BATCH << 2
+ *    n(1B) | m(1B)              number of samples, number of fields per sample
+ *    age(1-5B)                  varint, seconds between the first sample and the transmission
+ *    m fields                   the first sample, as above
+ *    n-1 times:
+ *      dt(1-5B)                 varint, seconds since the previous sample
+ *      m deltas(1-5B)           zigzag varint, difference with the previous value of the field
+ *
+ *  so that a new temperature sample usually takes 3 bytes instead of a whole packet.
+ */
+
+#ifndef SENSOR_CODEC_H
+#define SENSOR_CODEC_H
+
+#include <stdint.h>
+
+#define SENSOR_CODEC_SCHEMA \
+  "TC",  "HU",  "TC1", "HU1", "TC2", "HU2", "DS",  "LM35", \
+  "TMP36", "LW", "SH", "DIS", "BAT", "LUM", "CO2", "PH"
+
+#define SENSOR_CODEC_NAMED_FIELD    63
+#define SENSOR_CODEC_BATCH          62
+// a named field carries at most this number of characters
+#define SENSOR_CODEC_MAX_NAME_LENGTH 15
+// more decimals do not fit in an int32_t
+#define SENSOR_CODEC_MAX_DECIMALS   9
+// header, decimals, length, name and a 5-byte value
+#define SENSOR_CODEC_MAX_FIELD_SIZE (3+SENSOR_CODEC_MAX_NAME_LENGTH+5)
+
+// room for the samples of a batch, a packet is at most 8 bytes more
+#define SENSOR_CODEC_BATCH_SIZE     64
+#define SENSOR_CODEC_BATCH_MAX_FIELDS 4
+
+struct sensorCodecField {
+  uint8_t id;
+  // null-terminated nomenclature, from the schema or from the packet
+  char name[SENSOR_CODEC_MAX_NAME_LENGTH+1];
+  int32_t value;
+  uint8_t decimals;
+};
+
+// return the id of a nomenclature, or SENSOR_CODEC_NAMED_FIELD if it is not in the schema
+uint8_t sensorCodecFieldId(const char* name);
+
+// write a field at buf, name is only used for SENSOR_CODEC_NAMED_FIELD
+// return the number of bytes written, at most SENSOR_CODEC_MAX_FIELD_SIZE, 0 if decimals is too large
+uint8_t sensorCodecPut(uint8_t* buf, uint8_t id, const char* name, int32_t value, uint8_t decimals);
+
+// read the field at buf, return the number of bytes read, -1 if the field is invalid or truncated
+int sensorCodecGet(const uint8_t* buf, uint8_t len, sensorCodecField* f);
+
+// write the fields as the text payload of the end-devices, e.g. \!TC/23.51/HU/60, the last sample for a batch
+// return the length of the string, -1 if a field is invalid or if text is too small
+int sensorCodecToText(const uint8_t* buf, uint8_t len, char* text, int size);
+
+// return the number of samples, 1 if the payload is not a batch, -1 if it is invalid
+int sensorCodecSamples(const uint8_t* buf, uint8_t len);
+
+// same as sensorCodecToText() for sample k, the first one being 0
+// age is set to the number of seconds between the sample and the transmission
+int sensorCodecSampleToText(const uint8_t* buf, uint8_t len, uint8_t k, char* text, int size, uint32_t* age);
+
+// samples kept by a device until they are sent in a single packet
+struct sensorCodecBatch {
+  uint8_t data[SENSOR_CODEC_BATCH_SIZE];
+  uint8_t len;
+  // number of samples, of fields per sample, of fields in the current sample
+  uint8_t n;
+  uint8_t m;
+  uint8_t field;
+  // in seconds
+  uint32_t firstTime;
+  uint32_t lastTime;
+  int32_t values[SENSOR_CODEC_BATCH_MAX_FIELDS];
+};
+
+void sensorCodecBatchInit(sensorCodecBatch* b);
+
+// return true if another sample may not fit, the batch should then be sent
+bool sensorCodecBatchFull(const sensorCodecBatch* b);
+
+// start a new sample taken at time, in seconds
+// return false if it may not fit, the batch should then be sent first
+bool sensorCodecBatchSample(sensorCodecBatch* b, uint32_t time);
+
+// add a field to the current sample, all the samples must have the same fields in the same order
+// return false if the field does not fit or is not the expected one
+bool sensorCodecBatchPut(sensorCodecBatch* b, uint8_t id, const char* name, int32_t value, uint8_t decimals);
+
+// write the batch at buf for a transmission at time, at most SENSOR_CODEC_BATCH_SIZE+8 bytes
+// return the number of bytes written, 0 if the batch is empty or if the last sample is incomplete
+uint8_t sensorCodecBatchEnd(const sensorCodecBatch* b, uint32_t time, uint8_t* buf);
+
+#endif
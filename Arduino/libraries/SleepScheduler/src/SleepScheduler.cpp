@@ -0,0 +1,254 @@
+/*
+ *  Sleep scheduler for the end-devices
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SleepScheduler.h"
+
+#if defined __MK20DX256__ || defined __MKL26Z64__ || defined __MK64FX512__ || defined __MK66FX1M0__
+#define SLEEP_SCHEDULER_TEENSY
+#include <Snooze.h>
+
+static SnoozeTimer timer;
+static SnoozeBlock sleep_config(timer);
+#elif defined __AVR__
+// you need the LowPower library from RocketScream
+// https://github.com/rocketscream/Low-Power
+#include "LowPower.h"
+#endif
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// the watchdog sleeps, 2K to 1024K cycles of the 128kHz oscillator
+static const period_t wdtSleeps[]={SLEEP_8S, SLEEP_4S, SLEEP_2S, SLEEP_1S, SLEEP_500MS, SLEEP_250MS,
+                                   SLEEP_120MS, SLEEP_60MS, SLEEP_30MS, SLEEP_15MS};
+static const uint16_t wdtPeriods[]={8192, 4096, 2048, 1024, 512, 256, 128, 64, 32, 16};
+#endif
+
+#ifdef __SAMD21G18A__
+#include "RTCZero.h"
+
+static RTCZero rtc;
+#endif
+
+SleepScheduler::SleepScheduler()
+{
+    memset(_tasks, 0, sizeof(_tasks));
+    _clock=0;
+    _lastMillis=0;
+    _lastCalibration=0;
+    _ratio=1.0;
+    _fraction=0.0;
+    calibrationPeriod=3600000L;
+}
+
+void SleepScheduler::begin()
+{
+    _clock=0;
+    _lastMillis=millis();
+#ifdef __SAMD21G18A__
+    rtc.begin();
+    _epoch0=rtc.getEpoch();
+#endif
+    calibrate();
+}
+
+void SleepScheduler::setTask(uint8_t id, unsigned long period, unsigned long first, unsigned long jitter)
+{
+    if (id>=SLEEP_SCHEDULER_MAX_TASKS)
+        return;
+
+    _tasks[id].period=period;
+    _tasks[id].base=now()+first;
+    _tasks[id].jitter=jitter;
+    _tasks[id].due=_tasks[id].base+(jitter ? random(0, jitter+1) : 0);
+}
+
+void SleepScheduler::stopTask(uint8_t id)
+{
+    if (id<SLEEP_SCHEDULER_MAX_TASKS)
+        _tasks[id].period=0;
+}
+
+// adds the time awake, given by millis()
+void SleepScheduler::update()
+{
+    unsigned long m=millis();
+
+    _clock+=m-_lastMillis;
+    _lastMillis=m;
+}
+
+unsigned long SleepScheduler::now()
+{
+    update();
+    return _clock;
+}
+
+unsigned long SleepScheduler::nextWakeUp()
+{
+    unsigned long t=now();
+    unsigned long next=0;
+    bool found=false;
+
+    for (uint8_t i=0; i<SLEEP_SCHEDULER_MAX_TASKS; i++) {
+
+        if (!_tasks[i].period)
+            continue;
+
+        if ((long)(_tasks[i].due-t)<=0)
+            return 0;
+
+        if (!found || _tasks[i].due-t<next)
+            next=_tasks[i].due-t;
+
+        found=true;
+    }
+
+    return next;
+}
+
+uint8_t SleepScheduler::due()
+{
+    unsigned long t=now();
+    uint8_t tasks=0;
+
+    for (uint8_t i=0; i<SLEEP_SCHEDULER_MAX_TASKS; i++) {
+
+        if (!_tasks[i].period || (long)(t-_tasks[i].due)<0)
+            continue;
+
+        tasks|=1<<i;
+
+        // from the schedule, periods that have been missed while awake are skipped
+        do
+            _tasks[i].base+=_tasks[i].period;
+        while ((long)(t-_tasks[i].base)>=0);
+
+        _tasks[i].due=_tasks[i].base+(_tasks[i].jitter ? random(0, _tasks[i].jitter+1) : 0);
+    }
+
+    return tasks;
+}
+
+uint8_t SleepScheduler::sleep()
+{
+    unsigned long wait=nextWakeUp();
+
+    // the calibration takes about 1s
+    if (calibrationPeriod && now()-_lastCalibration>=calibrationPeriod && wait>2000) {
+        calibrate();
+        wait=nextWakeUp();
+    }
+
+    if (wait)
+        sleepFor(wait);
+
+    return due();
+}
+
+void SleepScheduler::sleepFor(unsigned long ms)
+{
+    update();
+
+#ifdef __AVR__
+    // watchdog sleeps as long as possible, millis() does not count the time in power-down mode
+    float remaining=ms;
+    float slept=_fraction;
+
+    for (uint8_t i=0; i<sizeof(wdtPeriods)/sizeof(wdtPeriods[0]); i++) {
+
+        float period=wdtPeriods[i]*_ratio;
+
+        while (remaining>=period) {
+            LowPower.powerDown(wdtSleeps[i], ADC_OFF, BOD_OFF);
+            remaining-=period;
+            slept+=period;
+        }
+    }
+
+    _clock+=(unsigned long)slept;
+    _fraction=slept-(unsigned long)slept;
+
+    // less than 16ms, not before the task is due
+    if (remaining>0.0)
+        delay((unsigned long)ceil(remaining));
+
+#elif defined __SAMD21G18A__
+    // the alarm of the RTC at the nearest second, at most 24h later with MATCH_HHMMSS
+    uint32_t wake=_epoch0+(_clock+ms+500)/1000;
+    uint32_t epoch=rtc.getEpoch();
+
+    while (wake>epoch) {
+        uint32_t alarm=(wake-epoch<86400) ? wake : epoch+86399;
+
+        rtc.setAlarmTime((alarm%86400)/3600, (alarm%3600)/60, alarm%60);
+        rtc.enableAlarm(rtc.MATCH_HHMMSS);
+        rtc.standbyMode();
+        rtc.disableAlarm();
+        epoch=rtc.getEpoch();
+    }
+
+    // the RTC gives the time asleep
+    _clock=(epoch-_epoch0)*1000;
+    _lastMillis=millis();
+
+#elif defined SLEEP_SCHEDULER_TEENSY
+    // the timer accepts from 1ms to 65535ms
+    float remaining=ms/_ratio;
+    float slept=_fraction;
+
+    while (remaining>=1.0) {
+        uint16_t chunk=(remaining>65535.0) ? 65535 : (uint16_t)remaining;
+
+        timer.setTimer(chunk);
+        Snooze.deepSleep(sleep_config);
+        remaining-=chunk;
+        slept+=chunk*_ratio;
+    }
+
+    _clock+=(unsigned long)slept;
+    _fraction=slept-(unsigned long)slept;
+    _lastMillis=millis();
+
+#else
+    delay(ms);
+#endif
+}
+
+void SleepScheduler::calibrate()
+{
+#ifdef __AVR__
+    unsigned long start;
+
+    // 1024ms of the watchdog in interrupt mode while timer0 runs, WDIE is cleared
+    // in hardware when the interrupt of the LowPower library is called
+    wdt_enable(WDTO_1S);
+    WDTCSR |= (1 << WDIE);
+    start=micros();
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+
+    while (WDTCSR & (1 << WDIE))
+        sleep_mode();
+
+    _ratio=(micros()-start)/1024000.0;
+#endif
+    _lastCalibration=now();
+}
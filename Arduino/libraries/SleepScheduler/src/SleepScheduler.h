@@ -0,0 +1,98 @@
+/*
+ *  Sleep scheduler for the end-devices
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  The device has a few periodic tasks (sensing, transmission, receive window...)
+ *  given by their period and, optionally, a random jitter. sleep() sleeps until the
+ *  next task is due and returns the bit mask of the due tasks. The next time of a
+ *  task is computed from its schedule, not from the time it is run, so that the
+ *  time the device is awake does not delay the next ones.
+ *
+ *  The clock of the scheduler, now(), counts the time asleep:
+ *    - AVR: the longest watchdog sleeps of the LowPower library are chained, from
+ *      8s down to 16ms. The watchdog oscillator (128kHz) can be 10% off and depends
+ *      on the temperature and the voltage: calibrate() measures it against the
+ *      crystal of millis() and the sleeps are corrected with this ratio. It is
+ *      measured again every calibrationPeriod ms
+ *    - SAMD21: the RTC (32.768kHz crystal) wakes up the board from standby mode,
+ *      with a resolution of 1s
+ *    - Teensy: the timer of the Snooze library (v6), in chunks of at most 65535ms,
+ *      corrected with the ratio given to setRatio()
+ *    - other boards: delay()
+ */
+
+#ifndef SLEEP_SCHEDULER_H
+#define SLEEP_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SLEEP_SCHEDULER_MAX_TASKS 8
+
+class SleepScheduler {
+  public:
+    SleepScheduler();
+
+    // starts the clock, and calibrates the watchdog on AVR
+    void begin();
+    // task 'id' is due every 'period' ms, the first time 'first' ms from now, plus a random
+    // time between 0 and 'jitter' ms at each period
+    void setTask(uint8_t id, unsigned long period, unsigned long first=0, unsigned long jitter=0);
+    void stopTask(uint8_t id);
+
+    // ms since begin(), including the time asleep
+    unsigned long now();
+    // ms until the next task is due, 0 if one is due or if there is no task
+    unsigned long nextWakeUp();
+    // bit mask of the due tasks, the next time of these tasks is computed
+    uint8_t due();
+    // sleeps until the next task is due, returns due()
+    uint8_t sleep();
+    // sleeps 'ms' ms, with the longest hardware sleeps
+    void sleepFor(unsigned long ms);
+
+    // measures the sleep oscillator against the system clock, AVR only
+    void calibrate();
+    // time asleep for 1 nominal ms of the sleep oscillator
+    float getRatio() { return _ratio; }
+    void setRatio(float ratio) { _ratio=ratio; }
+
+    // ms between 2 calibrations in sleep(), 0 to calibrate only in begin()
+    unsigned long calibrationPeriod;
+
+  private:
+    void update();
+
+    struct {
+      unsigned long period;
+      unsigned long base;
+      unsigned long due;
+      unsigned long jitter;
+    } _tasks[SLEEP_SCHEDULER_MAX_TASKS];
+
+    unsigned long _clock;
+    unsigned long _lastMillis;
+    unsigned long _lastCalibration;
+    float _ratio;
+    float _fraction;
+#ifdef __SAMD21G18A__
+    uint32_t _epoch0;
+#endif
+};
+
+#endif
@@ -0,0 +1,551 @@
+/************************************************************************
+ *									                                    *
+ *	Fast DCT for image compression scheme				                *
+ *									                                    *
+ *	Author: Vincent LECUIRE, CRAN UMR 7039, Nancy-Université, CNRS	    *
+ *	Date: march, 16 2012						                        *
+ *									                                    *
+ ************************************************************************/
+
+/**
+@file jpeg_dct.h
+@brief DCT and quantization of the 8x8 blocks of the image encoder
+*/
+
+/* adapted to the Arduino image sensor board by Congduc Pham, University of Pau, 2015 */
+/* moved from Arduino_LoRa_ucamII.ino with the fixed-point version, Oct 19th, 2026      */
+
+/*
+ * As mqc.h, it is included by the sketch after its #define statements:
+ *   - CRAN_NEW_CODING: DCT of one block with shifts and adds (Cordic-Loeffler), JPEGencoding(int Block[8][8])
+ *     is JPEGtransform() then JPEGquantization(), which jpeg_rate.h calls separately
+ *   - otherwise: DCT of the whole image (Loeffler), JPEGencoding(InImageStruct*, OutImageStruct*)
+ *   - FIXED_POINT_DCT: no float operation after QTinitialization(). The old DCT is computed in
+ *     32-bit integers with 13-bit constants, and the divide-and-round of the quantization becomes
+ *     a multiplication by the reciprocal of the quantization step computed by QTinitialization()
+ */
+
+#ifdef FIXED_POINT_DCT
+
+// x/step is (x*recip+2^(shift-1))>>shift, recip is between 2^15 and 2^16
+unsigned short LuminanceReciprocalTable[8][8];
+uint8_t LuminanceShiftTable[8][8];
+
+void QTreciprocal(float step, unsigned short *recip, uint8_t *shift)
+{
+ uint8_t s=15;
+ float r;
+
+ while ((float)(1UL<<(s-15)) < step)
+   s++;
+
+ r=(float)(1UL<<s)/step+0.5;
+
+ *recip=(r >= 65535.0) ? 65535 : (unsigned short)r;
+ *shift=s;
+}
+
+// rounds half away from zero as round(), |x| must be lower than 2^15
+static inline int QTquantize(long x, unsigned short recip, uint8_t shift)
+{
+ unsigned long half=1UL<<(shift-1);
+
+ if (x < 0)
+   return -(int)(((unsigned long)(-x)*recip+half)>>shift);
+
+ return (int)(((unsigned long)x*recip+half)>>shift);
+}
+
+#endif
+
+#ifdef CRAN_NEW_CODING
+
+float CordicLoefflerScalingFactor[8]={0.35355339, 0.35355339, 0.31551713, 0.5, 0.35355339, 0.5, 0.31551713, 0.35355339};
+
+short OriginalLuminanceJPEGTable[8][8] = {
+  16,  11,  10,  16,  24,  40,  51,  61,
+  12,  12,  14,  19,  26,  58,  60,  55,
+  14,  13,  16,  24,  40,  57,  69,  56,
+  14,  17,  22,  29,  51,  87,  80,  62,
+  18,  22,  37,  56,  68, 109, 103,  77,
+  24,  35,  55,  64,  81, 104, 113,  92,
+  49,  64,  78,  87, 103, 121, 120, 101,
+  72,  92,  95,  98, 112, 100, 103,  99
+};
+
+short LuminanceJPEGTable[8][8] = {
+  16,  11,  10,  16,  24,  40,  51,  61,
+  12,  12,  14,  19,  26,  58,  60,  55,
+  14,  13,  16,  24,  40,  57,  69,  56,
+  14,  17,  22,  29,  51,  87,  80,  62,
+  18,  22,  37,  56,  68, 109, 103,  77,
+  24,  35,  55,  64,  81, 104, 113,  92,
+  49,  64,  78,  87, 103, 121, 120, 101,
+  72,  92,  95,  98, 112, 100, 103,  99
+};
+
+void QTinitialization(int Quality)
+{
+ float Qs, scale;
+
+ if (Quality <= 0)  Quality = 1;
+ if (Quality > 100) Quality = 100;
+ if (Quality < 50)   Qs = 50.0 / (float) Quality;
+ 	else	     Qs = 2.0 - (float) Quality/50.0;
+
+ // Calcul des coefficients de la table de quantification
+ for (int u=0; u<8; u++)
+   for (int v=0; v<8; v++)
+	{
+	 scale = (float) OriginalLuminanceJPEGTable[u][v] * Qs;
+
+	 if (scale < 1.0) scale=1.0;
+
+	 LuminanceJPEGTable[u][v] = (short) round (scale / (CordicLoefflerScalingFactor[u]*CordicLoefflerScalingFactor[v]));
+#ifdef FIXED_POINT_DCT
+	 QTreciprocal(LuminanceJPEGTable[u][v], &LuminanceReciprocalTable[u][v], &LuminanceShiftTable[u][v]);
+#endif
+	}
+
+ return;
+}
+
+#ifdef FIXED_POINT_DCT
+#define JPEG_QUANTIZE(u, v) QTquantize(Block[u][v], LuminanceReciprocalTable[u][v], LuminanceShiftTable[u][v])
+#else
+#define JPEG_QUANTIZE(u, v) (int)round((float)Block[u][v] / (float)LuminanceJPEGTable[u][v])
+#endif
+
+// the DCT of the block, in place, without the quantization
+void JPEGtransform(int Block[8][8])
+{
+ int tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+ int tmp10, tmp11, tmp12, tmp13, tmp20, tmp23;
+ int z11, z12, z21, z22;
+ 
+    // On calcule la DCT, puis on quantifie
+    for (int u=0; u<8; u++)
+      {
+       tmp0=Block[u][0]+Block[u][7];
+       tmp7=Block[u][0]-Block[u][7];
+       tmp1=Block[u][1]+Block[u][6];
+       tmp6=Block[u][1]-Block[u][6];
+       tmp2=Block[u][2]+Block[u][5];
+       tmp5=Block[u][2]-Block[u][5];
+       tmp3=Block[u][3]+Block[u][4];
+       tmp4=Block[u][3]-Block[u][4];
+       
+       tmp10=tmp0+tmp3;
+       tmp13=tmp0-tmp3;
+       tmp11=tmp1+tmp2;
+       tmp12=tmp1-tmp2;
+
+       Block[u][0]=tmp10+tmp11;
+       Block[u][4]=tmp10-tmp11;
+       z11=tmp13+tmp12;	
+       z12=tmp13-tmp12;
+       z21=z11+(z12>>1);
+       z22=z12-(z11>>1);
+       Block[u][2]=z21-(z22>>4);
+       Block[u][6]=z22+(z21>>4);
+
+       z11=tmp4+(tmp7>>1);
+       z12=tmp7-(tmp4>>1);
+       z21=z11+(z12>>3);
+       z22=z12-(z11>>3);
+       z21=z21-(z21>>3);
+       z22=z22-(z22>>3);
+       tmp10=z21+(z21>>6);
+       tmp13=z22+(z22>>6);
+       z11=tmp5+(tmp6>>3);
+       z12=tmp6-(tmp5>>3);
+       tmp11=z11+(z12>>4);
+       tmp12=z12-(z11>>4);
+
+       tmp20=tmp10+tmp12;
+       Block[u][5]=tmp10-tmp12;
+       tmp23=tmp13+tmp11;
+       Block[u][3]=tmp13-tmp11;
+       Block[u][1]=tmp23+tmp20;
+       Block[u][7]=tmp23-tmp20;
+    }		
+
+    // On attaque ensuite colonne par colonne
+    for (int v=0; v<8; v++)
+      {
+       // 1Ëre Ètape
+       tmp0= Block[0][v]+Block[7][v];
+       tmp7= Block[0][v]-Block[7][v];
+       tmp1= Block[1][v]+Block[6][v];
+       tmp6= Block[1][v]-Block[6][v];
+       tmp2= Block[2][v]+Block[5][v];
+       tmp5= Block[2][v]-Block[5][v];
+       tmp3= Block[3][v]+Block[4][v];
+       tmp4= Block[3][v]-Block[4][v];
+
+       tmp10=tmp0+tmp3;
+       tmp13=tmp0-tmp3;
+       tmp11=tmp1+tmp2;
+       tmp12=tmp1-tmp2;
+
+       Block[0][v]=tmp10+tmp11;
+       Block[4][v]=tmp10-tmp11;
+       z11=tmp13+tmp12;	
+       z12=tmp13-tmp12;
+       z21=z11+(z12>>1);
+       z22=z12-(z11>>1);
+       Block[2][v]=z21-(z22>>4);
+       Block[6][v]=z22+(z21>>4);
+
+       z11=tmp4+(tmp7>>1);
+       z12=tmp7-(tmp4>>1);
+       z21=z11+(z12>>3);
+       z22=z12-(z11>>3);
+       z21=z21-(z21>>3);
+       z22=z22-(z22>>3);
+
+       tmp10=z21+(z21>>6);
+       tmp13=z22+(z22>>6);
+       z11=tmp5+(tmp6>>3);
+       z12=tmp6-(tmp5>>3);
+       tmp11=z11+(z12>>4);
+       tmp12=z12-(z11>>4);
+
+       tmp20=tmp10+tmp12;
+       Block[5][v]=tmp10-tmp12;
+       tmp23=tmp13+tmp11;
+       Block[3][v]=tmp13-tmp11;
+       Block[1][v]=tmp23+tmp20;
+       Block[7][v]=tmp23-tmp20;
+    }
+
+    // on centre sur l'interval [-128, 127]
+    Block[0][0]-=8192;
+
+   return;
+}
+
+// the quantization of the DCT coefficients with the table of QTinitialization(), in place
+void JPEGquantization(int Block[8][8])
+{
+    // Quantification
+#ifdef DISPLAY_BLOCK
+    Serial.println(F("JPEGencoding:"));
+    
+    for (int u=0; u<8; u++) {
+       for (int v=0; v<8; v++) {
+          Block[u][v] = JPEG_QUANTIZE(u, v);
+
+          Serial.print(Block[u][v]);
+          Serial.print(F("\t"));
+       }   
+       Serial.println("");
+    }   
+#else
+
+    for (int u=0; u<8; u++)
+       for (int v=0; v<8; v++)
+	   Block[u][v] = JPEG_QUANTIZE(u, v);
+
+#endif
+
+   return;
+}
+
+void JPEGencoding(int Block[8][8])
+{
+ JPEGtransform(Block);
+ JPEGquantization(Block);
+}
+
+#else
+
+#define a4   1.38703984532215
+#define a7  -0.275899379282943
+#define a47  0.831469612302545
+#define a5   1.17587560241936
+#define a6  -0.785694958387102
+#define a56  0.98078528040323
+#define a2   1.84775906502257
+#define a3   0.765366864730179
+#define a23  0.541196100146197
+#define a32  1.306562964876376
+#define rc2  1.414213562373095
+
+#ifdef FIXED_POINT_DCT
+// the constants on 13 bits, the first pass keeps 2 more bits and the result 1 more bit
+#define DCT_CONST_BITS  13
+#define DCT_PASS1_BITS  2
+#define DCT_OUT_BITS    1
+#define DCT_FIX(x)      ((long)((x)*(1L<<DCT_CONST_BITS)+((x)<0 ? -0.5 : 0.5)))
+#define DCT_DESCALE(x,n) (((x)+(1L<<((n)-1)))>>(n))
+#endif
+
+float OriginalLuminanceJPEGTable[8][8] = {
+  16.0,  11.0,  10.0,  16.0,  24.0,  40.0,  51.0,  61.0,
+  12.0,  12.0,  14.0,  19.0,  26.0,  58.0,  60.0,  55.0,
+  14.0,  13.0,  16.0,  24.0,  40.0,  57.0,  69.0,  56.0,
+  14.0,  17.0,  22.0,  29.0,  51.0,  87.0,  80.0,  62.0,
+  18.0,  22.0,  37.0,  56.0,  68.0, 109.0, 103.0,  77.0,
+  24.0,  35.0,  55.0,  64.0,  81.0, 104.0, 113.0,  92.0,
+  49.0,  64.0,  78.0,  87.0, 103.0, 121.0, 120.0, 101.0,
+  72.0,  92.0,  95.0,  98.0, 112.0, 100.0, 103.0,  99.0
+};
+
+float LuminanceJPEGTable[8][8] = {
+  16.0,  11.0,  10.0,  16.0,  24.0,  40.0,  51.0,  61.0,
+  12.0,  12.0,  14.0,  19.0,  26.0,  58.0,  60.0,  55.0,
+  14.0,  13.0,  16.0,  24.0,  40.0,  57.0,  69.0,  56.0,
+  14.0,  17.0,  22.0,  29.0,  51.0,  87.0,  80.0,  62.0,
+  18.0,  22.0,  37.0,  56.0,  68.0, 109.0, 103.0,  77.0,
+  24.0,  35.0,  55.0,  64.0,  81.0, 104.0, 113.0,  92.0,
+  49.0,  64.0,  78.0,  87.0, 103.0, 121.0, 120.0, 101.0,
+  72.0,  92.0,  95.0,  98.0, 112.0, 100.0, 103.0,  99.0
+};
+
+void QTinitialization(int Quality)
+{
+ float Qs;
+
+ if (Quality <= 0)  Quality = 1;
+ if (Quality > 100) Quality = 100;
+ if (Quality < 50)   Qs = 50.0 / (float) Quality;
+ 	else	     Qs = 2.0 - (float) Quality/50.0;
+
+
+ // Calcul des coefficients de la table de quantification
+ for (int u=0; u<8; u++)
+   for (int v=0; v<8; v++)
+	{
+	 LuminanceJPEGTable[u][v] = OriginalLuminanceJPEGTable[u][v] * Qs;
+	 if (LuminanceJPEGTable[u][v] < 1.0) LuminanceJPEGTable[u][v]=1.0;
+	 if (LuminanceJPEGTable[u][v] > 255.0) LuminanceJPEGTable[u][v]=255.0;
+#ifdef FIXED_POINT_DCT
+	 // the DCT gives 8 times the coefficients, with DCT_OUT_BITS more bits
+	 QTreciprocal(LuminanceJPEGTable[u][v] * 8.0 * (1<<DCT_OUT_BITS), &LuminanceReciprocalTable[u][v], &LuminanceShiftTable[u][v]);
+#endif
+	}
+
+ return;
+}
+
+#ifdef FIXED_POINT_DCT
+
+// same butterflies than the float version below, the products are on 32 bits
+void JPEGencoding(InImageStruct *InputImage , OutImageStruct *OutputImage)
+{
+   long Block[8][8];
+   long tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+   long tmp10, tmp11, tmp12, tmp13, tmp20, tmp23;
+   long tmp;
+
+   // Encodage bloc par bloc
+   for (int i=0; i<InputImage->imageVsize; i=i+8)
+     for (int j=0; j<InputImage->imageHsize; j=j+8) {
+       
+	  for (int u=0; u<8; u++)
+	   for (int v=0; v<8; v++) Block[u][v]=InputImage->data[i+u][j+v];
+
+          // lignes: les résultats sont multipliés par 2^DCT_PASS1_BITS
+          for (int u=0; u<8; u++)
+            {
+             tmp0=Block[u][0]+Block[u][7];
+             tmp7=Block[u][0]-Block[u][7];
+             tmp1=Block[u][1]+Block[u][6];
+             tmp6=Block[u][1]-Block[u][6];
+             tmp2=Block[u][2]+Block[u][5];
+             tmp5=Block[u][2]-Block[u][5];
+             tmp3=Block[u][3]+Block[u][4];
+             tmp4=Block[u][3]-Block[u][4];
+
+             tmp10=tmp0+tmp3;
+             tmp13=tmp0-tmp3;
+             tmp11=tmp1+tmp2;
+             tmp12=tmp1-tmp2;
+
+             Block[u][0]=(tmp10+tmp11)*(1<<DCT_PASS1_BITS);
+             Block[u][4]=(tmp10-tmp11)*(1<<DCT_PASS1_BITS);
+             tmp=(tmp12+tmp13)*DCT_FIX(a23);
+             Block[u][2]=DCT_DESCALE(tmp+DCT_FIX(a3)*tmp13, DCT_CONST_BITS-DCT_PASS1_BITS);
+             Block[u][6]=DCT_DESCALE(tmp-DCT_FIX(a2)*tmp12, DCT_CONST_BITS-DCT_PASS1_BITS);
+
+             tmp=(tmp4+tmp7)*DCT_FIX(a47);
+             tmp10=tmp+DCT_FIX(a7)*tmp7;
+             tmp13=tmp-DCT_FIX(a4)*tmp4;
+             tmp=(tmp5+tmp6)*DCT_FIX(a56);
+             tmp11=tmp+DCT_FIX(a6)*tmp6;
+             tmp12=tmp-DCT_FIX(a5)*tmp5;
+
+             tmp20=tmp10+tmp12;
+             tmp23=tmp13+tmp11;
+             Block[u][7]=DCT_DESCALE(tmp23-tmp20, DCT_CONST_BITS-DCT_PASS1_BITS);
+             Block[u][1]=DCT_DESCALE(tmp23+tmp20, DCT_CONST_BITS-DCT_PASS1_BITS);
+             Block[u][3]=DCT_DESCALE(DCT_DESCALE(tmp13-tmp11, DCT_CONST_BITS-DCT_PASS1_BITS)*DCT_FIX(rc2), DCT_CONST_BITS);
+             Block[u][5]=DCT_DESCALE(DCT_DESCALE(tmp10-tmp12, DCT_CONST_BITS-DCT_PASS1_BITS)*DCT_FIX(rc2), DCT_CONST_BITS);
+            }                
+
+          // colonnes: les résultats gardent DCT_OUT_BITS bits
+          for (int v=0; v<8; v++)
+            {
+             tmp0=Block[0][v]+Block[7][v];
+             tmp1=Block[1][v]+Block[6][v];
+             tmp2=Block[2][v]+Block[5][v];
+             tmp3=Block[3][v]+Block[4][v];
+             tmp4=Block[3][v]-Block[4][v];
+             tmp5=Block[2][v]-Block[5][v];
+             tmp6=Block[1][v]-Block[6][v];
+             tmp7=Block[0][v]-Block[7][v];
+
+             tmp10=tmp0+tmp3;
+             tmp13=tmp0-tmp3;
+             tmp11=tmp1+tmp2;
+             tmp12=tmp1-tmp2;
+
+             Block[0][v]=DCT_DESCALE(tmp10+tmp11, DCT_PASS1_BITS-DCT_OUT_BITS);
+             Block[4][v]=DCT_DESCALE(tmp10-tmp11, DCT_PASS1_BITS-DCT_OUT_BITS);
+             tmp=(tmp12+tmp13)*DCT_FIX(a23);
+             Block[2][v]=DCT_DESCALE(tmp+DCT_FIX(a3)*tmp13, DCT_CONST_BITS+DCT_PASS1_BITS-DCT_OUT_BITS);
+             Block[6][v]=DCT_DESCALE(tmp-DCT_FIX(a2)*tmp12, DCT_CONST_BITS+DCT_PASS1_BITS-DCT_OUT_BITS);
+
+             tmp=(tmp4+tmp7)*DCT_FIX(a47);
+             tmp10=tmp+DCT_FIX(a7)*tmp7;
+             tmp13=tmp-DCT_FIX(a4)*tmp4;
+             tmp=(tmp5+tmp6)*DCT_FIX(a56);
+             tmp11=tmp+DCT_FIX(a6)*tmp6;
+             tmp12=tmp-DCT_FIX(a5)*tmp5;
+
+             tmp20=tmp10+tmp12;
+             tmp23=tmp13+tmp11;
+             Block[7][v]=DCT_DESCALE(tmp23-tmp20, DCT_CONST_BITS+DCT_PASS1_BITS-DCT_OUT_BITS);
+             Block[1][v]=DCT_DESCALE(tmp23+tmp20, DCT_CONST_BITS+DCT_PASS1_BITS-DCT_OUT_BITS);
+             Block[3][v]=DCT_DESCALE(DCT_DESCALE(tmp13-tmp11, DCT_CONST_BITS)*DCT_FIX(rc2), DCT_CONST_BITS+DCT_PASS1_BITS-DCT_OUT_BITS);
+             Block[5][v]=DCT_DESCALE(DCT_DESCALE(tmp10-tmp12, DCT_CONST_BITS)*DCT_FIX(rc2), DCT_CONST_BITS+DCT_PASS1_BITS-DCT_OUT_BITS);
+            }
+
+          // on centre sur l'interval [-128, 127]
+          Block[0][0]-=8192L<<DCT_OUT_BITS;
+      
+          // Quantification et on range le résultat dans l'image de sortie
+          for (int u=0; u<8; u++)
+             for (int v=0; v<8; v++)
+      		OutputImage->data[i+u][j+v]=QTquantize(Block[u][v], LuminanceReciprocalTable[u][v], LuminanceShiftTable[u][v]);
+   }
+   return;
+}
+
+#else
+
+void JPEGencoding(InImageStruct *InputImage , OutImageStruct *OutputImage)
+{
+   float Block[8][8];
+   float tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+   float tmp10, tmp11, tmp12, tmp13, tmp20, tmp23;
+   float tmp;
+
+   // Encodage bloc par bloc
+   for (int i=0; i<InputImage->imageVsize; i=i+8)
+     for (int j=0; j<InputImage->imageHsize; j=j+8) {
+       
+	  for (int u=0; u<8; u++)
+	   for (int v=0; v<8; v++) Block[u][v]=InputImage->data[i+u][j+v];
+
+          // On calcule la DCT, puis on quantifie
+          for (int u=0; u<8; u++)
+            {
+             // 1ère étape
+             tmp0=Block[u][0]+Block[u][7];
+             tmp7=Block[u][0]-Block[u][7];
+             tmp1=Block[u][1]+Block[u][6];
+             tmp6=Block[u][1]-Block[u][6];		// soit 8 ADD
+             tmp2=Block[u][2]+Block[u][5];
+             tmp5=Block[u][2]-Block[u][5];
+             tmp3=Block[u][3]+Block[u][4];
+             tmp4=Block[u][3]-Block[u][4];
+             // 2ème étape: Partie paire
+             tmp10=tmp0+tmp3;
+             tmp13=tmp0-tmp3;			// soit 4 ADD
+             tmp11=tmp1+tmp2;
+             tmp12=tmp1-tmp2;
+             // 3ème étape: Partie paire
+             Block[u][0]=tmp10+tmp11;
+             Block[u][4]=tmp10-tmp11;
+             tmp=(tmp12+tmp13)*a23;		// soit 3 MULT et 5 ADD
+             Block[u][2]=tmp+(a3*tmp13);
+             Block[u][6]=tmp-(a2*tmp12);
+             // 2ème étape: Partie impaire
+             tmp=(tmp4+tmp7)*a47;
+             tmp10=tmp+(a7*tmp7);
+             tmp13=tmp-(a4*tmp4);
+             tmp=(tmp5+tmp6)*a56;		// soit 6 MULT et 6 ADD
+             tmp11=tmp+(a6*tmp6);
+             tmp12=tmp-(a5*tmp5);
+             // 3ème étape: Partie impaire
+             tmp20=tmp10+tmp12;
+             tmp23=tmp13+tmp11;
+             Block[u][7]=tmp23-tmp20;		// soit 2 MULT et 6 ADD
+             Block[u][1]=tmp23+tmp20;
+             Block[u][3]=(tmp13-tmp11)*rc2;
+             Block[u][5]=(tmp10-tmp12)*rc2;
+            }                
+
+          for (int v=0; v<8; v++)
+            {
+             // 1ère étape
+             tmp0=Block[0][v]+Block[7][v];
+             tmp1=Block[1][v]+Block[6][v];
+             tmp2=Block[2][v]+Block[5][v];
+             tmp3=Block[3][v]+Block[4][v];
+             tmp4=Block[3][v]-Block[4][v];
+             tmp5=Block[2][v]-Block[5][v];
+             tmp6=Block[1][v]-Block[6][v];
+             tmp7=Block[0][v]-Block[7][v];
+             // 2ème étape: Partie paire
+             tmp10=tmp0+tmp3;
+             tmp13=tmp0-tmp3;
+             tmp11=tmp1+tmp2;
+             tmp12=tmp1-tmp2;
+             // 3ème étape: Partie paire
+             Block[0][v]=tmp10+tmp11;
+             Block[4][v]=tmp10-tmp11;
+             tmp=(tmp12+tmp13)*a23;
+             Block[2][v]=tmp+(a3*tmp13);
+             Block[6][v]=tmp-(a2*tmp12);
+             // 2ème étape: Partie impaire
+             tmp=(tmp4+tmp7)*a47;
+             tmp10=tmp+(a7*tmp7);
+             tmp13=tmp-(a4*tmp4);
+             tmp=(tmp5+tmp6)*a56;
+             tmp11=tmp+(a6*tmp6);
+             tmp12=tmp-(a5*tmp5);
+             // 3ème étape: Partie impaire
+             tmp20=tmp10+tmp12;
+             tmp23=tmp13+tmp11;
+             Block[7][v]=tmp23-tmp20;
+             Block[1][v]=tmp23+tmp20;
+             Block[3][v]=(tmp13-tmp11)*rc2;
+             Block[5][v]=(tmp10-tmp12)*rc2;
+            }
+
+          // on centre sur l'interval [-128, 127]
+          Block[0][0]-=8192.0;
+      
+          // Quantification
+          for (int u=0; u<8; u++)
+             for (int v=0; v<8; v++)
+      	       Block[u][v] = round(Block[u][v] / (LuminanceJPEGTable[u][v] * 8.0));
+          
+          // On range le résultat dans l'image de sortie
+      	  for (int u=0; u<8; u++)
+      	     for (int v=0; v<8; v++)
+#ifdef SHORT_COMPUTATION
+      		OutputImage->data[i+u][j+v]=(short)Block[u][v];
+#else
+      		OutputImage->data[i+u][j+v]=Block[u][v];
+#endif      
+   }
+   return;
+}
+
+#endif
+
+#endif
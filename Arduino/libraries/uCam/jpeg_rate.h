@@ -0,0 +1,249 @@
+/*
+ *  Quality factor and packet size of the image for a time on air, for the new CRAN encoding
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  Included by the sketch after jpeg_dct.h, mqc.h and packet_fec.h (with WITH_FEC), with
+ *  CRAN_NEW_CODING.
+ *
+ *  RateSample() computes JPEGtransform() once for RATE_SAMPLE_BLOCKS blocks spread in the
+ *  interleaved order of the packets. For a quality factor, RateEstimate() quantizes them
+ *  with the table of QTinitialization() and codes them with the MQ coder as FillPacket() does:
+ *  the size of the image is that of the sampled blocks times the number of blocks, without
+ *  the DCT of the whole image.
+ *
+ *  RateImageToA() is the time on air of the packets of the image, with RateToA(), i.e.
+ *  sx1272.getToA() in the sketch: a packet ends when its next block does not fit, about half
+ *  a block before the MSS, and with RateFECgroupSize the FEC_OVERHEAD() of the data packets
+ *  and the RateFECparity parity packets of each group are counted.
+ *
+ *  RateControl() finds, by bisection between RATE_MIN_QUALITY and RATE_MAX_QUALITY, the highest
+ *  quality factor for which the image fits in the target time on air with the largest packets,
+ *  then the MSS up to maxMss that gives the lowest time on air for this quality factor, as
+ *  the payload of a LoRa packet is sent in blocks of symbols. When even RATE_MIN_QUALITY does
+ *  not fit, it is RATE_MIN_QUALITY.
+ */
+
+#ifndef JPEG_RATE_H
+#define JPEG_RATE_H
+
+// 2 bytes per coefficient, 4KB with 32 blocks
+#ifndef RATE_SAMPLE_BLOCKS
+#define RATE_SAMPLE_BLOCKS 32
+#endif
+
+#define RATE_MIN_QUALITY 5
+#define RATE_MAX_QUALITY 90
+// MIN_PKT_SIZE of the sketch
+#define RATE_MIN_MSS 32
+// the MQ coder is flushed when the sampled blocks reach half of the buffer
+#define RATE_BUFFER_SIZE 320
+
+// time on air in ms of a LoRa packet with pl bytes of payload
+typedef uint16_t (*RateToAFunction)(uint8_t pl);
+
+RateToAFunction RateToA=NULL;
+// the bytes of each packet before its MQ data: preamble, offset field and header of the library
+uint8_t RateOverhead=0;
+// 0 without FEC
+uint8_t RateFECgroupSize=0;
+uint8_t RateFECparity=0;
+
+// the coefficients of the sampled blocks, before the quantization
+short RateSampleBlocks[RATE_SAMPLE_BLOCKS][8][8];
+uint8_t RateSamples=0;
+unsigned int RateBlocks=0;
+
+// the result of RateControl()
+unsigned long RateEstimatedBytes=0;
+unsigned long RateEstimatedToA=0;
+unsigned int RateMSS=0;
+
+opj_mqc_t RateMqc;
+uint8_t RateBuffer[RATE_BUFFER_SIZE+1];
+
+// as the sketch, data[x][y] is the pixel of column x of line y of a square image
+void RateSample(InImageStruct *image)
+{
+ int Block[8][8];
+ unsigned int Hblocks=image->imageHsize/8;
+ unsigned int step;
+
+ RateBlocks=Hblocks*Hblocks;
+ step=RateBlocks > RATE_SAMPLE_BLOCKS ? RateBlocks/RATE_SAMPLE_BLOCKS : 1;
+ RateSamples=0;
+
+ for (unsigned int s=0; s*step<RateBlocks && RateSamples<RATE_SAMPLE_BLOCKS; s++) {
+   // one block of each step, at a different place in each step not to sample the same columns
+   unsigned int k=s*step+s%step;
+   unsigned int row=k/Hblocks;
+   unsigned int col=k%Hblocks;
+   unsigned int row_mix=((row*5)+(col*8))%Hblocks*8;
+   unsigned int col_mix=((row*8)+(col*13))%Hblocks*8;
+
+   for (uint8_t i=0; i<8; i++)
+     for (uint8_t j=0; j<8; j++)
+       Block[i][j]=(int)image->data[row_mix+i][col_mix+j];
+
+   JPEGtransform(Block);
+
+   for (uint8_t i=0; i<8; i++)
+     for (uint8_t j=0; j<8; j++)
+       RateSampleBlocks[RateSamples][i][j]=Block[i][j];
+
+   RateSamples++;
+ }
+}
+
+static void RateGolomb(unsigned int value)
+{
+ for (unsigned int x=0; x<value/2; x++)
+   mqc_encode(&RateMqc, 1);
+
+ mqc_encode(&RateMqc, 0);
+ mqc_encode(&RateMqc, value%2);
+}
+
+// the bytes of MQ data of the whole blocks of the image, QTinitialization() is called with Quality
+unsigned long RateEstimate(int Quality)
+{
+ int Block[8][8];
+ unsigned long bytes=0;
+
+ if (RateSamples == 0)
+   return 0;
+
+ QTinitialization(Quality);
+
+ // the byte before the buffer is read by mqc_init_enc()
+ RateBuffer[0]=0;
+ mqc_init_enc(&RateMqc, RateBuffer+1);
+ mqc_resetstates(&RateMqc);
+
+ for (uint8_t b=0; b<RateSamples; b++) {
+   int K=63;
+
+   for (uint8_t i=0; i<8; i++)
+     for (uint8_t j=0; j<8; j++)
+       Block[i][j]=RateSampleBlocks[b][i][j];
+
+   JPEGquantization(Block);
+
+   while (Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col] == 0 && K > 0)
+     K--;
+
+   K++;
+   RateGolomb(K);
+
+   for (int x=0; x<K; x++) {
+     int c=Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col];
+
+     RateGolomb(c >= 0 ? 2*c : 2*abs(c)-1);
+   }
+
+   // as a new packet, a block is at most about 100 bytes at Q=90
+   if (mqc_numbytes(&RateMqc) >= RATE_BUFFER_SIZE/2) {
+     mqc_flush(&RateMqc);
+     bytes+=mqc_numbytes(&RateMqc);
+     mqc_init_enc(&RateMqc, RateBuffer+1);
+     mqc_resetstates(&RateMqc);
+   }
+ }
+
+ mqc_flush(&RateMqc);
+ bytes+=mqc_numbytes(&RateMqc);
+
+ return bytes*RateBlocks/RateSamples;
+}
+
+// the time on air in ms of bytes of MQ data in packets of mss bytes (offset and data)
+unsigned long RateImageToA(unsigned long bytes, unsigned int mss)
+{
+ unsigned int room=mss-2;
+ unsigned int fill;
+ unsigned long n, last, toa;
+
+#ifdef PACKET_FEC_H
+ if (RateFECgroupSize)
+   room-=FEC_OVERHEAD(RateFECgroupSize);
+#endif
+
+ // the packet ends when the next block does not fit
+ fill=room-(bytes/RateBlocks+1)/2;
+
+ if (bytes == 0 || fill < 1 || fill > room)
+   fill=room;
+
+ n=(bytes+fill-1)/fill;
+ last=bytes-(n-1)*fill;
+
+ toa=(n-1)*RateToA(RateOverhead+2+fill)+RateToA(RateOverhead+2+last);
+
+#ifdef PACKET_FEC_H
+ // the parity packets are as long as the longest data packet of the group and its offsets
+ if (RateFECgroupSize)
+   toa+=(n+RateFECgroupSize-1)/RateFECgroupSize*RateFECparity*
+        RateToA(RateOverhead+2+fill+FEC_OVERHEAD(RateFECgroupSize));
+#endif
+
+ return toa;
+}
+
+// the MSS with the lowest time on air, the largest one for the same time
+unsigned int RateBestMSS(unsigned long bytes, unsigned int maxMss)
+{
+ unsigned int best=maxMss;
+ unsigned long bestToA=RateImageToA(bytes, maxMss);
+
+ for (unsigned int mss=maxMss-1; mss>=RATE_MIN_MSS; mss--) {
+   unsigned long toa=RateImageToA(bytes, mss);
+
+   if (toa < bestToA) {
+     bestToA=toa;
+     best=mss;
+   }
+ }
+
+ return best;
+}
+
+// the quality factor of the image for targetToA ms, RateMSS is its MSS
+int RateControl(InImageStruct *image, unsigned long targetToA, unsigned int maxMss)
+{
+ int low=RATE_MIN_QUALITY;
+ int high=RATE_MAX_QUALITY;
+
+ RateSample(image);
+
+ while (low < high) {
+   int Quality=(low+high+1)/2;
+
+   if (RateImageToA(RateEstimate(Quality), maxMss) <= targetToA)
+     low=Quality;
+   else
+     high=Quality-1;
+ }
+
+ RateEstimatedBytes=RateEstimate(low);
+ RateMSS=RateBestMSS(RateEstimatedBytes, maxMss);
+ RateEstimatedToA=RateImageToA(RateEstimatedBytes, RateMSS);
+
+ return low;
+}
+
+#endif
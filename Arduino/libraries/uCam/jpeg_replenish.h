@@ -0,0 +1,103 @@
+/*
+ *  Conditional replenishment of the image, for the new CRAN encoding
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  Included by the sketch after jpeg_dct.h, with CRAN_NEW_CODING.
+ *
+ *  FindChangedBlocks() compares each 8x8 block of the new image with the reference image, the
+ *  last image received by the gateway: the block has changed when the sum of the absolute
+ *  differences (SAD) of its 64 pixels is above the threshold. Only the changed blocks are then
+ *  packetized, in the interleaved order. The offset field of these packets has bit 15 set
+ *  (CR_PACKET_FLAG) and each block is preceded by the number of unchanged blocks skipped since
+ *  the previous one of the packet (Golomb-Rice as the number of coefficients). The packet ends
+ *  with no skip and K=0, K is at least 1 for a block. The gateway decodes them in place of the
+ *  blocks of its previous image of the same camera.
+ *
+ *  CopyChangedBlocks() updates the reference image with the changed blocks only, so that it
+ *  stays the image of the gateway.
+ */
+
+#ifndef JPEG_REPLENISH_H
+#define JPEG_REPLENISH_H
+
+#define CR_PACKET_FLAG 0x8000
+
+// one bit per block, block (bx, by) is bit by*ChangedHblocks+bx
+uint8_t *ChangedBlocks=NULL;
+uint8_t ChangedHblocks=0;
+uint8_t ChangedVblocks=0;
+
+bool ChangedAllocate(int Hsize, int Vsize)
+{
+ ChangedHblocks=Hsize/8;
+ ChangedVblocks=Vsize/8;
+
+ ChangedBlocks=(uint8_t*)calloc((ChangedHblocks*ChangedVblocks+7)/8, 1);
+
+ return ChangedBlocks!=NULL;
+}
+
+bool BlockChanged(uint8_t bx, uint8_t by)
+{
+ unsigned int k=by*ChangedHblocks+bx;
+
+ return ChangedBlocks[k/8] & (1 << (k%8));
+}
+
+// as in the sketch, data[x][y] is the pixel of column x of line y, bx and by are x/8 and y/8
+unsigned int FindChangedBlocks(InImageStruct *image, InImageStruct *ref, unsigned int thres)
+{
+ unsigned int changed=0;
+
+ memset(ChangedBlocks, 0, (ChangedHblocks*ChangedVblocks+7)/8);
+
+ for (uint8_t by=0; by<ChangedVblocks; by++)
+   for (uint8_t bx=0; bx<ChangedHblocks; bx++) {
+     unsigned int sad=0;
+
+     for (uint8_t i=0; i<8; i++)
+       for (uint8_t j=0; j<8; j++) {
+         uint8_t a=image->data[8*bx+i][8*by+j];
+         uint8_t b=ref->data[8*bx+i][8*by+j];
+
+         sad+=(a > b) ? a-b : b-a;
+       }
+
+     if (sad > thres) {
+       unsigned int k=by*ChangedHblocks+bx;
+
+       ChangedBlocks[k/8]|=1 << (k%8);
+       changed++;
+     }
+   }
+
+ return changed;
+}
+
+void CopyChangedBlocks(InImageStruct *image, InImageStruct *ref)
+{
+ for (uint8_t by=0; by<ChangedVblocks; by++)
+   for (uint8_t bx=0; bx<ChangedHblocks; bx++)
+     if (BlockChanged(bx, by))
+       for (uint8_t i=0; i<8; i++)
+         for (uint8_t j=0; j<8; j++)
+           ref->data[8*bx+i][8*by+j]=image->data[8*bx+i][8*by+j];
+}
+
+#endif
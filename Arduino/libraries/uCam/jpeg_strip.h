@@ -0,0 +1,181 @@
+/*
+ *  Strip-based encoding of the image, for the new CRAN encoding
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  Included by the sketch after jpeg_dct.h, with CRAN_NEW_CODING.
+ *
+ *  The pixels of the uCam are read in StripLines, 8 lines at a time. Each full strip is
+ *  encoded by StripEncode(): JPEGencoding() of its 8x8 blocks, and the quantized coefficients
+ *  are kept in StripStore. The blocks are interleaved over the whole image for the packets,
+ *  the first packet needs blocks of the last strip, so they are all kept until the image is
+ *  read, but quantized and run-length coded instead of the 8-bit pixels:
+ *    - 1 byte, the number of non-zero coefficients of the block
+ *    - for each of them, 1 byte with the number of zero coefficients before it (bits 0-5) and
+ *      bit 6 set for a 16-bit value, then the value on 8 or 16 bits
+ *  StripGetBlock() gives back the quantized block, in any order, for FillPacket().
+ *
+ *  As in the inImage array of the sketch, Block[i][j] is the pixel of column 8*bx+i of line j
+ *  of strip by. When StripStore is nearly full, the next blocks only keep their DC coefficient
+ *  (4 bytes at most), StripTruncatedBlocks counts them.
+ */
+
+#ifndef JPEG_STRIP_H
+#define JPEG_STRIP_H
+
+// 8 lines of the image, line j starts at StripLines+j*StripHsize
+uint8_t *StripLines=NULL;
+uint8_t *StripStore=NULL;
+unsigned int StripStoreSize=0;
+unsigned int StripStoreUsed=0;
+// offset in StripStore of each block, in the order of the strips
+unsigned short *StripBlockIndex=NULL;
+int StripHsize=0;
+uint8_t StripHblocks=0;
+uint8_t StripVblocks=0;
+// number of strips encoded
+uint8_t StripNumber=0;
+unsigned int StripTruncatedBlocks=0;
+
+// at least 4 bytes per block in StripStore
+bool StripAllocate(int Hsize, int Vsize, unsigned int storeSize)
+{
+ StripHsize=Hsize;
+ StripHblocks=(Hsize+7)/8;
+ StripVblocks=(Vsize+7)/8;
+
+ if (storeSize < 4*StripHblocks*StripVblocks)
+   return false;
+
+ StripLines=(uint8_t*)malloc(8*Hsize);
+ StripBlockIndex=(unsigned short*)malloc(StripHblocks*StripVblocks*sizeof(unsigned short));
+ StripStore=(uint8_t*)malloc(storeSize);
+
+ if (StripLines==NULL || StripBlockIndex==NULL || StripStore==NULL)
+   return false;
+
+ StripStoreSize=storeSize;
+ return true;
+}
+
+void StripBegin()
+{
+ StripStoreUsed=0;
+ StripNumber=0;
+ StripTruncatedBlocks=0;
+}
+
+// returns the number of bytes in coded[], 1+64*3 at most
+unsigned int StripCodeBlock(int Block[8][8], bool dcOnly, uint8_t *coded)
+{
+ uint8_t n=0, run=0;
+ unsigned int size=1;
+
+ for (int k=0; k<(dcOnly ? 1 : 64); k++) {
+   int c=Block[k/8][k%8];
+
+   if (c==0) {
+     run++;
+     continue;
+   }
+
+   if (c >= -128 && c <= 127) {
+     coded[size++]=run;
+     coded[size++]=(uint8_t)c;
+   }
+   else {
+     coded[size++]=run | 0x40;
+     coded[size++]=(uint8_t)(c & 0xFF);
+     coded[size++]=(uint8_t)((c >> 8) & 0xFF);
+   }
+   n++;
+   run=0;
+ }
+
+ coded[0]=n;
+ return size;
+}
+
+// encodes the 8 lines of StripLines, 'lines' is less than 8 for the last strip of the image
+// and the last line is repeated
+void StripEncode(uint8_t lines)
+{
+ int Block[8][8];
+ uint8_t coded[1+64*3];
+ unsigned int size, blocksLeft;
+
+ if (StripNumber==StripVblocks)
+   return;
+
+ for (uint8_t j=lines; j<8; j++)
+   memcpy(StripLines+j*StripHsize, StripLines+(lines-1)*StripHsize, StripHsize);
+
+ for (uint8_t bx=0; bx<StripHblocks; bx++) {
+
+   for (int i=0; i<8; i++)
+     for (int j=0; j<8; j++) {
+       int x=8*bx+i;
+
+       // the last column is repeated
+       if (x >= StripHsize)
+         x=StripHsize-1;
+       Block[i][j]=StripLines[j*StripHsize+x];
+     }
+
+   JPEGencoding(Block);
+
+   blocksLeft=(StripVblocks-StripNumber)*StripHblocks-bx-1;
+   size=StripCodeBlock(Block, false, coded);
+
+   // keeps room for the DC coefficient of the next blocks
+   if (StripStoreUsed+size+4*blocksLeft > StripStoreSize) {
+     size=StripCodeBlock(Block, true, coded);
+     StripTruncatedBlocks++;
+   }
+
+   StripBlockIndex[StripNumber*StripHblocks+bx]=StripStoreUsed;
+   memcpy(StripStore+StripStoreUsed, coded, size);
+   StripStoreUsed+=size;
+ }
+
+ StripNumber++;
+}
+
+void StripGetBlock(uint8_t bx, uint8_t by, int Block[8][8])
+{
+ uint8_t *p=StripStore+StripBlockIndex[by*StripHblocks+bx];
+ uint8_t n=*p++;
+ uint8_t k=0;
+
+ memset(Block, 0, 64*sizeof(int));
+
+ while (n--) {
+   k+=*p & 0x3F;
+
+   if (*p++ & 0x40) {
+     Block[k/8][k%8]=(short)(p[0] | (p[1] << 8));
+     p+=2;
+   }
+   else
+     Block[k/8][k%8]=(int8_t)*p++;
+
+   k++;
+ }
+}
+
+#endif
@@ -127,6 +127,13 @@ Decode a symbol
 @return Returns the decoded symbol (0 or 1)
 */
 int mqc_decode(opj_mqc_t *mqc);
+/**
+Decode the 1 symbols of a unary code up to its 0, as while (mqc_decode(mqc) == 1 && q < max) q++;
+@param mqc MQC handle
+@param max Maximum value
+@return Returns the number of 1 symbols decoded, max at most
+*/
+unsigned int mqc_decode_unary(opj_mqc_t *mqc, unsigned int max);
 
 
 /* ----------------------------------------------------------------------- */
@@ -143,6 +150,7 @@ Renormalize mqc->a and mqc->c while encoding, so that mqc->a stays between 0x800
 @param mqc MQC handle
 */
 static void mqc_renorme(opj_mqc_t *mqc);
+#ifdef MQC_REFERENCE
 /**
 Encode the most probable symbol
 @param mqc MQC handle
@@ -153,11 +161,13 @@ Encode the most least symbol
 @param mqc MQC handle
 */
 static void mqc_codelps(opj_mqc_t *mqc);
+#endif
 /**
 Fill mqc->c with 1's for flushing
 @param mqc MQC handle
 */
 static void mqc_setbits(opj_mqc_t *mqc);
+#ifdef MQC_REFERENCE
 /**
 FIXME: documentation ???
 @param mqc MQC handle
@@ -170,6 +180,7 @@ FIXME: documentation ???
 @return 
 */
 static int mqc_lpsexchange(opj_mqc_t *mqc);
+#endif
 /**
 Input a byte
 @param mqc MQC handle
@@ -317,6 +328,8 @@ static void mqc_byteout(opj_mqc_t *mqc) {
 	}
 }
 
+#ifdef MQC_REFERENCE
+
 static void mqc_renorme(opj_mqc_t *mqc) {
 	do {
 		mqc->a <<= 1;
@@ -354,6 +367,36 @@ static void mqc_codelps(opj_mqc_t *mqc) {
 	mqc_renorme(mqc);
 }
 
+#else
+
+/* the number of shifts of a (0 < a < 0x8000) up to 0x8000, a count leading zeros instruction with gcc (CLZ on ARM) */
+#ifdef __GNUC__
+#define mqc_shifts(a) (__builtin_clzl((unsigned long)(a)) - (8*sizeof(unsigned long)-16))
+#else
+static unsigned int mqc_shifts(unsigned long a) {
+	unsigned int n = 1;
+	while (((a << n) & 0x8000) == 0) n++;
+	return n;
+}
+#endif
+
+/* all the shifts of the bit loop at once, a byte is output each time ct reaches 0 */
+static void mqc_renorme(opj_mqc_t *mqc) {
+	unsigned int n = mqc_shifts(mqc->a);
+	while (n >= mqc->ct) {
+		n -= mqc->ct;
+		mqc->a <<= mqc->ct;
+		mqc->c <<= mqc->ct;
+		mqc->ct = 0;
+		mqc_byteout(mqc);
+	}
+	mqc->a <<= n;
+	mqc->c <<= n;
+	mqc->ct -= n;
+}
+
+#endif
+
 static void mqc_setbits(opj_mqc_t *mqc) {
 	unsigned int tempc = mqc->c + mqc->a;
 	mqc->c |= 0xffff;
@@ -362,6 +405,8 @@ static void mqc_setbits(opj_mqc_t *mqc) {
 	}
 }
 
+#ifdef MQC_REFERENCE
+
 static int mqc_mpsexchange(opj_mqc_t *mqc) {
 	int d;
 	if (mqc->a < (*mqc->curctx)->qeval) {
@@ -390,6 +435,8 @@ static int mqc_lpsexchange(opj_mqc_t *mqc) {
 	return d;
 }
 
+#endif
+
 static void mqc_bytein(opj_mqc_t *mqc) {
 	if (mqc->bp != mqc->end) {
 		unsigned int c;
@@ -418,6 +465,8 @@ static void mqc_bytein(opj_mqc_t *mqc) {
 	}
 }
 
+#ifdef MQC_REFERENCE
+
 static void mqc_renormd(opj_mqc_t *mqc) {
 	do {
 		if (mqc->ct == 0) {
@@ -429,6 +478,25 @@ static void mqc_renormd(opj_mqc_t *mqc) {
 	} while (mqc->a < 0x8000);
 }
 
+#else
+
+/* all the shifts of the bit loop at once, a byte is input each time ct is 0 */
+static void mqc_renormd(opj_mqc_t *mqc) {
+	unsigned int n = mqc_shifts(mqc->a);
+	do {
+		if (mqc->ct == 0) {
+			mqc_bytein(mqc);
+		}
+		unsigned int s = n < mqc->ct ? n : mqc->ct;
+		mqc->a <<= s;
+		mqc->c <<= s;
+		mqc->ct -= s;
+		n -= s;
+	} while (n);
+}
+
+#endif
+
 /* 
 ==========================================================
    MQ-Coder interface
@@ -449,11 +517,42 @@ void mqc_init_enc(opj_mqc_t *mqc, unsigned char *bp) {
 	mqc->start = bp;
 }
 
+#ifdef MQC_REFERENCE
+
 void mqc_encode(opj_mqc_t *mqc, int d) {
 	if ((*mqc->curctx)->mps == d) {	mqc_codemps(mqc); }
 				else  {	mqc_codelps(mqc); }
 }
 
+#else
+
+/* mqc_codemps() and mqc_codelps(), most of the MPS are coded without renormalization and
+   the conditional exchange of the intervals is a selection rather than a branch */
+void mqc_encode(opj_mqc_t *mqc, int d) {
+	opj_mqc_state_t *state = *mqc->curctx;
+	unsigned int qeval = state->qeval;
+	unsigned int a = mqc->a - qeval;
+	int swap = a < qeval;
+
+	if (state->mps == d) {
+		if (a & 0x8000) {
+			mqc->a = a;
+			mqc->c += qeval;
+			return;
+		}
+		mqc->a = swap ? qeval : a;
+		mqc->c += swap ? 0 : qeval;
+		*mqc->curctx = state->nmps;
+	} else {
+		mqc->a = swap ? a : qeval;
+		mqc->c += swap ? qeval : 0;
+		*mqc->curctx = state->nlps;
+	}
+	mqc_renorme(mqc);
+}
+
+#endif
+
 void mqc_flush(opj_mqc_t *mqc) {
 	mqc_setbits(mqc);
 	mqc->c <<= mqc->ct;
@@ -476,6 +575,8 @@ void mqc_init_dec(opj_mqc_t *mqc, unsigned char *bp, int len) {
 	mqc->a = 0x8000;
 }
 
+#ifdef MQC_REFERENCE
+
 int mqc_decode(opj_mqc_t *mqc) {
 	int d;
 	mqc->a -= (*mqc->curctx)->qeval;
@@ -492,6 +593,99 @@ int mqc_decode(opj_mqc_t *mqc) {
 	return d;
 }
 
+unsigned int mqc_decode_unary(opj_mqc_t *mqc, unsigned int max) {
+	unsigned int q = 0;
+	while (mqc_decode(mqc) == 1 && q < max) q++;
+	return q;
+}
+
+#else
+
+/* mqc_lpsexchange() and mqc_mpsexchange(), most of the MPS are decoded without renormalization and
+   the conditional exchange is a selection of the next state rather than a branch */
+int mqc_decode(opj_mqc_t *mqc) {
+	opj_mqc_state_t *state = *mqc->curctx;
+	unsigned int qeval = state->qeval;
+	unsigned int a = mqc->a - qeval;
+	int swap = a < qeval;
+
+	if ((mqc->c >> 16) < qeval) {
+		*mqc->curctx = swap ? state->nmps : state->nlps;
+		mqc->a = qeval;
+		mqc_renormd(mqc);
+		return state->mps ^ !swap;
+	}
+	mqc->c -= qeval << 16;
+	mqc->a = a;
+	if (a & 0x8000) {
+		return state->mps;
+	}
+	*mqc->curctx = swap ? state->nlps : state->nmps;
+	mqc_renormd(mqc);
+	return state->mps ^ swap;
+}
+
+/* mqc_decode() with a, c, ct and the state kept in local variables for the whole code */
+unsigned int mqc_decode_unary(opj_mqc_t *mqc, unsigned int max) {
+	opj_mqc_state_t *state = *mqc->curctx;
+	unsigned int a = mqc->a;
+	unsigned int c = mqc->c;
+	unsigned int ct = mqc->ct;
+	unsigned int q = 0;
+
+	for (;;) {
+		unsigned int qeval = state->qeval;
+		unsigned int n;
+		int swap, d;
+
+		a -= qeval;
+		swap = a < qeval;
+		if ((c >> 16) < qeval) {
+			d = state->mps ^ !swap;
+			state = swap ? state->nmps : state->nlps;
+			a = qeval;
+		} else {
+			c -= qeval << 16;
+			if (a & 0x8000) {
+				if (state->mps == 0 || q >= max) {
+					break;
+				}
+				q++;
+				continue;
+			}
+			d = state->mps ^ swap;
+			state = swap ? state->nlps : state->nmps;
+		}
+		/* mqc_renormd() */
+		n = mqc_shifts(a);
+		do {
+			unsigned int s;
+			if (ct == 0) {
+				mqc->c = c;
+				mqc_bytein(mqc);
+				c = mqc->c;
+				ct = mqc->ct;
+			}
+			s = n < ct ? n : ct;
+			a <<= s;
+			c <<= s;
+			ct -= s;
+			n -= s;
+		} while (n);
+		if (d == 0 || q >= max) {
+			break;
+		}
+		q++;
+	}
+	*mqc->curctx = state;
+	mqc->a = a;
+	mqc->c = c;
+	mqc->ct = ct;
+	return q;
+}
+
+#endif
+
 void mqc_resetstates(opj_mqc_t *mqc) {
 	int i;
 	for (i = 0; i < MQC_NUMCTXS; i++) {
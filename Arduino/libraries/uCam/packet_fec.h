@@ -0,0 +1,142 @@
+/*
+ *  Packet-erasure FEC for the image packets
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  Systematic Reed-Solomon code over GF(256) on groups of k image packets: the packets are
+ *  sent unchanged, then m parity packets. Any k packets of the group give back the others.
+ *
+ *  Data packet i of the group is the vector [packetsize, MQ data, 0...]. Parity packet j is
+ *  the sum of C(j,i).vector(i) with the Cauchy matrix C(j,i)=1/(x(j)+y(i)), x(j)=0x80+j and
+ *  y(i)=i, computed as the data packets are sent: only the m parity packets are in memory.
+ *
+ *  The offset field of parity packet j of group g is 0x7000 | j << 8 | g (scan 7, see
+ *  PROGRESSIVE_ENCODING), its data is:
+ *    - 1 byte, k the number of data packets of the group (less for the last group of the image)
+ *    - k x 2 bytes, the offset field of each data packet, to know which ones have been lost
+ *    - the parity of the vectors, as long as the longest one
+ *  A data packet is then at most FEC_OVERHEAD(k) bytes shorter than the parity packet.
+ */
+
+#ifndef PACKET_FEC_H
+#define PACKET_FEC_H
+
+#define FEC_PACKET_FLAG 0x7000
+#define FEC_MAX_GROUP_SIZE 32
+#define FEC_MAX_PARITY 8
+// the count, the offsets and the size byte of the vector
+#define FEC_OVERHEAD(k) (2+2*(k))
+
+uint8_t FECexp[512];
+uint8_t FEClog[256];
+
+uint8_t FECgroupSize=0;
+uint8_t FECparityPackets=0;
+uint8_t *FECparity=NULL;
+unsigned int FECvectorSize=0;
+// in the current group
+uint8_t FECcount=0;
+unsigned int FEClength=0;
+uint16_t FECoffsets[FEC_MAX_GROUP_SIZE];
+uint8_t FECgroup=0;
+
+// GF(256) with x^8+x^4+x^3+x^2+1
+bool FECallocate(uint8_t k, uint8_t m, unsigned int maxPacketSize)
+{
+ uint16_t x=1;
+
+ if (k > FEC_MAX_GROUP_SIZE || m > FEC_MAX_PARITY)
+   return false;
+
+ for (int i=0; i<255; i++) {
+   FECexp[i]=FECexp[i+255]=x;
+   FEClog[x]=i;
+   x<<=1;
+
+   if (x & 0x100)
+     x^=0x11D;
+ }
+
+ FECgroupSize=k;
+ FECparityPackets=m;
+ FECvectorSize=maxPacketSize+1;
+ FECparity=(uint8_t*)malloc(m*FECvectorSize);
+
+ return FECparity!=NULL;
+}
+
+uint8_t FECmul(uint8_t a, uint8_t b)
+{
+ if (a==0 || b==0)
+   return 0;
+
+ return FECexp[FEClog[a]+FEClog[b]];
+}
+
+uint8_t FECcoef(uint8_t j, uint8_t i)
+{
+ return FECexp[255-FEClog[(0x80+j)^i]];
+}
+
+void FECbegin()
+{
+ FECcount=0;
+ FEClength=0;
+ memset(FECparity, 0, FECparityPackets*FECvectorSize);
+}
+
+// returns true when the group is complete
+bool FECaddPacket(uint16_t offset, uint8_t *data, uint8_t size)
+{
+ for (uint8_t j=0; j<FECparityPackets; j++) {
+   uint8_t c=FECcoef(j, FECcount);
+   uint8_t *p=FECparity+j*FECvectorSize;
+
+   p[0]^=FECmul(c, size);
+
+   for (uint8_t t=0; t<size; t++)
+     p[t+1]^=FECmul(c, data[t]);
+ }
+
+ if ((unsigned int)size+1 > FEClength)
+   FEClength=size+1;
+
+ FECoffsets[FECcount++]=offset;
+
+ return FECcount==FECgroupSize;
+}
+
+// parity packet j of the current group in packet, returns its size and its offset field
+uint8_t FECparityPacket(uint8_t j, uint8_t *packet, uint16_t *offset)
+{
+ uint8_t size=0;
+
+ packet[size++]=FECcount;
+
+ for (uint8_t i=0; i<FECcount; i++) {
+   packet[size++]=FECoffsets[i] >> 8;
+   packet[size++]=FECoffsets[i] & 0xFF;
+ }
+
+ memcpy(packet+size, FECparity+j*FECvectorSize, FEClength);
+ *offset=FEC_PACKET_FLAG | j << 8 | FECgroup;
+
+ return size+FEClength;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ *  Minimal Arduino API to build the sensor classes on a host computer, the
+ *  test program defines the functions with a simulated clock and pins
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "binary.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define NOT_AN_INTERRUPT -1
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define bit(b) (1UL << (b))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#define F(s) (s)
+#define DEC 10
+#define HEX 16
+#define RISING 3
+
+#define microsecondsToClockCycles(a) ((a)*16L)
+#define digitalPinToInterrupt(p) pinToInterrupt(p)
+
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#define constrain(x,low,high) ((x)<(low)?(low):((x)>(high)?(high):(x)))
+
+// Serial writes on the standard output when its 'enabled' member is set
+class SerialStub {
+  public:
+    bool enabled;
+    void begin(unsigned long baud) {}
+    void flush() {}
+    template<class T> void print(T v) { if (enabled) out(v); }
+    template<class T> void print(T v, int base) { if (enabled) out(v); }
+    template<class T> void println(T v) { print(v); println(); }
+    template<class T> void println(T v, int base) { print(v); println(); }
+    void println() { if (enabled) out("\n"); }
+  private:
+    void out(const char* s) { printf("%s", s); }
+    void out(char c) { printf("%c", c); }
+    void out(double d) { printf("%.2f", d); }
+    void out(long l) { printf("%ld", l); }
+    void out(unsigned long l) { printf("%lu", l); }
+    void out(int i) { out((long)i); }
+    void out(unsigned int i) { out((unsigned long)i); }
+    void out(uint8_t i) { out((unsigned long)i); }
+    void out(int8_t i) { out((long)i); }
+    void out(int16_t i) { out((long)i); }
+    void out(uint16_t i) { out((unsigned long)i); }
+    void out(float f) { out((double)f); }
+    void out(char* s) { out((const char*)s); }
+};
+
+extern SerialStub Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+int pinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts();
+void interrupts();
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ *  OneWire API on a simulated bus to build the DallasTemperature library on a host
+ *  computer, the test program defines the functions, the probes and the timings
+ */
+
+#ifndef OneWire_h
+#define OneWire_h
+
+#include <stdint.h>
+
+class OneWire {
+  public:
+    OneWire(uint8_t pin);
+    uint8_t reset(void);
+    void select(const uint8_t rom[8]);
+    void skip(void);
+    void write(uint8_t v, uint8_t power = 0);
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0);
+    uint8_t read(void);
+    void read_bytes(uint8_t *buf, uint16_t count);
+    void write_bit(uint8_t v);
+    uint8_t read_bit(void);
+    void depower(void);
+    void reset_search();
+    uint8_t search(uint8_t *newAddr, bool search_mode = true);
+    static uint8_t crc8(const uint8_t *addr, uint8_t len);
+};
+
+#endif
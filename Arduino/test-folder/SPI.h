@@ -0,0 +1,27 @@
+/*
+ *  Minimal SPI API to build the SX1272 library on a host computer, the test program
+ *  defines transfer() with a simulated radio module
+ */
+
+#ifndef SPI_H
+#define SPI_H
+
+#include <stdint.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define SPI_CLOCK_DIV8 8
+
+class SPIClass {
+  public:
+    void begin() {}
+    void end() {}
+    void setBitOrder(uint8_t order) {}
+    void setClockDivider(uint8_t div) {}
+    void setDataMode(uint8_t mode) {}
+    uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
+
+#endif
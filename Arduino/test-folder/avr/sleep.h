@@ -0,0 +1,14 @@
+/*
+ *  sleep_mode() of avr-libc, the test program defines it with its simulated clock
+ */
+
+#ifndef SLEEP_H
+#define SLEEP_H
+
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode)
+
+void sleep_mode();
+
+#endif
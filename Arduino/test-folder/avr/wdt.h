@@ -0,0 +1,19 @@
+/*
+ *  Watchdog of avr-libc, the test program defines wdt_enable() with its simulated clock.
+ *  WDTCSR and WDIE come from avr/io.h on the device
+ */
+
+#ifndef WDT_H
+#define WDT_H
+
+#include <stdint.h>
+
+#define WDTO_1S 6
+
+#define WDIE 6
+
+extern volatile uint8_t WDTCSR;
+
+void wdt_enable(uint8_t timeout);
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ *  Float and fixed-point DCT of the image encoder (jpeg_dct.h of the uCam library)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/uCam test-dct.cpp -o test-dct
+ *  > ./test-dct
+ *
+ *  jpeg_dct.h is built 4 times, for the new and the old CRAN encoding, with and without
+ *  FIXED_POINT_DCT. The quantized coefficients of each 128x128 test image of
+ *  gw_full_latest/ucam-images are decoded by JPEGdecoding() of decode_to_bmp.c, as on
+ *  the gateway, to compare the PSNR. The time is the host time to encode the image.
+ */
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "Arduino.h"
+
+#define SHORT_COMPUTATION
+#include "mqc.h"
+
+namespace newFloat {
+#define CRAN_NEW_CODING
+#include "jpeg_dct.h"
+}
+
+#undef JPEG_QUANTIZE
+
+namespace newFixed {
+#define FIXED_POINT_DCT
+#include "jpeg_dct.h"
+#undef FIXED_POINT_DCT
+}
+
+#undef CRAN_NEW_CODING
+
+namespace oldFloat {
+#include "jpeg_dct.h"
+}
+
+namespace oldFixed {
+#define FIXED_POINT_DCT
+#include "jpeg_dct.h"
+#undef FIXED_POINT_DCT
+}
+
+// the decoder of the gateway, bmp.h defines max() and min()
+#undef max
+#undef min
+#undef MQC_NUMCTXS
+
+namespace gw {
+#define main decode_to_bmp_main
+#include "../../gw_full_latest/ucam-images/decode_to_bmp.c"
+#undef main
+}
+
+#include "check.h"
+
+#define SIZE 128
+#define RUNS 200
+
+SerialStub Serial;
+
+uint8_t pixels[SIZE][SIZE];
+uint8_t *pixelRows[SIZE];
+short coefs[SIZE][SIZE];
+short *coefRows[SIZE];
+
+// the luminance of the 8-bit (palette) and 16-bit (RGB555) BMP files, as the raw data of the uCam
+bool readBMP(const char *file) {
+
+  FILE *f=fopen(file, "rb");
+  uint8_t header[54];
+
+  if (!f)
+    return false;
+
+  if (fread(header, 1, 54, f)!=54) {
+    fclose(f);
+    return false;
+  }
+
+  uint32_t offset=header[10] | header[11] << 8 | header[12] << 16 | header[13] << 24;
+  int width=header[18] | header[19] << 8;
+  int height=header[22] | header[23] << 8;
+  int bpp=header[28];
+
+  if (width!=SIZE || height!=SIZE || (bpp!=8 && bpp!=16)) {
+    fclose(f);
+    return false;
+  }
+
+  uint8_t palette[256][4];
+
+  if (bpp==8 && fread(palette, 4, 256, f)!=256) {
+    fclose(f);
+    return false;
+  }
+
+  fseek(f, offset, SEEK_SET);
+
+  // bottom-up
+  for (int row=SIZE-1; row>=0; row--)
+    for (int col=0; col<SIZE; col++)
+      if (bpp==8) {
+        uint8_t *bgr=palette[fgetc(f)];
+        pixels[row][col]=(uint8_t)(0.299*bgr[2]+0.587*bgr[1]+0.114*bgr[0]+0.5);
+      }
+      else {
+        int lo=fgetc(f);
+        int hi=fgetc(f);
+        int rgb=lo | hi << 8;
+        double r=((rgb >> 10) & 0x1F)*255/31.0;
+        double g=((rgb >> 5) & 0x1F)*255/31.0;
+        double b=(rgb & 0x1F)*255/31.0;
+        pixels[row][col]=(uint8_t)(0.299*r+0.587*g+0.114*b+0.5);
+      }
+
+  fclose(f);
+  return true;
+}
+
+// with JPEGencoding(int Block[8][8]) of the new CRAN encoding
+template<void (*encode)(int[8][8])> void newEncoding() {
+
+  int Block[8][8];
+
+  for (int i=0; i<SIZE; i+=8)
+    for (int j=0; j<SIZE; j+=8) {
+
+      for (int u=0; u<8; u++)
+        for (int v=0; v<8; v++)
+          Block[u][v]=pixels[i+u][j+v];
+
+      encode(Block);
+
+      for (int u=0; u<8; u++)
+        for (int v=0; v<8; v++)
+          coefs[i+u][j+v]=Block[u][v];
+    }
+}
+
+// with JPEGencoding(InImageStruct*, OutImageStruct*) of the old CRAN encoding
+template<void (*encode)(InImageStruct*, OutImageStruct*)> void oldEncoding() {
+
+  InImageStruct in={SIZE, SIZE, pixelRows};
+  OutImageStruct out={SIZE, SIZE, coefRows};
+
+  encode(&in, &out);
+}
+
+struct Result {
+  double psnr;
+  double us;
+};
+
+// PSNR of the image decoded by the gateway, written in the BMP file as unsigned char
+double decodedPSNR(int Q) {
+
+  double *rows[SIZE];
+  double data[SIZE][SIZE];
+  gw::BMPImageStruct img;
+  double mse=0;
+
+  for (int i=0; i<SIZE; i++) {
+    rows[i]=data[i];
+    for (int j=0; j<SIZE; j++)
+      data[i][j]=coefs[i][j];
+  }
+
+  img.imageHsize=SIZE;
+  img.imageVsize=SIZE;
+  img.data=rows;
+
+  gw::QTinitialization(Q);
+  gw::JPEGdecoding(&img, &img);
+
+  for (int i=0; i<SIZE; i++)
+    for (int j=0; j<SIZE; j++) {
+      double e=(unsigned char)data[i][j]-(double)pixels[i][j];
+      mse+=e*e;
+    }
+
+  mse/=SIZE*SIZE;
+
+  return mse ? 10*log10(255.0*255.0/mse) : 99.0;
+}
+
+Result run(void (*init)(int), void (*encoding)(), int Q, short result[SIZE][SIZE]) {
+
+  Result r;
+  clock_t start=clock();
+
+  for (int k=0; k<RUNS; k++) {
+    init(Q);
+    encoding();
+  }
+
+  r.us=(double)(clock()-start)/CLOCKS_PER_SEC*1e6/RUNS;
+  r.psnr=decodedPSNR(Q);
+  memcpy(result, coefs, sizeof(coefs));
+
+  return r;
+}
+
+int differences(short a[SIZE][SIZE], short b[SIZE][SIZE]) {
+
+  int n=0;
+
+  for (int i=0; i<SIZE; i++)
+    for (int j=0; j<SIZE; j++)
+      if (a[i][j]!=b[i][j])
+        n++;
+
+  return n;
+}
+
+short floatCoefs[SIZE][SIZE];
+short fixedCoefs[SIZE][SIZE];
+
+void compare(const char *name, int Q) {
+
+  Result newF=run(newFloat::QTinitialization, newEncoding<newFloat::JPEGencoding>, Q, floatCoefs);
+  Result newX=run(newFixed::QTinitialization, newEncoding<newFixed::JPEGencoding>, Q, fixedCoefs);
+  int newDiff=differences(floatCoefs, fixedCoefs);
+
+  Result oldF=run(oldFloat::QTinitialization, oldEncoding<oldFloat::JPEGencoding>, Q, floatCoefs);
+  Result oldX=run(oldFixed::QTinitialization, oldEncoding<oldFixed::JPEGencoding>, Q, fixedCoefs);
+  int oldDiff=differences(floatCoefs, fixedCoefs);
+
+  printf("%-20s Q%-3d %6.2f %6.2f %5d %6.0f %6.0f   %6.2f %6.2f %5d %6.0f %6.0f\n", name, Q,
+         newF.psnr, newX.psnr, newDiff, newF.us, newX.us, oldF.psnr, oldX.psnr, oldDiff, oldF.us, oldX.us);
+
+  CHECK(fabs(newF.psnr-newX.psnr)<0.1);
+  CHECK(fabs(oldF.psnr-oldX.psnr)<0.1);
+  // a few coefficients at the limit between 2 quantized values
+  CHECK(newDiff<SIZE*SIZE/100);
+  CHECK(oldDiff<SIZE*SIZE/100);
+}
+
+// the reciprocals against round(x/step), for the steps of both encodings and all the 16-bit values:
+// the relative error of the reciprocal is less than 2^-16, the quantized value can only differ by 1
+// when x/step is that close to a half integer
+void checkReciprocal() {
+
+  unsigned short recip;
+  uint8_t shift;
+  long n=0, errors=0, wrong=0;
+
+  for (float step=4; step<=4080; step*=1.01) {
+
+    newFixed::QTreciprocal(step, &recip, &shift);
+
+    CHECK(recip>=32768);
+
+    for (long x=-32767; x<=32767; x++, n++) {
+
+      double d=fabs(x/(double)step);
+      int q=abs(newFixed::QTquantize(x, recip, shift));
+
+      if (q!=(int)round(d)) {
+        errors++;
+        if (abs(q-(int)round(d))>1 || fabs(d-floor(d)-0.5)>d/65536+1e-9)
+          wrong++;
+      }
+    }
+  }
+
+  printf("reciprocals: %ld values differ by 1 from round() for %ld values\n", errors, n);
+
+  CHECK(wrong==0);
+
+  // largest step of the old encoding, 255*8*2, and the largest coefficient
+  oldFixed::QTreciprocal(4080, &recip, &shift);
+  CHECK(oldFixed::QTquantize(32640, recip, shift)==8);
+  CHECK(oldFixed::QTquantize(-32640, recip, shift)==-8);
+}
+
+int main() {
+
+  const char *images[]={"128x128-test.bmp", "128x128-test-neg.bmp", "lion-128x128.bmp"};
+  const int Qs[]={5, 10, 20, 50, 80};
+  char file[100];
+
+  for (int i=0; i<SIZE; i++) {
+    pixelRows[i]=pixels[i];
+    coefRows[i]=coefs[i];
+  }
+
+  printf("%-20s %-4s %-36s   %s\n", "", "", "new CRAN encoding", "old CRAN encoding");
+  printf("%-20s %-4s %6s %6s %5s %6s %6s   %6s %6s %5s %6s %6s\n", "image", "", "PSNR", "fixed", "diff", "us", "fixed",
+         "PSNR", "fixed", "diff", "us", "fixed");
+
+  for (unsigned i=0; i<sizeof(images)/sizeof(images[0]); i++) {
+
+    snprintf(file, sizeof(file), "../../gw_full_latest/ucam-images/%s", images[i]);
+
+    if (!readBMP(file)) {
+      failures++;
+      printf("cannot read %s\n", file);
+      continue;
+    }
+
+    for (unsigned q=0; q<sizeof(Qs)/sizeof(Qs[0]); q++)
+      compare(images[i], Qs[q]);
+  }
+
+  checkReciprocal();
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,434 @@
+/*
+ *  Simulation of a DHT22 for the capture of its frame by an interrupt in DHT.cpp
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../Arduino_LoRa_Generic_Simple_MultiSensors -I../libraries/SensorCodec/src test-dht22.cpp ../Arduino_LoRa_Generic_Simple_MultiSensors/{DHT,DHT22_Temperature,DHT22_Humidity,Sensor}.cpp ../libraries/SensorCodec/src/SensorCodec.cpp -o test-dht22
+ *  > ./test-dht22
+ *
+ *  The data line is simulated with the timings of the AM2302 data sheet: the response of 80us
+ *  low and 80us high, then for each bit 48-55us low and 22-30us high for a 0 or 68-75us high
+ *  for a 1. micros() has the 8us resolution of an AVR at 8MHz and the interrupt is taken up to
+ *  10us after the edge, as when the timer interrupt of millis() is running.
+ *
+ *  - DHT::decode() with frames built from these timings, with and without the response of
+ *    the sensor, around the wrap-around of micros(), and with wrong frames
+ *  - the time the MCU is awake and the time with the interrupts disabled for a reading with
+ *    the busy-wait of read() (pin without interrupt) and with readStep()
+ *  - random readings with readStep()
+ *  - the DHT22_Temperature and DHT22_Humidity sensors of the sketch on the same pin with
+ *    update_sensors(): a single reading for both, a new reading after a wrong frame, and a
+ *    sensor that does not answer
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "DHT22_Temperature.h"
+#include "DHT22_Humidity.h"
+
+#include "check.h"
+
+// the pin of the DHT has an interrupt, not the other one
+#define DHT_PIN 16
+#define BUSY_PIN 17
+#define ISR_LATENCY 10
+
+// time in us, the MCU is awake unless it is in sleepMs()
+unsigned long long now_us=0;
+unsigned long long slept_us=0;
+// time with the interrupts disabled
+unsigned long long locked_us=0;
+unsigned long long locked_at;
+
+bool irq_enabled=true;
+bool irq_pending=false;
+bool in_isr=false;
+void (*isr)()=NULL;
+
+// the MCU drives the data line or the sensor does, with the pull-up
+bool pin_output=false;
+uint8_t pin_value=HIGH;
+uint8_t sensor_level=HIGH;
+uint8_t last_line=HIGH;
+bool start_signal=false;
+unsigned long long low_at;
+
+// the changes of the data line made by the sensor
+struct event {
+  unsigned long long t;
+  uint8_t level;
+};
+
+event events[100];
+int n_events=0;
+int next_event=0;
+
+// the simulated sensor
+uint8_t sensor_bytes[5];
+bool respond=true;
+int corrupt_frames=0;
+int starts=0;
+
+unsigned long millis() {
+  return now_us/1000;
+}
+
+// 8us resolution
+unsigned long micros() {
+  return now_us & ~7ULL;
+}
+
+uint8_t line() {
+  return pin_output ? pin_value : sensor_level;
+}
+
+void fireIsr() {
+  if (!isr)
+    return;
+
+  if (!irq_enabled) {
+    irq_pending=true;
+    return;
+  }
+
+  in_isr=true;
+  isr();
+  in_isr=false;
+}
+
+// a start signal of at least 800us starts a frame 20 to 40us after the line is released
+void checkLine() {
+
+  uint8_t l=line();
+
+  if (l==last_line)
+    return;
+
+  if (l==LOW && pin_output) {
+    start_signal=true;
+    low_at=now_us;
+  }
+
+  if (l==HIGH && start_signal && now_us-low_at>=800 && respond) {
+
+    uint8_t bytes[5];
+    unsigned long long t=now_us+20+rand()%21;
+
+    memcpy(bytes, sensor_bytes, 5);
+
+    if (corrupt_frames) {
+      corrupt_frames--;
+      bytes[rand()%5]^=1 << rand()%8;
+    }
+
+    starts++;
+    n_events=next_event=0;
+    events[n_events++]={t, LOW};
+    t+=75+rand()%11;
+    events[n_events++]={t, HIGH};
+    t+=75+rand()%11;
+
+    for (int i=0; i<40; i++) {
+      events[n_events++]={t, LOW};
+      t+=48+rand()%8;
+      events[n_events++]={t, HIGH};
+      t+=(bytes[i/8] & (0x80 >> i%8)) ? 68+rand()%8 : 22+rand()%9;
+    }
+
+    events[n_events++]={t, LOW};
+    t+=45+rand()%11;
+    events[n_events++]={t, HIGH};
+  }
+  else if (l==HIGH && start_signal && now_us-low_at>=800)
+    starts++;
+
+  if (l==HIGH)
+    start_signal=false;
+
+  last_line=l;
+  fireIsr();
+}
+
+void advance(unsigned long long to) {
+
+  while (next_event<n_events && events[next_event].t<=to) {
+
+    if (events[next_event].t>now_us)
+      now_us=events[next_event].t;
+
+    sensor_level=events[next_event++].level;
+
+    if (line()!=last_line && irq_enabled && isr)
+      now_us+=rand()%(ISR_LATENCY+1);
+
+    checkLine();
+  }
+
+  if (to>now_us)
+    now_us=to;
+}
+
+void delay(unsigned long ms) {
+  advance(now_us+ms*1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advance(now_us+us);
+}
+
+void sleepMs(unsigned long ms) {
+  slept_us+=ms*1000ULL;
+  advance(now_us+ms*1000ULL);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin==DHT_PIN || pin==BUSY_PIN) {
+    pin_output=(mode==OUTPUT);
+    if (mode==INPUT_PULLUP)
+      pin_value=HIGH;
+    checkLine();
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin==DHT_PIN || pin==BUSY_PIN) {
+    pin_value=value;
+    checkLine();
+  }
+}
+
+// a loop of the busy-wait of read() takes 1us
+int digitalRead(uint8_t pin) {
+  if (!in_isr)
+    advance(now_us+1);
+  return line();
+}
+
+int analogRead(uint8_t pin) {
+  return 0;
+}
+
+long random(long min, long max) {
+  return min+rand()%(max-min);
+}
+
+int pinToInterrupt(uint8_t pin) {
+  return pin==DHT_PIN ? 0 : NOT_AN_INTERRUPT;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*f)(), int mode) {
+  isr=f;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  isr=NULL;
+}
+
+void noInterrupts() {
+  irq_enabled=false;
+  locked_at=now_us;
+}
+
+void interrupts() {
+  irq_enabled=true;
+  locked_us+=now_us-locked_at;
+
+  if (irq_pending) {
+    irq_pending=false;
+    fireIsr();
+  }
+}
+
+// the data sheet example is 65.2%RH and 35.1C, then the checksum
+void setSensor(int humidity, int temperature) {
+  uint16_t t=temperature<0 ? 0x8000 | -temperature : temperature;
+
+  sensor_bytes[0]=humidity >> 8;
+  sensor_bytes[1]=humidity & 0xFF;
+  sensor_bytes[2]=t >> 8;
+  sensor_bytes[3]=t & 0xFF;
+  sensor_bytes[4]=sensor_bytes[0]+sensor_bytes[1]+sensor_bytes[2]+sensor_bytes[3];
+}
+
+// the falling edges of a frame of the simulated sensor
+uint8_t frameFalls(uint16_t start, uint16_t* falls) {
+  uint8_t n=0;
+
+  n_events=next_event=0;
+  pin_output=true;
+  pin_value=LOW;
+  last_line=LOW;
+  start_signal=true;
+  low_at=0;
+  now_us=1000;
+  pin_output=false;
+  checkLine();
+
+  for (int i=0; i<n_events; i++)
+    if (events[i].level==LOW)
+      falls[n++]=(uint16_t)(start+events[i].t+rand()%(ISR_LATENCY+1)) & ~7;
+
+  n_events=next_event=0;
+
+  return n;
+}
+
+void checkDecode(int n) {
+
+  uint16_t falls[64];
+  uint8_t bytes[5];
+
+  setSensor(652, 351);
+  CHECK(sensor_bytes[4]==0xEE);
+  CHECK(frameFalls(0, falls)==42);
+  CHECK(DHT::decode(falls, 42, bytes) && !memcmp(bytes, sensor_bytes, 5));
+  // the response was missed
+  CHECK(DHT::decode(falls+1, 41, bytes) && !memcmp(bytes, sensor_bytes, 5));
+  // a bit was missed
+  CHECK(!DHT::decode(falls+2, 40, bytes));
+  // a bit in two parts
+  falls[42]=falls[41];
+  falls[41]=falls[40]+20;
+  CHECK(!DHT::decode(falls, 43, bytes));
+
+  for (int t=0; t<n; t++) {
+
+    uint8_t k;
+
+    setSensor(rand()%1001, rand()%1200-400);
+
+    // a bit changed is seen by the checksum
+    if (t%4==0)
+      corrupt_frames=1;
+
+    k=frameFalls(rand(), falls);
+
+    if (DHT::decode(falls, k, bytes)!=(t%4!=0) || (t%4 && memcmp(bytes, sensor_bytes, 5))) {
+      failures++;
+      printf("decode() of frame %d\n", t);
+    }
+  }
+}
+
+void measure() {
+
+  DHT busy(BUSY_PIN, DHT22);
+  DHT capture(DHT_PIN, DHT22);
+  unsigned long long start, awake_busy, locked_busy, awake_capture, locked_capture;
+  uint16_t ms;
+
+  setSensor(652, 351);
+
+  busy.begin();
+  start=now_us;
+  locked_us=0;
+  CHECK(busy.read(true));
+  awake_busy=now_us-start;
+  locked_busy=locked_us;
+  CHECK(fabs(busy.readTemperature()-35.1)<0.01 && fabs(busy.readHumidity()-65.2)<0.01);
+
+  sleepMs(2000);
+
+  capture.begin();
+  start=now_us;
+  slept_us=0;
+  locked_us=0;
+  while ((ms=capture.readStep()))
+    sleepMs(ms);
+  awake_capture=now_us-start-slept_us;
+  locked_capture=locked_us;
+  CHECK(fabs(capture.readTemperature()-35.1)<0.01 && fabs(capture.readHumidity()-65.2)<0.01);
+
+  printf("busy-wait: awake %5.1f ms, interrupts disabled %4.1f ms\n", awake_busy/1000.0, locked_busy/1000.0);
+  printf("capture:   awake %5.1f ms, interrupts disabled %4.1f ms, sleeping %llu ms\n",
+    awake_capture/1000.0, locked_capture/1000.0, slept_us/1000);
+}
+
+void randomReadings(int n) {
+
+  DHT* dht=DHT::onPin(DHT_PIN, DHT22);
+  int starts_before=starts;
+  uint16_t ms;
+
+  for (int t=0; t<n; t++) {
+
+    int h=rand()%1001, temp=rand()%1200-400;
+
+    setSensor(h, temp);
+    sleepMs(2000);
+
+    while ((ms=dht->readStep()))
+      sleepMs(ms);
+
+    if (fabs(dht->readHumidity()-h/10.0)>0.01 || fabs(dht->readTemperature()-temp/10.0)>0.01) {
+      failures++;
+      printf("reading %d: %.1f %.1f instead of %.1f %.1f\n", t, dht->readHumidity(), dht->readTemperature(), h/10.0, temp/10.0);
+    }
+  }
+
+  // no wrong frame with the latency of the interrupt
+  CHECK(starts-starts_before==n);
+}
+
+void sketchSensors() {
+
+  DHT22_Temperature temperature((char*)"TC1", IS_NOT_ANALOG, IS_CONNECTED, IS_LOWPOWER, DHT_PIN, 7);
+  DHT22_Humidity humidity((char*)"HU1", IS_NOT_ANALOG, IS_CONNECTED, IS_LOWPOWER, DHT_PIN, 7);
+  Sensor* sensors[]={&temperature, &humidity};
+  unsigned long long start;
+
+  // both sensors use the same reading
+  setSensor(652, -101);
+  starts=0;
+  update_sensors(sensors, 2);
+  CHECK(starts==1);
+  CHECK(temperature.get_fixed_data()==-1010 && humidity.get_fixed_data()==6520);
+
+  // a wrong frame, the sensor is read again 2 seconds later
+  sleepMs(2000);
+  setSensor(487, 223);
+  starts=0;
+  corrupt_frames=1;
+  start=now_us;
+  update_sensors(sensors, 2);
+  CHECK(starts==2 && now_us-start>=4000000ULL);
+  CHECK(temperature.get_fixed_data()==2230 && humidity.get_fixed_data()==4870);
+
+  // always wrong
+  sleepMs(2000);
+  starts=0;
+  corrupt_frames=100;
+  update_sensors(sensors, 2);
+  CHECK(starts==1+DHT_RETRIES);
+  CHECK(temperature.get_fixed_data()==-100 && humidity.get_fixed_data()==-100);
+  corrupt_frames=0;
+
+  // no answer, no new reading
+  sleepMs(2000);
+  starts=0;
+  respond=false;
+  update_sensors(sensors, 2);
+  CHECK(starts==1);
+  CHECK(temperature.get_fixed_data()==-100 && humidity.get_fixed_data()==-100);
+  respond=true;
+
+  // and back
+  sleepMs(2000);
+  starts=0;
+  update_sensors(sensors, 2);
+  CHECK(starts==1);
+  CHECK(temperature.get_fixed_data()==2230 && humidity.get_fixed_data()==4870);
+}
+
+int main() {
+
+  srand(1);
+
+  checkDecode(100000);
+  measure();
+  randomReadings(10000);
+  sketchSensors();
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,407 @@
+/*
+ *  Simulation of the DS18B20 probes on a 1-Wire bus with the DallasTemperature library
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../Arduino_LoRa_Generic_Simple_MultiSensors -I../libraries/Dallas-Temperature -I../libraries/SensorCodec/src test-ds18b20.cpp ../libraries/Dallas-Temperature/DallasTemperature.cpp ../Arduino_LoRa_Generic_Simple_MultiSensors/DS18B20.cpp ../Arduino_LoRa_Generic_Simple_MultiSensors/Sensor.cpp ../libraries/SensorCodec/src/SensorCodec.cpp -o test-ds18b20
+ *  > ./test-ds18b20
+ *
+ *  OneWire.h is replaced by a simulated bus where each reset, bit slot, conversion and
+ *  delay() takes the time of the real one, so that the time the MCU is awake can be measured
+ *  for 1, 4 and 8 probes:
+ *  - blocking: requestTemperatures() waits for the conversion, then getTempCByIndex() for each probe
+ *  - asynchronous: requestTemperatures() returns at once, the MCU sleeps for millisToWaitForConversion(),
+ *    then getAllTemps() reads all the probes with a single search of the bus
+ *  The DS18B20 class of the MultiSensors sketch is then read with update_sensors().
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "OneWire.h"
+#include "DallasTemperature.h"
+#include "DS18B20.h"
+
+#include "check.h"
+
+// time in us, the MCU is awake unless it is in sleepMs()
+unsigned long long now_us=0;
+unsigned long long slept_us=0;
+
+unsigned long millis() {
+  return now_us/1000;
+}
+
+unsigned long micros() {
+  return now_us;
+}
+
+void delay(unsigned long ms) {
+  now_us+=ms*1000ULL;
+}
+
+void delayMicroseconds(unsigned int us) {
+  now_us+=us;
+}
+
+void sleepMs(unsigned long ms) {
+  now_us+=ms*1000ULL;
+  slept_us+=ms*1000ULL;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+}
+
+int digitalRead(uint8_t pin) {
+  return 0;
+}
+
+int analogRead(uint8_t pin) {
+  return 0;
+}
+
+long random(long min, long max) {
+  return min+rand()%(max-min);
+}
+
+// timings of OneWire.cpp
+#define RESET_US 960
+#define WRITE_1_US 65
+#define WRITE_0_US 70
+#define READ_US 66
+
+#define MAX_PROBES 8
+
+struct simProbe {
+  uint8_t rom[8];
+  uint8_t scratchpad[9];
+  // in 1/16 degrees C
+  int16_t temp;
+  unsigned long long converted_at;
+  bool converting;
+};
+
+simProbe probes[MAX_PROBES];
+uint8_t n_probes=0;
+
+enum { BUS_IDLE, BUS_ROM, BUS_FUNCTION, BUS_READ, BUS_WRITE, BUS_POWER } bus_state=BUS_IDLE;
+// -1 for all the probes after a skip-ROM
+int selected=-1;
+uint8_t bus_pos;
+uint8_t search_index;
+
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len) {
+
+  uint8_t crc=0;
+
+  while (len--) {
+    uint8_t inbyte=*addr++;
+    for (uint8_t i=8; i; i--) {
+      uint8_t mix=(crc ^ inbyte) & 0x01;
+      crc>>=1;
+      if (mix)
+        crc^=0x8C;
+      inbyte>>=1;
+    }
+  }
+
+  return crc;
+}
+
+uint8_t resolution(const simProbe* p) {
+  return 9+(p->scratchpad[CONFIGURATION] >> 5);
+}
+
+// datasheet maximum conversion time
+unsigned long conversionUs(const simProbe* p) {
+  return 93750UL << (resolution(p)-9);
+}
+
+void updateScratchpad(simProbe* p) {
+
+  if (p->converting && now_us>=p->converted_at) {
+    // the undefined bits are 0 in practice
+    int16_t t=p->temp & ~((1 << (12-resolution(p)))-1);
+    p->scratchpad[TEMP_LSB]=t & 0xFF;
+    p->scratchpad[TEMP_MSB]=(t >> 8) & 0xFF;
+    p->converting=false;
+  }
+
+  p->scratchpad[SCRATCHPAD_CRC]=OneWire::crc8(p->scratchpad, 8);
+}
+
+void addProbe(int16_t temp, uint8_t config) {
+
+  simProbe* p=&probes[n_probes++];
+
+  p->rom[0]=DS18B20MODEL;
+  for (uint8_t i=1; i<7; i++)
+    p->rom[i]=rand();
+  p->rom[7]=OneWire::crc8(p->rom, 7);
+
+  // 85 degrees C at power-up
+  memset(p->scratchpad, 0, sizeof(p->scratchpad));
+  p->scratchpad[TEMP_LSB]=0x50;
+  p->scratchpad[TEMP_MSB]=0x05;
+  p->scratchpad[CONFIGURATION]=config;
+  p->temp=temp;
+  p->converting=false;
+  updateScratchpad(p);
+}
+
+OneWire::OneWire(uint8_t pin) {
+}
+
+uint8_t OneWire::reset(void) {
+  now_us+=RESET_US;
+  bus_state=BUS_ROM;
+  return n_probes>0;
+}
+
+void OneWire::write_bit(uint8_t v) {
+  now_us+=v ? WRITE_1_US : WRITE_0_US;
+}
+
+uint8_t OneWire::read_bit(void) {
+
+  now_us+=READ_US;
+
+  // externally powered
+  if (bus_state==BUS_POWER)
+    return 1;
+
+  // 0 while a probe converts
+  for (uint8_t i=0; i<n_probes; i++)
+    if (probes[i].converting && now_us<probes[i].converted_at)
+      return 0;
+
+  return 1;
+}
+
+void OneWire::write(uint8_t v, uint8_t power) {
+
+  for (uint8_t i=0; i<8; i++)
+    write_bit((v >> i) & 1);
+
+  if (bus_state==BUS_WRITE) {
+    if (selected>=0)
+      probes[selected].scratchpad[bus_pos++]=v;
+    return;
+  }
+
+  if (bus_state!=BUS_FUNCTION)
+    return;
+
+  if (v==STARTCONVO) {
+    for (uint8_t i=0; i<n_probes; i++)
+      if (selected<0 || selected==i) {
+        probes[i].converting=true;
+        probes[i].converted_at=now_us+conversionUs(&probes[i]);
+      }
+    bus_state=BUS_IDLE;
+  }
+  else if (v==READSCRATCH) {
+    bus_state=BUS_READ;
+    bus_pos=0;
+    if (selected>=0)
+      updateScratchpad(&probes[selected]);
+  }
+  else if (v==WRITESCRATCH) {
+    bus_state=BUS_WRITE;
+    bus_pos=HIGH_ALARM_TEMP;
+  }
+  else if (v==READPOWERSUPPLY)
+    bus_state=BUS_POWER;
+  else
+    bus_state=BUS_IDLE;
+}
+
+void OneWire::write_bytes(const uint8_t *buf, uint16_t count, bool power) {
+  for (uint16_t i=0; i<count; i++)
+    write(buf[i], power);
+}
+
+uint8_t OneWire::read(void) {
+
+  uint8_t v=0;
+
+  for (uint8_t i=0; i<8; i++)
+    now_us+=READ_US;
+
+  if (bus_state==BUS_READ && selected>=0 && bus_pos<9)
+    v=probes[selected].scratchpad[bus_pos++];
+  else
+    v=0xFF;
+
+  return v;
+}
+
+void OneWire::read_bytes(uint8_t *buf, uint16_t count) {
+  for (uint16_t i=0; i<count; i++)
+    buf[i]=read();
+}
+
+void OneWire::skip(void) {
+  bus_state=BUS_IDLE;
+  write(0xCC);
+  selected=-1;
+  bus_state=BUS_FUNCTION;
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+
+  bus_state=BUS_IDLE;
+  write(0x55);
+  for (uint8_t i=0; i<8; i++)
+    write(rom[i]);
+
+  selected=-2;
+  for (uint8_t i=0; i<n_probes; i++)
+    if (!memcmp(probes[i].rom, rom, 8))
+      selected=i;
+
+  bus_state=BUS_FUNCTION;
+}
+
+void OneWire::depower(void) {
+}
+
+void OneWire::reset_search() {
+  search_index=0;
+}
+
+// the probes are found in the order of the array, with the bus time of the real search:
+// a reset, the search command, then 2 read slots and 1 write slot for each of the 64 bits
+uint8_t OneWire::search(uint8_t *newAddr, bool search_mode) {
+
+  if (search_index>=n_probes) {
+    search_index=0;
+    return 0;
+  }
+
+  reset();
+  bus_state=BUS_IDLE;
+  write(0xF0);
+
+  for (uint8_t i=0; i<64; i++) {
+    uint8_t bit=(probes[search_index].rom[i/8] >> (i%8)) & 1;
+    now_us+=2*READ_US;
+    write_bit(bit);
+  }
+
+  memcpy(newAddr, probes[search_index++].rom, 8);
+
+  return 1;
+}
+
+int16_t randomTemp() {
+  // -20 to 50 degrees C in 1/16
+  return rand()%(70*16)-20*16;
+}
+
+float expected(const simProbe* p) {
+  return (p->temp & ~((1 << (12-resolution(p)))-1))/16.0;
+}
+
+void measure(uint8_t n, uint8_t bits) {
+
+  OneWire ds(3);
+  DallasTemperature sensors(&ds);
+  uint8_t config=TEMP_9_BIT+((bits-9) << 5);
+  unsigned long long start, awake_begin, awake_blocking, awake_async;
+  int16_t raw[MAX_PROBES];
+
+  n_probes=0;
+  for (uint8_t i=0; i<n; i++)
+    addProbe(randomTemp(), config);
+
+  start=now_us;
+  sensors.begin();
+  awake_begin=now_us-start;
+  CHECK(sensors.getDeviceCount()==n);
+
+  // as the DS18B20 class did, the conversion is polled
+  start=now_us;
+  sensors.requestTemperatures();
+  for (uint8_t i=0; i<n; i++)
+    CHECK(sensors.getTempCByIndex(i)==expected(&probes[i]));
+  awake_blocking=now_us-start;
+
+  for (uint8_t i=0; i<n; i++)
+    probes[i].temp=randomTemp();
+
+  sensors.setWaitForConversion(false);
+  CHECK(sensors.millisToWaitForConversion()==sensors.millisToWaitForConversion(bits));
+
+  start=now_us;
+  slept_us=0;
+  sensors.requestTemperatures();
+  sleepMs(sensors.millisToWaitForConversion());
+  CHECK(sensors.getAllTemps(raw, MAX_PROBES)==n);
+  awake_async=now_us-start-slept_us;
+
+  for (uint8_t i=0; i<n; i++)
+    CHECK(DallasTemperature::rawToCelsius(raw[i])==expected(&probes[i]));
+
+  // only the probes that fit
+  if (n>1)
+    CHECK(sensors.getAllTemps(raw, n-1)==n-1);
+
+  printf("%u probe(s), %2u bits: awake %6.1f ms blocking, %5.1f ms asynchronous (sleeping %lu ms), begin() %5.1f ms\n",
+    n, bits, awake_blocking/1000.0, awake_async/1000.0, (unsigned long)sensors.millisToWaitForConversion(), awake_begin/1000.0);
+}
+
+// the DS18B20 class: 2 calls of read_data() with the conversion in between
+void sketchSensor() {
+
+  n_probes=0;
+  for (uint8_t i=0; i<4; i++)
+    addProbe(randomTemp(), TEMP_12_BIT);
+
+  // static as in the sketch, the class does not free the library objects
+  static DS18B20 ds18b20((char*)"DS", IS_NOT_ANALOG, IS_CONNECTED, IS_LOWPOWER, 3, 4);
+  Sensor* sensors[]={&ds18b20};
+
+  ds18b20.set_resolution(10);
+
+  for (int k=0; k<3; k++) {
+
+    for (uint8_t i=0; i<n_probes; i++)
+      probes[i].temp=randomTemp();
+
+    unsigned long start=millis();
+
+    update_sensors(sensors, 1);
+
+    CHECK(ds18b20.get_n_probes()==4);
+    CHECK(resolution(&probes[0])==10);
+
+    for (uint8_t i=0; i<n_probes; i++)
+      CHECK(ds18b20.get_probe_data(i)==expected(&probes[i]));
+
+    CHECK(ds18b20.get_data()==ds18b20.get_probe_data(0));
+    CHECK(ds18b20.get_probe_data(4)==DEVICE_DISCONNECTED_C);
+    // the warm-up and the 10-bit conversion
+    CHECK(millis()-start>=1000+188);
+  }
+
+  CHECK(ds18b20.get_value()==expected(&probes[0]));
+}
+
+int main() {
+
+  srand(1);
+
+  const uint8_t counts[]={1, 4, 8};
+
+  for (uint8_t bits=12; bits>=9; bits-=3)
+    for (uint8_t i=0; i<3; i++)
+      measure(counts[i], bits);
+
+  sketchSensor();
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
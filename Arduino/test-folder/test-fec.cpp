@@ -0,0 +1,427 @@
+/*
+ *  Packet-erasure FEC of the image packets (packet_fec.h of the uCam library)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/uCam test-fec.cpp -o test-fec
+ *  > ./test-fec
+ *
+ *  The lion of gw_full_latest/ucam-images is packetized as FillPacket() of the sketch with the
+ *  LoRa MSS, without FEC and with WITH_FEC for several group sizes (k) and parity packets (m).
+ *  Each packet is lost with probability 5% to 30%, then FECdecoding(), JPEGdepacketization()
+ *  and JPEGdecoding() of decode_to_bmp.c decode the received packets as on the gateway. The
+ *  overhead is in bytes sent (header, offset and data) against the image without FEC, the PSNR
+ *  is against the original image and averaged over the runs, with the percentage of the images
+ *  decoded without any missing block.
+ */
+
+#include <inttypes.h>
+
+#include "Arduino.h"
+
+#define LORA_UCAM
+#define SHORT_COMPUTATION
+#include "mqc.h"
+
+#define CRAN_NEW_CODING
+#define FIXED_POINT_DCT
+#include "jpeg_dct.h"
+#include "packet_fec.h"
+
+// the decoder of the gateway, bmp.h defines max() and min()
+#undef max
+#undef min
+#undef MQC_NUMCTXS
+
+namespace gw {
+#define main decode_to_bmp_main
+#include "../../gw_full_latest/ucam-images/decode_to_bmp.c"
+#undef main
+}
+
+#include "check.h"
+
+#define SIZE 128
+#define N (SIZE/8)
+#define MSS 235
+#define PREAMBLE_SIZE 7
+#define MAX_PACKETS 64
+#define RUNS 200
+
+SerialStub Serial;
+
+struct position { uint8_t row; uint8_t col; } ZigzagCoordinates[8*8]=
+  {0, 0, 0, 1, 1, 0, 2, 0, 1, 1, 0, 2, 0, 3, 1, 2, 2, 1, 3, 0,
+   4, 0, 3, 1, 2, 2, 1, 3, 0, 4, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1,
+   5, 0, 6, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1, 5, 0, 6, 0, 7, 1, 6,
+   2, 5, 3, 4, 4, 3, 5, 2, 6, 1, 7, 0, 7, 1, 6, 2, 5, 3, 4, 4,
+   3, 5, 2, 6, 1, 7, 2, 7, 3, 6, 4, 5, 5, 4, 6, 3, 7, 2, 7, 3,
+   6, 4, 5, 5, 4, 6, 3, 7, 4, 7, 5, 6, 6, 5, 7, 4, 7, 5, 6, 6,
+   5, 7, 6, 7, 7, 6, 7, 7};
+
+// [x][y] as in the sketch
+uint8_t image[SIZE][SIZE];
+
+// the luminance of the 16-bit (RGB555) BMP file
+bool readBMP(const char *file) {
+
+  FILE *f=fopen(file, "rb");
+  uint8_t header[54];
+
+  if (!f)
+    return false;
+
+  if (fread(header, 1, 54, f)!=54 || header[28]!=16) {
+    fclose(f);
+    return false;
+  }
+
+  fseek(f, header[10] | header[11] << 8 | header[12] << 16 | header[13] << 24, SEEK_SET);
+
+  for (int row=SIZE-1; row>=0; row--)
+    for (int col=0; col<SIZE; col++) {
+      int lo=fgetc(f);
+      int rgb=lo | fgetc(f) << 8;
+      image[row][col]=(uint8_t)(0.299*((rgb >> 10) & 0x1F)*255/31.0+0.587*((rgb >> 5) & 0x1F)*255/31.0+
+                                0.114*(rgb & 0x1F)*255/31.0+0.5);
+    }
+
+  fclose(f);
+  return true;
+}
+
+// the packetization of the sketch
+opj_mqc_t mqobjet, mqbckobjet, *objet=NULL;
+uint8_t buffer[MQC_NUMCTXS], bckbuffer[MQC_NUMCTXS];
+uint8_t packet[MQC_NUMCTXS];
+int packetsize, packetoffset;
+bool withFEC, sendingParity;
+int mss;
+
+struct { int offset; int size; uint8_t data[MQC_NUMCTXS]; } packets[MAX_PACKETS];
+int npackets, bytes;
+
+void CreateNewPacket(unsigned int BlockOffset) {
+
+  objet=&mqobjet;
+  memset(buffer, 0, sizeof(buffer));
+  mqc_init_enc(objet, buffer);
+  mqc_resetstates(objet);
+  packetoffset=BlockOffset;
+  packetsize=0;
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+  mqc_flush(objet);
+}
+
+void SendParityPackets();
+
+void SendPacket() {
+
+  if (packetsize==0)
+    return;
+
+  CHECK(npackets<MAX_PACKETS && packetsize<=MSS-2);
+  packets[npackets].offset=packetoffset;
+  packets[npackets].size=packetsize;
+  memcpy(packets[npackets].data, packet, packetsize);
+  npackets++;
+  bytes+=PREAMBLE_SIZE+2+packetsize;
+
+  if (withFEC && !sendingParity && FECaddPacket(packetoffset, packet, packetsize))
+    SendParityPackets();
+}
+
+void SendParityPackets() {
+
+  uint16_t offset;
+
+  sendingParity=true;
+
+  for (uint8_t j=0; j<FECparityPackets; j++) {
+    packetsize=FECparityPacket(j, packet, &offset);
+    packetoffset=offset;
+    SendPacket();
+  }
+
+  sendingParity=false;
+  packetsize=0;
+  FECgroup++;
+  FECbegin();
+}
+
+void golomb(unsigned int value) {
+
+  for (unsigned int x=0; x<value/2; x++)
+    mqc_encode(objet, 1);
+
+  mqc_encode(objet, 0);
+  mqc_encode(objet, value%2);
+}
+
+int FillPacket(int Block[8][8], bool *full) {
+
+  int K=63;
+
+  mqc_restore(objet, &mqbckobjet, bckbuffer);
+
+  while (Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]==0 && K>0)
+    K--;
+
+  K++;
+  golomb(K);
+
+  for (int x=0; x<K; x++) {
+    int c=Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col];
+    golomb(c>=0 ? 2*c : 2*abs(c)-1);
+  }
+
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+  mqc_flush(objet);
+
+  int buffersize=mqc_numbytes(objet);
+
+  if (buffersize>mss-2)
+    return -1;
+
+  packetsize=buffersize;
+  memcpy(packet, buffer, packetsize);
+  *full=buffersize>=mss-6;
+
+  return 0;
+}
+
+// encode_ucam_file_data() of the sketch, k=0 without FEC
+void encode(int k, int m) {
+
+  int Block[8][8];
+  unsigned int offset=0;
+  bool RTS=false;
+
+  withFEC=k>0;
+  mss=withFEC ? MSS-FEC_OVERHEAD(k) : MSS;
+  npackets=bytes=0;
+
+  if (withFEC) {
+    free(FECparity);
+    CHECK(FECallocate(k, m, MQC_NUMCTXS));
+    FECgroup=0;
+    FECbegin();
+  }
+
+  CreateNewPacket(offset);
+
+  for (int row=0; row<N; row++)
+    for (int col=0; col<N; col++) {
+      int row_mix=((row*5)+(col*8))%N*8;
+      int col_mix=((row*8)+(col*13))%N*8;
+
+      for (int i=0; i<8; i++)
+        for (int j=0; j<8; j++)
+          Block[i][j]=image[row_mix+i][col_mix+j];
+
+      JPEGencoding(Block);
+
+      if (FillPacket(Block, &RTS)==-1) {
+        SendPacket();
+        CreateNewPacket(offset);
+        FillPacket(Block, &RTS);
+      }
+
+      offset++;
+
+      if (RTS) {
+        SendPacket();
+        CreateNewPacket(offset);
+        RTS=false;
+      }
+    }
+
+  SendPacket();
+
+  if (withFEC && FECcount)
+    SendParityPackets();
+}
+
+// decodes the received packets as decode_to_bmp, returns the PSNR
+gw::BMPImageStruct decoded;
+bool lost[MAX_PACKETS];
+
+double decode(bool *complete) {
+
+  FILE *dat=tmpfile();
+  double mse=0;
+
+  for (int k=0; k<npackets; k++) {
+    if (lost[k])
+      continue;
+
+    fprintf(dat, "%04X %02X %02X ", packets[k].size+2, packets[k].offset >> 8 & 0xff, packets[k].offset & 0xff);
+
+    for (int x=0; x<packets[k].size; x++)
+      fprintf(dat, "%02X ", packets[k].data[x]);
+  }
+
+  rewind(dat);
+
+  for (int i=0; i<SIZE; i++)
+    for (int j=0; j<SIZE; j++)
+      decoded.data[i][j]=0.0;
+
+  FILE *dataFile=gw::FECdecoding(dat);
+
+  memset(gw::receivedBlock, 0, N*N*sizeof(bool));
+  gw::nbReceivedBlocks=0;
+
+  while (gw::JPEGdepacketization(&decoded, dataFile))
+    ;
+
+  if (dataFile!=dat)
+    fclose(dataFile);
+
+  fclose(dat);
+  gw::JPEGdecoding(&decoded, &decoded);
+  *complete=gw::nbReceivedBlocks==N*N;
+
+  for (int x=0; x<SIZE; x++)
+    for (int y=0; y<SIZE; y++)
+      mse+=(decoded.data[x][y]-image[x][y])*(decoded.data[x][y]-image[x][y]);
+
+  mse/=SIZE*SIZE;
+
+  return mse ? 10*log10(255.0*255.0/mse) : 99.0;
+}
+
+const int losses[]={0, 5, 10, 20, 30};
+#define NLOSSES (int)(sizeof(losses)/sizeof(losses[0]))
+
+double reference[SIZE][SIZE];
+double psnrNoFEC[NLOSSES];
+
+void run(int k, int m, int noFECbytes) {
+
+  double psnr[NLOSSES];
+  int complete[NLOSSES];
+
+  encode(k, m);
+
+  for (int l=0; l<NLOSSES; l++) {
+    psnr[l]=0;
+    complete[l]=0;
+    srand(l+1);
+
+    for (int r=0; r<RUNS; r++) {
+      bool ok;
+
+      for (int p=0; p<npackets; p++)
+        lost[p]=rand()%100<losses[l];
+
+      psnr[l]+=decode(&ok);
+      complete[l]+=ok;
+
+      if (losses[l]==0)
+        break;
+    }
+
+    psnr[l]/=losses[l]==0 ? 1 : RUNS;
+
+    if (losses[l]==0) {
+      // the same image with or without FEC
+      for (int i=0; i<SIZE; i++)
+        for (int j=0; j<SIZE; j++)
+          if (k==0)
+            reference[i][j]=decoded.data[i][j];
+          else
+            CHECK(decoded.data[i][j]==reference[i][j]);
+
+      CHECK(complete[l]==1);
+      complete[l]=RUNS;
+    }
+  }
+
+  if (k==0) {
+    printf("%-10s %3d %5d %5s ", "no FEC", npackets, bytes, "");
+
+    for (int l=0; l<NLOSSES; l++)
+      psnrNoFEC[l]=psnr[l];
+  }
+  else {
+    char name[16];
+
+    snprintf(name, sizeof(name), "k=%d m=%d", k, m);
+    printf("%-10s %3d %5d %4.0f%% ", name, npackets, bytes, 100.0*(bytes-noFECbytes)/noFECbytes);
+  }
+
+  for (int l=0; l<NLOSSES; l++)
+    printf(" %5.2f %3.0f%%", psnr[l], 100.0*complete[l]/RUNS);
+
+  printf("\n");
+
+  // the parity packets help at 10% loss
+  if (k>0)
+    CHECK(psnr[2]>psnrNoFEC[2]);
+}
+
+// any m lost packets of a group are recovered
+void recovery(int k, int m) {
+
+  bool ok;
+
+  encode(k, m);
+
+  for (int first=0; first+m<=k+m; first++) {
+    for (int p=0; p<npackets; p++)
+      lost[p]=(p%(k+m))>=first && (p%(k+m))<first+m;
+
+    decode(&ok);
+    CHECK(ok);
+    CHECK(gw::nbRecoveredPackets>0 || first>=k);
+    CHECK(gw::nbLostPackets==0);
+
+    for (int i=0; i<SIZE; i++)
+      for (int j=0; j<SIZE; j++)
+        CHECK(decoded.data[i][j]==reference[i][j]);
+  }
+}
+
+int main() {
+
+  const int configs[][2]={{8, 1}, {8, 2}, {8, 4}, {4, 2}};
+  char templateFile[]="../../gw_full_latest/ucam-images/128x128-test.bmp";
+
+  if (!readBMP("../../gw_full_latest/ucam-images/lion-128x128.bmp") || gw::ReadBitmapFile(templateFile, &decoded)) {
+    printf("cannot read the BMP files\n");
+    return 1;
+  }
+
+  gw::receivedBlock=(bool*)calloc(N*N, sizeof(bool));
+
+  const int Qs[]={20, 50};
+
+  for (unsigned q=0; q<sizeof(Qs)/sizeof(Qs[0]); q++) {
+    QTinitialization(Qs[q]);
+    gw::QTinitialization(Qs[q]);
+
+    printf("Q=%d%-8s %3s %5s %5s ", Qs[q], "", "pkt", "bytes", "over");
+
+    for (int l=0; l<NLOSSES; l++)
+      printf("  %3d%% loss ", losses[l]);
+
+    printf("\n");
+
+    run(0, 0, 0);
+
+    int noFECbytes=bytes;
+
+    for (unsigned c=0; c<sizeof(configs)/sizeof(configs[0]); c++)
+      run(configs[c][0], configs[c][1], noFECbytes);
+
+    for (unsigned c=0; c<sizeof(configs)/sizeof(configs[0]); c++)
+      recovery(configs[c][0], configs[c][1]);
+  }
+
+  // the same GF(256) on the node and on the gateway
+  gw::FECinit();
+  CHECK(memcmp(FECexp, gw::FECexp, sizeof(FECexp))==0);
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,361 @@
+/*
+ *  Correctness and speed of the fixed-point data of Sensor.cpp for the analog sensors
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../Arduino_LoRa_Generic_Simple_MultiSensors -I../libraries/SensorCodec/src test-fixedPoint.cpp ../Arduino_LoRa_Generic_Simple_MultiSensors/{Sensor,LM35,TMP36,rawAnalog,LeafWetness}.cpp ../libraries/SensorCodec/src/SensorCodec.cpp -o test-fixedPoint
+ *  > ./test-fixedPoint
+ *
+ *  - TMP36, LM35, rawAnalog and LeafWetness are read from simulated analog values and compared
+ *    to the previous floating-point computation, rounded to the same number of decimals
+ *  - format_data(), the calibration and scale_sum() are compared to their floating-point equivalent
+ *  - the floating-point operations of the previous computation are counted, each one being a call
+ *    to the software floating-point library on AVR, against a single 32-bit division in scale_sum()
+ *  - both computations are timed on this computer, but it has a floating-point unit and the time of
+ *    read_data() is mostly the calls to the getters of Sensor: the gain is on AVR only
+ */
+
+#include <stdio.h>
+#include <x86intrin.h>
+
+#include "Arduino.h"
+#include "LM35.h"
+#include "TMP36.h"
+#include "rawAnalog.h"
+#include "LeafWetness.h"
+
+#include "check.h"
+
+// the values returned by analogRead()
+int adc[256];
+int adc_index=0;
+int digital=0;
+
+unsigned long millis() {
+  return 0;
+}
+
+// not inlined in the previous computation, as for read_data()
+__attribute__((noinline)) void delay(unsigned long ms) {
+}
+
+void delayMicroseconds(unsigned int us) {
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+}
+
+int digitalRead(uint8_t pin) {
+  return digital;
+}
+
+__attribute__((noinline)) int analogRead(uint8_t pin) {
+  return adc[adc_index++ & 0xFF];
+}
+
+long random(long min, long max) {
+  return min+rand()%(max-min);
+}
+
+// counts the operations of the software floating-point library of AVR
+struct opCount {
+  long add, mul, div, conv;
+};
+
+opCount ops;
+
+struct Float {
+  double v;
+  Float(double d=0) : v(d) {}
+  // int to float
+  Float(int i) : v(i) { ops.conv++; }
+  Float(long i) : v(i) { ops.conv++; }
+  Float operator+(Float b) const { ops.add++; return v+b.v; }
+  Float operator-(Float b) const { ops.add++; return v-b.v; }
+  Float operator*(Float b) const { ops.mul++; return v*b.v; }
+  Float operator/(Float b) const { ops.div++; return v/b.v; }
+  Float& operator+=(Float b) { ops.add++; v+=b.v; return *this; }
+  bool operator<(Float b) const { ops.add++; return v<b.v; }
+  long toLong() const { ops.conv++; return (long)v; }
+};
+
+// the previous read_data() of the sensors then the set_data() rounding, with T=double or Float
+template<class T> long roundData(T d, uint8_t decimals) {
+  for (uint8_t i=0; i<decimals; i++)
+    d=d*T(10.0);
+  return (d<T(0.0) ? d-T(0.5) : d+T(0.5)).toLong();
+}
+
+template<> long roundData<double>(double d, uint8_t decimals) {
+  for (uint8_t i=0; i<decimals; i++)
+    d*=10.0;
+  return (long)(d<0 ? d-0.5 : d+0.5);
+}
+
+template<class T> long oldLM35(uint8_t n, uint8_t decimals) {
+  T temperature=0.0;
+  for (int i=0; i<n; i++) {
+    T aux_temp=T(analogRead(0));
+    delay(10);
+    aux_temp=aux_temp*T((double)_BOARD_MVOLT_SCALE)/T(1024.0);
+    aux_temp=aux_temp/T(10.0);
+    temperature+=aux_temp;
+  }
+  return roundData(temperature/T((int)n), decimals);
+}
+
+template<class T> long oldTMP36(uint8_t n, uint8_t decimals) {
+  T temperature=0.0;
+  for (int i=0; i<n; i++) {
+    T aux_temp=T(analogRead(0));
+    delay(10);
+    aux_temp=((aux_temp*T((double)_BOARD_MVOLT_SCALE)/T(1024.0))-T(500.0))/T(10.0);
+    temperature+=aux_temp;
+  }
+  return roundData(temperature/T((int)n), decimals);
+}
+
+template<class T> long oldRawAnalog(uint8_t n, uint8_t decimals) {
+  int value=0;
+  for (int i=0; i<n; i++) {
+    value+=analogRead(0);
+    delay(10);
+  }
+  return roundData(T(value)/T((int)n), decimals);
+}
+
+template<class T> long oldLeafWetness(uint8_t n, uint8_t decimals) {
+  return roundData(T(analogRead(0))*T((double)_BOARD_VOLT_SCALE)/T(1024.0), decimals);
+}
+
+// the ftoa() of the sketch with 2 decimals, without the itoa()
+template<class T> long oldFormat(T f) {
+  long heiltal=f.toLong();
+  long desimal=((f-T(heiltal))*T(100.0)).toLong();
+  return heiltal+desimal;
+}
+
+template<> long oldFormat<double>(double f) {
+  long heiltal=(long)f;
+  return heiltal+labs((long)((f-heiltal)*100));
+}
+
+void fillAdc(int value) {
+  for (int i=0; i<256; i++)
+    adc[i]=(value<0) ? rand()%1024 : value;
+}
+
+// compare the fixed-point data of the sensor with the previous floating-point computation
+template<long (*old)(uint8_t, uint8_t)> void compare(Sensor* s, const char* name, int n_values) {
+
+  int worst=0;
+
+  for (uint8_t decimals=0; decimals<=4; decimals++) {
+
+    s->set_decimals(decimals);
+
+    for (int t=0; t<n_values; t++) {
+
+      uint8_t n=(t%3==0) ? 5 : 1+rand()%255;
+
+      fillAdc(t<1024 ? t : -1);
+      s->set_n_sample(n);
+
+      adc_index=0;
+      long expected=old(n, decimals);
+      adc_index=0;
+      s->read_data();
+
+      int d=labs(s->get_fixed_data()-expected);
+
+      if (d>worst)
+        worst=d;
+    }
+  }
+
+  // the floating-point computation also rounds, so that 1 unit of the last decimal may differ
+  if (worst>1) {
+    failures++;
+    printf("%s: difference of %d\n", name, worst);
+  }
+}
+
+void checkFormat(int n) {
+
+  char buf[SENSOR_MAX_DATA_LENGTH+1], expected[64];
+  rawAnalog s((char*)"SH", IS_ANALOG, IS_NOT_CONNECTED, IS_NOT_LOWPOWER, 0, 0);
+
+  s.set_fake_data(true);
+
+  for (int t=0; t<n; t++) {
+
+    int32_t v=(t%2) ? (int32_t)((uint32_t)rand() ^ ((uint32_t)rand() << 16)) : rand()%20001-10000;
+    uint8_t decimals=rand()%10;
+
+    if (t==0)
+      v=INT32_MIN;
+
+    s.set_decimals(decimals);
+    s.set_fixed_data(v);
+
+    uint32_t a=v<0 ? -(uint32_t)v : (uint32_t)v;
+    uint32_t scale=s.get_scale();
+
+    if (decimals)
+      sprintf(expected, "%s%u.%0*u", v<0 ? "-" : "", a/scale, decimals, a%scale);
+    else
+      sprintf(expected, "%s%u", v<0 ? "-" : "", a);
+
+    uint8_t len=s.format_data(buf);
+
+    if (strcmp(buf, expected) || len!=strlen(expected) || len>SENSOR_MAX_DATA_LENGTH) {
+      failures++;
+      printf("format_data: %s instead of %s\n", buf, expected);
+    }
+  }
+
+  s.set_decimals(2);
+  s.set_data(-0.05);
+  s.format_data(buf);
+  // ftoa() gave 0.5
+  CHECK(!strcmp(buf, "-0.05"));
+  s.set_data(27.05);
+  s.format_data(buf);
+  // ftoa() gave 27.5
+  CHECK(!strcmp(buf, "27.05"));
+
+  rawAnalog off((char*)"SH", IS_ANALOG, IS_NOT_CONNECTED, IS_NOT_LOWPOWER, 0, 0);
+  off.set_fixed_data(1234);
+  CHECK(off.get_fixed_data()==-100 && off.get_data()==-1.0);
+}
+
+void checkCalibration(int n) {
+
+  rawAnalog s((char*)"SH", IS_ANALOG, IS_NOT_CONNECTED, IS_NOT_LOWPOWER, 0, 0);
+
+  s.set_fake_data(true);
+
+  for (int t=0; t<n; t++) {
+
+    int32_t v=rand()%2000001-1000000;
+    int32_t offset=rand()%2001-1000;
+    uint16_t gain=rand()%4096;
+
+    s.set_calibration(offset, gain);
+    s.set_fixed_data(v);
+
+    double expected=(double)v*gain/SENSOR_GAIN_ONE+offset;
+
+    if (fabs(s.get_fixed_data()-expected)>1.0) {
+      failures++;
+      printf("calibration of %d: %d instead of %.1f\n", v, s.get_fixed_data(), expected);
+    }
+  }
+
+  s.set_calibration(-50, SENSOR_GAIN_ONE/2);
+  s.set_fixed_data(2000);
+  CHECK(s.get_fixed_data()==950);
+}
+
+void checkScaleSum(int n) {
+
+  for (int t=0; t<n; t++) {
+
+    uint8_t count=1+rand()%255;
+    uint32_t sum=rand()%(1024*count);
+    uint32_t mul=(t%2) ? rand()%0x200000 : rand()%100000000;
+    uint32_t div=1+rand()%2000000;
+
+    double expected=(double)sum*mul/((double)count*div);
+
+    if (expected>=INT32_MAX)
+      continue;
+
+    int32_t v=Sensor::scale_sum(sum, count, mul, div);
+
+    if (fabs(v-expected)>1.0) {
+      failures++;
+      printf("scale_sum(%u, %u, %u, %u): %d instead of %.2f\n", sum, count, mul, div, v, expected);
+    }
+  }
+}
+
+// host cycles per read_data() with 5 samples, against the previous computation
+template<long (*old)(uint8_t, uint8_t)> void bench(Sensor* s, const char* name, uint8_t n) {
+
+  const int loops=2000000;
+  long total=0;
+  uint64_t start;
+  double cycles_old, cycles_new;
+
+  fillAdc(-1);
+  s->set_decimals(2);
+  s->set_n_sample(n);
+
+  start=__rdtsc();
+  for (int i=0; i<loops; i++)
+    total+=old(n, 2);
+  cycles_old=(double)(__rdtsc()-start)/loops;
+
+  start=__rdtsc();
+  for (int i=0; i<loops; i++) {
+    s->read_data();
+    total+=s->get_fixed_data();
+  }
+  cycles_new=(double)(__rdtsc()-start)/loops;
+
+  printf("%-11s %5.1f -> %5.1f host cycles per sample  (%ld)\n", name, cycles_old/n, cycles_new/n, total & 1);
+}
+
+template<long (*old)(uint8_t, uint8_t)> void countOps(const char* name, uint8_t n) {
+
+  ops=opCount();
+  fillAdc(512);
+  old(n, 2);
+  // then ftoa() in the sketch
+  oldFormat(Float(25.5));
+
+  printf("%-11s %2ld float add/sub, %2ld mul, %2ld div, %2ld int<->float per reading of %u samples, 0 after\n",
+    name, ops.add, ops.mul, ops.div, ops.conv, n);
+}
+
+int main() {
+
+  srand(1);
+
+  LM35 lm35((char*)"LM35", IS_ANALOG, IS_CONNECTED, IS_NOT_LOWPOWER, 0, 9);
+  TMP36 tmp36((char*)"TMP36", IS_ANALOG, IS_CONNECTED, IS_NOT_LOWPOWER, 1, 8);
+  rawAnalog raw((char*)"SH", IS_ANALOG, IS_CONNECTED, IS_NOT_LOWPOWER, 2, 7);
+  LeafWetness lw((char*)"LW", IS_ANALOG, IS_CONNECTED, IS_NOT_LOWPOWER, 3, 6);
+
+  compare<oldLM35<double> >(&lm35, "LM35", 5000);
+  compare<oldTMP36<double> >(&tmp36, "TMP36", 5000);
+  compare<oldRawAnalog<double> >(&raw, "rawAnalog", 5000);
+  compare<oldLeafWetness<double> >(&lw, "LeafWetness", 5000);
+
+  lw.set_is_analog(false);
+  lw.set_decimals(2);
+  digital=1;
+  lw.read_data();
+  CHECK(lw.get_fixed_data()==100);
+  lw.set_is_analog(true);
+
+  checkFormat(1000000);
+  checkCalibration(1000000);
+  checkScaleSum(1000000);
+
+  printf("%d failure(s)\n", failures);
+
+  countOps<oldLM35<Float> >("LM35", 5);
+  countOps<oldTMP36<Float> >("TMP36", 5);
+  countOps<oldRawAnalog<Float> >("rawAnalog", 5);
+  countOps<oldLeafWetness<Float> >("LeafWetness", 1);
+
+  bench<oldLM35<double> >(&lm35, "LM35", 5);
+  bench<oldTMP36<double> >(&tmp36, "TMP36", 5);
+  bench<oldRawAnalog<double> >(&raw, "rawAnalog", 5);
+  bench<oldLeafWetness<double> >(&lw, "LeafWetness", 1);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+/*
+ *  MIC of the LoRaWAN-like frames (Encrypt_V31.cpp of the AES-128_V10 library)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/AES-128_V10 test-mic.cpp ../libraries/AES-128_V10/AES-128_V10.cpp ../libraries/AES-128_V10/Encrypt_V31.cpp -o test-mic
+ *  > ./test-mic
+ *
+ *  The reference is Calculate_MIC() of version 3.1 of the library, which derives K1 and K2
+ *  from NwkSkey for each MIC. Calculate_MIC() and MIC_Init(), MIC_Start(), MIC_Update() and
+ *  MIC_Final() with the data in 2 parts must give the same MIC for all the lengths from 1 to
+ *  255 bytes, both directions and several frame counters. The time is the best in us per MIC on
+ *  the computer, for the reference, for MIC_Init() before each MIC as without the cached subkeys,
+ *  and for Calculate_MIC() with the subkeys of its context.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "AES-128_V10.h"
+#include "Encrypt_V31.h"
+#include "check.h"
+
+unsigned char NwkSkey[16]={ 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+unsigned char AppSkey[16]={ 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+unsigned char DevAddr[4]={ 0x00, 0x00, 0x00, 0x06 };
+
+#define RUNS 20000
+#define REPEATS 9
+
+namespace ref {
+
+// Generate_Keys() and Calculate_MIC() of version 3.1
+void Generate_Keys(unsigned char *K1, unsigned char *K2) {
+
+  memset(K1, 0, 16);
+  AES_Encrypt(K1, NwkSkey);
+
+  unsigned char msb=K1[0] & 0x80;
+  for (int i=0; i<16; i++)
+    K1[i]=(K1[i] << 1) | (i < 15 ? K1[i+1] >> 7 : 0);
+  if (msb)
+    K1[15]^=0x87;
+
+  msb=K1[0] & 0x80;
+  for (int i=0; i<16; i++)
+    K2[i]=(K1[i] << 1) | (i < 15 ? K1[i+1] >> 7 : 0);
+  if (msb)
+    K2[15]^=0x87;
+}
+
+void Calculate_MIC(unsigned char *Data, unsigned char *Final_MIC, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction) {
+
+  unsigned char Block_B[16]={ 0x49, 0, 0, 0, 0, Direction, DevAddr[3], DevAddr[2], DevAddr[1], DevAddr[0],
+    (unsigned char)(Frame_Counter & 0xFF), (unsigned char)((Frame_Counter >> 8) & 0xFF), 0, 0, 0, Data_Length };
+  unsigned char Key_K1[16], Key_K2[16], Old_Data[16], New_Data[16];
+  int Number_of_Blocks=(Data_Length+15)/16;
+  int Incomplete_Block_Size=Data_Length%16;
+
+  Generate_Keys(Key_K1, Key_K2);
+
+  AES_Encrypt(Block_B, NwkSkey);
+  memcpy(Old_Data, Block_B, 16);
+
+  for (int b=1; b<Number_of_Blocks; b++) {
+    memcpy(New_Data, Data, 16);
+    Data+=16;
+    XOR(New_Data, Old_Data);
+    AES_Encrypt(New_Data, NwkSkey);
+    memcpy(Old_Data, New_Data, 16);
+  }
+
+  if (Incomplete_Block_Size == 0) {
+    memcpy(New_Data, Data, 16);
+    XOR(New_Data, Key_K1);
+  }
+  else {
+    memset(New_Data, 0, 16);
+    memcpy(New_Data, Data, Incomplete_Block_Size);
+    New_Data[Incomplete_Block_Size]=0x80;
+    XOR(New_Data, Key_K2);
+  }
+
+  XOR(New_Data, Old_Data);
+  AES_Encrypt(New_Data, NwkSkey);
+  memcpy(Final_MIC, New_Data, 4);
+}
+
+}
+
+// MIC_Init() for each MIC, as the library without a cached context
+void initEachTime(unsigned char *Data, unsigned char *Final_MIC, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction) {
+
+  MIC_Context ctx;
+
+  MIC_Init(&ctx, NwkSkey);
+  MIC_Start(&ctx, DevAddr, Data_Length, Frame_Counter, Direction);
+  MIC_Update(&ctx, Data, Data_Length);
+  MIC_Final(&ctx, Final_MIC);
+}
+
+typedef void (*micFunction)(unsigned char*, unsigned char*, unsigned char, unsigned int, unsigned char);
+
+// the best of REPEATS times, the others are slowed down by the other processes
+double bench(micFunction f, unsigned char *data, int len) {
+
+  unsigned char mic[4];
+  double best=0;
+
+  for (int n=0; n<REPEATS; n++) {
+    clock_t start=clock();
+
+    for (int r=0; r<RUNS; r++)
+      f(data, mic, len, r, 0);
+
+    double t=(double)(clock()-start)/CLOCKS_PER_SEC*1e6/RUNS;
+    if (n==0 || t<best)
+      best=t;
+  }
+
+  return best;
+}
+
+int main() {
+
+  unsigned char data[255];
+  unsigned int counters[]={ 0, 1, 255, 256, 0xABCD, 0xFFFF };
+  const int lengths[]={ 10, 32, 64, 200, 255 };
+
+  srand(1);
+  for (int i=0; i<255; i++)
+    data[i]=rand();
+
+  for (int len=1; len<=255; len++)
+    for (int c=0; c<(int)(sizeof(counters)/sizeof(counters[0])); c++)
+      for (unsigned char dir=0; dir<2; dir++) {
+        unsigned char expected[4], mic[4];
+        MIC_Context ctx;
+
+        ref::Calculate_MIC(data, expected, len, counters[c], dir);
+
+        Calculate_MIC(data, mic, len, counters[c], dir);
+        CHECK(memcmp(mic, expected, 4)==0);
+
+        MIC_Init(&ctx, NwkSkey);
+        MIC_Start(&ctx, DevAddr, len, counters[c], dir);
+        MIC_Update(&ctx, data, len/3);
+        MIC_Update(&ctx, data+len/3, len-len/3);
+        MIC_Final(&ctx, mic);
+        CHECK(memcmp(mic, expected, 4)==0);
+      }
+
+  printf("us per MIC    ref   init  cached\n");
+
+  for (int i=0; i<(int)(sizeof(lengths)/sizeof(lengths[0])); i++)
+    printf("len %3d    %6.2f %6.2f %7.2f\n", lengths[i], bench(ref::Calculate_MIC, data, lengths[i]),
+      bench(initEachTime, data, lengths[i]), bench(Calculate_MIC, data, lengths[i]));
+
+  printf("%d failure(s)\n", failures);
+  return failures ? 1 : 0;
+}
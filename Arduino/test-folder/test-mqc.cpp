@@ -0,0 +1,287 @@
+/*
+ *  MQ coder of the image packets (mqc.h and mqc-mega.h of the uCam library, mqc.h of the gateway)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/uCam test-mqc.cpp -o test-mqc
+ *  > ./test-mqc
+ *
+ *  Each coder is built twice, with MQC_REFERENCE for the bit loops of the original coder and
+ *  without it for the renormalization in one step, the exchanges without branches and
+ *  mqc_decode_unary(). The packets of gw_full_latest/ucam-images/test-Q20.dat are decoded as
+ *  decode_to_bmp.c does and the decoded symbols are coded again, then random Golomb codes with
+ *  a mean of 1 to 32. Both versions must give the same bytes, the same values and the same
+ *  registers. The time is in ns per coded symbol on the computer.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Arduino.h"
+
+#define LORA_UCAM
+#define SHORT_COMPUTATION
+
+namespace node {
+#include "mqc.h"
+}
+
+namespace nodeRef {
+#define MQC_REFERENCE
+#include "mqc.h"
+#undef MQC_REFERENCE
+}
+
+#undef MQC_NUMCTXS
+
+namespace mega {
+#include "mqc-mega.h"
+}
+
+namespace megaRef {
+#define MQC_REFERENCE
+#include "mqc-mega.h"
+#undef MQC_REFERENCE
+}
+
+#undef MQC_NUMCTXS
+
+namespace gw {
+#include "../../gw_full_latest/ucam-images/mqc.h"
+}
+
+namespace gwRef {
+#define MQC_REFERENCE
+#include "../../gw_full_latest/ucam-images/mqc.h"
+#undef MQC_REFERENCE
+}
+
+#include "check.h"
+
+#define DAT_FILE "../../gw_full_latest/ucam-images/test-Q20.dat"
+#define MAX_PACKETS 64
+#define MAX_PACKET_SIZE 255
+// the unary codes longer than that are cut, as the bounded loops of decode_to_bmp.c
+#define MAX_UNARY 1024
+#define MAX_VALUES 200000
+#define MAX_SYMBOLS 2000000
+#define RANDOM_RUNS 200
+#define RUNS 50
+
+struct packet {
+  int size;
+  uint8_t data[MAX_PACKET_SIZE];
+};
+
+packet packets[MAX_PACKETS];
+int npackets=0;
+
+unsigned int values[2][MAX_VALUES];
+uint8_t symbols[MAX_SYMBOLS];
+int nsymbols;
+uint8_t bytes[2][MAX_SYMBOLS/4];
+
+// the data of the packets, without the size and the offset
+int readDat(const char* file) {
+  FILE* f=fopen(file, "r");
+  unsigned int size, byte;
+
+  if (!f) return 0;
+  while (npackets < MAX_PACKETS && fscanf(f, "%4X", &size)==1 && size > 2) {
+    packet* p=&packets[npackets++];
+    fscanf(f, "%2X %2X", &byte, &byte);
+    p->size=size-2;
+    for (int i=0; i<p->size; i++) {
+      fscanf(f, "%2X", &byte);
+      p->data[i]=byte;
+    }
+  }
+  fclose(f);
+  return npackets;
+}
+
+// the symbols of an unary code and its low bit
+template <class MQC> unsigned int decodeGolomb(MQC* m, bool unary, bool record) {
+  unsigned int q;
+  int r;
+
+  if (unary)
+    q=mqc_decode_unary(m, MAX_UNARY);
+  else {
+    int d;
+    q=0;
+    while ((d=mqc_decode(m))==1 && q<MAX_UNARY) {
+      q++;
+      if (record) symbols[nsymbols++]=1;
+    }
+    if (record) symbols[nsymbols++]=d;
+  }
+  r=mqc_decode(m);
+  if (record) symbols[nsymbols++]=r;
+  return q*2+r;
+}
+
+// the blocks of a packet as JPEGdepacketization() of decode_to_bmp.c: K then K coefficients
+template <class MQC> int decodePacket(MQC* m, const packet* p, unsigned int* v, bool unary, bool record) {
+  int n=0;
+
+  mqc_init_dec(m, (unsigned char*)p->data, p->size);
+  mqc_resetstates(m);
+  while (mqc_numbytes(m) < p->size && n < MAX_VALUES-MAX_UNARY) {
+    unsigned int K=decodeGolomb(m, unary, record);
+    v[n++]=K;
+    for (unsigned int x=0; x<K && x<64; x++)
+      v[n++]=decodeGolomb(m, unary, record);
+  }
+  return n;
+}
+
+template <class MQC> int encodeSymbols(MQC* m, uint8_t* buf, const uint8_t* s, int n) {
+  // the byte before the buffer is read by mqc_init_enc()
+  buf[0]=0;
+  mqc_init_enc(m, buf+1);
+  mqc_resetstates(m);
+  for (int i=0; i<n; i++)
+    mqc_encode(m, s[i]);
+  mqc_flush(m);
+  return mqc_numbytes(m);
+}
+
+template <class MQC> int decodeSymbols(MQC* m, const uint8_t* buf, int len, int n) {
+  int ones=0;
+
+  mqc_init_dec(m, (unsigned char*)buf+1, len);
+  mqc_resetstates(m);
+  for (int i=0; i<n; i++)
+    ones+=mqc_decode(m);
+  return ones;
+}
+
+template <class MQC> int decodeValues(MQC* m, const uint8_t* buf, int len, unsigned int* v, int n, bool unary) {
+  mqc_init_dec(m, (unsigned char*)buf+1, len);
+  mqc_resetstates(m);
+  for (int i=0; i<n; i++)
+    v[i]=decodeGolomb(m, unary, false);
+  return n;
+}
+
+template <class REF, class FAST> bool sameRegisters(REF* ref, FAST* fast) {
+  return ref->a==fast->a && ref->c==fast->c && ref->ct==fast->ct && ref->bp-ref->start==fast->bp-fast->start
+    && (*ref->curctx)->qeval==(*fast->curctx)->qeval && (*ref->curctx)->mps==(*fast->curctx)->mps;
+}
+
+// q 1 symbols, a 0 then the low bit, q with a geometric distribution of the given mean
+int randomSymbols(double mean, int nvalues, unsigned int* v) {
+  nsymbols=0;
+  for (int i=0; i<nvalues; i++) {
+    unsigned int q=0;
+    while (q < MAX_UNARY && rand() < RAND_MAX*(mean/(mean+1))) q++;
+    v[i]=q*2+(rand()&1);
+    for (unsigned int k=0; k<q; k++) symbols[nsymbols++]=1;
+    if (q < MAX_UNARY) symbols[nsymbols++]=0;
+    symbols[nsymbols++]=v[i]&1;
+  }
+  return nsymbols;
+}
+
+double elapsed(clock_t start, int n) {
+  return (double)(clock()-start)/CLOCKS_PER_SEC*1e9/((double)RUNS*n);
+}
+
+// the time of the coder of the symbols of the stream, in ns per symbol
+template <class REF, class FAST> void bench(const char* name, const char* stream, int nvalues) {
+  static REF ref;
+  static FAST fast;
+  double encRef, encFast, decRef, decFast, decUnary;
+  int len;
+  clock_t start;
+
+  start=clock();
+  for (int r=0; r<RUNS; r++) len=encodeSymbols(&ref, bytes[0], symbols, nsymbols);
+  encRef=elapsed(start, nsymbols);
+  start=clock();
+  for (int r=0; r<RUNS; r++) encodeSymbols(&fast, bytes[1], symbols, nsymbols);
+  encFast=elapsed(start, nsymbols);
+  start=clock();
+  for (int r=0; r<RUNS; r++) decodeValues(&ref, bytes[0], len, values[0], nvalues, false);
+  decRef=elapsed(start, nsymbols);
+  start=clock();
+  for (int r=0; r<RUNS; r++) decodeValues(&fast, bytes[1], len, values[1], nvalues, false);
+  decFast=elapsed(start, nsymbols);
+  start=clock();
+  for (int r=0; r<RUNS; r++) decodeValues(&fast, bytes[1], len, values[1], nvalues, true);
+  decUnary=elapsed(start, nsymbols);
+
+  printf("%-12s %-14s %8d %7d %6.2f %6.2f %6.2f %6.2f %6.2f %5.2fx\n", name, stream, nsymbols, len,
+    encRef, encFast, decRef, decFast, decUnary, decRef/decUnary);
+}
+
+template <class REF, class FAST> void testCoder(const char* name) {
+  static REF ref;
+  static FAST fast;
+  int n[2], len[2];
+  char stream[16];
+
+  // the captured packets, decoded then coded again
+  for (int p=0; p<npackets; p++) {
+    nsymbols=0;
+    n[0]=decodePacket(&ref, &packets[p], values[0], false, true);
+    n[1]=decodePacket(&fast, &packets[p], values[1], true, false);
+    CHECK(n[0]==n[1] && n[0] > 0);
+    CHECK(memcmp(values[0], values[1], n[0]*sizeof(unsigned int))==0);
+    CHECK(sameRegisters(&ref, &fast));
+
+    len[0]=encodeSymbols(&ref, bytes[0], symbols, nsymbols);
+    len[1]=encodeSymbols(&fast, bytes[1], symbols, nsymbols);
+    CHECK(len[0]==len[1] && memcmp(bytes[0], bytes[1], len[0]+1)==0);
+    CHECK(sameRegisters(&ref, &fast));
+    CHECK(decodeSymbols(&fast, bytes[1], len[1], nsymbols)==decodeSymbols(&ref, bytes[0], len[0], nsymbols));
+    CHECK(sameRegisters(&ref, &fast));
+  }
+
+  // random codes
+  srand(1);
+  for (int r=0; r<RANDOM_RUNS; r++) {
+    int nvalues=1+rand()%2000;
+    double mean=(1+rand()%32)/(double)(1+rand()%4);
+
+    randomSymbols(mean, nvalues, values[0]);
+    len[0]=encodeSymbols(&ref, bytes[0], symbols, nsymbols);
+    len[1]=encodeSymbols(&fast, bytes[1], symbols, nsymbols);
+    CHECK(len[0]==len[1] && memcmp(bytes[0], bytes[1], len[0]+1)==0);
+    CHECK(sameRegisters(&ref, &fast));
+    decodeValues(&ref, bytes[0], len[0], values[1], nvalues, false);
+    decodeValues(&fast, bytes[1], len[1], values[1]+nvalues, nvalues, true);
+    CHECK(memcmp(values[0], values[1], nvalues*sizeof(unsigned int))==0);
+    CHECK(memcmp(values[0], values[1]+nvalues, nvalues*sizeof(unsigned int))==0);
+    CHECK(sameRegisters(&ref, &fast));
+  }
+
+  // all the captured packets as one stream, then random codes
+  nsymbols=0;
+  n[0]=0;
+  for (int p=0; p<npackets; p++)
+    n[0]+=decodePacket(&ref, &packets[p], values[0]+n[0], false, true);
+  bench<REF, FAST>(name, "test-Q20.dat", n[0]);
+  for (int mean=1; mean<=32; mean*=4) {
+    srand(mean);
+    randomSymbols(mean, 20000, values[0]);
+    sprintf(stream, "mean %d", mean);
+    bench<REF, FAST>(name, stream, 20000);
+  }
+}
+
+int main() {
+
+  CHECK(readDat(DAT_FILE) > 0);
+
+  printf("                                               encode ns/sym   decode ns/sym\n");
+  printf("coder        stream          symbols   bytes    ref   fast    ref   fast  unary\n");
+  testCoder<nodeRef::opj_mqc_t, node::opj_mqc_t>("mqc.h");
+  testCoder<megaRef::opj_mqc_t, mega::opj_mqc_t>("mqc-mega.h");
+  testCoder<gwRef::opj_mqc_t, gw::opj_mqc_t>("gw mqc.h");
+
+  printf("%d failure(s)\n", failures);
+  return failures ? 1 : 0;
+}
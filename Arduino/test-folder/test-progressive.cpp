@@ -0,0 +1,365 @@
+/*
+ *  Progressive encoding of the image (PROGRESSIVE_ENCODING of Arduino_LoRa_ucamII)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/uCam test-progressive.cpp -o test-progressive
+ *  > ./test-progressive
+ *
+ *  The sample images of gw_full_latest/ucam-images are packetized as FillPacket() of the sketch
+ *  with the LoRa MSS, with the whole blocks and with the DC coefficients first then the AC
+ *  bands. The first n packets are decoded by JPEGdepacketization() and JPEGdecoding() of
+ *  decode_to_bmp.c, as when the image stops after n packets (LIMIT_TOA), and the PSNR is
+ *  against the original image. When all the packets are received, both images must be the same.
+ */
+
+#include <inttypes.h>
+#include <limits.h>
+
+#include "Arduino.h"
+
+#define LORA_UCAM
+#define SHORT_COMPUTATION
+#include "mqc.h"
+
+#define CRAN_NEW_CODING
+#define FIXED_POINT_DCT
+#include "jpeg_dct.h"
+
+// the decoder of the gateway, bmp.h defines max() and min()
+#undef max
+#undef min
+#undef MQC_NUMCTXS
+
+namespace gw {
+#define main decode_to_bmp_main
+#include "../../gw_full_latest/ucam-images/decode_to_bmp.c"
+#undef main
+}
+
+#include "check.h"
+
+#define SIZE 128
+#define N (SIZE/8)
+#define MSS 235
+#define PREAMBLE_SIZE 7
+#define PROGRESSIVE_SCANS 5
+#define MAX_PACKETS 64
+
+SerialStub Serial;
+
+struct position { uint8_t row; uint8_t col; } ZigzagCoordinates[8*8]=
+  {0, 0, 0, 1, 1, 0, 2, 0, 1, 1, 0, 2, 0, 3, 1, 2, 2, 1, 3, 0,
+   4, 0, 3, 1, 2, 2, 1, 3, 0, 4, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1,
+   5, 0, 6, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1, 5, 0, 6, 0, 7, 1, 6,
+   2, 5, 3, 4, 4, 3, 5, 2, 6, 1, 7, 0, 7, 1, 6, 2, 5, 3, 4, 4,
+   3, 5, 2, 6, 1, 7, 2, 7, 3, 6, 4, 5, 5, 4, 6, 3, 7, 2, 7, 3,
+   6, 4, 5, 5, 4, 6, 3, 7, 4, 7, 5, 6, 6, 5, 7, 4, 7, 5, 6, 6,
+   5, 7, 6, 7, 7, 6, 7, 7};
+
+const uint8_t ProgressiveBands[PROGRESSIVE_SCANS+1]={0, 1, 6, 15, 28, 64};
+
+// [x][y] as in the sketch
+uint8_t image[SIZE][SIZE];
+char templateFile[PATH_MAX];
+
+// luminance of the 8-bit (palette) and 16-bit (RGB555) BMP files
+bool readBMP(const char *file) {
+
+  FILE *f=fopen(file, "rb");
+  uint8_t header[54];
+  uint8_t palette[256][4];
+
+  if (!f)
+    return false;
+
+  if (fread(header, 1, 54, f)!=54 || (header[28]==8 && fread(palette, 4, 256, f)!=256)) {
+    fclose(f);
+    return false;
+  }
+
+  fseek(f, header[10] | header[11] << 8 | header[12] << 16 | header[13] << 24, SEEK_SET);
+
+  for (int row=SIZE-1; row>=0; row--)
+    for (int col=0; col<SIZE; col++)
+      if (header[28]==8) {
+        uint8_t *bgr=palette[fgetc(f)];
+        image[row][col]=(uint8_t)(0.299*bgr[2]+0.587*bgr[1]+0.114*bgr[0]+0.5);
+      }
+      else {
+        int lo=fgetc(f);
+        int rgb=lo | fgetc(f) << 8;
+        image[row][col]=(uint8_t)(0.299*((rgb >> 10) & 0x1F)*255/31.0+0.587*((rgb >> 5) & 0x1F)*255/31.0+
+                                  0.114*(rgb & 0x1F)*255/31.0+0.5);
+      }
+
+  fclose(f);
+  return true;
+}
+
+// the packetization of the sketch
+opj_mqc_t mqobjet, mqbckobjet, *objet=NULL;
+uint8_t buffer[MQC_NUMCTXS], bckbuffer[MQC_NUMCTXS];
+uint8_t packet[MQC_NUMCTXS];
+int packetsize, packetoffset;
+uint8_t scanNumber=0;
+uint8_t packetBlocks=0;
+
+struct { int offset; int size; uint8_t data[MQC_NUMCTXS]; } packets[MAX_PACKETS];
+int npackets, bytes;
+
+void CreateNewPacket(unsigned int BlockOffset) {
+
+  objet=&mqobjet;
+  memset(buffer, 0, sizeof(buffer));
+  mqc_init_enc(objet, buffer);
+  mqc_resetstates(objet);
+  packetoffset=BlockOffset | scanNumber << 12;
+  packetsize=0;
+  packetBlocks=0;
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+  mqc_flush(objet);
+}
+
+void SendPacket() {
+
+  if (packetsize==0)
+    return;
+
+  CHECK(npackets<MAX_PACKETS);
+  packets[npackets].offset=packetoffset;
+  packets[npackets].size=packetsize;
+  memcpy(packets[npackets].data, packet, packetsize);
+  npackets++;
+  bytes+=PREAMBLE_SIZE+2+packetsize;
+}
+
+void golomb(unsigned int value) {
+
+  for (unsigned int x=0; x<value/2; x++)
+    mqc_encode(objet, 1);
+
+  mqc_encode(objet, 0);
+  mqc_encode(objet, value%2);
+}
+
+int FillPacket(int Block[8][8], bool *full) {
+
+  int first=0, last=64;
+
+  if (scanNumber) {
+    first=ProgressiveBands[scanNumber-1];
+    last=ProgressiveBands[scanNumber];
+  }
+
+  mqc_restore(objet, &mqbckobjet, bckbuffer);
+
+  int K=last-1;
+
+  while (Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]==0 && K>first)
+    K--;
+
+  if (Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]!=0 || first==0)
+    K++;
+
+  K-=first;
+
+  if (last-first>1)
+    golomb(K);
+
+  for (int x=first; x<first+K; x++) {
+    int c=Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col];
+    golomb(c>=0 ? 2*c : 2*abs(c)-1);
+  }
+
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+  mqc_flush(objet);
+
+  // the number of blocks before the data
+  int buffersize=mqc_numbytes(objet)+(scanNumber ? 1 : 0);
+
+  if (buffersize>MSS-2)
+    return -1;
+
+  packetsize=buffersize;
+
+  if (scanNumber) {
+    memcpy(packet+1, buffer, packetsize-1);
+    packet[0]=++packetBlocks;
+  }
+  else
+    memcpy(packet, buffer, packetsize);
+
+  *full=buffersize>=MSS-6 || packetBlocks==255;
+
+  return 0;
+}
+
+// encode_ucam_file_data() of the sketch
+void encode(bool progressive) {
+
+  int Block[8][8];
+  bool RTS=false;
+
+  npackets=bytes=0;
+
+  for (scanNumber=progressive ? 1 : 0; scanNumber<=(progressive ? PROGRESSIVE_SCANS : 0); scanNumber++) {
+    unsigned int offset=0;
+
+    CreateNewPacket(offset);
+
+    for (int row=0; row<N; row++)
+      for (int col=0; col<N; col++) {
+        int row_mix=((row*5)+(col*8))%N*8;
+        int col_mix=((row*8)+(col*13))%N*8;
+
+        for (int i=0; i<8; i++)
+          for (int j=0; j<8; j++)
+            Block[i][j]=image[row_mix+i][col_mix+j];
+
+        JPEGencoding(Block);
+
+        if (FillPacket(Block, &RTS)==-1) {
+          SendPacket();
+          CreateNewPacket(offset);
+          FillPacket(Block, &RTS);
+        }
+
+        offset++;
+
+        if (RTS) {
+          SendPacket();
+          CreateNewPacket(offset);
+          RTS=false;
+        }
+      }
+
+    SendPacket();
+  }
+
+  scanNumber=0;
+}
+
+// decodes the first n packets
+gw::BMPImageStruct decoded;
+
+double decode(int n) {
+
+  FILE *dat=tmpfile();
+  double mse=0;
+
+  for (int k=0; k<n && k<npackets; k++) {
+    fprintf(dat, "%04X %02X %02X ", packets[k].size+2, packets[k].offset >> 8 & 0xff, packets[k].offset & 0xff);
+
+    for (int x=0; x<packets[k].size; x++)
+      fprintf(dat, "%02X ", packets[k].data[x]);
+  }
+
+  rewind(dat);
+
+  for (int i=0; i<SIZE; i++)
+    for (int j=0; j<SIZE; j++)
+      decoded.data[i][j]=0.0;
+
+  while (gw::JPEGdepacketization(&decoded, dat))
+    ;
+
+  fclose(dat);
+  gw::JPEGdecoding(&decoded, &decoded);
+
+  // same indexes as the image of the sketch
+  for (int x=0; x<SIZE; x++)
+    for (int y=0; y<SIZE; y++)
+      mse+=(decoded.data[x][y]-image[x][y])*(decoded.data[x][y]-image[x][y]);
+
+  mse/=SIZE*SIZE;
+
+  return mse ? 10*log10(255.0*255.0/mse) : 99.0;
+}
+
+const int steps[]={1, 2, 3, 4, 6, 8, 12, 16, 24};
+#define NSTEPS (int)(sizeof(steps)/sizeof(steps[0]))
+
+double whole[SIZE][SIZE];
+
+void run(const char *name, int Q) {
+
+  double curve[2][NSTEPS], full[2];
+  int total[2], totalBytes[2];
+
+  QTinitialization(Q);
+  gw::QTinitialization(Q);
+
+  for (int mode=0; mode<2; mode++) {
+    encode(mode==1);
+    total[mode]=npackets;
+    totalBytes[mode]=bytes;
+
+    for (int s=0; s<NSTEPS; s++)
+      curve[mode][s]=decode(steps[s]);
+
+    full[mode]=decode(npackets);
+
+    if (mode==0)
+      for (int i=0; i<SIZE; i++)
+        for (int j=0; j<SIZE; j++)
+          whole[i][j]=decoded.data[i][j];
+  }
+
+  for (int mode=0; mode<2; mode++) {
+    printf("%-16s Q%-3d %-11s %3d %5d ", name, Q, mode ? "progressive" : "blocks", total[mode], totalBytes[mode]);
+
+    for (int s=0; s<NSTEPS; s++)
+      if (steps[s]<total[mode])
+        printf(" %5.2f", curve[mode][s]);
+      else
+        printf("     -");
+
+    printf("  %5.2f\n", full[mode]);
+  }
+
+  // the same coefficients at the end
+  for (int i=0; i<SIZE; i++)
+    for (int j=0; j<SIZE; j++)
+      CHECK(decoded.data[i][j]==whole[i][j]);
+
+  // the first packets give a better image
+  CHECK(curve[1][0]>curve[0][0]+3.0);
+  CHECK(curve[1][1]>curve[0][1]);
+  // but the AC bands cost more bytes
+  CHECK(totalBytes[1]<totalBytes[0]*1.3);
+}
+
+int main() {
+
+  const char *images[]={"lion-128x128.bmp", "128x128-test.bmp"};
+  const int Qs[]={20, 50};
+  char file[128];
+
+  if (!realpath("../../gw_full_latest/ucam-images/128x128-test.bmp", templateFile) ||
+      gw::ReadBitmapFile(templateFile, &decoded)) {
+    printf("cannot read the BMP files\n");
+    return 1;
+  }
+
+  printf("%-16s %-4s %-11s %3s %5s ", "image", "Q", "packets", "all", "bytes");
+
+  for (int s=0; s<NSTEPS; s++)
+    printf(" %5d", steps[s]);
+
+  printf("  %5s\n", "all");
+
+  for (unsigned i=0; i<sizeof(images)/sizeof(images[0]); i++) {
+    snprintf(file, sizeof(file), "../../gw_full_latest/ucam-images/%s", images[i]);
+
+    if (!readBMP(file)) {
+      printf("cannot read %s\n", file);
+      return 1;
+    }
+
+    for (unsigned q=0; q<sizeof(Qs)/sizeof(Qs[0]); q++)
+      run(images[i], Qs[q]);
+  }
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,443 @@
+/*
+ *  Quality factor and packet size of the image for a time on air (jpeg_rate.h of the uCam library)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/uCam -I../libraries/SX1272/src test-rate.cpp ../libraries/SX1272/src/SX1272.cpp -o test-rate
+ *  > ./test-rate
+ *
+ *  The 128x128 BMP images of gw_full_latest/ucam-images are packetized as FillPacket() of the
+ *  sketch, and the time on air of the packets is given by getToA() of the SX1272 library for
+ *  each LoRa mode. RateEstimate() from the sampled blocks is compared to the bytes of the
+ *  packets for several quality factors. For each LoRa mode and a target time on air of 4 to 32
+ *  packets of DEFAULT_LORA_MSS bytes, RateControl() gives the quality factor and the MSS of
+ *  each image, the image is packetized with them and its time on air is compared to the target.
+ *  The best quality factor is the highest one whose packets fit in the target. Up to Q=100, a
+ *  block that does not fit in the packet must stop before going past the MSS in the buffer.
+ */
+
+#include <inttypes.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "SX1272.h"
+
+#define LORA_UCAM
+#define SHORT_COMPUTATION
+#include "mqc.h"
+
+#define CRAN_NEW_CODING
+#define FIXED_POINT_DCT
+#include "jpeg_dct.h"
+
+#include "check.h"
+
+#define SIZE 128
+#define N (SIZE/8)
+#define DEFAULT_LORA_MSS 235
+#define PREAMBLE_SIZE 7
+#define MAX_PACKETS 256
+#define NMODES 10
+
+SerialStub Serial;
+SPIClass SPI;
+
+struct position { uint8_t row; uint8_t col; } ZigzagCoordinates[8*8]=
+  {0, 0, 0, 1, 1, 0, 2, 0, 1, 1, 0, 2, 0, 3, 1, 2, 2, 1, 3, 0,
+   4, 0, 3, 1, 2, 2, 1, 3, 0, 4, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1,
+   5, 0, 6, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1, 5, 0, 6, 0, 7, 1, 6,
+   2, 5, 3, 4, 4, 3, 5, 2, 6, 1, 7, 0, 7, 1, 6, 2, 5, 3, 4, 4,
+   3, 5, 2, 6, 1, 7, 2, 7, 3, 6, 4, 5, 5, 4, 6, 3, 7, 2, 7, 3,
+   6, 4, 5, 5, 4, 6, 3, 7, 4, 7, 5, 6, 6, 5, 7, 4, 7, 5, 6, 6,
+   5, 7, 6, 7, 7, 6, 7, 7};
+
+#include "jpeg_rate.h"
+
+// the SX1272 library only calls them to access the radio module, which is not used
+unsigned long millis() { return 0; }
+unsigned long micros() { return 0; }
+void delay(unsigned long ms) {}
+void delayMicroseconds(unsigned int us) {}
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) {}
+int digitalRead(uint8_t pin) { return 0; }
+int analogRead(uint8_t pin) { return 0; }
+long random(long min, long max) { return min; }
+void randomSeed(unsigned long seed) {}
+int pinToInterrupt(uint8_t pin) { return NOT_AN_INTERRUPT; }
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode) {}
+void detachInterrupt(uint8_t interrupt) {}
+void noInterrupts() {}
+void interrupts() {}
+uint8_t SPIClass::transfer(uint8_t data) { return 0; }
+
+// the LoRa modes of SX1272::setMode(), CR 4/5
+const struct { uint8_t sf; uint8_t bw; } modes[NMODES+1]={{0, 0},
+  {SF_12, BW_125}, {SF_12, BW_250}, {SF_10, BW_125}, {SF_12, BW_500}, {SF_10, BW_250},
+  {SF_11, BW_500}, {SF_9, BW_250}, {SF_9, BW_500}, {SF_8, BW_500}, {SF_7, BW_500}};
+
+void setMode(int mode) {
+  sx1272._spreadingFactor=modes[mode].sf;
+  sx1272._bandwidth=modes[mode].bw;
+  sx1272._codingRate=CR_5;
+  sx1272._header=HEADER_ON;
+  sx1272._preamblelength=8;
+}
+
+uint16_t toa(uint8_t pl) {
+  return sx1272.getToA(pl);
+}
+
+// [x][y] as in the sketch
+uint8_t image[SIZE][SIZE];
+uint8_t *rows[SIZE];
+InImageStruct inImage={SIZE, SIZE, rows};
+
+// the luminance of the 8-bit (palette) and 16-bit (RGB555) BMP files, as the raw data of the uCam
+bool readBMP(const char *file) {
+
+  FILE *f=fopen(file, "rb");
+  uint8_t header[54];
+
+  if (!f)
+    return false;
+
+  if (fread(header, 1, 54, f)!=54) {
+    fclose(f);
+    return false;
+  }
+
+  uint32_t offset=header[10] | header[11] << 8 | header[12] << 16 | header[13] << 24;
+  int width=header[18] | header[19] << 8;
+  int height=header[22] | header[23] << 8;
+  int bpp=header[28];
+
+  if (width!=SIZE || height!=SIZE || (bpp!=8 && bpp!=16)) {
+    fclose(f);
+    return false;
+  }
+
+  uint8_t palette[256][4];
+
+  if (bpp==8 && fread(palette, 4, 256, f)!=256) {
+    fclose(f);
+    return false;
+  }
+
+  fseek(f, offset, SEEK_SET);
+
+  // bottom-up
+  for (int row=SIZE-1; row>=0; row--)
+    for (int col=0; col<SIZE; col++)
+      if (bpp==8) {
+        uint8_t *bgr=palette[fgetc(f)];
+        image[row][col]=(uint8_t)(0.299*bgr[2]+0.587*bgr[1]+0.114*bgr[0]+0.5);
+      }
+      else {
+        int lo=fgetc(f);
+        int hi=fgetc(f);
+        int rgb=lo | hi << 8;
+        double r=((rgb >> 10) & 0x1F)*255/31.0;
+        double g=((rgb >> 5) & 0x1F)*255/31.0;
+        double b=(rgb & 0x1F)*255/31.0;
+        image[row][col]=(uint8_t)(0.299*r+0.587*g+0.114*b+0.5);
+      }
+
+  fclose(f);
+  return true;
+}
+
+// the packetization of the sketch, the sizes of the packets (MQ data)
+opj_mqc_t mqobjet, mqbckobjet, *objet=NULL;
+// mqc_init_enc() reads the byte before the buffer
+uint8_t mqcBuffer[1+MQC_NUMCTXS], bckbuffer[MQC_NUMCTXS];
+uint8_t *buffer=mqcBuffer+1;
+int packetsize;
+// the most bytes written in buffer
+int maxBytes;
+int mss;
+
+int sizes[MAX_PACKETS];
+int npackets;
+
+void CreateNewPacket() {
+
+  objet=&mqobjet;
+  memset(mqcBuffer, 0, sizeof(mqcBuffer));
+  mqc_init_enc(objet, buffer);
+  mqc_resetstates(objet);
+  packetsize=0;
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+  mqc_flush(objet);
+}
+
+void SendPacket() {
+
+  if (packetsize==0)
+    return;
+
+  CHECK(npackets<MAX_PACKETS && packetsize<=mss-2);
+  sizes[npackets++]=packetsize;
+}
+
+// FillGolomb() of the sketch, false when the packet has more than room bytes
+bool golomb(unsigned int value, int room) {
+
+  for (unsigned int x=0; x<value/2; x++) {
+    mqc_encode(objet, 1);
+
+    if (mqc_numbytes(objet)>maxBytes)
+      maxBytes=mqc_numbytes(objet);
+
+    if (mqc_numbytes(objet)>room)
+      return false;
+  }
+
+  mqc_encode(objet, 0);
+  mqc_encode(objet, value%2);
+
+  if (mqc_numbytes(objet)>maxBytes)
+    maxBytes=mqc_numbytes(objet);
+
+  return mqc_numbytes(objet)<=room;
+}
+
+int FillPacket(int Block[8][8], bool *full) {
+
+  int K=63;
+
+  mqc_restore(objet, &mqbckobjet, bckbuffer);
+
+  while (Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]==0 && K>0)
+    K--;
+
+  K++;
+  if (!golomb(K, mss-2))
+    return -1;
+
+  for (int x=0; x<K; x++) {
+    int c=Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col];
+
+    if (!golomb(c>=0 ? 2*c : 2*abs(c)-1, mss-2))
+      return -1;
+  }
+
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+  mqc_flush(objet);
+
+  int buffersize=mqc_numbytes(objet);
+
+  if (buffersize>mss-2)
+    return -1;
+
+  packetsize=buffersize;
+  *full=buffersize>=mss-6;
+
+  return 0;
+}
+
+// encode_ucam_file_data() of the sketch, returns the bytes of MQ data
+int encode(int Quality, int packetMss) {
+
+  int Block[8][8];
+  bool RTS=false;
+  int bytes=0;
+
+  QTinitialization(Quality);
+  mss=packetMss;
+  npackets=0;
+  CreateNewPacket();
+
+  for (int row=0; row<N; row++)
+    for (int col=0; col<N; col++) {
+      int row_mix=((row*5)+(col*8))%N*8;
+      int col_mix=((row*8)+(col*13))%N*8;
+
+      for (int i=0; i<8; i++)
+        for (int j=0; j<8; j++)
+          Block[i][j]=image[row_mix+i][col_mix+j];
+
+      JPEGencoding(Block);
+
+      if (FillPacket(Block, &RTS)==-1) {
+        SendPacket();
+        CreateNewPacket();
+        FillPacket(Block, &RTS);
+      }
+
+      if (RTS) {
+        SendPacket();
+        CreateNewPacket();
+        RTS=false;
+      }
+    }
+
+  SendPacket();
+
+  for (int k=0; k<npackets; k++)
+    bytes+=sizes[k];
+
+  return bytes;
+}
+
+// the time on air of the packets of the last encode()
+unsigned long packetsToA() {
+
+  unsigned long t=0;
+
+  for (int k=0; k<npackets; k++)
+    t+=toa(RateOverhead+2+sizes[k]);
+
+  return t;
+}
+
+const char *images[]={"128x128-test.bmp", "128x128-test-neg.bmp", "lion-128x128.bmp"};
+#define NIMAGES (int)(sizeof(images)/sizeof(images[0]))
+
+const int Qs[]={5, 10, 20, 30, 50, 70, RATE_MAX_QUALITY};
+#define NQS (int)(sizeof(Qs)/sizeof(Qs[0]))
+
+const int targetPackets[]={4, 8, 16, 32};
+#define NTARGETS (int)(sizeof(targetPackets)/sizeof(targetPackets[0]))
+
+// the time on air of the image for each quality factor with DEFAULT_LORA_MSS
+int allBytes[NIMAGES][RATE_MAX_QUALITY+1];
+int allSizes[NIMAGES][RATE_MAX_QUALITY+1][MAX_PACKETS];
+int allPackets[NIMAGES][RATE_MAX_QUALITY+1];
+
+bool loadImage(int i) {
+
+  char file[128];
+
+  snprintf(file, sizeof(file), "../../gw_full_latest/ucam-images/%s", images[i]);
+  return readBMP(file);
+}
+
+int main() {
+
+  double estimateError=0;
+  int estimates=0;
+
+  RateToA=toa;
+  RateOverhead=PREAMBLE_SIZE+OFFSET_PAYLOADLENGTH;
+
+  for (int r=0; r<SIZE; r++)
+    rows[r]=image[r];
+
+  printf("bytes of MQ data, estimated from %d blocks / packetized with MSS=%d\n", RATE_SAMPLE_BLOCKS, DEFAULT_LORA_MSS);
+  printf("%-20s", "image");
+  for (int q=0; q<NQS; q++)
+    printf("       Q%-3d     ", Qs[q]);
+  printf("\n");
+
+  for (int i=0; i<NIMAGES; i++) {
+    if (!loadImage(i)) {
+      printf("cannot read %s\n", images[i]);
+      return 1;
+    }
+
+    // up to Q=100 of the /@Q command, a block that does not fit stops before the end of buffer
+    maxBytes=0;
+    for (int Q=RATE_MIN_QUALITY; Q<=100; Q+=5)
+      encode(Q, DEFAULT_LORA_MSS);
+    CHECK(maxBytes<=DEFAULT_LORA_MSS);
+
+    for (int Q=RATE_MIN_QUALITY; Q<=RATE_MAX_QUALITY; Q++) {
+      allBytes[i][Q]=encode(Q, DEFAULT_LORA_MSS);
+      allPackets[i][Q]=npackets;
+      memcpy(allSizes[i][Q], sizes, npackets*sizeof(int));
+    }
+
+    RateSample(&inImage);
+    CHECK(RateSamples==RATE_SAMPLE_BLOCKS);
+    printf("%-20s", images[i]);
+
+    for (int q=0; q<NQS; q++) {
+      long estimated=RateEstimate(Qs[q]);
+      double error=100.0*(estimated-allBytes[i][Qs[q]])/allBytes[i][Qs[q]];
+
+      printf(" %5ld/%5d %+3.0f%%", estimated, allBytes[i][Qs[q]], error);
+      CHECK(fabs(error)<25);
+      estimateError+=fabs(error);
+      estimates++;
+    }
+    printf("\n");
+  }
+
+  printf("mean estimate error %.1f%%\n", estimateError/estimates);
+
+  printf("target time on air of 4 to 32 packets of %d bytes, RateControl() against the best quality factor\n", DEFAULT_LORA_MSS);
+  printf("mode              target ms       Q  best   MSS  estimated ms  actual ms  error\n");
+
+  for (int mode=1; mode<=NMODES; mode++) {
+    double modeError=0, modeOver=0;
+    int exact=0, under=0, runs=0, clamped=0;
+    double controlTime=0;
+
+    setMode(mode);
+
+    for (int t=0; t<NTARGETS; t++) {
+      unsigned long target=targetPackets[t]*(unsigned long)toa(RateOverhead+DEFAULT_LORA_MSS);
+
+      for (int i=0; i<NIMAGES; i++) {
+        int Q, best=RATE_MIN_QUALITY;
+        unsigned long actual;
+        clock_t start;
+
+        loadImage(i);
+
+        start=clock();
+        Q=RateControl(&inImage, target, DEFAULT_LORA_MSS);
+        controlTime+=(double)(clock()-start)/CLOCKS_PER_SEC*1e3;
+
+        CHECK(Q>=RATE_MIN_QUALITY && Q<=RATE_MAX_QUALITY);
+        CHECK(RateMSS>=RATE_MIN_MSS && RateMSS<=DEFAULT_LORA_MSS);
+        CHECK(RateEstimatedToA<=RateImageToA(RateEstimatedBytes, DEFAULT_LORA_MSS));
+
+        encode(Q, RateMSS);
+        actual=packetsToA();
+
+        // with the packets of DEFAULT_LORA_MSS bytes
+        for (int q=RATE_MIN_QUALITY; q<=RATE_MAX_QUALITY; q++) {
+          unsigned long sum=0;
+
+          for (int k=0; k<allPackets[i][q]; k++)
+            sum+=toa(RateOverhead+2+allSizes[i][q][k]);
+
+          if (sum<=target)
+            best=q;
+        }
+
+        double error=100.0*((double)actual-target)/target;
+
+        if (mode==1 || mode==NMODES)
+          printf("%2d %-20s %6lu %5d %5d %5u %11lu %10lu %+5.1f%%\n", mode, images[i], target, Q, best,
+            RateMSS, RateEstimatedToA, actual, error);
+
+        // the whole image at RATE_MAX_QUALITY is under the target, the error is not that of the estimate
+        if (Q==RATE_MAX_QUALITY && best==RATE_MAX_QUALITY)
+          clamped++;
+        else
+          modeError+=fabs(error);
+
+        if (actual>target)
+          modeOver+=error;
+        else
+          under++;
+        exact+=Q==best;
+        runs++;
+
+        // the estimate is close to the time on air of the image
+        CHECK(fabs(100.0*((double)actual-RateEstimatedToA)/actual)<30);
+        CHECK(abs(Q-best)<=15 || Q==RATE_MIN_QUALITY);
+      }
+    }
+
+    printf("mode %2d SF%-2u BW%u: mean |error| %4.1f%% below Q%d, %2d/%d under the target (over by %4.1f%% on average), "
+      "%2d/%d best Q, %.2f ms per RateControl()\n", mode, sx1272._spreadingFactor,
+      sx1272._bandwidth==BW_125 ? 125 : (sx1272._bandwidth==BW_250 ? 250 : 500),
+      runs>clamped ? modeError/(runs-clamped) : 0.0, RATE_MAX_QUALITY, under, runs,
+      runs>under ? modeOver/(runs-under) : 0.0, exact, runs, controlTime/runs);
+  }
+
+  printf("%d failure(s)\n", failures);
+  return failures ? 1 : 0;
+}
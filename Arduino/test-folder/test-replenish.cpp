@@ -0,0 +1,391 @@
+/*
+ *  Conditional replenishment of the image (jpeg_replenish.h of the uCam library)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/uCam test-replenish.cpp -o test-replenish
+ *  > ./test-replenish
+ *
+ *  The reference image is the lion of gw_full_latest/ucam-images, sent as a whole image and
+ *  decoded by startDecodeImage() of decode_to_bmp.c as on the gateway (with -vflip). A new image
+ *  has a centered square of 5%, 20% or 50% of its area replaced by 128x128-test.bmp, and +/-2 of
+ *  noise on all the pixels. It is sent as a whole image, and with the changed blocks only, decoded
+ *  with -previous the decoded reference image. The packetization is the one of FillPacket() of
+ *  Arduino_LoRa_ucamII with the LoRa MSS, the bytes are those of the image packets (7 bytes of
+ *  header, the 2-byte offset and the MQ data). The PSNR is against the new image.
+ */
+
+#include <inttypes.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+
+#define LORA_UCAM
+#define SHORT_COMPUTATION
+#include "mqc.h"
+
+#define CRAN_NEW_CODING
+#define FIXED_POINT_DCT
+#include "jpeg_dct.h"
+#include "jpeg_replenish.h"
+
+// the decoder of the gateway, bmp.h defines max() and min()
+#undef max
+#undef min
+#undef MQC_NUMCTXS
+
+namespace gw {
+#define main decode_to_bmp_main
+#include "../../gw_full_latest/ucam-images/decode_to_bmp.c"
+#undef main
+}
+
+#include "check.h"
+
+#define SIZE 128
+#define N (SIZE/8)
+#define MSS 235
+#define PREAMBLE_SIZE 7
+#define BLOCK_SAD_THRES 512
+
+SerialStub Serial;
+
+struct position { uint8_t row; uint8_t col; } ZigzagCoordinates[8*8]=
+  {0, 0, 0, 1, 1, 0, 2, 0, 1, 1, 0, 2, 0, 3, 1, 2, 2, 1, 3, 0,
+   4, 0, 3, 1, 2, 2, 1, 3, 0, 4, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1,
+   5, 0, 6, 0, 5, 1, 4, 2, 3, 3, 2, 4, 1, 5, 0, 6, 0, 7, 1, 6,
+   2, 5, 3, 4, 4, 3, 5, 2, 6, 1, 7, 0, 7, 1, 6, 2, 5, 3, 4, 4,
+   3, 5, 2, 6, 1, 7, 2, 7, 3, 6, 4, 5, 5, 4, 6, 3, 7, 2, 7, 3,
+   6, 4, 5, 5, 4, 6, 3, 7, 4, 7, 5, 6, 6, 5, 7, 4, 7, 5, 6, 6,
+   5, 7, 6, 7, 7, 6, 7, 7};
+
+// [x][y] as in the sketch
+uint8_t lion[SIZE][SIZE];
+uint8_t object[SIZE][SIZE];
+uint8_t refData[SIZE][SIZE], newData[SIZE][SIZE];
+uint8_t *refRows[SIZE], *newRows[SIZE];
+InImageStruct ref={SIZE, SIZE, refRows};
+InImageStruct image={SIZE, SIZE, newRows};
+
+char templateFile[PATH_MAX];
+
+// luminance of the 8-bit (palette) and 16-bit (RGB555) BMP files
+bool readBMP(const char *file, uint8_t pixels[SIZE][SIZE]) {
+
+  FILE *f=fopen(file, "rb");
+  uint8_t header[54];
+  uint8_t palette[256][4];
+
+  if (!f)
+    return false;
+
+  if (fread(header, 1, 54, f)!=54 || (header[28]==8 && fread(palette, 4, 256, f)!=256)) {
+    fclose(f);
+    return false;
+  }
+
+  fseek(f, header[10] | header[11] << 8 | header[12] << 16 | header[13] << 24, SEEK_SET);
+
+  for (int row=SIZE-1; row>=0; row--)
+    for (int col=0; col<SIZE; col++)
+      if (header[28]==8) {
+        uint8_t *bgr=palette[fgetc(f)];
+        pixels[row][col]=(uint8_t)(0.299*bgr[2]+0.587*bgr[1]+0.114*bgr[0]+0.5);
+      }
+      else {
+        int lo=fgetc(f);
+        int rgb=lo | fgetc(f) << 8;
+        pixels[row][col]=(uint8_t)(0.299*((rgb >> 10) & 0x1F)*255/31.0+0.587*((rgb >> 5) & 0x1F)*255/31.0+
+                                   0.114*(rgb & 0x1F)*255/31.0+0.5);
+      }
+
+  fclose(f);
+  return true;
+}
+
+// the packetization of the sketch, the packets are written in the .dat format of post_processing_gw.py
+opj_mqc_t mqobjet, mqbckobjet, *objet=NULL;
+uint8_t buffer[MQC_NUMCTXS], bckbuffer[MQC_NUMCTXS];
+uint8_t packet[MQC_NUMCTXS];
+int packetsize, packetoffset;
+int packets, bytes;
+FILE *dat;
+
+void CreateNewPacket(unsigned int BlockOffset, bool replenishing) {
+
+  objet=&mqobjet;
+  memset(buffer, 0, sizeof(buffer));
+  mqc_init_enc(objet, buffer);
+  mqc_resetstates(objet);
+  packetoffset=BlockOffset | (replenishing ? CR_PACKET_FLAG : 0);
+  packetsize=0;
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+  mqc_flush(objet);
+}
+
+void SendPacket() {
+
+  if (packetsize==0)
+    return;
+
+  fprintf(dat, "%04X %02X %02X ", packetsize+2, packetoffset >> 8 & 0xff, packetoffset & 0xff);
+
+  for (int x=0; x<packetsize; x++)
+    fprintf(dat, "%02X ", packet[x]);
+
+  packets++;
+  bytes+=PREAMBLE_SIZE+2+packetsize;
+}
+
+void golomb(unsigned int value) {
+
+  for (unsigned int x=0; x<value/2; x++)
+    mqc_encode(objet, 1);
+
+  mqc_encode(objet, 0);
+  mqc_encode(objet, value%2);
+}
+
+int FillPacket(int Block[8][8], int skip, bool *full) {
+
+  int K=63;
+
+  mqc_restore(objet, &mqbckobjet, bckbuffer);
+
+  if (skip>=0)
+    golomb(skip);
+
+  while (Block[ZigzagCoordinates[K].row][ZigzagCoordinates[K].col]==0 && K>0)
+    K--;
+
+  K++;
+  golomb(K);
+
+  for (int x=0; x<K; x++) {
+    int c=Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col];
+    golomb(c>=0 ? 2*c : 2*abs(c)-1);
+  }
+
+  mqc_backup(objet, &mqbckobjet, bckbuffer);
+
+  // the end of the packet
+  opj_mqc_state_t *ctxstate=*objet->curctx;
+
+  if (skip>=0)
+    for (int x=0; x<4; x++)
+      mqc_encode(objet, 0);
+
+  mqc_flush(objet);
+  *objet->curctx=ctxstate;
+
+  int buffersize=mqc_numbytes(objet);
+
+  if (buffersize>MSS-2)
+    return -1;
+
+  packetsize=buffersize;
+  memcpy(packet, buffer, packetsize);
+  *full=buffersize>=MSS-6;
+
+  return 0;
+}
+
+// encode_ucam_file_data() of the sketch
+void encode(InImageStruct *in, bool replenishing) {
+
+  int Block[8][8];
+  unsigned int offset=0;
+  int skip=replenishing ? 0 : -1;
+  bool RTS=false;
+
+  packets=bytes=0;
+  CreateNewPacket(offset, replenishing);
+
+  for (int row=0; row<N; row++)
+    for (int col=0; col<N; col++) {
+      int row_mix=((row*5)+(col*8))%N*8;
+      int col_mix=((row*8)+(col*13))%N*8;
+
+      if (replenishing && !BlockChanged(row_mix/8, col_mix/8)) {
+        skip++;
+        offset++;
+        continue;
+      }
+
+      for (int i=0; i<8; i++)
+        for (int j=0; j<8; j++)
+          Block[i][j]=in->data[row_mix+i][col_mix+j];
+
+      JPEGencoding(Block);
+
+      if (FillPacket(Block, skip, &RTS)==-1) {
+        SendPacket();
+        CreateNewPacket(offset, replenishing);
+        FillPacket(Block, skip<0 ? -1 : 0, &RTS);
+      }
+
+      offset++;
+
+      if (skip>0)
+        skip=0;
+
+      if (RTS) {
+        SendPacket();
+        CreateNewPacket(offset, replenishing);
+        RTS=false;
+      }
+    }
+
+  SendPacket();
+}
+
+// sends the image and decodes it on the gateway, returns the name of the BMP file
+char *transmit(InImageStruct *in, bool replenishing, int Q, int SN, const char *previous, double decoded[SIZE][SIZE]) {
+
+  static char bmpFile[80];
+  gw::BMPImageStruct img;
+
+  QTinitialization(Q);
+  dat=tmpfile();
+  encode(in, replenishing);
+  rewind(dat);
+
+  gw::QTinitialization(Q);
+  gw::previousFile=(char*)previous;
+
+  // the name of the BMP file is on stdout
+  fflush(stdout);
+  int out=dup(1);
+  FILE *name=tmpfile();
+  dup2(fileno(name), 1);
+  gw::startDecodeImage(dat, Q, SN, templateFile, 6, 0);
+  fflush(stdout);
+  dup2(out, 1);
+  close(out);
+  rewind(name);
+  CHECK(fscanf(name, "%79s", bmpFile)==1);
+  fclose(name);
+  fclose(dat);
+
+  CHECK(gw::ReadBitmapFile(bmpFile, &img)==0);
+
+  // written with -vflip
+  for (int i=0; i<SIZE; i++)
+    for (int j=0; j<SIZE; j++)
+      decoded[i][j]=img.data[SIZE-1-i][j];
+
+  return bmpFile;
+}
+
+double psnr(double decoded[SIZE][SIZE], uint8_t original[SIZE][SIZE]) {
+
+  double mse=0;
+
+  for (int i=0; i<SIZE; i++)
+    for (int j=0; j<SIZE; j++)
+      mse+=(decoded[i][j]-original[i][j])*(decoded[i][j]-original[i][j]);
+
+  mse/=SIZE*SIZE;
+
+  return mse ? 10*log10(255.0*255.0/mse) : 99.0;
+}
+
+double refDecoded[SIZE][SIZE], fullDecoded[SIZE][SIZE], crDecoded[SIZE][SIZE];
+
+void scene(int percent, int Q) {
+
+  char previous[80];
+  int side=(int)(sqrt(percent/100.0)*SIZE+0.5);
+  int first=(SIZE-side)/2;
+
+  srand(percent*100+Q);
+
+  // the reference image, sent as a whole image
+  for (int x=0; x<SIZE; x++)
+    for (int y=0; y<SIZE; y++)
+      refData[x][y]=lion[x][y];
+
+  strcpy(previous, transmit(&ref, false, Q, 0, NULL, refDecoded));
+
+  for (int x=0; x<SIZE; x++)
+    for (int y=0; y<SIZE; y++) {
+      int v=(x>=first && x<first+side && y>=first && y<first+side) ? object[x][y] : lion[x][y];
+      v+=rand()%5-2;
+      newData[x][y]=v<0 ? 0 : (v>255 ? 255 : v);
+    }
+
+  unsigned int changed=FindChangedBlocks(&image, &ref, BLOCK_SAD_THRES);
+
+  transmit(&image, false, Q, 1, NULL, fullDecoded);
+  int fullPackets=packets, fullBytes=bytes;
+
+  transmit(&image, true, Q, 2, previous, crDecoded);
+
+  printf("%3d%%   Q%-3d %4u/%d %4d %6d %6.2f   %4d %6d %6.2f   %5.1f%%\n", percent, Q, changed, N*N, fullPackets, fullBytes,
+         psnr(fullDecoded, newData), packets, bytes, psnr(crDecoded, newData), 100.0*bytes/fullBytes);
+
+  CHECK(gw::nbReceivedBlocks==(int)changed);
+  CHECK(changed>=(unsigned)(side/8)*(side/8));
+  CHECK(bytes<fullBytes);
+  CHECK(psnr(crDecoded, newData)>psnr(fullDecoded, newData)-1.0);
+
+  // the changed blocks are decoded as in the whole image, the others are the previous image
+  for (int bx=0; bx<N; bx++)
+    for (int by=0; by<N; by++)
+      for (int i=0; i<8; i++)
+        for (int j=0; j<8; j++) {
+          double expected=BlockChanged(bx, by) ? fullDecoded[8*bx+i][8*by+j] : refDecoded[8*bx+i][8*by+j];
+          CHECK(crDecoded[8*bx+i][8*by+j]==expected);
+        }
+
+  // the reference image becomes the image of the gateway
+  CopyChangedBlocks(&image, &ref);
+  CHECK(FindChangedBlocks(&image, &ref, BLOCK_SAD_THRES)==0);
+}
+
+int main() {
+
+  char dir[]="/tmp/test-replenishXXXXXX";
+
+  if (!readBMP("../../gw_full_latest/ucam-images/lion-128x128.bmp", lion) ||
+      !readBMP("../../gw_full_latest/ucam-images/128x128-test.bmp", object) ||
+      !realpath("../../gw_full_latest/ucam-images/128x128-test.bmp", templateFile)) {
+    printf("cannot read the BMP files\n");
+    return 1;
+  }
+
+  for (int i=0; i<SIZE; i++) {
+    refRows[i]=refData[i];
+    newRows[i]=newData[i];
+  }
+
+  CHECK(ChangedAllocate(SIZE, SIZE));
+
+  // the BMP files of the decoder
+  if (!mkdtemp(dir) || chdir(dir)) {
+    printf("cannot create %s\n", dir);
+    return 1;
+  }
+
+  gw::vflip=true;
+  // the decoder prints on stderr
+  freopen("/dev/null", "w", stderr);
+
+  printf("%-11s %6s   %-20s   %-20s\n", "", "", "whole image", "changed blocks only");
+  printf("%-11s %6s %4s %6s %6s   %4s %6s %6s   %6s\n", "change", "blocks", "pkts", "bytes", "PSNR", "pkts", "bytes",
+         "PSNR", "bytes");
+
+  const int percents[]={5, 20, 50};
+  const int Qs[]={10, 50};
+
+  for (unsigned q=0; q<sizeof(Qs)/sizeof(Qs[0]); q++)
+    for (unsigned p=0; p<sizeof(percents)/sizeof(percents[0]); p++)
+      scene(percents[p], Qs[q]);
+
+  char rm[64];
+  snprintf(rm, sizeof(rm), "rm -rf %s", dir);
+  system(rm);
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+/*
+ *  Simulation of update_sensors() in Sensor.cpp of Arduino_LoRa_Generic_Simple_MultiSensors
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../Arduino_LoRa_Generic_Simple_MultiSensors -I../libraries/SensorCodec/src test-sensorScheduler.cpp ../Arduino_LoRa_Generic_Simple_MultiSensors/Sensor.cpp ../libraries/SensorCodec/src/SensorCodec.cpp -o test-sensorScheduler
+ *  > ./test-sensorScheduler
+ *
+ *  millis() and delay() use a simulated clock, so the awake time of the device is the
+ *  time spent in delay(). Each simulated sensor checks that it is read when it is powered
+ *  and after its warm-up time.
+ *
+ *  - the sensors of the sketch are read one by one with update_data(), then with update_sensors()
+ *  - random sets of sensors, some of them on the same power pin as the DHT22 or the SHT,
+ *    with a clock that wraps around
+ *  - sensors whose read_data() always returns false, at once or at a new ready time, are left
+ *    with their previous data SENSOR_READ_TIMEOUT after their warm-up time
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "Sensor.h"
+
+#include "check.h"
+
+unsigned long now=0;
+uint8_t pins[64];
+
+unsigned long millis() {
+  return now;
+}
+
+void delay(unsigned long ms) {
+  now+=ms;
+}
+
+void delayMicroseconds(unsigned int us) {
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  pins[pin]=value;
+}
+
+int digitalRead(uint8_t pin) {
+  return pins[pin];
+}
+
+int analogRead(uint8_t pin) {
+  return 512;
+}
+
+long random(long min, long max) {
+  return min+rand()%(max-min);
+}
+
+// a sensor with a warm-up time, an optional conversion started by the first read_data(),
+// e.g. the DS18B20, and the time taken by the reading itself, e.g. the n_sample analog reads
+class SimSensor : public Sensor {
+  public:
+    SimSensor(bool is_connected, bool is_low_power, uint8_t pin_power, uint16_t warmup, uint16_t conversion, uint16_t reading) :
+      Sensor((char*)"SIM", IS_NOT_ANALOG, is_connected, is_low_power, 0, pin_power) {
+      set_warmup_time(warmup);
+      set_fake_data(true);
+      _conversion=conversion;
+      _reading=reading;
+      _reads=0;
+      _converting=false;
+    }
+
+    void power_on() {
+      Sensor::power_on();
+      _powered_at=millis();
+      _converting=false;
+    }
+
+    bool read_data() {
+
+      if (get_is_connected()) {
+
+        if (get_is_low_power() && pins[get_pin_power()]!=HIGH) {
+          failures++;
+          printf("read without power at %lu\n", millis());
+        }
+
+        if ((long)(millis()-_powered_at) < get_warmup_time()) {
+          failures++;
+          printf("read after %ld ms instead of %u ms\n", (long)(millis()-_powered_at), get_warmup_time());
+        }
+
+        if (_conversion && !_converting) {
+          _converting=true;
+          _conversion_at=millis();
+          set_ready_time(millis()+_conversion);
+          return false;
+        }
+
+        if (_conversion && (long)(millis()-_conversion_at) < _conversion) {
+          failures++;
+          printf("read during the conversion\n");
+        }
+      }
+
+      delay(_reading);
+      set_data(_reads++);
+
+      return true;
+    }
+
+    double get_value() {
+      update_data();
+      return get_data();
+    }
+
+    unsigned long latency() {
+      return get_is_connected() ? get_warmup_time()+_conversion+_reading : _reading;
+    }
+
+    uint16_t _conversion;
+    uint16_t _reading;
+    int _reads;
+    bool _converting;
+    unsigned long _powered_at;
+    unsigned long _conversion_at;
+};
+
+// a sensor that never answers, read_data() takes _reading ms and asks to be called again
+// _retry ms later, or at once if _retry is 0
+class StuckSensor : public Sensor {
+  public:
+    StuckSensor(uint8_t pin_power, uint16_t warmup, uint16_t reading, uint16_t retry) :
+      Sensor((char*)"STK", IS_NOT_ANALOG, IS_CONNECTED, IS_LOWPOWER, 0, pin_power) {
+      set_warmup_time(warmup);
+      _reading=reading;
+      _retry=retry;
+      _reads=0;
+    }
+
+    bool read_data() {
+
+      delay(_reading);
+      _reads++;
+
+      if (_retry)
+        set_ready_time(millis()+_retry);
+
+      return false;
+    }
+
+    uint16_t _reading;
+    uint16_t _retry;
+    int _reads;
+};
+
+void checkPowerOff(Sensor* sensors[], uint8_t n) {
+
+  for (uint8_t i=0; i<n; i++)
+    if (sensors[i]->get_is_connected() && sensors[i]->get_is_low_power())
+      CHECK(pins[sensors[i]->get_pin_power()]==LOW);
+}
+
+void sketchSensors() {
+
+  // warm-up times of the sensor classes, 5 analog reads take 50 ms
+  SimSensor lm35(IS_CONNECTED, IS_LOWPOWER, 9, 500, 0, 50);
+  SimSensor tmp36(IS_CONNECTED, IS_LOWPOWER, 8, 500, 0, 50);
+  SimSensor dht22_t(IS_CONNECTED, IS_LOWPOWER, 7, 2000, 0, 5);
+  SimSensor dht22_h(IS_CONNECTED, IS_LOWPOWER, 7, 2000, 0, 5);
+  SimSensor sht_t(IS_CONNECTED, IS_LOWPOWER, 6, 1000, 0, 80);
+  SimSensor sht_h(IS_CONNECTED, IS_LOWPOWER, 6, 1000, 0, 80);
+  // 750 ms for a 12-bit conversion
+  SimSensor ds18b20(IS_CONNECTED, IS_LOWPOWER, 4, 1000, 750, 10);
+  Sensor* sensors[]={&lm35, &tmp36, &dht22_t, &dht22_h, &sht_t, &sht_h, &ds18b20};
+  uint8_t n=sizeof(sensors)/sizeof(sensors[0]);
+  unsigned long start, sequential, scheduled, sum=0, longest=0;
+
+  for (uint8_t i=0; i<n; i++)
+    sum+=((SimSensor*)sensors[i])->latency();
+
+  start=now;
+
+  for (uint8_t i=0; i<n; i++)
+    sensors[i]->get_value();
+
+  sequential=now-start;
+  checkPowerOff(sensors, n);
+
+  start=now;
+  update_sensors(sensors, n);
+  scheduled=now-start;
+  checkPowerOff(sensors, n);
+
+  for (uint8_t i=0; i<n; i++) {
+    CHECK(((SimSensor*)sensors[i])->_reads==2);
+    if (((SimSensor*)sensors[i])->latency()>longest)
+      longest=((SimSensor*)sensors[i])->latency();
+  }
+
+  CHECK(sequential==sum);
+  // the readings themselves are not overlapped
+  CHECK(scheduled>=longest && scheduled<=longest+50+50+5+5+80+80+10);
+
+  printf("sketch sensors: %lu ms with update_data(), %lu ms with update_sensors(), longest sensor %lu ms\n",
+    sequential, scheduled, longest);
+}
+
+// the DHT22 gives 2 sensors on the same power pin, the first one read must not power off the second one
+void sharedPin() {
+
+  SimSensor dht22_t(IS_CONNECTED, IS_LOWPOWER, 7, 2000, 0, 5);
+  SimSensor dht22_h(IS_CONNECTED, IS_LOWPOWER, 7, 2000, 0, 5);
+  SimSensor lm35(IS_CONNECTED, IS_LOWPOWER, 9, 500, 0, 50);
+  Sensor* sensors[]={&dht22_t, &lm35, &dht22_h};
+
+  update_sensors(sensors, 3);
+
+  CHECK(dht22_t._reads==1 && dht22_h._reads==1 && lm35._reads==1);
+  checkPowerOff(sensors, 3);
+}
+
+void stuckSensors() {
+
+  StuckSensor retrying(7, 2000, 5, 1000);
+  StuckSensor spinning(7, 2000, 1, 0);
+  StuckSensor silent(5, 500, 1, 0);
+  SimSensor lm35(IS_CONNECTED, IS_LOWPOWER, 9, 500, 0, 50);
+  // retrying and spinning are on the same power pin, as the 2 sensors of the DHT22
+  Sensor* sensors[]={&retrying, &lm35, &spinning};
+
+  silent.set_fixed_data(1234);
+
+  unsigned long start=now;
+  silent.update_data();
+
+  CHECK(silent.get_fixed_data()==1234 && pins[5]==LOW);
+  CHECK(now-start>=500+SENSOR_READ_TIMEOUT && now-start<=500+SENSOR_READ_TIMEOUT+1);
+
+  retrying.set_fixed_data(-5);
+  spinning.set_fixed_data(7);
+
+  start=now;
+  update_sensors(sensors, 3);
+
+  CHECK(lm35._reads==1);
+  CHECK(retrying.get_fixed_data()==-5 && spinning.get_fixed_data()==7);
+  // the last retry may start just before the deadline
+  CHECK(now-start>=2000+SENSOR_READ_TIMEOUT && now-start<=2000+SENSOR_READ_TIMEOUT+1000+5+50);
+  CHECK(retrying._reads<=SENSOR_READ_TIMEOUT/1000+2 && spinning._reads>1);
+  checkPowerOff(sensors, 3);
+}
+
+void randomSensors(int n) {
+
+  SimSensor* sims[32];
+  Sensor* sensors[32];
+
+  for (int t=0; t<n; t++) {
+
+    uint8_t count=1+rand()%32;
+    uint8_t npins=1+rand()%8;
+    bool low_power[8];
+    unsigned long ready=0, readings=0;
+
+    for (uint8_t p=0; p<npins; p++)
+      low_power[p]=rand()%4;
+
+    // around the wrap-around of millis()
+    now=(rand()%2) ? 0xFFFFFFFF-rand()%5000 : rand();
+
+    for (uint8_t i=0; i<count; i++) {
+
+      uint8_t p=rand()%npins;
+
+      sims[i]=new SimSensor(rand()%8, low_power[p], 10+p, rand()%3000, (rand()%3) ? 0 : rand()%1000, rand()%100);
+      sensors[i]=sims[i];
+
+      if (sims[i]->latency()-sims[i]->_reading>ready)
+        ready=sims[i]->latency()-sims[i]->_reading;
+      readings+=sims[i]->_reading;
+    }
+
+    unsigned long start=now;
+
+    update_sensors(sensors, count);
+
+    unsigned long elapsed=now-start;
+
+    // the longest warm-up and conversion, plus at most all the readings
+    if (elapsed<ready || elapsed>ready+readings) {
+      failures++;
+      printf("%lu ms for %u sensors, longest warm-up %lu ms, readings %lu ms\n", elapsed, count, ready, readings);
+    }
+
+    checkPowerOff(sensors, count);
+
+    for (uint8_t i=0; i<count; i++) {
+      CHECK(sims[i]->_reads==1);
+      delete sims[i];
+    }
+  }
+}
+
+int main() {
+
+  srand(1);
+
+  sketchSensors();
+  sharedPin();
+  stuckSensors();
+  randomSensors(100000);
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
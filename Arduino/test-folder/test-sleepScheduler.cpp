@@ -0,0 +1,277 @@
+/*
+ *  Simulation of the SleepScheduler library on AVR
+ *
+ *  > g++ -O2 -D__AVR__ -DARDUINO=100 -I. -I../libraries/SleepScheduler/src test-sleepScheduler.cpp ../libraries/SleepScheduler/src/SleepScheduler.cpp -o test-sleepScheduler
+ *  > ./test-sleepScheduler
+ *
+ *  The simulated clock is the real time. millis() and micros() only count the time the MCU
+ *  is awake or in idle mode, as timer0 is stopped in power-down mode. LowPower.powerDown()
+ *  lasts 2K to 1024K cycles of the watchdog oscillator, whose frequency is 128kHz with an
+ *  offset and a daily variation (temperature), and the watchdog of calibrate() wakes up
+ *  sleep_mode() after 128K cycles.
+ *
+ *  - the wake-time error over 24h of 3 tasks (transmission every 10min, sensing every
+ *    minute, receive window every 128s) with the loop of the sketches (75 x SLEEP_8S for
+ *    10min), with the scheduler without calibration, calibrated in begin() and every hour
+ *  - the number of watchdog sleeps of a 10min sleep, the jitter, the periods missed while
+ *    awake, and a sleep() without task
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "LowPower.h"
+#include "avr/sleep.h"
+#include "avr/wdt.h"
+#include "SleepScheduler.h"
+
+#include "check.h"
+
+#define DAY_US 86400000000ULL
+
+SerialStub Serial;
+LowPowerClass LowPower;
+volatile uint8_t WDTCSR=0;
+
+// real time, and time counted by timer0 (crystal)
+unsigned long long now_us=0;
+unsigned long long timer0_us=0;
+unsigned long long wdt_at=0;
+unsigned long powerdowns=0;
+
+// the watchdog oscillator is 'offset' off, plus 'swing' over the day
+double offset=-0.07;
+double swing=0.01;
+
+double wdtFrequency() {
+  return 128000.0*(1+offset)*(1+swing*sin(2*M_PI*(now_us%DAY_US)/DAY_US));
+}
+
+void awake(unsigned long long us) {
+  now_us+=us;
+  timer0_us+=us;
+}
+
+unsigned long millis() {
+  return timer0_us/1000;
+}
+
+unsigned long micros() {
+  return timer0_us;
+}
+
+void delay(unsigned long ms) {
+  awake(ms*1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  awake(us);
+}
+
+long random(long min, long max) {
+  return min+rand()%(max-min);
+}
+
+void LowPowerClass::powerDown(period_t period, adc_t adc, bod_t bod) {
+  powerdowns++;
+  now_us+=(unsigned long long)((2048UL << period)/wdtFrequency()*1e6);
+}
+
+void wdt_enable(uint8_t timeout) {
+  wdt_at=now_us+(unsigned long long)((2048UL << timeout)/wdtFrequency()*1e6);
+}
+
+// idle mode, until the next overflow of timer0 or the watchdog interrupt
+void sleep_mode() {
+
+  unsigned long long wake=now_us+(timer0_us/1024+1)*1024-timer0_us;
+
+  if (wdt_at && wdt_at<=wake) {
+    wake=wdt_at;
+    wdt_at=0;
+    WDTCSR&=~(1 << WDIE);
+  }
+
+  awake(wake-now_us);
+}
+
+const unsigned long periods[3]={600000, 60000, 128000};
+// ms awake for the task
+const unsigned long work[3]={1600, 50, 100};
+
+struct Day {
+  double error[3];
+  double last[3];
+  unsigned long wakeups;
+  double awake;
+};
+
+void record(Day *d, int i, unsigned long long start, unsigned long k) {
+
+  double error=(now_us-start)/1000.0-(double)k*periods[i];
+
+  if (fabs(error)>d->error[i])
+    d->error[i]=fabs(error);
+  d->last[i]=error;
+}
+
+void reset(Day *d) {
+  memset(d, 0, sizeof(Day));
+  powerdowns=0;
+  now_us=0;
+  timer0_us=0;
+}
+
+// the loop of the sketches for the transmission only, LOW_POWER_PERIOD is 8
+Day sketchLoop() {
+
+  Day d;
+  unsigned long k;
+
+  reset(&d);
+
+  for (k=1; now_us<DAY_US; k++) {
+
+    for (int i=0; i<600/8; i++)
+      LowPower.powerDown(SLEEP_8S, ADC_OFF, BOD_OFF);
+
+    record(&d, 0, 0, k);
+    delay(work[0]);
+  }
+
+  d.wakeups=powerdowns;
+  d.awake=timer0_us/1e6;
+
+  return d;
+}
+
+// 0 no calibration, 1 in begin(), 2 every hour
+Day scheduler(int calibration) {
+
+  Day d;
+  SleepScheduler s;
+  unsigned long long start;
+  unsigned long k[3]={1, 1, 1};
+
+  reset(&d);
+
+  s.calibrationPeriod=(calibration==2) ? 3600000L : 0;
+  s.begin();
+  if (calibration==0)
+    s.setRatio(1.0);
+
+  start=now_us;
+
+  for (int i=0; i<3; i++)
+    s.setTask(i, periods[i], periods[i]);
+
+  while (now_us-start<DAY_US) {
+
+    uint8_t tasks=s.sleep();
+
+    CHECK(tasks!=0);
+
+    for (int i=0; i<3; i++)
+      if (tasks & (1 << i))
+        record(&d, i, start, k[i]++);
+
+    for (int i=0; i<3; i++)
+      if (tasks & (1 << i))
+        delay(work[i]);
+  }
+
+  d.wakeups=powerdowns;
+  d.awake=timer0_us/1e6;
+
+  return d;
+}
+
+void print(const char *name, Day d, bool all) {
+
+  printf("%-29s", name);
+
+  for (int i=0; i<3; i++)
+    if (all || i==0)
+      printf(" %8.1f %8.1f", d.error[i]/1000, d.last[i]/1000);
+    else
+      printf(" %17s", "-");
+
+  printf(" %8lu %7.0f\n", d.wakeups, d.awake);
+}
+
+void day() {
+
+  Day loop=sketchLoop();
+  Day none=scheduler(0);
+  Day once=scheduler(1);
+  Day hourly=scheduler(2);
+
+  printf("24h, watchdog %+.0f%% and +/-%.0f%% over the day, wake-time error in s (max, at 24h)\n", offset*100, swing*100);
+  printf("%-29s %17s %17s %17s %8s %7s\n", "", "TX 10min", "sensing 1min", "Rx window 128s", "sleeps", "awake s");
+  print("sketch loop (75 x SLEEP_8S)", loop, false);
+  print("scheduler, no calibration", none, true);
+  print("scheduler, calibrated once", once, true);
+  print("scheduler, calibrated hourly", hourly, true);
+
+  for (int i=0; i<3; i++) {
+    CHECK(hourly.error[i]<once.error[i]);
+    CHECK(once.error[i]<none.error[i]);
+    CHECK(hourly.error[i]<30000);
+  }
+
+  CHECK(none.error[0]<loop.error[0]);
+}
+
+void checks() {
+
+  SleepScheduler s;
+
+  offset=-0.07;
+  swing=0;
+  now_us=timer0_us=0;
+  s.calibrationPeriod=0;
+  s.begin();
+  CHECK(fabs(s.getRatio()-1/0.93)<0.0001);
+
+  // no task
+  CHECK(s.nextWakeUp()==0);
+  CHECK(s.sleep()==0);
+
+  // the longest watchdog sleeps: 68 x 8s for 10min at this ratio, then less than 9 shorter ones
+  powerdowns=0;
+  unsigned long long start=now_us;
+  unsigned long t=s.now();
+  s.sleepFor(600000);
+  CHECK(powerdowns<=600000/(8192*s.getRatio())+9);
+  CHECK(fabs((now_us-start)/1000.0-600000)<20);
+  CHECK(s.now()-t>=599980 && s.now()-t<=600020);
+
+  // the jitter delays each occurrence by at most 5s, from the schedule
+  s.setTask(0, 60000, 60000, 5000);
+  start=now_us;
+
+  for (int k=1; k<=50; k++) {
+    CHECK(s.sleep()==1);
+    double late=(now_us-start)/1000.0-k*60000.0;
+    CHECK(late>-20 && late<5020);
+  }
+
+  // awake longer than 2 periods, the missed ones are skipped
+  s.setTask(1, 1000, 1000);
+  delay(3500);
+  CHECK(s.due() & 2);
+  CHECK(s.nextWakeUp()<=1000);
+  s.stopTask(0);
+  s.stopTask(1);
+  CHECK(s.nextWakeUp()==0);
+}
+
+int main() {
+
+  day();
+  checks();
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
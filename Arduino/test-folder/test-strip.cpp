@@ -0,0 +1,222 @@
+/*
+ *  Strip-based encoding of the image (jpeg_strip.h of the uCam library)
+ *
+ *  > g++ -O2 -DARDUINO=100 -I. -I../libraries/uCam test-strip.cpp -o test-strip
+ *  > ./test-strip
+ *
+ *  The lion of gw_full_latest/ucam-images is resized to the raw modes of the uCam (80x60,
+ *  128x128, 160x120). The image is encoded with the new CRAN encoding and FIXED_POINT_DCT:
+ *    - frame: the whole image in memory (inImage of the sketch), JPEGencoding() of each block
+ *      in the interleaved order of the packets
+ *    - strip: the lines are given 8 at a time to StripEncode(), then StripGetBlock() in the
+ *      interleaved order
+ *  The blocks given to FillPacket() must be the same. The RAM is the image, or the strip, the
+ *  index and the used part of the store. The time is the host time for the whole image.
+ */
+
+#include <inttypes.h>
+#include <time.h>
+
+#include "Arduino.h"
+
+#define SHORT_COMPUTATION
+#include "mqc.h"
+
+#define CRAN_NEW_CODING
+#define FIXED_POINT_DCT
+#include "jpeg_dct.h"
+#include "jpeg_strip.h"
+
+#include "check.h"
+
+#define LION 128
+#define RUNS 200
+
+SerialStub Serial;
+
+uint8_t lion[LION][LION];
+// [x][y] as inImage.data of the sketch
+uint8_t image[160][120];
+int W, H;
+
+// the luminance of the 16-bit (RGB555) BMP file
+bool readBMP(const char *file) {
+
+  FILE *f=fopen(file, "rb");
+  uint8_t header[54];
+
+  if (!f)
+    return false;
+
+  if (fread(header, 1, 54, f)!=54 || header[28]!=16) {
+    fclose(f);
+    return false;
+  }
+
+  fseek(f, header[10] | header[11] << 8 | header[12] << 16 | header[13] << 24, SEEK_SET);
+
+  // bottom-up
+  for (int row=LION-1; row>=0; row--)
+    for (int col=0; col<LION; col++) {
+      int lo=fgetc(f);
+      int hi=fgetc(f);
+      int rgb=lo | hi << 8;
+      double r=((rgb >> 10) & 0x1F)*255/31.0;
+      double g=((rgb >> 5) & 0x1F)*255/31.0;
+      double b=(rgb & 0x1F)*255/31.0;
+      lion[row][col]=(uint8_t)(0.299*r+0.587*g+0.114*b+0.5);
+    }
+
+  fclose(f);
+  return true;
+}
+
+// bilinear
+void resize(int w, int h) {
+
+  W=w;
+  H=h;
+
+  for (int x=0; x<W; x++)
+    for (int y=0; y<H; y++) {
+      double fx=x*(LION-1)/(double)(W-1), fy=y*(LION-1)/(double)(H-1);
+      int x0=(int)fx, y0=(int)fy;
+      int x1=x0<LION-1 ? x0+1 : x0, y1=y0<LION-1 ? y0+1 : y0;
+      double ax=fx-x0, ay=fy-y0;
+
+      image[x][y]=(uint8_t)((1-ay)*((1-ax)*lion[y0][x0]+ax*lion[y0][x1])+ay*((1-ax)*lion[y1][x0]+ax*lion[y1][x1])+0.5);
+    }
+}
+
+// the interleaving of encode_ucam_file_data() on the square of blocks, without the blocks
+// outside the image
+int order[20*15][2];
+int nblocks;
+
+void interleave() {
+
+  int Hb=(W+7)/8, Vb=(H+7)/8;
+  int N=Hb > Vb ? Hb : Vb;
+
+  nblocks=0;
+
+  for (int row=0; row<N; row++)
+    for (int col=0; col<N; col++) {
+      int row_mix=((row*5)+(col*8))%N;
+      int col_mix=((row*8)+(col*13))%N;
+
+      if (row_mix<Hb && col_mix<Vb) {
+        order[nblocks][0]=row_mix;
+        order[nblocks][1]=col_mix;
+        nblocks++;
+      }
+    }
+}
+
+int frameBlocks[20*15][8][8];
+int stripBlocks[20*15][8][8];
+
+void frameEncoding() {
+
+  for (int k=0; k<nblocks; k++) {
+    int (*Block)[8]=frameBlocks[k];
+
+    // the last line and column are repeated
+    for (int i=0; i<8; i++)
+      for (int j=0; j<8; j++) {
+        int x=order[k][0]*8+i, y=order[k][1]*8+j;
+        Block[i][j]=image[x < W ? x : W-1][y < H ? y : H-1];
+      }
+
+    JPEGencoding(Block);
+  }
+}
+
+void stripEncoding() {
+
+  StripBegin();
+
+  // as the uCam, line by line
+  for (int y=0; y<H; y++) {
+
+    for (int x=0; x<W; x++)
+      StripLines[(y%8)*W+x]=image[x][y];
+
+    if (y%8==7 || y==H-1)
+      StripEncode(y%8+1);
+  }
+
+  for (int k=0; k<nblocks; k++)
+    StripGetBlock(order[k][0], order[k][1], stripBlocks[k]);
+}
+
+double timing(void (*encoding)()) {
+
+  clock_t start=clock();
+
+  for (int k=0; k<RUNS; k++)
+    encoding();
+
+  return (double)(clock()-start)/CLOCKS_PER_SEC*1e6/RUNS;
+}
+
+void run(int w, int h, int Q) {
+
+  resize(w, h);
+  interleave();
+  QTinitialization(Q);
+
+  // large enough for all the blocks
+  CHECK(StripAllocate(W, H, nblocks*(1+64*3)));
+  CHECK(nblocks==StripHblocks*StripVblocks);
+
+  double frameUs=timing(frameEncoding);
+  double stripUs=timing(stripEncoding);
+  int strip=8*W+nblocks*sizeof(unsigned short)+StripStoreUsed;
+
+  printf("%3dx%-3d Q%-3d %6d %6.0f   %6d %5d %6d %6.0f %5.1f\n", W, H, Q, W*H, frameUs, strip, StripStoreUsed,
+         StripTruncatedBlocks, stripUs, StripStoreUsed*8.0/(W*H));
+
+  CHECK(StripTruncatedBlocks==0);
+  CHECK(memcmp(frameBlocks, stripBlocks, nblocks*sizeof(frameBlocks[0]))==0);
+
+  free(StripLines);
+  free(StripBlockIndex);
+  free(StripStore);
+
+  // the smallest store, the last blocks keep their DC coefficient
+  CHECK(StripAllocate(W, H, 4*nblocks));
+  CHECK(!StripAllocate(W, H, 4*nblocks-1));
+  stripEncoding();
+
+  CHECK(StripStoreUsed<=4*(unsigned)nblocks);
+
+  for (int k=0; k<nblocks; k++)
+    CHECK(stripBlocks[k][0][0]==frameBlocks[k][0][0]);
+
+  free(StripLines);
+  free(StripBlockIndex);
+  free(StripStore);
+}
+
+int main() {
+
+  const int sizes[][2]={{80, 60}, {128, 128}, {160, 120}};
+  const int Qs[]={10, 20, 50, 80, 100};
+
+  if (!readBMP("../../gw_full_latest/ucam-images/lion-128x128.bmp")) {
+    printf("cannot read lion-128x128.bmp\n");
+    return 1;
+  }
+
+  printf("%-12s %13s   %s\n", "", "frame", "strip");
+  printf("%-12s %6s %6s   %6s %5s %6s %6s %5s\n", "image", "RAM", "us", "RAM", "store", "trunc", "us", "bpp");
+
+  for (unsigned s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++)
+    for (unsigned q=0; q<sizeof(Qs)/sizeof(Qs[0]); q++)
+      run(sizes[s][0], sizes[s][1], Qs[q]);
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
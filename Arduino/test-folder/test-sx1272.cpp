@@ -0,0 +1,678 @@
+/*
+ *  Simulation of the radio module for the transmission and the reception of the SX1272 library
+ *
+ *  > g++ -O2 -D__AVR__ -DARDUINO=100 -I. -I../libraries/SX1272/src test-sx1272.cpp ../libraries/SX1272/src/SX1272.cpp -o test-sx1272
+ *  > ./test-sx1272
+ *
+ *  __AVR__ builds the sleep of sendWithTimeout() and receiveWindow() with avr/sleep.h of this folder,
+ *  where sleep_mode() stops the MCU until an interrupt on DIO0/DIO1 or the next tick of millis().
+ *  The registers of the radio module are simulated: writing LORA_TX_MODE in REG_OP_MODE sets the
+ *  TxDone flag after the time on air given by getToA(), and raises DIO0 if it is mapped to TxDone.
+ *  In Rx continuous and Rx single modes, a downlink packet starting at a given time sets ValidHeader
+ *  after its preamble and RxDone at its end; Rx single sets RxTimeout after the symbol timeout when
+ *  there is no preamble. A register access takes the time of digitalWrite() and SPI.transfer()
+ *  on an AVR at 16MHz with SPI_CLOCK_DIV8.
+ *
+ *  - the time the MCU is awake to send a packet at SF7 and SF12 when sendWithTimeout() polls
+ *    REG_IRQ_FLAGS, and with setDIO0Pin()
+ *  - startSendPacket(), isSendDone() without SPI access and endSend()
+ *  - the timeout when the radio module does not send the packet, the remaining ToA
+ *  - the time the MCU is awake and the energy of a receive window of 10s for each LoRa mode,
+ *    without and with a downlink packet, when receivePacketTimeout() polls REG_IRQ_FLAGS and
+ *    with setDIO0Pin()/setDIO1Pin()
+ *  - the window without DIO1, a downlink packet for another node, an ACK with sendPacketTimeoutACK()
+ *  - the average current and the downlink latency of wakeOnRadio() for several CAD periods, the CAD
+ *    sets CadDone after 2 symbols and CadDetected when the long preamble of the downlink is on air
+ */
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "SX1272.h"
+
+#include "check.h"
+
+#define DIO0_PIN 2
+#define DIO1_PIN 3
+// us, digitalWrite() and one byte at 2MHz
+#define DIGITALWRITE_US 4
+#define SPI_BYTE_US 5
+// the timer interrupt of millis() and the test of isSendDone() when the MCU wakes up
+#define WAKEUP_US 6
+
+// mA, SX1276 in Rx (LnaBoost off, band 1) and ATmega328P at 8MHz and 3.3V active and in idle mode
+#define RX_MA 10.8
+#define MCU_ACTIVE_MA 4.0
+#define MCU_IDLE_MA 1.0
+// uA, ATmega328P in power-down mode with the watchdog and SX1276 in sleep mode
+#define SLEEP_UA 5.0
+
+SerialStub Serial;
+SPIClass SPI;
+
+// time in us, the MCU is awake unless it is in sleep_mode()
+unsigned long long now_us=0;
+unsigned long long slept_us=0;
+unsigned long spi_accesses=0;
+
+// the radio module
+uint8_t regs[128];
+uint8_t spi_byte=0;
+uint8_t spi_address;
+bool radio_ok=true;
+unsigned long long tx_done_at=0;
+void (*isr[2])()={NULL, NULL};
+
+// the downlink packet, its preamble starts at downlink_at
+uint8_t downlink[255];
+uint8_t downlink_length=0;
+unsigned long long downlink_at=0;
+unsigned long long header_at=0;
+unsigned long long rx_done_at=0;
+unsigned long long rx_timeout_at=0;
+unsigned long long cad_done_at=0;
+bool cad_detected=false;
+// preamble of the downlink packet in symbols
+uint16_t downlink_preamble=8;
+// time in Rx
+unsigned long long rx_since=0;
+unsigned long long rx_us=0;
+uint8_t fifo[256];
+uint8_t fifo_ptr=0;
+// the gateway sends an ACK after the next packet
+bool ack_after_tx=false;
+
+bool dio0(uint8_t mapping) {
+  return (regs[REG_DIO_MAPPING1] >> 6)==mapping && isr[0];
+}
+
+// RxTimeout with the mapping 00
+bool dio1() {
+  return ((regs[REG_DIO_MAPPING1] >> 4) & 0x03)==0 && isr[1];
+}
+
+bool receiving() {
+  return regs[REG_OP_MODE]==LORA_RX_MODE || regs[REG_OP_MODE]==LORA_RXSINGLE_MODE;
+}
+
+// the CAD counts as Rx
+bool listening() {
+  return receiving() || regs[REG_OP_MODE]==LORA_CAD_MODE;
+}
+
+// us
+double symbolTime() {
+  return (double)(1 << sx1272._spreadingFactor)*1000/((sx1272._bandwidth==BW_125)?125:((sx1272._bandwidth==BW_250)?250:500));
+}
+
+// end of the preamble of the downlink packet
+unsigned long long preambleEnd() {
+  return downlink_at+(unsigned long long)(downlink_preamble*symbolTime());
+}
+
+void setOpMode(uint8_t mode) {
+
+  if (listening())
+    rx_us+=now_us-rx_since;
+
+  regs[REG_OP_MODE]=mode;
+  header_at=rx_done_at=rx_timeout_at=cad_done_at=0;
+
+  if (!listening())
+    return;
+
+  rx_since=now_us;
+
+  // 4 symbols of the preamble are left to detect it
+  bool preamble=downlink_length && now_us+(unsigned long long)(4*symbolTime())<=preambleEnd();
+
+  if (mode==LORA_CAD_MODE) {
+    cad_done_at=now_us+(unsigned long long)(2*symbolTime());
+    cad_detected=preamble && downlink_at<=now_us;
+  }
+  else if (mode==LORA_RX_MODE) {
+    if (preamble)
+      rx_done_at=downlink_at;
+  }
+  else {
+    uint16_t symbols=((regs[REG_MODEM_CONFIG2] & 0x03) << 8) | regs[REG_SYMB_TIMEOUT_LSB];
+    unsigned long long end=now_us+(unsigned long long)(symbols*symbolTime());
+
+    // the preamble must start before the symbol timeout
+    if (preamble && downlink_at<end)
+      rx_done_at=downlink_at;
+    else
+      rx_timeout_at=end;
+  }
+
+  if (rx_done_at) {
+    // ValidHeader after the preamble and the header, getToA() counts the preamble of the module
+    header_at=preambleEnd()+(unsigned long long)((4.25+8)*symbolTime());
+    rx_done_at+=sx1272.getToA(downlink_length)*1000ULL
+      +(unsigned long long)((downlink_preamble-sx1272._preamblelength)*symbolTime());
+  }
+}
+
+// the next event of the radio module until 'to', 0 if none
+unsigned long long nextEvent(unsigned long long to) {
+
+  unsigned long long next=0;
+  unsigned long long events[]={tx_done_at, header_at, rx_done_at, rx_timeout_at, cad_done_at};
+
+  for (int i=0; i<5; i++)
+    if (events[i] && events[i]<=to && (!next || events[i]<next))
+      next=events[i];
+
+  return next;
+}
+
+void advance(unsigned long long to) {
+
+  unsigned long long next;
+
+  while ((next=nextEvent(to))) {
+
+    if (next>now_us)
+      now_us=next;
+
+    if (next==tx_done_at) {
+      tx_done_at=0;
+      regs[REG_IRQ_FLAGS]|=0x08;
+      // back to standby after the transmission
+      setOpMode(LORA_STANDBY_MODE);
+
+      if (ack_after_tx) {
+        // 100ms later
+        ack_after_tx=false;
+        downlink[0]=sx1272.packet_sent.src;
+        downlink[1]=PKT_TYPE_ACK;
+        downlink[2]=sx1272.packet_sent.dst;
+        downlink[3]=sx1272.packet_sent.packnum;
+        downlink[4]=2;
+        downlink[5]=CORRECT_PACKET;
+        downlink[6]=8;
+        downlink_length=7;
+        downlink_preamble=sx1272._preamblelength;
+        downlink_at=now_us+100000;
+      }
+
+      if (dio0(1))
+        isr[0]();
+    }
+    else if (next==header_at) {
+      header_at=0;
+      regs[REG_IRQ_FLAGS]|=0x10;
+      regs[REG_FIFO_RX_BYTE_ADDR]=downlink_length;
+    }
+    else if (next==rx_done_at) {
+      rx_done_at=0;
+      regs[REG_IRQ_FLAGS]|=0x40;
+      memcpy(fifo, downlink, downlink_length);
+      regs[REG_RX_NB_BYTES]=downlink_length;
+      downlink_length=0;
+
+      // Rx single goes back to standby
+      if (regs[REG_OP_MODE]==LORA_RXSINGLE_MODE)
+        setOpMode(LORA_STANDBY_MODE);
+
+      if (dio0(0))
+        isr[0]();
+    }
+    else if (next==cad_done_at) {
+      cad_done_at=0;
+      regs[REG_IRQ_FLAGS]|=cad_detected ? 0x05 : 0x04;
+      setOpMode(LORA_STANDBY_MODE);
+
+      if (dio0(2))
+        isr[0]();
+    }
+    else {
+      rx_timeout_at=0;
+      regs[REG_IRQ_FLAGS]|=0x80;
+      setOpMode(LORA_STANDBY_MODE);
+
+      if (dio1())
+        isr[1]();
+    }
+  }
+
+  if (to>now_us)
+    now_us=to;
+}
+
+unsigned long millis() {
+  advance(now_us+1);
+  return now_us/1000;
+}
+
+unsigned long micros() {
+  return now_us;
+}
+
+void delay(unsigned long ms) {
+  advance(now_us+ms*1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advance(now_us+us);
+}
+
+// until the next tick of the timer of millis() or an interrupt of the radio module
+void sleep_mode() {
+
+  unsigned long long wake=(now_us/1024+1)*1024;
+
+  if (tx_done_at && tx_done_at<wake && dio0(1))
+    wake=tx_done_at;
+  if (rx_done_at && rx_done_at<wake && dio0(0))
+    wake=rx_done_at;
+  if (rx_timeout_at && rx_timeout_at<wake && dio1())
+    wake=rx_timeout_at;
+  if (cad_done_at && cad_done_at<wake && dio0(2))
+    wake=cad_done_at;
+
+  slept_us+=wake-now_us;
+  advance(wake);
+  advance(now_us+WAKEUP_US);
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+
+  uint8_t value=0;
+
+  advance(now_us+SPI_BYTE_US);
+
+  if (spi_byte++==0) {
+    spi_address=data;
+    spi_accesses++;
+    return 0;
+  }
+
+  if (!(spi_address & 0x80))
+    return spi_address==REG_FIFO ? fifo[fifo_ptr++] : regs[spi_address];
+
+  spi_address&=0x7F;
+
+  if (spi_address==REG_IRQ_FLAGS)
+    regs[REG_IRQ_FLAGS]&=~data;
+  else if (spi_address==REG_FIFO)
+    fifo[fifo_ptr++]=data;
+  else if (spi_address==REG_OP_MODE) {
+    setOpMode(data);
+
+    if (data==LORA_TX_MODE && radio_ok)
+      tx_done_at=now_us+sx1272.getToA(regs[REG_PAYLOAD_LENGTH_LORA])*1000ULL;
+  }
+  else {
+    regs[spi_address]=data;
+
+    if (spi_address==REG_FIFO_ADDR_PTR)
+      fifo_ptr=data;
+  }
+
+  return value;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+// chip select
+void digitalWrite(uint8_t pin, uint8_t value) {
+  advance(now_us+DIGITALWRITE_US);
+  spi_byte=0;
+}
+
+int digitalRead(uint8_t pin) {
+  return 0;
+}
+
+int analogRead(uint8_t pin) {
+  return 0;
+}
+
+long random(long min, long max) {
+  return min+rand()%(max-min);
+}
+
+void randomSeed(unsigned long seed) {
+}
+
+int pinToInterrupt(uint8_t pin) {
+  return pin==DIO0_PIN ? 0 : (pin==DIO1_PIN ? 1 : NOT_AN_INTERRUPT);
+}
+
+void attachInterrupt(uint8_t interrupt, void (*f)(), int mode) {
+  isr[interrupt]=f;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  isr[interrupt]=NULL;
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+void setLoRa(uint8_t sf) {
+  sx1272._modem=LORA;
+  setOpMode(LORA_STANDBY_MODE);
+  CHECK(sx1272.setCR(CR_5)==0);
+  CHECK(sx1272.setSF(sf)==0);
+  CHECK(sx1272.setBW(BW_125)==0);
+}
+
+// awake time in ms to send a packet written by setPacket() with sendWithTimeout(),
+// the delay(250) of setPacketLength() is the same with or without DIO0
+double awakeTime(uint8_t sf, uint8_t length) {
+
+  uint8_t payload[255];
+  unsigned long long start;
+
+  setLoRa(sf);
+  memset(payload, 0x55, length);
+  CHECK(sx1272.truncPayload(length)==0);
+  CHECK(sx1272.setPacket(1, payload)==0);
+  slept_us=0;
+  start=now_us;
+  CHECK(sx1272.sendWithTimeout(sx1272.getToA(length+OFFSET_PAYLOADLENGTH)+1000)==0);
+
+  return (now_us-start-slept_us)/1000.0;
+}
+
+void measure() {
+
+  const uint8_t lengths[]={21, 73};
+  const uint8_t sfs[]={SF_7, SF_12};
+  double polling[2][2];
+
+  for (int i=0; i<2; i++)
+    for (int j=0; j<2; j++)
+      polling[i][j]=awakeTime(sfs[i], lengths[j]);
+
+  sx1272.setDIO0Pin(DIO0_PIN);
+  CHECK(isr[0]!=NULL);
+
+  for (int i=0; i<2; i++)
+    for (int j=0; j<2; j++) {
+
+      double dio0=awakeTime(sfs[i], lengths[j]);
+
+      setLoRa(sfs[i]);
+      printf("SF%-2u %2u bytes, ToA %4u ms: awake %7.2f ms polling REG_IRQ_FLAGS, %4.2f ms with DIO0\n",
+        sfs[i], lengths[j], sx1272.getToA(lengths[j]+OFFSET_PAYLOADLENGTH), polling[i][j], dio0);
+
+      CHECK(dio0<polling[i][j]);
+    }
+}
+
+void asynchronous() {
+
+  uint8_t payload[20]={0};
+  unsigned long accesses;
+  int work=0;
+
+  setLoRa(SF_12);
+
+  // the packet is written in FIFO, then the MCU does something else
+  CHECK(sx1272.startSendPacket(1, payload, sizeof(payload))==0);
+  CHECK(tx_done_at!=0);
+
+  accesses=spi_accesses;
+
+  while (!sx1272.isSendDone()) {
+    work++;
+    delay(1);
+  }
+
+  // no SPI access while waiting
+  CHECK(spi_accesses==accesses);
+  CHECK(work>=sx1272.getToA(sizeof(payload)+OFFSET_PAYLOADLENGTH)-2);
+  CHECK(sx1272.endSend()==0);
+  CHECK(regs[REG_IRQ_FLAGS]==0);
+
+  // the radio module does not send it, the timeout expires
+  radio_ok=false;
+  CHECK(sx1272.startSendPacket(1, payload, sizeof(payload))==0);
+  while (!sx1272.isSendDone())
+    delay(1);
+  CHECK(sx1272.endSend()==1);
+
+  unsigned long long start=now_us;
+  CHECK(sx1272.sendWithTimeout(500)==1);
+  CHECK(now_us-start>=500000 && now_us-start<502000);
+  radio_ok=true;
+
+  // the ToA is counted when the packet is sent
+  sx1272.limitToA();
+  long remaining=sx1272.getRemainingToA();
+  CHECK(sx1272.sendPacketTimeout(1, payload, sizeof(payload))==0);
+  CHECK(sx1272.getRemainingToA()==remaining-sx1272.getToA(sizeof(payload)+OFFSET_PAYLOADLENGTH));
+}
+
+// a downlink packet for 'dst' with 'length' bytes of payload, 'after' ms later, none if length is 0
+void sendDownlink(uint8_t dst, uint8_t length, unsigned long after) {
+
+  downlink[0]=dst;
+  downlink[1]=PKT_TYPE_DATA;
+  downlink[2]=1;
+  downlink[3]=42;
+
+  for (int i=0; i<length; i++)
+    downlink[OFFSET_PAYLOADLENGTH+i]='a'+i%26;
+
+  downlink_length=length ? OFFSET_PAYLOADLENGTH+length : 0;
+  downlink_preamble=sx1272._preamblelength;
+  downlink_at=now_us+after*1000ULL;
+}
+
+struct Window {
+  double awake;
+  double rx;
+  double energy;
+};
+
+// the receive window of 10s of Arduino_LoRa_temp, the downlink packet starts 1s later
+Window listen(uint8_t length, uint8_t *e) {
+
+  Window w;
+  unsigned long long start;
+
+  sendDownlink(8, length, 1000);
+  slept_us=0;
+  rx_us=0;
+  start=now_us;
+  *e=sx1272.receivePacketTimeout(10000);
+
+  w.awake=(now_us-start-slept_us)/1000.0;
+  w.rx=rx_us/1000.0;
+  // mJ at 3.3V
+  w.energy=3.3*(RX_MA*w.rx+MCU_ACTIVE_MA*w.awake+MCU_IDLE_MA*slept_us/1000.0)/1000;
+
+  return w;
+}
+
+void receive() {
+
+  const uint8_t lengths[]={0, 20};
+  Window polling[11][2];
+  uint8_t e;
+
+  sx1272._nodeAddress=8;
+  sx1272._dio0Pin=SX1272_NO_DIO;
+
+  for (int mode=1; mode<=10; mode++)
+    for (int j=0; j<2; j++) {
+      CHECK(sx1272.setMode(mode)==0);
+      polling[mode][j]=listen(lengths[j], &e);
+      CHECK(e==(lengths[j] ? 0 : 3));
+    }
+
+  sx1272.setDIO0Pin(DIO0_PIN);
+  sx1272.setDIO1Pin(DIO1_PIN);
+  CHECK(isr[1]!=NULL);
+
+  printf("receive window of 10s, awake time and energy polling REG_IRQ_FLAGS -> with DIO0/DIO1\n");
+
+  for (int mode=1; mode<=10; mode++)
+    for (int j=0; j<2; j++) {
+
+      CHECK(sx1272.setMode(mode)==0);
+      Window dio=listen(lengths[j], &e);
+
+      CHECK(e==(lengths[j] ? 0 : 3));
+      CHECK(dio.awake<polling[mode][j].awake/10);
+      CHECK(dio.energy<polling[mode][j].energy);
+      // the radio module is in Rx until the end of the window or of the packet
+      CHECK(dio.rx<(lengths[j] ? 1000+sx1272.getToA(OFFSET_PAYLOADLENGTH+lengths[j]) : 10000)+1);
+
+      if (lengths[j]) {
+        CHECK(sx1272._payloadlength==lengths[j]);
+        CHECK(sx1272.packet_received.data[lengths[j]-1]=='a'+(lengths[j]-1)%26);
+      }
+
+      if (j==0)
+        printf("mode %2d SF%-2u BW%u:", mode, sx1272._spreadingFactor,
+          sx1272._bandwidth==BW_125 ? 125 : (sx1272._bandwidth==BW_250 ? 250 : 500));
+      printf("  %s %6.1f -> %4.1f ms, %3.0f -> %3.0f mJ", lengths[j] ? "20-byte downlink after 1s" : "no downlink",
+        polling[mode][j].awake, dio.awake, polling[mode][j].energy, dio.energy);
+      if (j)
+        printf("\n");
+    }
+
+  // without DIO1, RxTimeout is read after the symbol timeout
+  sx1272._dio1Pin=SX1272_NO_DIO;
+  CHECK(sx1272.setMode(10)==0);
+  Window w=listen(0, &e);
+  CHECK(e==3 && w.awake<polling[10][0].awake/10);
+  w=listen(20, &e);
+  CHECK(e==0 && w.awake<polling[10][1].awake/10);
+  sx1272.setDIO1Pin(DIO1_PIN);
+
+  // the packet is for another node
+  CHECK(sx1272.setMode(1)==0);
+  sendDownlink(9, 20, 1000);
+  CHECK(sx1272.receivePacketTimeout(10000)==3);
+  CHECK(regs[REG_OP_MODE]==LORA_STANDBY_MODE);
+
+  // the ACK of the gateway
+  uint8_t payload[10]={0};
+  ack_after_tx=true;
+  CHECK(sx1272.sendPacketTimeoutACK(1, payload, sizeof(payload))==0);
+  CHECK(sx1272.ACK.data[0]==CORRECT_PACKET);
+  CHECK(sx1272.sendPacketTimeoutACK(1, payload, sizeof(payload))==SX1272_ERROR_ACK);
+}
+
+// 'cycles' calls to wakeOnRadio() every 'period' ms, the MCU and the radio module are in sleep
+// mode in between, returns the average current in mA and the last value returned by wakeOnRadio()
+double dutyCycle(uint16_t period, int cycles, uint8_t *e) {
+
+  unsigned long long start=now_us;
+  unsigned long long powerdown_us=0;
+
+  slept_us=0;
+  rx_us=0;
+
+  for (int i=0; i<cycles; i++) {
+    *e=sx1272.wakeOnRadio(period);
+
+    if (*e==0)
+      break;
+
+    CHECK(regs[REG_OP_MODE]==LORA_SLEEP_MODE);
+    advance(now_us+period*1000ULL);
+    powerdown_us+=period*1000ULL;
+  }
+
+  double total=(now_us-start)/1000.0;
+  double awake=total-slept_us/1000.0-powerdown_us/1000.0;
+
+  return (RX_MA*rx_us/1000.0+MCU_ACTIVE_MA*awake+MCU_IDLE_MA*slept_us/1000.0+SLEEP_UA/1000*powerdown_us/1000.0)/total;
+}
+
+void wakeOnRadio() {
+
+  const uint8_t modes[]={1, 3, 10};
+  const uint16_t periods[]={250, 500, 1000, 2000, 4000, 8000};
+  double previous;
+  uint8_t e;
+
+  sx1272._nodeAddress=8;
+  CHECK(sx1272._preamblelength==8);
+
+  printf("wake-on-radio, average current without downlink and latency of a 20-byte downlink sent with a long preamble\n");
+
+  for (int m=0; m<3; m++) {
+
+    CHECK(sx1272.setMode(modes[m])==0);
+
+    printf("mode %2d SF%-2u BW%u: continuous Rx %.1f mA\n", modes[m], sx1272._spreadingFactor,
+      sx1272._bandwidth==BW_125 ? 125 : (sx1272._bandwidth==BW_250 ? 250 : 500), RX_MA+MCU_IDLE_MA);
+    previous=RX_MA+MCU_IDLE_MA;
+
+    for (int p=0; p<6; p++) {
+
+      uint16_t preamble=sx1272.getWakeOnRadioPreamble(periods[p]);
+
+      sendDownlink(8, 0, 0);
+      double current=dutyCycle(periods[p], 60000/periods[p], &e);
+      CHECK(e==3);
+
+      // the downlink starts at 10 points of the period, the latency is from its start to RxDone
+      double latency=0;
+
+      for (int i=0; i<10; i++) {
+        sendDownlink(8, 20, periods[p]*i/10);
+        downlink_preamble=preamble;
+        unsigned long long sent=downlink_at;
+
+        dutyCycle(periods[p], 3, &e);
+        CHECK(e==0);
+        CHECK(sx1272._payloadlength==20 && sx1272.packet_received.data[19]=='a'+19%26);
+
+        double l=(now_us-sent)/1000.0;
+        latency+=l/10;
+        // the end of the packet, wherever the CAD falls in the preamble
+        CHECK(l<periods[p]*1.1+sx1272.getToA(OFFSET_PAYLOADLENGTH+20)+10*symbolTime()/1000+2);
+        sx1272.setSleepMode();
+      }
+
+      printf("  CAD every %4u ms: %6.3f mA, preamble %5u symbols, downlink latency %5.0f ms\n",
+        periods[p], current, preamble, latency);
+
+      CHECK(current<previous);
+      previous=current;
+    }
+  }
+
+  // without DIO0, CadDone is polled
+  sx1272._dio0Pin=SX1272_NO_DIO;
+  CHECK(sx1272.setMode(10)==0);
+  sendDownlink(8, 20, 100);
+  downlink_preamble=sx1272.getWakeOnRadioPreamble(1000);
+  dutyCycle(1000, 3, &e);
+  CHECK(e==0);
+
+  // a preamble of 8 symbols is missed
+  sendDownlink(8, 20, 100);
+  dutyCycle(1000, 3, &e);
+  CHECK(e==3);
+  sx1272.setDIO0Pin(DIO0_PIN);
+}
+
+int main() {
+
+  sx1272._board=SX1276Chip;
+  // the default preamble of the gateway and of the end-devices
+  sx1272._preamblelength=8;
+
+  measure();
+  asynchronous();
+  receive();
+  wakeOnRadio();
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
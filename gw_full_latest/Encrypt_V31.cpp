@@ -0,0 +1,396 @@
+/******************************************************************************************
+* Copyright 2015, 2016 Ideetron B.V.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************************/
+/******************************************************************************************
+*
+* File:        Encrypt_V31.cpp
+* Author:      Gerben den Hartog
+* Compagny:    Ideetron B.V.
+* Website:     http://www.ideetron.nl/LoRa
+* E-mail:      info@ideetron.nl
+******************************************************************************************/
+/****************************************************************************************
+*
+* Created on: 			04-02-2016
+* Supported Hardware: ID150119-02 Nexus board with RFM95
+*
+* Firmware Version 1.0
+* First version
+*
+* Firmware Version 2.0
+* Works the same is 1.0 using own AES encryption
+*
+* Firmware Version 3.0
+* Included direction in MIC calculation and encryption
+*
+* Firmware Version 3.1
+* Now using AppSkey in Encrypt Payload function
+*
+* Firmware Version 3.2
+* Added MIC context: K1/K2 are derived once per key and the MIC can be computed
+* incrementally over several buffers (header, payload) without copying them
+****************************************************************************************/
+
+/*
+*****************************************************************************************
+* INCLUDE FILES
+*****************************************************************************************
+*/
+
+#include "Encrypt_V31.h"
+#include "AES-128_V10.h"
+
+/*
+*****************************************************************************************
+* INCLUDE GLOBAL VARIABLES
+*****************************************************************************************
+*/
+
+extern unsigned char NwkSkey[16];
+extern unsigned char AppSkey[16];
+extern unsigned char DevAddr[4];
+
+void Encrypt_Payload(unsigned char *Data, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction)
+{
+	Encrypt_Payload_Key(Data, Data_Length, Frame_Counter, Direction, AppSkey, DevAddr);
+}
+
+/*
+*****************************************************************************************
+* Description : Same as Encrypt_Payload but with an explicit key and device address, e.g.
+*               for a gateway that handles several devices
+*
+* Arguments   : *Key            16 byte long key (AppSkey)
+*               *Dev_Addr       4 byte long device address, msb first
+*****************************************************************************************
+*/
+void Encrypt_Payload_Key(unsigned char *Data, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction, unsigned char *Key, unsigned char *Dev_Addr)
+{
+	unsigned char i = 0x00;
+	unsigned char j;
+	unsigned char Number_of_Blocks = 0x00;
+	unsigned char Incomplete_Block_Size = 0x00;
+
+	unsigned char Block_A[16];
+
+	//Calculate number of blocks
+	Number_of_Blocks = Data_Length / 16;
+	Incomplete_Block_Size = Data_Length % 16;
+	if(Incomplete_Block_Size != 0)
+	{
+		Number_of_Blocks++;
+	}
+
+	for(i = 1; i <= Number_of_Blocks; i++)
+	{
+		Block_A[0] = 0x01;
+		Block_A[1] = 0x00;
+		Block_A[2] = 0x00;
+		Block_A[3] = 0x00;
+		Block_A[4] = 0x00;
+
+		Block_A[5] = Direction;
+
+		Block_A[6] = Dev_Addr[3];
+		Block_A[7] = Dev_Addr[2];
+		Block_A[8] = Dev_Addr[1];
+		Block_A[9] = Dev_Addr[0];
+
+		Block_A[10] = (Frame_Counter & 0x00FF);
+		Block_A[11] = ((Frame_Counter >> 8) & 0x00FF);
+
+		Block_A[12] = 0x00; //Frame counter upper Bytes
+		Block_A[13] = 0x00;
+
+		Block_A[14] = 0x00;
+
+		Block_A[15] = i;
+
+		//Calculate S
+		AES_Encrypt(Block_A,Key);
+
+		//Check for last block
+		if(i != Number_of_Blocks)
+		{
+			for(j = 0; j < 16; j++)
+			{
+				*Data = *Data ^ Block_A[j];
+				Data++;
+			}
+		}
+		else
+		{
+			if(Incomplete_Block_Size == 0)
+			{
+				Incomplete_Block_Size = 16;
+			}
+			for(j = 0; j < Incomplete_Block_Size; j++)
+			{
+				*Data = *Data ^ Block_A[j];
+				Data++;
+			}
+		}
+	}
+}
+
+/*
+*****************************************************************************************
+* Description : Calculates the LoRaWAN MIC of Data with the NwkSkey. The K1/K2 subkeys are
+*               kept in a static MIC context and only derived again when NwkSkey changes
+*****************************************************************************************
+*/
+void Calculate_MIC(unsigned char *Data, unsigned char *Final_MIC, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction)
+{
+	static MIC_Context NwkSkey_MIC;
+	static unsigned char NwkSkey_MIC_Valid = 0;
+	unsigned char i;
+
+	//Derive K1 and K2 only for the first call or for a new NwkSkey
+	if(NwkSkey_MIC_Valid == 1)
+	{
+		for(i = 0; i < 16; i++)
+		{
+			if(NwkSkey_MIC.Key[i] != NwkSkey[i])
+			{
+				NwkSkey_MIC_Valid = 0;
+				break;
+			}
+		}
+	}
+
+	if(NwkSkey_MIC_Valid == 0)
+	{
+		MIC_Init(&NwkSkey_MIC, NwkSkey);
+		NwkSkey_MIC_Valid = 1;
+	}
+
+	MIC_Start(&NwkSkey_MIC, DevAddr, Data_Length, Frame_Counter, Direction);
+	MIC_Update(&NwkSkey_MIC, Data, Data_Length);
+	MIC_Final(&NwkSkey_MIC, Final_MIC);
+}
+
+/*
+*****************************************************************************************
+* Description : Stores the key and derives the K1 and K2 subkeys of the MIC context.
+*               Only needs to be called again when the key changes
+*
+* Arguments   : *Ctx    MIC context
+*               *Key    16 byte long key (NwkSkey)
+*****************************************************************************************
+*/
+void MIC_Init(MIC_Context *Ctx, unsigned char *Key)
+{
+	unsigned char i;
+
+	for(i = 0; i < 16; i++)
+	{
+		Ctx->Key[i] = Key[i];
+	}
+
+	Generate_Subkeys(Ctx->Key, Ctx->Key_K1, Ctx->Key_K2);
+
+	Ctx->Block_Fill = 0;
+}
+
+/*
+*****************************************************************************************
+* Description : Starts a new MIC calculation by processing Block B0
+*
+* Arguments   : *Ctx            MIC context initialized with MIC_Init
+*               *Dev_Addr       4 byte long device address, msb first
+*               Data_Length     total number of bytes that will be given to MIC_Update
+*               Frame_Counter   frame counter
+*               Direction       0x00 for uplink, 0x01 for downlink
+*****************************************************************************************
+*/
+void MIC_Start(MIC_Context *Ctx, unsigned char *Dev_Addr, unsigned char Data_Length, unsigned int Frame_Counter, unsigned char Direction)
+{
+	unsigned char *Block_B = Ctx->Old_Data;
+
+	//Create Block_B
+	Block_B[0] = 0x49;
+	Block_B[1] = 0x00;
+	Block_B[2] = 0x00;
+	Block_B[3] = 0x00;
+	Block_B[4] = 0x00;
+
+	Block_B[5] = Direction;
+
+	Block_B[6] = Dev_Addr[3];
+	Block_B[7] = Dev_Addr[2];
+	Block_B[8] = Dev_Addr[1];
+	Block_B[9] = Dev_Addr[0];
+
+	Block_B[10] = (Frame_Counter & 0x00FF);
+	Block_B[11] = ((Frame_Counter >> 8) & 0x00FF);
+
+	Block_B[12] = 0x00; //Frame counter upper bytes
+	Block_B[13] = 0x00;
+
+	Block_B[14] = 0x00;
+	Block_B[15] = Data_Length;
+
+	//Preform AES encryption on Block B0, result is the first chaining value
+	AES_Encrypt(Block_B,Ctx->Key);
+
+	Ctx->Block_Fill = 0;
+}
+
+/*
+*****************************************************************************************
+* Description : Adds Data to the MIC calculation. Can be called several times, e.g. once
+*               for the header and once for the payload, the data is not copied
+*
+* Arguments   : *Ctx            MIC context started with MIC_Start
+*               *Data           data to add
+*               Data_Length     number of bytes in Data
+*****************************************************************************************
+*/
+void MIC_Update(MIC_Context *Ctx, unsigned char *Data, unsigned char Data_Length)
+{
+	unsigned char i;
+
+	while(Data_Length > 0)
+	{
+		//The last block needs K1 or K2, so a full block is only processed when more data follows
+		if(Ctx->Block_Fill == 16)
+		{
+			XOR(Ctx->New_Data,Ctx->Old_Data);
+			AES_Encrypt(Ctx->New_Data,Ctx->Key);
+
+			//Copy New_Data to Old_Data
+			for(i = 0; i < 16; i++)
+			{
+				Ctx->Old_Data[i] = Ctx->New_Data[i];
+			}
+
+			Ctx->Block_Fill = 0;
+		}
+
+		Ctx->New_Data[Ctx->Block_Fill] = *Data;
+		Ctx->Block_Fill++;
+		Data++;
+		Data_Length--;
+	}
+}
+
+/*
+*****************************************************************************************
+* Description : Processes the last block and returns the 4 byte MIC
+*
+* Arguments   : *Ctx            MIC context
+*               *Final_MIC      4 byte long array receiving the MIC
+*****************************************************************************************
+*/
+void MIC_Final(MIC_Context *Ctx, unsigned char *Final_MIC)
+{
+	unsigned char i;
+
+	//Check if the last block is complete
+	if(Ctx->Block_Fill == 16)
+	{
+		//Preform XOR with Key 1
+		XOR(Ctx->New_Data,Ctx->Key_K1);
+	}
+	else
+	{
+		//Pad the remaining bytes
+		Ctx->New_Data[Ctx->Block_Fill] = 0x80;
+		for(i = Ctx->Block_Fill + 1; i < 16; i++)
+		{
+			Ctx->New_Data[i] = 0x00;
+		}
+
+		//Preform XOR with Key 2
+		XOR(Ctx->New_Data,Ctx->Key_K2);
+	}
+
+	//Preform XOR with old data
+	XOR(Ctx->New_Data,Ctx->Old_Data);
+
+	//Preform last AES routine
+	AES_Encrypt(Ctx->New_Data,Ctx->Key);
+
+	Final_MIC[0] = Ctx->New_Data[0];
+	Final_MIC[1] = Ctx->New_Data[1];
+	Final_MIC[2] = Ctx->New_Data[2];
+	Final_MIC[3] = Ctx->New_Data[3];
+
+	Ctx->Block_Fill = 0;
+}
+
+void Generate_Keys(unsigned char *K1, unsigned char *K2)
+{
+	Generate_Subkeys(NwkSkey, K1, K2);
+}
+
+void Generate_Subkeys(unsigned char *Key, unsigned char *K1, unsigned char *K2)
+{
+	unsigned char i;
+
+	//Encrypt zeros with the Key
+	for(i = 0; i < 16; i++)
+	{
+		K1[i] = 0x00;
+	}
+
+	AES_Encrypt(K1,Key);
+
+	//Create K1: shift K1 one bit left and XOR with 0x87 if MSB was 1
+	i = K1[0] & 0x80;
+	Shift_Left(K1);
+	if(i == 0x80)
+	{
+		K1[15] = K1[15] ^ 0x87;
+	}
+
+	//Create K2 from K1 in the same way
+	for(i = 0; i < 16; i++)
+	{
+		K2[i] = K1[i];
+	}
+
+	i = K2[0] & 0x80;
+	Shift_Left(K2);
+	if(i == 0x80)
+	{
+		K2[15] = K2[15] ^ 0x87;
+	}
+}
+
+void Shift_Left(unsigned char *Data)
+{
+	unsigned char i;
+
+	//Shift one left, carrying the upper bit of the next byte
+	for(i = 0; i < 15; i++)
+	{
+		Data[i] = (Data[i] << 1) | (Data[i+1] >> 7);
+	}
+
+	Data[15] = Data[15] << 1;
+}
+
+void XOR(unsigned char *New_Data,unsigned char *Old_Data)
+{
+	unsigned char i;
+
+	for(i = 0; i < 16; i++)
+	{
+		New_Data[i] = New_Data[i] ^ Old_Data[i];
+	}
+}
+
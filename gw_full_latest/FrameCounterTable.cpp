@@ -0,0 +1,289 @@
+/*
+ *  Persistent per-node frame counter table for the low-level gateway
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FrameCounterTable.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+FrameCounterTable::FrameCounterTable() {
+  _map=NULL;
+  _mapSize=0;
+  _logfd=-1;
+  _seq=0;
+  _header=NULL;
+  _records=NULL;
+}
+
+FrameCounterTable::~FrameCounterTable() {
+  close();
+}
+
+int FrameCounterTable::open(const char* path) {
+
+  struct stat st;
+  char logPath[300];
+
+  close();
+
+  uint32_t size=sizeof(frameCounterTableHeader)+((uint32_t)1 << FCNT_TABLE_SLOT_BITS)*sizeof(frameCounterRecord);
+
+  int fd=::open(path, O_RDWR | O_CREAT, 0644);
+
+  if (fd<0)
+    return 1;
+
+  if (fstat(fd, &st)<0) {
+    ::close(fd);
+    return 1;
+  }
+
+  bool created=(st.st_size==0);
+
+  // a new file reads as zeros, i.e. an empty table
+  if (created && (ftruncate(fd, size)<0 || fsync(fd)<0)) {
+    ::close(fd);
+    return 1;
+  }
+
+  if (!created && st.st_size!=(off_t)size) {
+    ::close(fd);
+    return 2;
+  }
+
+  void* map=mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if (map==MAP_FAILED)
+    return 1;
+
+  frameCounterTableHeader* header=(frameCounterTableHeader*)map;
+
+  // a run stopped between ftruncate() and the header leaves an empty table without header
+  if (!created && header->magic==0 && header->count==0 && header->checkpointSeq==0)
+    created=true;
+
+  if (!created && (header->magic!=FCNT_TABLE_MAGIC || header->version!=FCNT_TABLE_VERSION ||
+                   header->slotBits!=FCNT_TABLE_SLOT_BITS)) {
+    munmap(map, size);
+    return 2;
+  }
+
+  snprintf(logPath, sizeof(logPath), "%s.wal", path);
+
+  _logfd=::open(logPath, O_RDWR | O_CREAT, 0644);
+
+  // the records of a log left by a previous table have sequence numbers above the checkpoint of the new
+  // table, they are erased before the new header is written. The log is preallocated so that fdatasync()
+  // never has to update the file size
+  if (_logfd<0 || fstat(_logfd, &st)<0 || (created && st.st_size && ftruncate(_logfd, 0)<0) ||
+      ((created || st.st_size<(off_t)(FCNT_WAL_RECORDS*sizeof(frameCounterLogRecord))) &&
+       (ftruncate(_logfd, FCNT_WAL_RECORDS*sizeof(frameCounterLogRecord))<0 || fsync(_logfd)<0))) {
+    if (_logfd>=0)
+      ::close(_logfd);
+    _logfd=-1;
+    munmap(map, size);
+    return 1;
+  }
+
+  if (created) {
+    header->magic=FCNT_TABLE_MAGIC;
+    header->version=FCNT_TABLE_VERSION;
+    header->slotBits=FCNT_TABLE_SLOT_BITS;
+    msync(map, size, MS_SYNC);
+  }
+
+  _map=map;
+  _mapSize=size;
+  _header=header;
+  _records=(frameCounterRecord*)((uint8_t*)map+sizeof(frameCounterTableHeader));
+  _seq=header->checkpointSeq;
+
+  replayLog();
+
+  return 0;
+}
+
+void FrameCounterTable::close() {
+
+  if (_map) {
+    checkpoint();
+    munmap(_map, _mapSize);
+  }
+
+  if (_logfd>=0)
+    ::close(_logfd);
+
+  _map=NULL;
+  _mapSize=0;
+  _logfd=-1;
+  _seq=0;
+  _header=NULL;
+  _records=NULL;
+}
+
+uint16_t FrameCounterTable::logCheck(const frameCounterLogRecord* r) {
+
+  // Fletcher-16 over the record without the check field
+  const uint8_t* p=(const uint8_t*)r;
+  uint16_t s1=0, s2=0;
+
+  for (uint8_t i=0; i<sizeof(frameCounterLogRecord)-sizeof(r->check); i++) {
+    s1=(s1+p[i]) % 255;
+    s2=(s2+s1) % 255;
+  }
+
+  return (s2 << 8) | s1;
+}
+
+void FrameCounterTable::replayLog() {
+
+  frameCounterLogRecord log[FCNT_WAL_RECORDS];
+  frameCounterLogRecord* pending[FCNT_WAL_RECORDS];
+  uint16_t n=0;
+
+  if (pread(_logfd, log, sizeof(log), 0)!=(ssize_t)sizeof(log))
+    return;
+
+  for (uint16_t i=0; i<FCNT_WAL_RECORDS; i++) {
+
+    // records up to the checkpoint are already in the table, the others were written after it
+    if ((int32_t)(log[i].seq-_header->checkpointSeq)<=0 || log[i].check!=logCheck(&log[i]))
+      continue;
+
+    // keep them sorted by sequence number, there are at most FCNT_WAL_RECORDS of them
+    uint16_t j=n++;
+
+    for ( ; j>0 && (int32_t)(pending[j-1]->seq-log[i].seq)>0; j--)
+      pending[j]=pending[j-1];
+
+    pending[j]=&log[i];
+  }
+
+  for (uint16_t i=0; i<n; i++) {
+    update(pending[i]->kind, pending[i]->addr, pending[i]->fcnt);
+    _seq=pending[i]->seq;
+  }
+
+  checkpoint();
+}
+
+frameCounterRecord* FrameCounterTable::find(uint8_t kind, uint32_t addr) const {
+
+  uint32_t mask=((uint32_t)1 << FCNT_TABLE_SLOT_BITS)-1;
+  // same Knuth multiplicative hash as the key store
+  uint32_t i=(uint32_t)((addr^kind)*2654435761U) >> (32-FCNT_TABLE_SLOT_BITS);
+
+  // the table is never more than 3/4 full so there is always an empty slot ending the probe
+  while (_records[i].kind) {
+
+    if (_records[i].addr==addr && _records[i].kind==kind)
+      return _records+i;
+
+    i=(i+1) & mask;
+  }
+
+  return _records+i;
+}
+
+bool FrameCounterTable::update(uint8_t kind, uint32_t addr, uint32_t fcnt) {
+
+  frameCounterRecord* r=find(kind, addr);
+
+  if (!r->kind) {
+
+    if (_header->count >= 3*((uint32_t)1 << FCNT_TABLE_SLOT_BITS)/4)
+      return false;
+
+    r->addr=addr;
+    r->kind=kind;
+    _header->count++;
+  }
+
+  r->fcnt=fcnt;
+  r->accepted++;
+
+  return true;
+}
+
+bool FrameCounterTable::check(uint8_t kind, uint32_t addr, uint32_t fcnt) {
+
+  if (!_map)
+    return true;
+
+  uint32_t mask=(kind==FCNT_KIND_NATIVE) ? 0xFF : 0xFFFF;
+  frameCounterRecord* r=find(kind, addr);
+
+  fcnt&=mask;
+
+  if (r->kind) {
+    // the counter wraps, so it must be ahead of the last one by less than half the range
+    uint32_t diff=(fcnt-r->fcnt) & mask;
+
+    if (diff==0 || diff>mask/2)
+      return false;
+  }
+
+  // never overwrite a log record that is not in the table yet
+  if (_seq-_header->checkpointSeq >= FCNT_WAL_RECORDS)
+    checkpoint();
+
+  frameCounterLogRecord l;
+
+  memset(&l, 0, sizeof(l));
+  l.seq=++_seq;
+  l.addr=addr;
+  l.fcnt=fcnt;
+  l.kind=kind;
+  l.check=logCheck(&l);
+
+  // the counter is durable before the frame is forwarded
+  if (pwrite(_logfd, &l, sizeof(l), (l.seq % FCNT_WAL_RECORDS)*sizeof(l))==(ssize_t)sizeof(l))
+    fdatasync(_logfd);
+
+  update(kind, addr, fcnt);
+
+  return true;
+}
+
+long FrameCounterTable::lastCounter(uint8_t kind, uint32_t addr) const {
+
+  if (!_map)
+    return -1;
+
+  frameCounterRecord* r=find(kind, addr);
+
+  return r->kind ? (long)r->fcnt : -1;
+}
+
+void FrameCounterTable::checkpoint() {
+
+  if (!_map || _seq==_header->checkpointSeq)
+    return;
+
+  // the records must be on storage before the header says so
+  msync(_map, _mapSize, MS_SYNC);
+
+  _header->checkpointSeq=_seq;
+  msync(_map, sizeof(frameCounterTableHeader), MS_SYNC);
+}
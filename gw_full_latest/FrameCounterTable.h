@@ -0,0 +1,123 @@
+/*
+ *  Persistent per-node frame counter table for the low-level gateway
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  The table keeps the last accepted frame counter of each node so that
+ *  replayed or duplicated frames can be dropped, also across restarts.
+ *
+ *  The table file is a 64-byte header followed by an open addressing hash
+ *  table (linear probing) of 16-byte records. It is mapped read-write and
+ *  updated in place, but only written back to the SD card by checkpoint(),
+ *  which the gateway calls periodically.
+ *
+ *  Every accepted counter is first written to the write-ahead log <table>.wal,
+ *  a preallocated file of FCNT_WAL_RECORDS records used as a ring and synced
+ *  with fdatasync(), i.e. one page write and no metadata update per frame.
+ *  checkpoint() msyncs the table then records in the header the sequence
+ *  number of the last log record it contains. On open(), the log records
+ *  that are more recent than the checkpoint are applied again, so a power
+ *  loss at any time loses no accepted counter.
+ */
+
+#ifndef FRAME_COUNTER_TABLE_H
+#define FRAME_COUNTER_TABLE_H
+
+#include <stdint.h>
+
+#define FCNT_TABLE_MAGIC          0x54434647  // "GFCT"
+#define FCNT_TABLE_VERSION        1
+
+// 4096 slots, 64KB, for up to 3072 nodes
+#define FCNT_TABLE_SLOT_BITS      12
+// 256 records, the log is exactly one 4KB page
+#define FCNT_WAL_RECORDS          256
+
+// native frames carry an 8-bit sequence number, LoRaWAN frames the 16 LSB of FCnt
+#define FCNT_KIND_NATIVE          1
+#define FCNT_KIND_LORAWAN         2
+
+struct frameCounterTableHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotBits;
+  uint32_t count;
+  // sequence number of the last log record contained in the table
+  uint32_t checkpointSeq;
+  uint8_t reserved[44];
+};
+
+struct frameCounterRecord {
+  uint32_t addr;
+  // 0 for an empty slot
+  uint8_t kind;
+  uint8_t reserved[3];
+  uint32_t fcnt;
+  uint32_t accepted;
+};
+
+struct frameCounterLogRecord {
+  uint32_t seq;
+  uint32_t addr;
+  uint32_t fcnt;
+  uint8_t kind;
+  uint8_t reserved;
+  uint16_t check;
+};
+
+class FrameCounterTable {
+
+public:
+  FrameCounterTable();
+  ~FrameCounterTable();
+
+  // create the table if needed and replay the log
+  // return 0 on success, 1 if the files cannot be created, 2 if the table is not valid
+  int open(const char* path);
+  void close();
+
+  // return false if fcnt is not more recent than the last accepted counter of the node
+  // otherwise log the new counter and return true, a new node is always accepted
+  bool check(uint8_t kind, uint32_t addr, uint32_t fcnt);
+
+  // return the last accepted counter of the node, -1 if unknown
+  long lastCounter(uint8_t kind, uint32_t addr) const;
+
+  // write the table back to storage if counters were accepted since the last checkpoint
+  void checkpoint();
+
+  uint32_t count() const { return _header ? _header->count : 0; }
+  uint32_t pending() const { return _header ? _seq-_header->checkpointSeq : 0; }
+
+private:
+  frameCounterRecord* find(uint8_t kind, uint32_t addr) const;
+  bool update(uint8_t kind, uint32_t addr, uint32_t fcnt);
+  void replayLog();
+
+  static uint16_t logCheck(const frameCounterLogRecord* r);
+
+  void* _map;
+  uint32_t _mapSize;
+  int _logfd;
+  // sequence number of the last log record written
+  uint32_t _seq;
+  frameCounterTableHeader* _header;
+  frameCounterRecord* _records;
+};
+
+#endif
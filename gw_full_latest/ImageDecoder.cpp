@@ -0,0 +1,787 @@
+/*
+ *  In-memory decoder of the image packets for the low-level gateway
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ImageDecoder.h"
+
+// the MQ decoder of decode_to_bmp, only included here
+#include "ucam-images/mqc.h"
+// the PNG and JPEG encoders, only included here
+#include "ucam-images/web_image.h"
+
+// see decode_to_bmp.c
+#define CR_PACKET_FLAG            0x8000
+#define FEC_PACKET_FLAG           0x7000
+#define FEC_MAX_PARITY            8
+#define PROGRESSIVE_SCANS         5
+
+static const uint8_t progressiveBands[PROGRESSIVE_SCANS+1]={0, 1, 6, 15, 28, 64};
+
+// natural index of the zig-zag order
+static const uint8_t zigzag[64]={
+   0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+static const uint8_t luminanceTable[64]={
+  16,  11,  10,  16,  24,  40,  51,  61,
+  12,  12,  14,  19,  26,  58,  60,  55,
+  14,  13,  16,  24,  40,  57,  69,  56,
+  14,  17,  22,  29,  51,  87,  80,  62,
+  18,  22,  37,  56,  68, 109, 103,  77,
+  24,  35,  55,  64,  81, 104, 113,  92,
+  49,  64,  78,  87, 103, 121, 120, 101,
+  72,  92,  95,  98, 112, 100, 103,  99};
+
+// the unary part of a value cannot be longer in a valid packet, a corrupted packet must not
+// keep the gateway decoding
+#define MAX_UNARY                 4096
+
+// GF(256) with x^8+x^4+x^3+x^2+1, as packet_fec.h
+static uint8_t gfExp[512];
+static uint8_t gfLog[256];
+
+static void gfInit() {
+
+  unsigned int x=1;
+
+  for (int i=0; i<255; i++) {
+    gfExp[i]=gfExp[i+255]=x;
+    gfLog[x]=i;
+    x<<=1;
+
+    if (x & 0x100)
+      x^=0x11D;
+  }
+}
+
+static inline uint8_t gfMul(uint8_t a, uint8_t b) {
+  return (a==0 || b==0) ? 0 : gfExp[gfLog[a]+gfLog[b]];
+}
+
+static inline uint8_t gfInv(uint8_t a) {
+  return gfExp[255-gfLog[a]];
+}
+
+// Cauchy matrix of the parity packets
+static inline uint8_t fecCoef(uint8_t j, uint8_t i) {
+  return gfInv((0x80+j)^i);
+}
+
+// byte t of the vector [size, data...] of a data packet
+static inline uint8_t fecVector(const imagePacket* p, int t) {
+  return t==0 ? p->size : (t<=p->size ? p->data[t-1] : 0);
+}
+
+static unsigned int golomb(opj_mqc_t* mqc, unsigned int maxUnary=MAX_UNARY) {
+
+  unsigned int q=mqc_decode_unary(mqc, maxUnary);
+
+  return q*2+mqc_decode(mqc);
+}
+
+ImageDecoder::ImageDecoder() :
+  _nresults(0), _SN(0), _vflip(false), _timeout(IMG_TIMEOUT), _preview(0), _format(IMG_FORMAT_BMP), _webQuality(WEB_IMAGE_JPEG_QUALITY),
+  _nextPreview(0), _quality(0) {
+
+  _slots=(imageSlot*)calloc(IMG_MAX_IMAGES, sizeof(imageSlot));
+  _cameras=(cameraImage*)calloc(IMG_MAX_CAMERAS, sizeof(cameraImage));
+  _packets=(imagePacket*)calloc(IMG_MAX_IMAGES*IMG_MAX_PACKETS, sizeof(imagePacket));
+
+  for (int i=0; _slots && _packets && i<IMG_MAX_IMAGES; i++)
+    _slots[i].packets=_packets+i*IMG_MAX_PACKETS;
+
+  strcpy(_folder, ".");
+  gfInit();
+}
+
+ImageDecoder::~ImageDecoder() {
+  free(_slots);
+  free(_cameras);
+  free(_packets);
+}
+
+void ImageDecoder::setFolder(const char* folder) {
+  snprintf(_folder, sizeof(_folder), "%s", folder);
+}
+
+bool ImageDecoder::isImagePacket(const uint8_t* data, int len) {
+  return len>=IMG_HEADER_SIZE+2 && data[0]==0xFF && data[1]>=IMG_FLOW_ID && data[1]<IMG_FLOW_ID+IMG_MAX_CAM;
+}
+
+int ImageDecoder::receiving() const {
+
+  int n=0;
+
+  for (int i=0; _slots && i<IMG_MAX_IMAGES; i++)
+    n+=_slots[i].used;
+
+  return n;
+}
+
+imageSlot* ImageDecoder::findSlot(uint16_t src, uint8_t cam) {
+
+  for (int i=0; i<IMG_MAX_IMAGES; i++)
+    if (_slots[i].used && _slots[i].src==src && _slots[i].cam==cam)
+      return &_slots[i];
+
+  return NULL;
+}
+
+cameraImage* ImageDecoder::findCamera(uint16_t src, uint8_t cam, bool create) {
+
+  cameraImage* camera=NULL;
+
+  for (int i=0; i<IMG_MAX_CAMERAS; i++)
+    if (_cameras[i].used && _cameras[i].src==src && _cameras[i].cam==cam)
+      return &_cameras[i];
+
+  if (!create)
+    return NULL;
+
+  // a free entry, otherwise the camera with the oldest image
+  for (int i=0; i<IMG_MAX_CAMERAS && (!camera || camera->used); i++)
+    if (!camera || !_cameras[i].used || _cameras[i].lastTime<camera->lastTime)
+      camera=&_cameras[i];
+
+  camera->used=true;
+  camera->src=src;
+  camera->cam=cam;
+  // no image yet
+  camera->lastTime=0;
+
+  return camera;
+}
+
+bool ImageDecoder::addPacket(const uint8_t* data, int len, unsigned long now) {
+
+  if (!_slots || !_cameras || !_packets || !isImagePacket(data, len) || len-IMG_HEADER_SIZE-2>IMG_MAX_PACKET_SIZE)
+    return false;
+
+  uint8_t cam=data[1]-IMG_FLOW_ID;
+  uint16_t src=data[2] << 8 | data[3];
+  uint8_t seq=data[4];
+  uint8_t Q=data[5];
+  uint16_t offset=data[IMG_HEADER_SIZE] << 8 | data[IMG_HEADER_SIZE+1];
+  const uint8_t* mq=data+IMG_HEADER_SIZE+2;
+  int size=len-IMG_HEADER_SIZE-2;
+
+  imageSlot* slot=findSlot(src, cam);
+
+  // the sequence number starts again at 0 with each image
+  if (slot && (seq<=slot->lastSeq || Q!=slot->Q)) {
+    finish(slot);
+    slot=NULL;
+  }
+
+  if (!slot) {
+    for (int i=0; i<IMG_MAX_IMAGES && !slot; i++)
+      if (!_slots[i].used)
+        slot=&_slots[i];
+
+    // too many images at the same time, the oldest one is finished
+    if (!slot) {
+      for (int i=0; i<IMG_MAX_IMAGES; i++)
+        if (!slot || _slots[i].lastTime<slot->lastTime)
+          slot=&_slots[i];
+
+      finish(slot);
+    }
+
+    slot->used=true;
+    // numbered in the order of their first packet, as post_processing_gw.py
+    slot->SN=_SN++;
+    slot->src=src;
+    slot->cam=cam;
+    slot->Q=Q;
+    slot->npkt=0;
+    slot->totalsize=0;
+    slot->replenishment=false;
+    slot->nbReceivedBlocks=0;
+    slot->npackets=0;
+    slot->newBlocks=false;
+    slot->previewed=false;
+    memset(slot->blockState, 0, sizeof(slot->blockState));
+    memset(slot->coefs, 0, sizeof(slot->coefs));
+  }
+
+  slot->lastSeq=seq;
+  slot->lastTime=now;
+
+  // kept for the parity packets
+  if (slot->npackets<IMG_MAX_PACKETS) {
+    imagePacket* p=&slot->packets[slot->npackets++];
+
+    p->offset=offset;
+    p->size=size;
+    memcpy(p->data, mq, size);
+  }
+
+  if ((offset & 0xF000)!=FEC_PACKET_FLAG) {
+    decodePacket(slot, mq, size, offset);
+    slot->newBlocks=true;
+  }
+
+  return true;
+}
+
+// JPEGdepacketization() of decode_to_bmp.c, into the coefficients of the image
+void ImageDecoder::decodePacket(imageSlot* slot, const uint8_t* data, int size, uint16_t offset) {
+
+  uint8_t buffer[IMG_MAX_PACKET_SIZE];
+  opj_mqc_t mqobjet;
+  opj_mqc_t* objet=&mqobjet;
+  unsigned int BlockOffset=offset;
+  unsigned int K;
+  int blocksInPacket=0;
+
+  slot->npkt++;
+  slot->totalsize+=size;
+
+  bool skipping=(BlockOffset & CR_PACKET_FLAG)!=0;
+
+  if (skipping) {
+    slot->replenishment=true;
+    BlockOffset&=~CR_PACKET_FLAG;
+  }
+
+  // only one band of coefficients of the blocks, the others are kept
+  unsigned int scan=(BlockOffset >> 12) & 0x7;
+  unsigned int first=0, last=64;
+
+  if (scan) {
+    if (scan>PROGRESSIVE_SCANS || size<1)
+      return;
+
+    first=progressiveBands[scan-1];
+    last=progressiveBands[scan];
+    BlockOffset&=0x0FFF;
+  }
+
+  memcpy(buffer, data, size);
+
+  // the progressive packets start with their number of blocks
+  if (scan) {
+    blocksInPacket=buffer[0];
+    mqc_init_dec(objet, buffer+1, size-1);
+  }
+  else
+    mqc_init_dec(objet, buffer, size);
+
+  mqc_resetstates(objet);
+
+  // the last block of a packet with whole blocks is decoded after the end of its data, it is
+  // only kept until the block is decoded from its own packet, in any order of the packets
+  for (bool tail=false; ; ) {
+    if (!tail && !(scan ? blocksInPacket>0 : (skipping || mqc_numbytes(objet)<size))) {
+      if (scan || BlockOffset>=IMG_BLOCKS)
+        return;
+
+      tail=true;
+    }
+
+    // number of unchanged blocks
+    if (skipping && !tail) {
+      unsigned int q=mqc_decode_unary(objet, IMG_BLOCKS);
+
+      BlockOffset+=q*2+mqc_decode(objet);
+    }
+
+    if (BlockOffset>=IMG_BLOCKS)
+      return;
+
+    K=(last-first==1) ? 1 : golomb(objet, tail ? 32 : MAX_UNARY);
+
+    // end of the packet
+    if (skipping && !tail && (K==0 || K>64))
+      return;
+
+    if (K>last-first)
+      return;
+
+    int16_t Block[64];
+
+    for (unsigned int x=first; x<first+K; x++) {
+      unsigned int index=golomb(objet, tail ? 32 : MAX_UNARY);
+
+      Block[x]=(index%2==0) ? index/2 : -(int)((index+1)/2);
+    }
+
+    for (unsigned int x=first+K; x<last; x++)
+      Block[x]=0;
+
+    if (!tail || slot->blockState[BlockOffset]<2) {
+      for (unsigned int x=first; x<last; x++)
+        slot->coefs[BlockOffset][zigzag[x]]=Block[x];
+
+      if (slot->blockState[BlockOffset]==0)
+        slot->nbReceivedBlocks++;
+
+      slot->blockState[BlockOffset]=tail ? 1 : 2;
+    }
+
+    if (tail)
+      return;
+
+    BlockOffset++;
+    blocksInPacket--;
+  }
+}
+
+// FECdecoding() of decode_to_bmp.c, the recovered packets are decoded
+void ImageDecoder::recoverPackets(imageSlot* slot, imageDecoderResult* result) {
+
+  static uint8_t syndrome[FEC_MAX_PARITY][IMG_MAX_PACKET_SIZE+1];
+  uint8_t A[FEC_MAX_PARITY][FEC_MAX_PARITY];
+  int parity[FEC_MAX_PARITY], missing[FEC_MAX_PARITY], received[256];
+  bool groupDone[256];
+  imagePacket* packets=slot->packets;
+  int npackets=slot->npackets;
+
+  memset(groupDone, 0, sizeof(groupDone));
+
+  for (int p=0; p<npackets; p++) {
+    if ((packets[p].offset & 0xF000)!=FEC_PACKET_FLAG || groupDone[packets[p].offset & 0xFF] || packets[p].size<1)
+      continue;
+
+    int group=packets[p].offset & 0xFF;
+    int k=packets[p].data[0];
+    int length=packets[p].size-1-2*k;
+    int nparity=0, nmissing=0;
+
+    groupDone[group]=true;
+
+    if (length<=0)
+      continue;
+
+    for (int q=p; q<npackets && nparity<FEC_MAX_PARITY; q++)
+      if ((packets[q].offset & 0xF000)==FEC_PACKET_FLAG && (packets[q].offset & 0xFF)==group && packets[q].size==packets[p].size)
+        parity[nparity++]=q;
+
+    for (int i=0; i<k; i++) {
+      uint16_t offset=packets[p].data[1+2*i] << 8 | packets[p].data[2+2*i];
+
+      received[i]=-1;
+
+      for (int q=0; q<npackets; q++)
+        if (packets[q].offset==offset && (offset & 0xF000)!=FEC_PACKET_FLAG)
+          received[i]=q;
+
+      if (received[i]<0) {
+        if (nmissing<FEC_MAX_PARITY)
+          missing[nmissing]=i;
+
+        nmissing++;
+      }
+    }
+
+    if (nmissing==0)
+      continue;
+
+    if (nmissing>nparity) {
+      result->nbLostPackets+=nmissing;
+      continue;
+    }
+
+    // the parity minus the received packets, for the first nmissing parity packets
+    for (int r=0; r<nmissing; r++) {
+      const imagePacket* P=&packets[parity[r]];
+      uint8_t j=(P->offset >> 8) & 0xF;
+
+      memcpy(syndrome[r], P->data+1+2*k, length);
+
+      for (int i=0; i<k; i++)
+        if (received[i]>=0) {
+          uint8_t c=fecCoef(j, i);
+
+          for (int t=0; t<length; t++)
+            syndrome[r][t]^=gfMul(c, fecVector(&packets[received[i]], t));
+        }
+
+      for (int c=0; c<nmissing; c++)
+        A[r][c]=fecCoef(j, missing[c]);
+    }
+
+    // Gauss-Jordan elimination, any square sub-matrix of the Cauchy matrix is invertible
+    for (int c=0; c<nmissing; c++) {
+      int pivot=c;
+
+      while (A[pivot][c]==0)
+        pivot++;
+
+      if (pivot!=c) {
+        for (int x=0; x<nmissing; x++) { uint8_t tmp=A[c][x]; A[c][x]=A[pivot][x]; A[pivot][x]=tmp; }
+        for (int t=0; t<length; t++) { uint8_t tmp=syndrome[c][t]; syndrome[c][t]=syndrome[pivot][t]; syndrome[pivot][t]=tmp; }
+      }
+
+      uint8_t inv=gfInv(A[c][c]);
+
+      for (int x=0; x<nmissing; x++)
+        A[c][x]=gfMul(A[c][x], inv);
+
+      for (int t=0; t<length; t++)
+        syndrome[c][t]=gfMul(syndrome[c][t], inv);
+
+      for (int r=0; r<nmissing; r++)
+        if (r!=c && A[r][c]) {
+          uint8_t f=A[r][c];
+
+          for (int x=0; x<nmissing; x++)
+            A[r][x]^=gfMul(f, A[c][x]);
+
+          for (int t=0; t<length; t++)
+            syndrome[r][t]^=gfMul(f, syndrome[c][t]);
+        }
+    }
+
+    for (int c=0; c<nmissing; c++) {
+      int i=missing[c];
+
+      if (syndrome[c][0]>=length) {
+        result->nbLostPackets++;
+        continue;
+      }
+
+      decodePacket(slot, &syndrome[c][1], syndrome[c][0], packets[p].data[1+2*i] << 8 | packets[p].data[2+2*i]);
+      result->nbRecoveredPackets++;
+    }
+  }
+}
+
+void ImageDecoder::initQuantization(uint8_t Q) {
+
+  double Qs;
+  int quality=Q;
+
+  if (quality<=0)
+    quality=1;
+
+  if (quality>100)
+    quality=100;
+
+  Qs=(quality<50) ? 50.0/quality : 2.0-quality/50.0;
+
+  for (int x=0; x<64; x++) {
+    double q=luminanceTable[x]*Qs;
+
+    if (q<1.0)
+      q=1.0;
+
+    if (q>255.0)
+      q=255.0;
+
+    _qt[x]=(int32_t)(q*16+0.5);
+  }
+
+  _quality=Q;
+}
+
+// the IDCT of JPEGdecoding() in decode_to_bmp.c, with 13-bit constants and 2 fractional bits
+#define IDCT_CONST_BITS           13
+#define IDCT_PASS_BITS            2
+#define FIX(x)                    ((int32_t)((x)*(1 << IDCT_CONST_BITS)+((x)<0 ? -0.5 : 0.5)))
+#define MUL(x, c)                 ((int32_t)(((int64_t)(x)*(c)) >> IDCT_CONST_BITS))
+
+#define FIX_a4                    FIX(1.38703984532215)
+#define FIX_a7                    FIX(-0.275899379282943)
+#define FIX_a47                   FIX(0.831469612302545)
+#define FIX_a5                    FIX(1.17587560241936)
+#define FIX_a6                    FIX(-0.785694958387102)
+#define FIX_a56                   FIX(0.98078528040323)
+#define FIX_a2                    FIX(1.84775906502257)
+#define FIX_a3                    FIX(0.765366864730179)
+#define FIX_a23                   FIX(0.541196100146197)
+#define FIX_rc2                   FIX(1.414213562373095)
+
+static void idct8(int32_t* b0, int32_t* b1, int32_t* b2, int32_t* b3, int32_t* b4, int32_t* b5, int32_t* b6, int32_t* b7) {
+
+  int32_t tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+  int32_t tmp10, tmp11, tmp12, tmp13, tmp20, tmp23, tmp;
+
+  // even part
+  tmp0=*b0+*b4;
+  tmp1=*b0-*b4;
+  tmp=MUL(*b2+*b6, FIX_a23);
+  tmp2=tmp-MUL(*b6, FIX_a2);
+  tmp3=tmp+MUL(*b2, FIX_a3);
+
+  tmp10=tmp0+tmp3;
+  tmp13=tmp0-tmp3;
+  tmp11=tmp1+tmp2;
+  tmp12=tmp1-tmp2;
+
+  // odd part
+  tmp0=*b1-*b7;
+  tmp3=*b1+*b7;
+  tmp1=MUL(*b3, FIX_rc2);
+  tmp2=MUL(*b5, FIX_rc2);
+  tmp4=tmp0+tmp2;
+  tmp6=tmp0-tmp2;
+  tmp7=tmp3+tmp1;
+  tmp5=tmp3-tmp1;
+
+  tmp=MUL(tmp4+tmp7, FIX_a47);
+  tmp20=tmp-MUL(tmp7, FIX_a4);
+  tmp23=tmp+MUL(tmp4, FIX_a7);
+  *b0=tmp10+tmp23;
+  *b7=tmp10-tmp23;
+  *b3=tmp13+tmp20;
+  *b4=tmp13-tmp20;
+
+  tmp=MUL(tmp5+tmp6, FIX_a56);
+  tmp20=tmp-MUL(tmp6, FIX_a5);
+  tmp23=tmp+MUL(tmp5, FIX_a6);
+  *b2=tmp12+tmp20;
+  *b5=tmp12-tmp20;
+  *b1=tmp11+tmp23;
+  *b6=tmp11-tmp23;
+}
+
+void ImageDecoder::transform(imageSlot* slot, uint8_t pixels[IMG_HEIGHT][IMG_WIDTH]) {
+
+  int32_t B[8][8];
+
+  if (_quality!=slot->Q)
+    initQuantization(slot->Q);
+
+  for (unsigned int BlockOffset=0; BlockOffset<IMG_BLOCKS; BlockOffset++) {
+    unsigned int row=(BlockOffset*8)/IMG_WIDTH*8;
+    unsigned int col=(BlockOffset*8)%IMG_WIDTH;
+    unsigned int row_mix=((row*5)+(col*8))%IMG_WIDTH;
+    unsigned int col_mix=((row*8)+(col*13))%IMG_HEIGHT;
+    const int16_t* coefs=slot->coefs[BlockOffset];
+
+    for (int x=0; x<64; x++)
+      B[x >> 3][x & 7]=(coefs[x]*_qt[x]+2) >> (4-IDCT_PASS_BITS);
+
+    B[0][0]+=1024 << IDCT_PASS_BITS;
+
+    for (int u=0; u<8; u++)
+      idct8(&B[u][0], &B[u][1], &B[u][2], &B[u][3], &B[u][4], &B[u][5], &B[u][6], &B[u][7]);
+
+    for (int v=0; v<8; v++)
+      idct8(&B[0][v], &B[1][v], &B[2][v], &B[3][v], &B[4][v], &B[5][v], &B[6][v], &B[7][v]);
+
+    // truncated as the pixels written by decode_to_bmp
+    for (int u=0; u<8; u++)
+      for (int v=0; v<8; v++) {
+        int32_t p=B[u][v] >> (3+IDCT_PASS_BITS);
+
+        pixels[row_mix+u][col_mix+v]=p<0 ? 0 : (p>255 ? 255 : p);
+      }
+  }
+}
+
+// the pixels of the image in _pixels, only the changed blocks have been sent when replenishment
+// is set: the others are those of the last image of the camera
+void ImageDecoder::render(imageSlot* slot, cameraImage* camera) {
+
+  transform(slot, _pixels);
+
+  if (slot->replenishment && camera && camera->lastTime)
+    for (unsigned int BlockOffset=0; BlockOffset<IMG_BLOCKS; BlockOffset++)
+      if (!slot->blockState[BlockOffset]) {
+        unsigned int row=(BlockOffset*8)/IMG_WIDTH*8;
+        unsigned int col=(BlockOffset*8)%IMG_WIDTH;
+        unsigned int row_mix=((row*5)+(col*8))%IMG_WIDTH;
+        unsigned int col_mix=((row*8)+(col*13))%IMG_HEIGHT;
+
+        for (int u=0; u<8; u++)
+          memcpy(&_pixels[row_mix+u][col_mix], &camera->pixels[row_mix+u][col_mix], 8);
+      }
+}
+
+// written in a temporary file then renamed, the file is never seen partly written
+int ImageDecoder::writeBitmap(const char* file, uint8_t pixels[IMG_HEIGHT][IMG_WIDTH]) {
+
+  // 8-bit BMP with a gray palette, as 128x128-test.bmp
+  uint8_t header[54+256*4];
+  uint32_t fields[]={ (uint32_t)sizeof(header)+IMG_WIDTH*IMG_HEIGHT, 0, sizeof(header), 40, IMG_WIDTH, IMG_HEIGHT };
+
+  memset(header, 0, sizeof(header));
+  header[0]='B';
+  header[1]='M';
+
+  for (int f=0; f<6; f++)
+    for (int b=0; b<4; b++)
+      header[2+4*f+b]=fields[f] >> (8*b);
+
+  // planes, bits per pixel, compression, image size, resolution and colors
+  header[26]=1;
+  header[28]=8;
+  header[34]=(IMG_WIDTH*IMG_HEIGHT) & 0xFF;
+  header[35]=(IMG_WIDTH*IMG_HEIGHT) >> 8;
+  header[38]=header[42]=2835 & 0xFF;
+  header[39]=header[43]=2835 >> 8;
+  header[47]=header[51]=1;
+
+  for (int i=0; i<256; i++)
+    header[54+4*i]=header[55+4*i]=header[56+4*i]=i;
+
+  char path[sizeof(_folder)+IMG_MAX_FILE+1];
+  char tmpPath[sizeof(path)+4];
+
+  snprintf(path, sizeof(path), "%s/%s", _folder, file);
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+  FILE* f=fopen(tmpPath, "wb");
+
+  if (!f)
+    return -1;
+
+  bool ok=fwrite(header, sizeof(header), 1, f)==1;
+
+  for (int row=0; row<IMG_HEIGHT && ok; row++)
+    ok=fwrite(pixels[_vflip ? row : IMG_HEIGHT-1-row], IMG_WIDTH, 1, f)==1;
+
+  if (fclose(f)!=0 || !ok || rename(tmpPath, path)!=0) {
+    remove(tmpPath);
+    return -1;
+  }
+
+  return 0;
+}
+
+// the PNG or JPEG file and its thumbnail, from the top row of the image
+int ImageDecoder::writeImage(const char* file, uint8_t pixels[IMG_HEIGHT][IMG_WIDTH], bool thumbnail) {
+
+  if (_format==IMG_FORMAT_BMP)
+    return writeBitmap(file, pixels);
+
+  uint8_t top[IMG_HEIGHT][IMG_WIDTH];
+  uint8_t small[IMG_HEIGHT/WEB_IMAGE_THUMBNAIL_SCALE][IMG_WIDTH/WEB_IMAGE_THUMBNAIL_SCALE];
+  char path[sizeof(_folder)+IMG_MAX_FILE+8];
+
+  for (int row=0; row<IMG_HEIGHT; row++)
+    memcpy(top[row], pixels[_vflip ? IMG_HEIGHT-1-row : row], IMG_WIDTH);
+
+  snprintf(path, sizeof(path), "%s/%s", _folder, file);
+
+  if (WriteWebImageFile(path, _format, top[0], IMG_WIDTH, IMG_HEIGHT, _webQuality))
+    return -1;
+
+  if (!thumbnail)
+    return 0;
+
+  // ucam_0-node_0006-cam_0-Q20-P38-S2046-thumb.png
+  snprintf(path, sizeof(path), "%s/%.*s-thumb.%s", _folder, (int)strlen(file)-4, file, WebImageExtension[_format]);
+  WebThumbnail(top[0], IMG_WIDTH, IMG_HEIGHT, WEB_IMAGE_THUMBNAIL_SCALE, small[0]);
+
+  return WriteWebImageFile(path, _format, small[0], IMG_WIDTH/WEB_IMAGE_THUMBNAIL_SCALE, IMG_HEIGHT/WEB_IMAGE_THUMBNAIL_SCALE, _webQuality);
+}
+
+void ImageDecoder::finish(imageSlot* slot) {
+
+  // the oldest result is lost if nextImage() is not called often enough
+  if (_nresults==IMG_MAX_IMAGES) {
+    memmove(_results, _results+1, (IMG_MAX_IMAGES-1)*sizeof(imageDecoderResult));
+    _nresults--;
+  }
+
+  imageDecoderResult* result=&_results[_nresults++];
+
+  memset(result, 0, sizeof(imageDecoderResult));
+  result->SN=slot->SN;
+  result->src=slot->src;
+  result->cam=slot->cam;
+  result->Q=slot->Q;
+
+  recoverPackets(slot, result);
+
+  cameraImage* camera=findCamera(slot->src, slot->cam, true);
+
+  render(slot, camera);
+  memcpy(camera->pixels, _pixels, sizeof(_pixels));
+  // 0 until the camera has an image
+  camera->lastTime=slot->lastTime ? slot->lastTime : 1;
+
+  result->npkt=slot->npkt;
+  result->totalsize=slot->totalsize;
+  result->nbReceivedBlocks=slot->nbReceivedBlocks;
+  result->replenishment=slot->replenishment;
+
+  snprintf(result->file, sizeof(result->file), "ucam_%d-node_%04X-cam_%d-Q%d-P%d-S%d.%s",
+           result->SN, result->src, result->cam, result->Q, result->npkt, result->totalsize, WebImageExtension[_format]);
+  result->error=writeImage(result->file, _pixels, true);
+  slot->used=false;
+}
+
+bool ImageDecoder::nextPreview(unsigned long now, imageDecoderResult* result) {
+
+  if (!_preview || !_slots || !_cameras || !_packets)
+    return false;
+
+  for (int i=0; i<IMG_MAX_IMAGES; i++) {
+    imageSlot* slot=&_slots[(_nextPreview+i)%IMG_MAX_IMAGES];
+
+    if (!slot->used || !slot->newBlocks || (slot->previewed && now-slot->previewTime<_preview))
+      continue;
+
+    // the images being received get their preview in turn
+    _nextPreview=(_nextPreview+i+1)%IMG_MAX_IMAGES;
+
+    memset(result, 0, sizeof(imageDecoderResult));
+    result->SN=slot->SN;
+    result->src=slot->src;
+    result->cam=slot->cam;
+    result->Q=slot->Q;
+    result->npkt=slot->npkt;
+    result->totalsize=slot->totalsize;
+    result->nbReceivedBlocks=slot->nbReceivedBlocks;
+    result->replenishment=slot->replenishment;
+    result->preview=true;
+
+    render(slot, findCamera(slot->src, slot->cam, false));
+
+    snprintf(result->file, sizeof(result->file), "ucam_%d-node_%04X-cam_%d-Q%d-preview.%s",
+             result->SN, result->src, result->cam, result->Q, WebImageExtension[_format]);
+
+    result->error=writeImage(result->file, _pixels, false);
+    slot->newBlocks=false;
+    slot->previewed=true;
+    slot->previewTime=now;
+
+    return true;
+  }
+
+  return false;
+}
+
+bool ImageDecoder::nextImage(unsigned long now, imageDecoderResult* result, bool flush) {
+
+  if (!_slots || !_cameras || !_packets)
+    return false;
+
+  for (int i=0; i<IMG_MAX_IMAGES; i++)
+    if (_slots[i].used && (flush || now-_slots[i].lastTime>=_timeout))
+      finish(&_slots[i]);
+
+  if (!_nresults)
+    return false;
+
+  *result=_results[0];
+  memmove(_results, _results+1, (IMG_MAX_IMAGES-1)*sizeof(imageDecoderResult));
+  _nresults--;
+
+  return true;
+}
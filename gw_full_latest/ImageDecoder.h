@@ -0,0 +1,200 @@
+/*
+ *  In-memory decoder of the image packets for the low-level gateway
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  The packets of the image mode (0xFF 0x50-0x54 src_addr(16b) SN(8b) Q(8b) len(8b),
+ *  see Arduino_LoRa_ucamII) are given as they are received and their blocks are
+ *  decoded right away by the MQ decoder into the quantized coefficients of their
+ *  image, without the .dat file and the decode_to_bmp process of post_processing_gw.py.
+ *
+ *  The packets are decoded as decode_to_bmp does: the whole blocks, the changed
+ *  blocks only (CR_PACKET_FLAG, the other blocks are those of the last image of the
+ *  same camera), the bands of coefficients (PROGRESSIVE_ENCODING) and the lost
+ *  packets recovered by the parity packets (WITH_FEC) when the image is finished.
+ *
+ *  An image is finished when no packet has been received for its camera for
+ *  IMG_TIMEOUT ms or when its camera starts a new image, i.e. a sequence number
+ *  that is not more recent. It is then dequantized, transformed with an integer
+ *  IDCT and written as an 8-bit BMP file named as by decode_to_bmp.
+ *
+ *  With setPreview(), the image that is being received is also written every preview
+ *  ms when new blocks have been decoded, in a file ending with -preview.bmp that
+ *  is replaced each time. The blocks not received yet are gray, or those of the last
+ *  image of the camera for the changed blocks only.
+ *
+ *  With setFormat(), the images are written as PNG or JPEG files instead (see
+ *  ucam-images/web_image.h), with the same names ending with .png or .jpg, and the
+ *  finished images also get a thumbnail ending with -thumb.png or -thumb.jpg.
+ *
+ *  All the memory is allocated by the constructor: IMG_MAX_IMAGES images received
+ *  at the same time and the last image of IMG_MAX_CAMERAS cameras.
+ */
+
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <stdint.h>
+
+#define IMG_WIDTH                 128
+#define IMG_HEIGHT                128
+#define IMG_BLOCKS                (IMG_WIDTH*IMG_HEIGHT/64)
+
+#define IMG_MAX_IMAGES            8
+#define IMG_MAX_CAMERAS           16
+// data and parity packets of an image, for the FEC
+#define IMG_MAX_PACKETS           128
+#define IMG_MAX_PACKET_SIZE       255
+
+// the preamble of the image packets
+#define IMG_HEADER_SIZE           7
+#define IMG_FLOW_ID               0x50
+#define IMG_MAX_CAM               5
+
+#define IMG_TIMEOUT               30000L
+#define IMG_MAX_FILE              64
+
+// as WEB_IMAGE_BMP, WEB_IMAGE_PNG and WEB_IMAGE_JPEG of web_image.h
+#define IMG_FORMAT_BMP            0
+#define IMG_FORMAT_PNG            1
+#define IMG_FORMAT_JPEG           2
+
+struct imagePacket {
+  uint16_t offset;
+  uint8_t size;
+  uint8_t data[IMG_MAX_PACKET_SIZE];
+};
+
+struct imageSlot {
+  bool used;
+  int SN;
+  uint16_t src;
+  uint8_t cam;
+  uint8_t Q;
+  uint8_t lastSeq;
+  unsigned long lastTime;
+  int npkt;
+  int totalsize;
+  bool replenishment;
+  // 0 not received, 1 decoded after the end of a packet, 2 decoded
+  uint8_t blockState[IMG_BLOCKS];
+  int nbReceivedBlocks;
+  // blocks decoded since the last preview
+  bool newBlocks;
+  bool previewed;
+  unsigned long previewTime;
+  // in the interleaved order of the blocks, natural order of the coefficients
+  int16_t coefs[IMG_BLOCKS][64];
+  int npackets;
+  imagePacket* packets;
+};
+
+struct cameraImage {
+  bool used;
+  uint16_t src;
+  uint8_t cam;
+  unsigned long lastTime;
+  uint8_t pixels[IMG_HEIGHT][IMG_WIDTH];
+};
+
+struct imageDecoderResult {
+  int SN;
+  uint16_t src;
+  uint8_t cam;
+  uint8_t Q;
+  int npkt;
+  int totalsize;
+  int nbReceivedBlocks;
+  int nbRecoveredPackets;
+  int nbLostPackets;
+  bool replenishment;
+  // the image is not finished
+  bool preview;
+  // 0 if the image file has been written
+  int error;
+  char file[IMG_MAX_FILE];
+};
+
+class ImageDecoder {
+
+public:
+  ImageDecoder();
+  ~ImageDecoder();
+
+  // where the image files are written, the current directory by default
+  void setFolder(const char* folder);
+  // the first line of the BMP file is the top of the image, as decode_to_bmp -vflip
+  void setVflip(bool vflip) { _vflip=vflip; }
+  void setTimeout(unsigned long timeout) { _timeout=timeout; }
+  // 0 for no preview
+  void setPreview(unsigned long preview) { _preview=preview; }
+  // IMG_FORMAT_BMP by default, the quality is that of the JPEG files, 1 to 100
+  void setFormat(int format, int quality=90) { _format=format; _webQuality=quality; }
+
+  // return true if data is an image packet
+  static bool isImagePacket(const uint8_t* data, int len);
+
+  // decode the blocks of an image packet, the whole packet with its preamble
+  // return false if the packet is not valid
+  bool addPacket(const uint8_t* data, int len, unsigned long now);
+
+  // decode and write the next image that is finished at time now, all the images with flush
+  // return false when there is none
+  bool nextImage(unsigned long now, imageDecoderResult* result, bool flush=false);
+
+  // write the preview of the next image with new blocks at time now
+  // return false when there is none
+  bool nextPreview(unsigned long now, imageDecoderResult* result);
+
+  int receiving() const;
+
+private:
+  imageSlot* findSlot(uint16_t src, uint8_t cam);
+  cameraImage* findCamera(uint16_t src, uint8_t cam, bool create);
+  void finish(imageSlot* slot);
+  void decodePacket(imageSlot* slot, const uint8_t* data, int size, uint16_t offset);
+  void recoverPackets(imageSlot* slot, imageDecoderResult* result);
+  void transform(imageSlot* slot, uint8_t pixels[IMG_HEIGHT][IMG_WIDTH]);
+  void render(imageSlot* slot, cameraImage* camera);
+  int writeBitmap(const char* file, uint8_t pixels[IMG_HEIGHT][IMG_WIDTH]);
+  int writeImage(const char* file, uint8_t pixels[IMG_HEIGHT][IMG_WIDTH], bool thumbnail);
+
+  void initQuantization(uint8_t Q);
+
+  imageSlot* _slots;
+  cameraImage* _cameras;
+  imagePacket* _packets;
+  // the finished images, not yet returned by nextImage()
+  imageDecoderResult _results[IMG_MAX_IMAGES];
+  int _nresults;
+  int _SN;
+  bool _vflip;
+  unsigned long _timeout;
+  unsigned long _preview;
+  int _format;
+  int _webQuality;
+  // the slot of the next preview, in turn
+  int _nextPreview;
+  char _folder[128];
+  // the quantization table of _quality, x16
+  uint8_t _quality;
+  int32_t _qt[64];
+  uint8_t _pixels[IMG_HEIGHT][IMG_WIDTH];
+};
+
+#endif
@@ -33,6 +33,7 @@ import re
 
 #contains the encryption key used by LSC: LSC_Nonce
 import LSC_config
+from node_keys import node_keys_lookup
 
 np.seterr(over='ignore')
 
@@ -158,6 +159,18 @@ def encrypt_ctr(seq_in, seq_out, lenH, RM1, PboxRM, Sbox1, Sbox2, myrand):
 
 def LSC_process_pkt(lorapkt, dst, ptype, src, seq):
 
+	#use the key of the device if it is in the key store (only for 16-byte keys)
+	key=default_key
+	
+	if LSC_SKEY==16:
+		keys=node_keys_lookup(src)
+		if keys and 'LSCKey' in keys:
+			key=keys['LSCKey']
+	
+	#tables are only computed again when the key changes from the previous packet
+	if key!=current_key:
+		LSC_set_key(key)
+		
 	#it seems that there is not a full reset when calling this function from a parent Python program
 	#so we need to reset at the beginning of the function
 	if LSC_DETERMINISTIC==True:
@@ -312,33 +325,45 @@ else:
 		val>>=8
 		Nonce[i+3]=val&0xFF
 
-for i in range(LSC_SKEY):
-    DK[i]=DK[i]^Nonce[i]
-
-rc4key(DK[0:LSC_SKEY/4], sc, LSC_SKEY/4)
-#print("sc")
-#print(sc)
-prga(sc, h2, RM1);
-#print("RM1")
-#print(RM1)
-rc4keyperm(DK[LSC_SKEY/4:2*LSC_SKEY/4], h2, rp, PboxRM, LSC_SKEY/4);
-#print("PboxRM")
-#print(PboxRM)
-rc4key(DK[2*LSC_SKEY/4:3*LSC_SKEY/4], Sbox1, LSC_SKEY/4);
-rc4key(DK[3*LSC_SKEY/4:LSC_SKEY], Sbox2, LSC_SKEY/4);
-#print("Sbox1")
-#print(Sbox1)
-#print("Sbox2")
-#print(Sbox2)
-
-RM2=np.copy(RM1)
-RMorig=np.copy(RM1)
-
-myrand=np.uint32(0)
-
-for i in range(min(LSC_SKEY,32)):
-	myrand=myrand|(DK[i]&1);
-	myrand=np.uint32(myrand<<1)
+#DK before being combined with the key
+DKseed=np.copy(DK)
+
+#compute the tables used by encrypt_ctr from a LSC_SKEY-byte key
+def LSC_set_key(key):
+	global DK, RM1, RM2, RMorig, myrand, current_key
+	
+	for i in range(LSC_SKEY):
+		DK[i]=DKseed[i]^key[i]
+
+	rc4key(DK[0:LSC_SKEY/4], sc, LSC_SKEY/4)
+	#print("sc")
+	#print(sc)
+	prga(sc, h2, RM1);
+	#print("RM1")
+	#print(RM1)
+	rc4keyperm(DK[LSC_SKEY/4:2*LSC_SKEY/4], h2, rp, PboxRM, LSC_SKEY/4);
+	#print("PboxRM")
+	#print(PboxRM)
+	rc4key(DK[2*LSC_SKEY/4:3*LSC_SKEY/4], Sbox1, LSC_SKEY/4);
+	rc4key(DK[3*LSC_SKEY/4:LSC_SKEY], Sbox2, LSC_SKEY/4);
+	#print("Sbox1")
+	#print(Sbox1)
+	#print("Sbox2")
+	#print(Sbox2)
+
+	RM2=np.copy(RM1)
+	RMorig=np.copy(RM1)
+
+	myrand=np.uint32(0)
+
+	for i in range(min(LSC_SKEY,32)):
+		myrand=myrand|(DK[i]&1);
+		myrand=np.uint32(myrand<<1)
+	
+	current_key=list(key)
+
+LSC_set_key(Nonce)
+default_key=list(Nonce)
 
 # with following setting:
 #
@@ -0,0 +1,272 @@
+/*
+ *  Per-node key store for the low-level gateway
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "NodeKeyStore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+NodeKeyStore::NodeKeyStore() {
+  _path[0]='\0';
+  _map=NULL;
+  _mapSize=0;
+  _ino=0;
+  _header=NULL;
+  _records=NULL;
+}
+
+NodeKeyStore::~NodeKeyStore() {
+  close();
+}
+
+// map and check the store at path, the previous store is kept if it fails
+int NodeKeyStore::mapFile(const char* path, void** map, size_t* mapSize, ino_t* ino) {
+
+  struct stat st;
+  int fd;
+
+  fd=::open(path, O_RDONLY);
+
+  if (fd<0)
+    return 1;
+
+  if (fstat(fd, &st)<0 || st.st_size < (off_t)sizeof(nodeKeyStoreHeader)) {
+    ::close(fd);
+    return 2;
+  }
+
+  void* m=mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after closing the file
+  ::close(fd);
+
+  if (m==MAP_FAILED)
+    return 2;
+
+  const nodeKeyStoreHeader* header=(const nodeKeyStoreHeader*)m;
+
+  if (header->magic!=NODE_KEY_STORE_MAGIC || header->version!=NODE_KEY_STORE_VERSION || header->slotBits>31 ||
+      (size_t)st.st_size < sizeof(nodeKeyStoreHeader)+((size_t)1 << header->slotBits)*sizeof(nodeKeyRecord) ||
+      header->count > ((uint32_t)1 << header->slotBits)/2) {
+    munmap(m, st.st_size);
+    return 2;
+  }
+
+  // lookup() relies on the empty slots of a table at most half full, a corrupted table could have none
+  const nodeKeyRecord* records=(const nodeKeyRecord*)((const uint8_t*)m+sizeof(nodeKeyStoreHeader));
+  uint32_t used=0;
+
+  for (uint32_t i=0; i < ((uint32_t)1 << header->slotBits); i++)
+    if (records[i].flags & NODE_KEY_FLAG_USED)
+      used++;
+
+  if (used!=header->count) {
+    munmap(m, st.st_size);
+    return 2;
+  }
+
+  *map=m;
+  *mapSize=st.st_size;
+  *ino=st.st_ino;
+
+  return 0;
+}
+
+void NodeKeyStore::use(void* map, size_t mapSize, ino_t ino) {
+
+  close();
+
+  _map=map;
+  _mapSize=mapSize;
+  _ino=ino;
+  _header=(const nodeKeyStoreHeader*)map;
+  _records=(const nodeKeyRecord*)((const uint8_t*)map+sizeof(nodeKeyStoreHeader));
+}
+
+int NodeKeyStore::open(const char* path) {
+
+  void* map;
+  size_t mapSize;
+  ino_t ino;
+
+  close();
+
+  strncpy(_path, path, sizeof(_path)-1);
+  _path[sizeof(_path)-1]='\0';
+
+  int e=mapFile(_path, &map, &mapSize, &ino);
+
+  if (e)
+    return e;
+
+  use(map, mapSize, ino);
+
+  return 0;
+}
+
+void NodeKeyStore::close() {
+
+  if (_map)
+    munmap(_map, _mapSize);
+
+  _map=NULL;
+  _mapSize=0;
+  _ino=0;
+  _header=NULL;
+  _records=NULL;
+}
+
+bool NodeKeyStore::reloadIfChanged() {
+
+  struct stat st;
+
+  if (_path[0]=='\0' || stat(_path, &st)<0)
+    return false;
+
+  // the update tool always creates a new file, so a new inode means a new store
+  if (_map && st.st_ino==_ino)
+    return false;
+
+  void* map;
+  size_t mapSize;
+  ino_t ino;
+
+  // a truncated or corrupted new file leaves the current store in use
+  if (mapFile(_path, &map, &mapSize, &ino))
+    return false;
+
+  use(map, mapSize, ino);
+
+  return true;
+}
+
+uint32_t NodeKeyStore::hash(uint32_t devAddr, uint32_t slotBits) {
+
+  if (slotBits==0)
+    return 0;
+
+  // Knuth multiplicative hash, node addresses are often small consecutive numbers
+  return (uint32_t)(devAddr*2654435761U) >> (32-slotBits);
+}
+
+const nodeKeyRecord* NodeKeyStore::lookup(uint32_t devAddr) const {
+
+  if (!_header || !_header->count)
+    return NULL;
+
+  uint32_t nslots=(uint32_t)1 << _header->slotBits;
+  uint32_t i=hash(devAddr, _header->slotBits);
+
+  // the table is at most half full so there is always an empty slot ending the probe, the number of slots
+  // only bounds it if the file has been changed since mapFile() checked it
+  for (uint32_t probes=0; probes<nslots && (_records[i].flags & NODE_KEY_FLAG_USED); probes++) {
+
+    if (_records[i].devAddr==devAddr)
+      return _records+i;
+
+    i=(i+1) & (nslots-1);
+  }
+
+  return NULL;
+}
+
+int NodeKeyStore::write(const char* path, const nodeKeyRecord* records, uint32_t n) {
+
+  uint32_t slotBits=4;
+  char tmpPath[300];
+  char dirPath[300];
+  nodeKeyStoreHeader header;
+
+  while (((uint32_t)1 << slotBits) < 2*n)
+    slotBits++;
+
+  uint32_t nslots=(uint32_t)1 << slotBits;
+  uint32_t mask=nslots-1;
+
+  nodeKeyRecord* table=(nodeKeyRecord*)calloc(nslots, sizeof(nodeKeyRecord));
+
+  if (!table)
+    return 1;
+
+  uint32_t count=0;
+
+  for (uint32_t k=0; k<n; k++) {
+
+    uint32_t i=hash(records[k].devAddr, slotBits);
+
+    while ((table[i].flags & NODE_KEY_FLAG_USED) && table[i].devAddr!=records[k].devAddr)
+      i=(i+1) & mask;
+
+    // a later record for the same device replaces the previous one
+    if (!(table[i].flags & NODE_KEY_FLAG_USED))
+      count++;
+
+    table[i]=records[k];
+    table[i].flags|=NODE_KEY_FLAG_USED;
+  }
+
+  memset(&header, 0, sizeof(header));
+  header.magic=NODE_KEY_STORE_MAGIC;
+  header.version=NODE_KEY_STORE_VERSION;
+  header.slotBits=slotBits;
+  header.count=count;
+
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp.%d", path, (int)getpid());
+
+  // the store holds the keys of all the devices, only the owner can read it. The mode of a temporary file
+  // left by a previous run is reset as it becomes the store with rename()
+  int fd=::open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+  if (fd<0 || fchmod(fd, 0600)<0) {
+    if (fd>=0)
+      ::close(fd);
+    free(table);
+    return 1;
+  }
+
+  bool ok= ::write(fd, &header, sizeof(header))==(ssize_t)sizeof(header) &&
+           ::write(fd, table, nslots*sizeof(nodeKeyRecord))==(ssize_t)(nslots*sizeof(nodeKeyRecord)) &&
+           fsync(fd)==0;
+
+  ::close(fd);
+  free(table);
+
+  if (!ok || rename(tmpPath, path)<0) {
+    unlink(tmpPath);
+    return 1;
+  }
+
+  // make the rename itself durable
+  strncpy(dirPath, path, sizeof(dirPath)-1);
+  dirPath[sizeof(dirPath)-1]='\0';
+
+  fd=::open(dirname(dirPath), O_RDONLY);
+
+  if (fd>=0) {
+    fsync(fd);
+    ::close(fd);
+  }
+
+  return 0;
+}
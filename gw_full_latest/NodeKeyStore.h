@@ -0,0 +1,107 @@
+/*
+ *  Per-node key store for the low-level gateway
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  The store is a single file: a 64-byte header followed by an open addressing
+ *  hash table (linear probing, at most half full) of 96-byte records indexed
+ *  by device address. The file is memory-mapped read-only so a lookup is one
+ *  hash and usually one record access. open() checks that the number of used
+ *  records matches the header, so that a corrupted file cannot make a lookup
+ *  probe a table without empty slot.
+ *
+ *  The file is never modified in place: NodeKeyStore::write() builds a new
+ *  file and rename()s it over the old one. Readers keep a valid mapping of
+ *  the old file and call reloadIfChanged() to switch to the new one, so any
+ *  number of readers can run while node_keys_tool updates the store.
+ */
+
+#ifndef NODE_KEY_STORE_H
+#define NODE_KEY_STORE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define NODE_KEY_STORE_MAGIC      0x534B474C  // "LGKS"
+#define NODE_KEY_STORE_VERSION    1
+
+#define NODE_KEY_FLAG_USED        0x01
+#define NODE_KEY_FLAG_AES         0x02
+#define NODE_KEY_FLAG_LSC         0x04
+
+struct nodeKeyStoreHeader {
+  uint32_t magic;
+  uint32_t version;
+  // the table has 1<<slotBits records
+  uint32_t slotBits;
+  uint32_t count;
+  uint8_t reserved[48];
+};
+
+struct nodeKeyRecord {
+  uint32_t devAddr;
+  uint32_t flags;
+  // zero, the frame counters are kept by FrameCounterTable
+  uint8_t reserved[8];
+  uint8_t appSKey[16];
+  uint8_t nwkSKey[16];
+  // CMAC subkeys of nwkSKey, derived once by the update tool
+  uint8_t K1[16];
+  uint8_t K2[16];
+  uint8_t lscKey[16];
+};
+
+class NodeKeyStore {
+
+public:
+  NodeKeyStore();
+  ~NodeKeyStore();
+
+  // return 0 on success, 1 if the file does not exist, 2 if it is not a valid store
+  int open(const char* path);
+  void close();
+
+  // re-open the store if the file has been replaced since open(), return true if reloaded. The current store is
+  // kept if the new file is not a valid store
+  bool reloadIfChanged();
+
+  // return NULL if the device has no entry
+  const nodeKeyRecord* lookup(uint32_t devAddr) const;
+
+  uint32_t count() const { return _header ? _header->count : 0; }
+  uint32_t slots() const { return _header ? (1UL << _header->slotBits) : 0; }
+  const nodeKeyRecord* slot(uint32_t i) const { return _records+i; }
+
+  static uint32_t hash(uint32_t devAddr, uint32_t slotBits);
+
+  // atomically replace the store at path with the n records, return 0 on success
+  static int write(const char* path, const nodeKeyRecord* records, uint32_t n);
+
+private:
+  static int mapFile(const char* path, void** map, size_t* mapSize, ino_t* ino);
+  void use(void* map, size_t mapSize, ino_t ino);
+
+  char _path[256];
+  void* _map;
+  size_t _mapSize;
+  ino_t _ino;
+  const nodeKeyStoreHeader* _header;
+  const nodeKeyRecord* _records;
+};
+
+#endif
@@ -30,6 +30,9 @@
 #include <math.h>
 
 /*  CHANGE LOGS by C. Pham
+ *	October 19th, 2026
+ *		- add getWakeOnRadioPreamble() that gives the preamble length to reach a device calling wakeOnRadio() of the
+ *		  Arduino SX1272 library every period ms. setPreambleLength() now also updates _preamblelength
  *	August 28th, 2018
  *		- add a small delay in the availableData() loop that decreases the CPU load of the lora_gateway process to 4~5% instead of nearly 100%
  *		- suggested by rertini (https://github.com/CongducPham/LowCostLoRaGw/issues/211)
@@ -3061,6 +3064,7 @@ uint8_t SX1272::setPreambleLength(uint16_t l)
         writeRegister(REG_PREAMBLE_LSB_FSK, p_length);
     }
 
+    _preamblelength = l;
     state = 0;
 #if (SX1272_debug_mode > 1)
     printf("## Preamble length ");
@@ -4687,7 +4691,8 @@ int8_t SX1272::getPacket(uint16_t wait)
             packet_received.type = readRegister(REG_FIFO);		// Reading second byte of the received packet
             
             // check packet type to discard unknown packet type
-            if ( ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_DATA) && ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_ACK) ) {
+            if ( ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_DATA) && ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_DATA_BIN)
+            	&& ((packet_received.type & PKT_TYPE_MASK) != PKT_TYPE_ACK) ) {
                 _reception = INCORRECT_PACKET_TYPE;
                 state = 3;
 #if (SX1272_debug_mode > 0)
@@ -6604,6 +6609,29 @@ uint8_t SX1272::doCAD(uint8_t counter)
     return state;
 }
 
+/*
+ Function: Gets the preamble length to reach a device calling wakeOnRadio() every 'period' ms: the preamble
+           lasts period ms plus 10%, for the clock drift, and 10 symbols for the CAD and the preamble detection.
+ Returns: The preamble length in symbols, to be set with setPreambleLength().
+ Parameters:
+   period: time between two CAD at the receiver.
+*/
+uint16_t SX1272::getWakeOnRadioPreamble(uint16_t period)
+{
+    uint32_t symbols = (uint32_t)period * 1100UL / getSymbolTime() + 10;
+
+    return (symbols > 0xFFFF) ? 0xFFFF : (uint16_t)symbols;
+}
+
+/*
+ Function: Gets the time of a LoRa symbol with the current SF and BW.
+ Returns: The time of a symbol in us.
+*/
+uint32_t SX1272::getSymbolTime()
+{
+    return ((uint32_t)1 << _spreadingFactor) * 1000 / ((_bandwidth==BW_125)?125:((_bandwidth==BW_250)?250:500));
+}
+
 
 uint16_t SX1272::getToA(uint8_t pl) {
 
@@ -363,6 +363,9 @@ const uint8_t INCORRECT_PACKET_TYPE = 2;
 
 #define PKT_TYPE_DATA   0x10
 #define PKT_TYPE_ACK    0x20
+// data in the binary format of SensorCodec.h, the flags are the same as for PKT_TYPE_DATA
+// 0x30 is left unchanged when the send functions OR the type with PKT_TYPE_DATA
+#define PKT_TYPE_DATA_BIN   0x30
 
 #define PKT_FLAG_ACK_REQ            0x08
 #define PKT_FLAG_DATA_ENCRYPTED     0x04
@@ -1156,6 +1159,8 @@ public:
     void setPacketType(uint8_t type);
     void RxChainCalibration();
     uint8_t doCAD(uint8_t counter);
+    uint16_t getWakeOnRadioPreamble(uint16_t period);
+    uint32_t getSymbolTime();
     uint16_t getToA(uint8_t pl);
     void CarrierSense(uint8_t cs=1);
     void CarrierSense1();
@@ -0,0 +1,381 @@
+/*
+ *  Compact binary encoding of the nomenclature/value sensor data
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SensorCodec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define strcmp_P strcmp
+#define strcpy_P strcpy
+#endif
+
+// keep the schema in flash on the AVR boards, the nomenclatures have at most 5 characters
+static const char schema[][6] PROGMEM = { SENSOR_CODEC_SCHEMA };
+
+#define SCHEMA_SIZE (sizeof(schema)/sizeof(schema[0]))
+
+static const uint32_t scale[SENSOR_CODEC_MAX_DECIMALS+1]={1,10,100,1000,10000,100000,1000000,10000000,100000000,1000000000};
+
+// a nomenclature from the radio must not break the text format
+static bool validName(const uint8_t* name, uint8_t len) {
+
+  if (!len || len>SENSOR_CODEC_MAX_NAME_LENGTH)
+    return false;
+
+  for (uint8_t i=0; i<len; i++)
+    if (name[i]<=' ' || name[i]>'~' || name[i]=='/' || name[i]=='#' || name[i]=='\\')
+      return false;
+
+  return true;
+}
+
+uint8_t sensorCodecFieldId(const char* name) {
+
+  for (uint8_t i=0; i<SCHEMA_SIZE; i++)
+    if (!strcmp_P(name, schema[i]))
+      return i;
+
+  return SENSOR_CODEC_NAMED_FIELD;
+}
+
+static uint8_t putVarint(uint8_t* buf, uint32_t v) {
+
+  uint8_t n=0;
+
+  while (v>=0x80) {
+    buf[n++]=(v & 0x7F) | 0x80;
+    v>>=7;
+  }
+
+  buf[n++]=v;
+
+  return n;
+}
+
+// zigzag so that small negative values also take few bytes
+static uint8_t putSigned(uint8_t* buf, int32_t value) {
+  return putVarint(buf, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+// return the number of bytes read, -1 if the varint is truncated or too large
+static int getVarint(const uint8_t* buf, uint8_t len, uint32_t* v) {
+
+  uint8_t n=0;
+
+  *v=0;
+
+  for (uint8_t shift=0; ; shift+=7) {
+
+    // a 32-bit value has at most 5 bytes and 4 bits in the last one
+    if (n==len || (shift==28 && buf[n]>0x0F))
+      return -1;
+
+    *v|=(uint32_t)(buf[n] & 0x7F) << shift;
+
+    if (!(buf[n++] & 0x80))
+      return n;
+  }
+}
+
+static int getSigned(const uint8_t* buf, uint8_t len, int32_t* value) {
+
+  uint32_t v;
+  int n=getVarint(buf, len, &v);
+
+  *value=(int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+
+  return n;
+}
+
+uint8_t sensorCodecPut(uint8_t* buf, uint8_t id, const char* name, int32_t value, uint8_t decimals) {
+
+  uint8_t n=0;
+
+  if (decimals>SENSOR_CODEC_MAX_DECIMALS || id>SENSOR_CODEC_NAMED_FIELD || id==SENSOR_CODEC_BATCH)
+    return 0;
+
+  buf[n++]=(id << 2) | (decimals<3 ? decimals : 3);
+
+  if (decimals>=3)
+    buf[n++]=decimals;
+
+  if (id==SENSOR_CODEC_NAMED_FIELD) {
+
+    uint8_t len=strlen(name);
+
+    if (len>SENSOR_CODEC_MAX_NAME_LENGTH)
+      len=SENSOR_CODEC_MAX_NAME_LENGTH;
+
+    buf[n++]=len;
+    memcpy(buf+n, name, len);
+    n+=len;
+  }
+
+  return n+putSigned(buf+n, value);
+}
+
+int sensorCodecGet(const uint8_t* buf, uint8_t len, sensorCodecField* f) {
+
+  uint8_t n=0;
+
+  if (!len)
+    return -1;
+
+  f->id=buf[n] >> 2;
+  f->decimals=buf[n++] & 0x03;
+
+  if (f->decimals==3) {
+    if (n==len || buf[n]<3 || buf[n]>SENSOR_CODEC_MAX_DECIMALS)
+      return -1;
+    f->decimals=buf[n++];
+  }
+
+  if (f->id==SENSOR_CODEC_NAMED_FIELD) {
+
+    if (n==len || n+1+buf[n]>len || !validName(buf+n+1, buf[n]))
+      return -1;
+
+    memcpy(f->name, buf+n+1, buf[n]);
+    f->name[buf[n]]='\0';
+    n+=1+buf[n];
+  }
+  else if (f->id<SCHEMA_SIZE)
+    strcpy_P(f->name, schema[f->id]);
+  // sent by a device with a more recent schema
+  else
+    return -1;
+
+  int k=getSigned(buf+n, len-n, &f->value);
+
+  return k<0 ? -1 : n+k;
+}
+
+// append name/value to text, return the new length of text
+static int formatField(char* text, int n, int size, bool first, const sensorCodecField* f) {
+
+  uint32_t a=f->value<0 ? -(uint32_t)f->value : (uint32_t)f->value;
+  uint32_t d=scale[f->decimals];
+
+  if (n<size)
+    n+=snprintf(text+n, size-n, "%s%s/%s%lu", first ? "" : "/", f->name, f->value<0 ? "-" : "", (unsigned long)(a/d));
+
+  if (f->decimals && n<size)
+    n+=snprintf(text+n, size-n, ".%0*lu", f->decimals, (unsigned long)(a%d));
+
+  return n;
+}
+
+// decode the batch up to sample k, or to the end if k is 255, return the number of bytes read or -1
+static int decodeBatch(const uint8_t* buf, uint8_t len, uint8_t k, sensorCodecField* fields, uint32_t* age) {
+
+  uint8_t n=3, m, count;
+  uint32_t v;
+  int r;
+
+  if (len<3 || buf[0]!=(SENSOR_CODEC_BATCH << 2) || !buf[1] || !buf[2] || buf[2]>SENSOR_CODEC_BATCH_MAX_FIELDS)
+    return -1;
+
+  count=buf[1];
+  m=buf[2];
+
+  if (k!=255 && k>=count)
+    return -1;
+
+  if ((r=getVarint(buf+n, len-n, age))<0)
+    return -1;
+  n+=r;
+
+  for (uint8_t j=0; j<m; j++) {
+    if ((r=sensorCodecGet(buf+n, len-n, &fields[j]))<0 || fields[j].id==SENSOR_CODEC_BATCH)
+      return -1;
+    n+=r;
+  }
+
+  for (uint8_t i=1; i<count && (k==255 || i<=k); i++) {
+
+    if ((r=getVarint(buf+n, len-n, &v))<0 || v>*age)
+      return -1;
+    n+=r;
+    *age-=v;
+
+    for (uint8_t j=0; j<m; j++) {
+
+      int32_t delta;
+
+      if ((r=getSigned(buf+n, len-n, &delta))<0)
+        return -1;
+      n+=r;
+      // modulo 2^32, as for the encoding
+      fields[j].value=(int32_t)((uint32_t)fields[j].value+(uint32_t)delta);
+    }
+  }
+
+  return n;
+}
+
+int sensorCodecSamples(const uint8_t* buf, uint8_t len) {
+
+  sensorCodecField fields[SENSOR_CODEC_BATCH_MAX_FIELDS];
+  uint32_t age;
+
+  if (!len)
+    return -1;
+
+  if (buf[0]!=(SENSOR_CODEC_BATCH << 2))
+    return 1;
+
+  // the whole payload must be the batch
+  if (decodeBatch(buf, len, 255, fields, &age)!=len)
+    return -1;
+
+  return buf[1];
+}
+
+int sensorCodecSampleToText(const uint8_t* buf, uint8_t len, uint8_t k, char* text, int size, uint32_t* age) {
+
+  sensorCodecField f[SENSOR_CODEC_BATCH_MAX_FIELDS];
+  int n=snprintf(text, size, "\\!");
+
+  *age=0;
+
+  if (len && buf[0]==(SENSOR_CODEC_BATCH << 2)) {
+
+    if (decodeBatch(buf, len, k, f, age)<0)
+      return -1;
+
+    for (uint8_t j=0; j<buf[2]; j++)
+      n=formatField(text, n, size, j==0, &f[j]);
+
+    return n<size ? n : -1;
+  }
+
+  if (k)
+    return -1;
+
+  for (uint8_t i=0; i<len; ) {
+
+    int r=sensorCodecGet(buf+i, len-i, &f[0]);
+
+    if (r<0)
+      return -1;
+
+    n=formatField(text, n, size, i==0, &f[0]);
+    i+=r;
+  }
+
+  return n<size ? n : -1;
+}
+
+int sensorCodecToText(const uint8_t* buf, uint8_t len, char* text, int size) {
+
+  uint32_t age;
+  int count=sensorCodecSamples(buf, len);
+
+  if (count<1)
+    return -1;
+
+  return sensorCodecSampleToText(buf, len, count-1, text, size, &age);
+}
+
+void sensorCodecBatchInit(sensorCodecBatch* b) {
+  b->len=b->n=b->m=b->field=0;
+}
+
+bool sensorCodecBatchFull(const sensorCodecBatch* b) {
+  // a time and m deltas of at most 5 bytes
+  return b->n==255 || (b->n && b->len+5+5*b->m>SENSOR_CODEC_BATCH_SIZE);
+}
+
+bool sensorCodecBatchSample(sensorCodecBatch* b, uint32_t time) {
+
+  // an incomplete sample would shift all the fields of the next ones
+  if (b->n && b->field!=b->m)
+    return false;
+
+  if (sensorCodecBatchFull(b))
+    return false;
+
+  if (!b->n)
+    b->firstTime=time;
+  else
+    b->len+=putVarint(b->data+b->len, time>b->lastTime ? time-b->lastTime : 0);
+
+  if (!b->n || time>b->lastTime)
+    b->lastTime=time;
+
+  b->n++;
+  b->field=0;
+
+  return true;
+}
+
+bool sensorCodecBatchPut(sensorCodecBatch* b, uint8_t id, const char* name, int32_t value, uint8_t decimals) {
+
+  if (!b->n)
+    return false;
+
+  if (b->n==1) {
+
+    if (b->m==SENSOR_CODEC_BATCH_MAX_FIELDS || b->len+SENSOR_CODEC_MAX_FIELD_SIZE>SENSOR_CODEC_BATCH_SIZE)
+      return false;
+
+    uint8_t r=sensorCodecPut(b->data+b->len, id, name, value, decimals);
+
+    if (!r)
+      return false;
+
+    b->len+=r;
+    b->m++;
+  }
+  else {
+
+    if (b->field==b->m)
+      return false;
+
+    // modulo 2^32 so that any two values have a delta
+    b->len+=putSigned(b->data+b->len, (int32_t)((uint32_t)value-(uint32_t)b->values[b->field]));
+  }
+
+  b->values[b->field++]=value;
+
+  return true;
+}
+
+uint8_t sensorCodecBatchEnd(const sensorCodecBatch* b, uint32_t time, uint8_t* buf) {
+
+  uint8_t n=0;
+
+  if (!b->n || !b->m || b->field!=b->m)
+    return 0;
+
+  buf[n++]=SENSOR_CODEC_BATCH << 2;
+  buf[n++]=b->n;
+  buf[n++]=b->m;
+  // the ages of the samples cannot be negative
+  n+=putVarint(buf+n, (time>b->lastTime ? time : b->lastTime)-b->firstTime);
+
+  memcpy(buf+n, b->data, b->len);
+
+  return n+b->len;
+}
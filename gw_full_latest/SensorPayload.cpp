@@ -0,0 +1,201 @@
+/*
+ *  Parser for the nomenclature/value payload format of the end-devices
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SensorPayload.h"
+
+#include <stdio.h>
+
+// convert a decimal number such as -0.3637 to fixed-point, return false if it is not one
+static bool parseFixed(const char* t, uint8_t n, int32_t* value, uint8_t* decimals) {
+
+  uint8_t i=0, digits=0, dec=0;
+  int32_t m=0;
+  bool neg=false, dot=false, any=false;
+
+  if (n && (t[0]=='-' || t[0]=='+')) {
+    neg=(t[0]=='-');
+    i++;
+  }
+
+  for ( ; i<n; i++) {
+
+    char c=t[i];
+
+    if (c=='.' && !dot) {
+      dot=true;
+      continue;
+    }
+
+    if (c<'0' || c>'9')
+      return false;
+
+    any=true;
+
+    // too many digits: drop the extra decimals, but the integer part must fit
+    if (digits==SENSOR_PAYLOAD_MAX_DIGITS || (dot && dec==SENSOR_PAYLOAD_MAX_DIGITS)) {
+      if (!dot)
+        return false;
+      continue;
+    }
+
+    // leading zeros do not use any precision
+    if (m || c!='0')
+      digits++;
+
+    m=m*10+(c-'0');
+
+    if (dot)
+      dec++;
+  }
+
+  if (!any)
+    return false;
+
+  *value=neg ? -m : m;
+  *decimals=dec;
+
+  return true;
+}
+
+// token k of the data part is a name if k is even, a value if k is odd
+static bool addToken(sensorPayload* p, uint8_t k, const char* tok, const char* end) {
+
+  if (k/2 >= SENSOR_PAYLOAD_MAX_FIELDS)
+    return false;
+
+  sensorField* f=&p->fields[k/2];
+
+  if (!(k & 1)) {
+    f->name=tok;
+    f->nameLen=end-tok;
+    return true;
+  }
+
+  f->text=tok;
+  f->textLen=end-tok;
+  f->numeric=parseFixed(tok, end-tok, &f->value, &f->decimals);
+  p->count++;
+
+  return true;
+}
+
+int parseSensorPayload(const uint8_t* payload, uint8_t len, sensorPayload* p) {
+
+  const char* s=(const char*)payload;
+  const char* end=s+len;
+  const char* tok;
+  uint8_t k=0, sharps=0;
+
+  p->prefix=0;
+  p->channel=p->field=NULL;
+  p->channelLen=p->fieldLen=0;
+  p->count=0;
+
+  if (len>=2 && s[0]=='\\' && (s[1]=='!' || s[1]=='&' || s[1]=='$')) {
+    p->prefix=s[1];
+    s+=2;
+  }
+
+  p->data=tok=s;
+
+  for ( ; ; s++) {
+
+    // the sketches may send the string terminator
+    char c=(s<end) ? *s : '\0';
+
+    if (c=='\0' || c=='\n')
+      break;
+
+    // a \$ message is free text
+    if (p->prefix=='$')
+      continue;
+
+    if (c=='#') {
+
+      // the # sections come before any nomenclature
+      if (k || sharps==2)
+        return -1;
+
+      if (sharps==0) {
+        p->channel=tok;
+        p->channelLen=s-tok;
+      }
+      else {
+        p->field=tok;
+        p->fieldLen=s-tok;
+      }
+
+      sharps++;
+      p->data=tok=s+1;
+    }
+    else if (c=='/') {
+      if (!addToken(p, k++, tok, s))
+        return -1;
+      tok=s+1;
+    }
+  }
+
+  p->dataLen=s-p->data;
+
+  if (p->prefix=='$' || !p->dataLen)
+    return 0;
+
+  if (!addToken(p, k++, tok, s))
+    return -1;
+
+  // a single value without nomenclature
+  if (k==1) {
+    p->fields[0].nameLen=0;
+    return addToken(p, 1, tok, s) ? 1 : -1;
+  }
+
+  // a nomenclature without value
+  if (k & 1)
+    return -1;
+
+  return p->count;
+}
+
+int formatSensorPayload(const sensorPayload* p, char* buf, int size) {
+
+  int n=0;
+
+  if (size<=0)
+    return 0;
+
+  buf[0]='\0';
+
+  if (p->prefix)
+    n=snprintf(buf, size, "%c", p->prefix);
+
+  for (uint8_t i=0; i<p->count && n<size; i++) {
+
+    const sensorField* f=&p->fields[i];
+
+    if (!f->numeric)
+      continue;
+
+    if (f->decimals)
+      n+=snprintf(buf+n, size-n, ";%.*s=%de-%d", f->nameLen, f->name, (int)f->value, f->decimals);
+    else
+      n+=snprintf(buf+n, size-n, ";%.*s=%d", f->nameLen, f->name, (int)f->value);
+  }
+
+  return n<size ? n : size-1;
+}
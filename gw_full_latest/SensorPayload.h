@@ -0,0 +1,76 @@
+/*
+ *  Parser for the nomenclature/value payload format of the end-devices
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  The payload is [\p][channel#][field#]data where
+ *    - \p is the logging prefix: \! (upload to clouds), \& or \$ (log in a file)
+ *    - channel and field are optional, e.g. \!SGSH52UGPVAUYG3S#2#9.4, \!##9.4
+ *      with a single #, the cloud script decides whether it is a channel or a field
+ *    - data is a single value, e.g. 9.4, or nomenclature/value pairs, e.g. TC/23.5/HU/60
+ *
+ *  parseSensorPayload() does a single pass on the received bytes and never
+ *  allocates: names and texts in the result point into the payload buffer.
+ *  Values are converted to fixed-point, i.e. value/10^decimals, so that 23.5
+ *  is stored as 235 with 1 decimal.
+ */
+
+#ifndef SENSOR_PAYLOAD_H
+#define SENSOR_PAYLOAD_H
+
+#include <stdint.h>
+
+#define SENSOR_PAYLOAD_MAX_FIELDS   16
+// more digits do not fit in an int32_t, extra decimals are truncated
+#define SENSOR_PAYLOAD_MAX_DIGITS   9
+
+struct sensorField {
+  // nomenclature, e.g. TC, not null-terminated, empty for a single value
+  const char* name;
+  uint8_t nameLen;
+  // value as received
+  const char* text;
+  uint8_t textLen;
+  // false if text is not a decimal number, e.g. a GPS fix status
+  bool numeric;
+  int32_t value;
+  uint8_t decimals;
+};
+
+struct sensorPayload {
+  // '!', '&', '$', or 0 if there is no logging prefix
+  char prefix;
+  const char* channel;
+  uint8_t channelLen;
+  const char* field;
+  uint8_t fieldLen;
+  // everything after the prefix and the # sections
+  const char* data;
+  uint8_t dataLen;
+  uint8_t count;
+  sensorField fields[SENSOR_PAYLOAD_MAX_FIELDS];
+};
+
+// return the number of fields, 0 for a \$ message, -1 if the data has no valid nomenclature/value format
+int parseSensorPayload(const uint8_t* payload, uint8_t len, sensorPayload* p);
+
+// write the numeric fields as name=value[e-decimals] separated by ; after the prefix, e.g. !;TC=235e-1;HU=60
+// return the length of the string, which is truncated to size-1 characters if needed
+int formatSensorPayload(const sensorPayload* p, char* buf, int size);
+
+#endif
@@ -34,6 +34,8 @@ except ImportError:
 
 #contains the 2 encryption keys used by LoRaWAN-like AES: AppSKey and NwkSKey
 import loraWAN_config
+#per-device keys, loraWAN_config is used for devices that are not in the key store
+from node_keys import node_keys_lookup
 		
 def import_LoRaWAN_lib():
 
@@ -85,16 +87,24 @@ def loraWAN_process_pkt(lorapkt):
 
 		#print "start decryption"
 		
-		appskey=bytearray.fromhex(loraWAN_config.AppSKey)
-		appskeylist=[]
+		#DevAddr is sent lsb first
+		devaddr=lorapkt[1] | (lorapkt[2]<<8) | (lorapkt[3]<<16) | (lorapkt[4]<<24)
+		keys=node_keys_lookup(devaddr)
+		
+		if keys and 'AppSKey' in keys:
+			appskeylist=keys['AppSKey']
+			nwkskeylist=keys['NwkSKey']
+		else:
+			appskey=bytearray.fromhex(loraWAN_config.AppSKey)
+			appskeylist=[]
 
-		for i in range (0,len(appskey)):
-			appskeylist.append(appskey[i])
+			for i in range (0,len(appskey)):
+				appskeylist.append(appskey[i])
 
-		nwkskey=bytearray.fromhex(loraWAN_config.NwkSKey)
-		nwkskeylist=[]
-		for i in range (0,len(nwkskey)):
-			nwkskeylist.append(nwkskey[i])
+			nwkskey=bytearray.fromhex(loraWAN_config.NwkSKey)
+			nwkskeylist=[]
+			for i in range (0,len(nwkskey)):
+				nwkskeylist.append(nwkskey[i])
 
 		lorawan = LoRaWAN.new(nwkskeylist)
 		lorawan.read(lorapkt)
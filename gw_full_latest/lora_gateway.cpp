@@ -72,6 +72,47 @@
 */
 
 /*  Change logs
+ *  Oct, 19th, 2026. v1.9i
+ *        with --img, --imgformat png or --imgformat jpg writes the images as PNG or baseline JPEG files instead of BMP files
+ *          - e.g. ^i6,0,ucam_0-node_0006-cam_0-Q20-P17-S1366.png, with its thumbnail ucam_0-node_0006-cam_0-Q20-P17-S1366-thumb.png
+ *          - smaller files for the web pages of gw_images_web, see ucam-images/web_image.h
+ *  Oct, 19th, 2026. v1.9h
+ *        with --img, --preview s writes the image being received every s seconds when it has new blocks
+ *          - given to the post-processing stage in a ^v line, e.g. ^v6,0,ucam_0-node_0006-cam_0-Q20-preview.bmp
+ *          - the file is replaced by each preview, --preview 0 writes a preview after each packet
+ *  Oct, 19th, 2026. v1.9g
+ *        add in-memory decoding of the image packets with the --img option, see ImageDecoder.h
+ *          - the blocks of each packet are decoded when it is received, no .dat file and decode_to_bmp process
+ *          - a finished image is written as a BMP file in the current folder and given to the post-processing
+ *            stage in a ^i line, e.g. ^i6,0,ucam_0-node_0006-cam_0-Q20-P13-S1370.bmp
+ *  Oct, 19th, 2026. v1.9f
+ *        downlink requests with a "wor" key are sent to a device listening with wakeOnRadio() every "wor" ms
+ *          - e.g. { "status" : "send_request", "dst" : 3, "data" : "/@L1#", "wor" : 2000 }
+ *          - the packet is sent with a preamble of getWakeOnRadioPreamble(wor) symbols, the preamble length is set back after
+ *          - post-processing writes them in downlink.txt without waiting for a packet from the device, so downlink.txt
+ *            is also checked every interWorDownlinkCheckTime when there is no pending downlink request
+ *          - with BAND868, the time on air of the downlink packets is counted in the 1% duty-cycle of limitToA(), a
+ *            request waits for the next cycle when it needs more than the remaining time on air and is discarded when
+ *            it needs more than a whole cycle
+ *  Oct, 19th, 2026. v1.9e
+ *        a PKT_TYPE_DATA_BIN packet can carry a batch of samples taken at different times, see SensorCodec.h
+ *          - each sample before the last one is given as a packet with the same ^p and ^r lines and
+ *            the ^t time at which it was taken, the last sample is the data of the received packet
+ *  Oct, 19th, 2026. v1.9d
+ *        packets of type PKT_TYPE_DATA_BIN carry the sensor values in the binary format of SensorCodec.h
+ *          - they are converted to the text format, e.g. \!TC/23.5/HU/60, and handled as PKT_TYPE_DATA packets
+ *          - not in raw mode nor with encryption, the packet is then given as received
+ *  Oct, 19th, 2026. v1.9c
+ *        the nomenclature/value payload, e.g. \!TC/23.5/HU/60, is parsed by the gateway, see SensorPayload.h
+ *          - the numeric values are given to the post-processing stage in a ^d line before the data, e.g. ^d!;TC=235e-1;HU=60
+ *  Oct, 19th, 2026. v1.9b
+ *        add replay rejection with the --fcnt option
+ *          - the last frame counter of each node is kept in frame_counters.bin, see FrameCounterTable.h
+ *          - frames whose counter is not more recent are dropped before being passed to the post-processing stage
+ *  Oct, 19th, 2026. v1.9a
+ *        with INCLUDE_MIC_IN_DOWNLINK the 4-byte downlink MIC is computed by the gateway at send time
+ *          - per-node AppSKey/NwkSKey are read from the node_keys.bin key store, default keys otherwise
+ *          - the MIC0..MIC3 fields are no longer needed in the downlink JSON entry
  *	March 23rd, 2019. v1.9
  *		  improve suport for LoRaWAN
  *		  the radio info string has a frequency information, e.g. 125,5,12,868100
@@ -317,10 +358,73 @@ unsigned long interDownlinkCheckTime=5000L;
 unsigned long lastDownlinkSendTime=0;
 // 20s between 2 downlink transmissions when there are queued requests
 unsigned long interDownlinkSendTime=20000L;
+// wake-on-radio requests ("wor" key) do not wait for a lora packet from the device
+unsigned long lastWorDownlinkCheckTime=0;
+unsigned long interWorDownlinkCheckTime=10000L;
+
+// the time on air of the downlink packets, long with wake-on-radio, is counted in the 1% duty-cycle of the
+// SX1272 library (limitToA(), MAX_DUTY_CYCLE_PER_HOUR). A request waits when the remaining time on air of the
+// cycle is not enough, and is discarded when it needs more than a whole cycle
+#ifdef BAND868
+#define LIMIT_DOWNLINK_TOA
+long maxDownlinkToA=0;
+#endif
 
 //#define INCLUDE_MIC_IN_DOWNLINK
 
 int xtoi(const char *hexstring);
+
+#include "AES-128_V10.h"
+#include "Encrypt_V31.h"
+
+// default keys used by Encrypt_V31 for nodes that have no entry in the key store
+// same default as in loraWAN_config.py
+unsigned char AppSkey[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+unsigned char NwkSkey[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+unsigned char DevAddr[4] = { 0x00, 0x00, 0x00, 0x00 };
+
+#ifdef INCLUDE_MIC_IN_DOWNLINK
+#include "NodeKeyStore.h"
+
+// per-node keys, built from node_keys.txt with node_keys_tool
+#define NODE_KEY_STORE_FILE "node_keys.bin"
+
+NodeKeyStore nodeKeyStore;
+// K1/K2 of the default NwkSkey
+MIC_Context defaultMIC;
+
+void computeDownlinkMIC(int addr, uint8_t* data, uint8_t len, uint8_t* mic);
+#endif
+#endif
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FOR REPLAY REJECTION
+//
+#ifndef ARDUINO
+#include "FrameCounterTable.h"
+
+#define FRAME_COUNTER_TABLE_FILE "frame_counters.bin"
+// the log makes the counters durable, the checkpoint only bounds the replay time at startup
+#define FRAME_COUNTER_CHECKPOINT_TIME 600000L
+
+FrameCounterTable frameCounterTable;
+unsigned long lastFrameCounterCheckpointTime=0;
+
+bool checkFrameCounter();
+
+#include "SensorPayload.h"
+#include "SensorCodec.h"
+
+// binary payload of the last packet when it is a batch of samples
+uint8_t batchData[MAX_PAYLOAD];
+uint8_t batchLength=0;
+
+void printSensorValues(uint8_t* data, uint8_t len);
+
+#include "ImageDecoder.h"
+
+ImageDecoder imageDecoder;
 #endif
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -450,6 +554,10 @@ bool  optRAW=false;
 double optFQ=-1.0;
 uint8_t optSW=0x12;
 bool  optHEX=false;
+bool  optFCNT=false;
+bool  optIMG=false;
+int   optPreview=-1;
+int   optImgFormat=0; // IMG_FORMAT_BMP
 ///////////////////////////////////////////////////////////////////
 
 #if defined ARDUINO && defined SHOW_FREEMEMORY && not defined __MK20DX256__ && not defined __MKL26Z64__ && not defined  __SAMD21G18A__ && not defined _VARIANT_ARDUINO_DUE_X_
@@ -760,6 +868,50 @@ void setup()
 
   lastDownlinkCheckTime=millis();
 
+#ifdef LIMIT_DOWNLINK_TOA
+  maxDownlinkToA=sx1272.limitToA();
+  printf("^$Downlink time on air limited to %ldms per cycle\n", maxDownlinkToA);
+#endif
+
+#ifdef INCLUDE_MIC_IN_DOWNLINK
+  MIC_Init(&defaultMIC, NwkSkey);
+
+  if (nodeKeyStore.open(NODE_KEY_STORE_FILE)==0)
+    printf("^$Key store with %d node keys for downlink MIC\n", nodeKeyStore.count());
+  else
+    printf("^$No valid %s, use default keys for downlink MIC\n", NODE_KEY_STORE_FILE);
+#endif
+#endif
+
+#ifndef ARDUINO
+  if (optFCNT) {
+    e=frameCounterTable.open(FRAME_COUNTER_TABLE_FILE);
+
+    if (!e)
+      printf("^$Replay check with %d known nodes\n", frameCounterTable.count());
+    else {
+      printf("^$Cannot open %s (%d), replay check disabled\n", FRAME_COUNTER_TABLE_FILE, e);
+      optFCNT=false;
+    }
+
+    lastFrameCounterCheckpointTime=millis();
+  }
+
+  if (optIMG) {
+    // as decode_to_bmp -vflip for post_processing_gw.py
+    imageDecoder.setVflip(true);
+    printf("^$Image packets decoded by the gateway\n");
+
+    if (optPreview>=0) {
+      imageDecoder.setPreview(optPreview ? optPreview*1000L : 1);
+      printf("^$Image preview every %ds\n", optPreview);
+    }
+
+    if (optImgFormat!=IMG_FORMAT_BMP) {
+      imageDecoder.setFormat(optImgFormat);
+      printf("^$Image files in %s format\n", optImgFormat==IMG_FORMAT_PNG ? "PNG" : "JPEG");
+    }
+  }
 #endif
 }
 
@@ -1006,6 +1158,36 @@ void loop(void)
   }
 #endif
 
+#ifndef ARDUINO
+  if (optFCNT && millis()-lastFrameCounterCheckpointTime > FRAME_COUNTER_CHECKPOINT_TIME) {
+    frameCounterTable.checkpoint();
+    lastFrameCounterCheckpointTime=millis();
+  }
+
+  if (optIMG) {
+    imageDecoderResult image;
+
+    while (imageDecoder.nextPreview(millis(), &image)) {
+      if (!image.error)
+        printf("^v%d,%d,%s\n", image.src, image.cam, image.file);
+
+      FLUSHOUTPUT;
+    }
+
+    while (imageDecoder.nextImage(millis(), &image)) {
+      if (image.nbRecoveredPackets || image.nbLostPackets)
+        printf("^$Image %d: %d packets recovered, %d packets lost\n", image.SN, image.nbRecoveredPackets, image.nbLostPackets);
+
+      if (image.error)
+        printf("^$Cannot write image %s\n", image.file);
+      else
+        printf("^i%d,%d,%s\n", image.src, image.cam, image.file);
+
+      FLUSHOUTPUT;
+    }
+  }
+#endif
+
 /////////////////////////////////////////////////////////////////// 
 // THE MAIN PACKET RECEPTION LOOP
 //
@@ -1075,6 +1257,12 @@ void loop(void)
 #endif
 /////////////////////////////////////////////////////////////////// 
 
+#ifndef ARDUINO
+      // drop replayed frames before they reach the post-processing stage
+      if (!e && optFCNT && !checkFrameCounter())
+         e=1;
+#endif
+
       if (!e) {
         
          int a=0, b=0;
@@ -1115,6 +1303,39 @@ void loop(void)
 
          //tmp_length=sx1272._payloadlength;
          tmp_length=sx1272.getPayloadLength();
+
+#if not defined ARDUINO && not defined GW_RELAY && not defined LORA_LAS
+         // convert the binary sensor values to the text format so that the rest of the gateway
+         // and the post-processing stage see a regular data packet
+         if (!optRAW && (sx1272.packet_received.type & PKT_TYPE_MASK)==PKT_TYPE_DATA_BIN 
+         	&& !(sx1272.packet_received.type & PKT_FLAG_DATA_ENCRYPTED)) {
+            uint8_t offset=(sx1272.packet_received.type & PKT_FLAG_DATA_WAPPKEY) ? 4 : 0;
+            // the text must still fit in the reception buffer
+            char text[MAX_PAYLOAD+1];
+            int l=-1;
+
+            if (tmp_length>offset)
+               l=sensorCodecToText(sx1272.packet_received.data+offset, tmp_length-offset, text, MAX_PAYLOAD-offset+1);
+
+            // keep the batch, the samples before the last one are given with their own timestamp
+            if (l>0 && sensorCodecSamples(sx1272.packet_received.data+offset, tmp_length-offset)>1) {
+               memcpy(batchData, sx1272.packet_received.data, tmp_length);
+               batchLength=tmp_length;
+            }
+
+            if (l>0) {
+               memcpy(sx1272.packet_received.data+offset, text, l);
+               PRINT_CSTSTR("%s","--- binary payload of ");
+               PRINT_VALUE("%d", tmp_length);
+               PRINT_CSTSTR("%s"," bytes decoded\n");
+               tmp_length=offset+l;
+               sx1272._payloadlength=tmp_length;
+               sx1272.packet_received.type=PKT_TYPE_DATA | (sx1272.packet_received.type & PKT_FLAG_MASK);
+            }
+            else
+               PRINT_CSTSTR("%s","^$Invalid binary payload\n");
+         }
+#endif
          
 #if not defined GW_RELAY
 
@@ -1167,11 +1388,54 @@ void loop(void)
 #endif         
 ///////////////////////////////////////////////////////////////////
 
+#if not defined ARDUINO && not defined GW_RELAY && not defined LORA_LAS
+         // the samples of a batch before the last one are given as packets with the same ^p and ^r lines
+         // and the time at which they were taken, the last sample is the data of this packet
+         if (batchLength) {
+            uint8_t offset=(sx1272.packet_received.type & PKT_FLAG_DATA_WAPPKEY) ? 4 : 0;
+            uint8_t sample[MAX_PAYLOAD+1];
+            uint32_t age;
+            int count=sensorCodecSamples(batchData+offset, batchLength-offset);
+            
+            // with the app key so that the post-processing stage finds the data where expected
+            memcpy(sample, batchData, offset);
+            
+            for (int k=0; k<count-1; k++) {
+               int l=sensorCodecSampleToText(batchData+offset, batchLength-offset, k, (char*)sample+offset, MAX_PAYLOAD-offset+1, &age);
+               
+               if (l<0)
+                  continue;
+               
+               time_t sampleTime=tv.tv_sec-age;
+               
+               strftime(time_buffer, 30, "%Y-%m-%dT%H:%M:%S", localtime(&sampleTime));
+               sprintf(cmd, "^t%s.%03d\n", time_buffer, millisec);
+               PRINT_STR("%s", cmd);
+               
+               printSensorValues(sample, offset+l);
+#ifdef WITH_DATA_PREFIX
+               PRINT_STR("%c",(char)DATA_PREFIX_0);        
+               PRINT_STR("%c",(char)DATA_PREFIX_1);
+#endif
+               for (int a=0; a<offset+l; a++)
+                  PRINT_STR("%c",(char)sample[a]);
+               PRINTLN;
+            }
+            
+            batchLength=0;
+            FLUSHOUTPUT;
+         }
+#endif
+
 #if not defined ARDUINO && not defined GW_RELAY        
          strftime(time_buffer, 30, "%Y-%m-%dT%H:%M:%S", tm_info);
          sprintf(cmd, "^t%s.%03d\n", time_buffer, millisec);
          PRINT_STR("%s", cmd);
 #endif
+
+#if not defined ARDUINO && not defined GW_RELAY && not defined LORA_LAS
+         printSensorValues(sx1272.packet_received.data, tmp_length);
+#endif
             
 #ifdef LORA_LAS        
          if (loraLAS.isLASMsg(sx1272.packet_received.data)) {
@@ -1198,9 +1462,20 @@ void loop(void)
          else
            PRINT_CSTSTR("%s","No LAS header. Write raw data\n");
 #else
+#ifndef ARDUINO
+         // the image packets are decoded here instead of by post_processing_gw.py
+         if (optIMG && ImageDecoder::isImagePacket(sx1272.packet_received.data, tmp_length)) {
+           if (!imageDecoder.addPacket(sx1272.packet_received.data, tmp_length, millis()))
+             printf("^$Invalid image packet\n");
+           // don't print anything
+           a=tmp_length;
+         }
+#endif
 #if defined WITH_DATA_PREFIX && not defined GW_RELAY
-         PRINT_STR("%c",(char)DATA_PREFIX_0);        
-         PRINT_STR("%c",(char)DATA_PREFIX_1);
+         if (a<tmp_length) {
+           PRINT_STR("%c",(char)DATA_PREFIX_0);        
+           PRINT_STR("%c",(char)DATA_PREFIX_1);
+         }
 #endif
 #endif
 
@@ -1549,6 +1824,16 @@ void loop(void)
         if (millis()+ULONG_MAX-lastDownlinkCheckTime > interDownlinkCheckTime)
                 triggerDownlinkCheck=true;            
 	  }  
+
+	// post-processing can write a wake-on-radio request at any time
+	if (!enableDownlinkCheck && !hasDownlinkEntry && millis()-lastWorDownlinkCheckTime > interWorDownlinkCheckTime) {
+		lastWorDownlinkCheckTime=millis();
+		
+		if (!access("downlink/downlink.txt", F_OK)) {
+			enableDownlinkCheck=true;
+			triggerDownlinkCheck=true;
+		}
+	}
 	
     if ( (millis()-lastDownlinkCheckTime > interDownlinkCheckTime || triggerDownlinkCheck) && enableDownlinkCheck)  {	
     	
@@ -1706,9 +1991,43 @@ void loop(void)
     		// check if it is a valid send request
     		if (document["status"]=="send_request" && document["dst"].IsInt()) {
     			
+    			// the device listens with wakeOnRadio() every "wor" ms, the preamble must last longer
+    			uint16_t preamblelength=sx1272._preamblelength;
+    			uint16_t worPreamble=preamblelength;
+    			uint16_t sendTimeout=10000;
+    			
+    			if (document.HasMember("wor") && document["wor"].IsInt() && document["wor"].GetInt()>0) {
+    				uint16_t period=document["wor"].GetInt() < 50000 ? document["wor"].GetInt() : 50000;
+    				
+    				printf("^$wor = %d\n", period);
+    				worPreamble=sx1272.getWakeOnRadioPreamble(period);
+    				sendTimeout+=period*11/10;
+    			}
+
+#ifdef LIMIT_DOWNLINK_TOA
+    			uint8_t pl=document["data"].GetStringLength()+OFFSET_PAYLOADLENGTH;
+#ifdef INCLUDE_MIC_IN_DOWNLINK
+    			pl+=4;
+#endif
+    			// getToA() with the preamble of the packet
+    			long toa=sx1272.getToA(pl)+(long)(worPreamble-preamblelength)*sx1272.getSymbolTime()/1000;
+#endif
+    			
     			// disable extended IFS behavior, just a small number of CAD
     			extendedIFS=false;
     			
+#ifdef LIMIT_DOWNLINK_TOA
+    			if (toa > maxDownlinkToA) {
+    				printf("^$DISCARDING: %ldms of time on air, more than the %ldms of a duty-cycle\n", toa, maxDownlinkToA);
+    				// skip it
+    				dl_line_index++;
+    			}
+    			else if (toa > sx1272.getRemainingToA()) {
+    				printf("^$DELAYED: %ldms of time on air, %ldms left in the duty-cycle\n", toa, sx1272.getRemainingToA());
+    				// here we will retry later, at the next cycle
+    			}
+    			else
+#endif
     			if (!CarrierSense(true)) {
     				
     				char time_buffer[30];
@@ -1718,31 +2037,31 @@ void loop(void)
     						
     				gettimeofday(&tv, NULL);
     				
+    				if (worPreamble!=preamblelength)
+    					sx1272.setPreambleLength(worPreamble);
+    				
     				sx1272.setPacketType(PKT_TYPE_DATA | PKT_FLAG_DATA_DOWNLINK);
 
-#ifdef INCLUDE_MIC_IN_DOWNLINK    				
-    				// we test if we have MIC data in the json entry
-    				if (document["MIC0"].IsString() && document["MIC0"]!="") {
-    					uint8_t downlink_message[100];
-    					
+#ifdef INCLUDE_MIC_IN_DOWNLINK
+    				uint8_t downlink_message[100];
+    				uint8_t l=document["data"].GetStringLength();
+
+    				if ((size_t)l+4 <= sizeof(downlink_message)) {
     					// indicate a downlink packet with a 4-byte MIC after the payload
     					sx1272.setPacketType(PKT_TYPE_DATA | PKT_FLAG_DATA_ENCRYPTED | PKT_FLAG_DATA_DOWNLINK);
     					
-    					uint8_t l=document["data"].GetStringLength();
-    					
     					memcpy(downlink_message, (uint8_t*)document["data"].GetString(), l);
     					
-    					// set the 4-byte MIC after the payload
-    					downlink_message[l]=(uint8_t)xtoi(document["MIC0"].GetString());
-    					downlink_message[l+1]=(uint8_t)xtoi(document["MIC1"].GetString());
-    					downlink_message[l+2]=(uint8_t)xtoi(document["MIC2"].GetString());
-    					downlink_message[l+3]=(uint8_t)xtoi(document["MIC3"].GetString());
+    					// the MIC is computed with the keys of the destination device. With a broadcast request
+    					// the only device listening is the one that just sent a packet, so use its address
+    					computeDownlinkMIC(document["dst"].GetInt() ? document["dst"].GetInt() : sx1272.packet_received.src,
+    					                   downlink_message, l, downlink_message+l);
 
 						l += 4;
 						
     					// here we sent the downlink packet with the 4-byte MIC
     					//
-    					e = sx1272.sendPacketTimeout(document["dst"].GetInt(), downlink_message, l, 10000);    	
+    					e = sx1272.sendPacketTimeout(document["dst"].GetInt(), downlink_message, l, sendTimeout);    	
     					// at the device, the expected behavior is to test for the packet type, then remove 4 bytes from the payload length to get the real payload
     					// use AES encryption on the clear payload to compute the MIC and compare with the MIC sent in the downlink packet
     					// if both MIC are equal, then accept the downlink packet as a valid downlink packet				
@@ -1750,17 +2069,25 @@ void loop(void)
     				else {
     					// here we sent the downlink packet
     					//
-    					e = sx1272.sendPacketTimeout(document["dst"].GetInt(), (uint8_t*)document["data"].GetString(), document["data"].GetStringLength(), 10000);
+    					e = sx1272.sendPacketTimeout(document["dst"].GetInt(), (uint8_t*)document["data"].GetString(), document["data"].GetStringLength(), sendTimeout);
     				}
 #else    				
     				// here we sent the downlink packet
     				//
-    				e = sx1272.sendPacketTimeout(document["dst"].GetInt(), (uint8_t*)document["data"].GetString(), document["data"].GetStringLength(), 10000);    
+    				e = sx1272.sendPacketTimeout(document["dst"].GetInt(), (uint8_t*)document["data"].GetString(), document["data"].GetStringLength(), sendTimeout);    
 #endif    				
     				
 					PRINT_CSTSTR("%s","Packet sent, state ");
 					PRINT_VALUE("%d",e);
 					PRINTLN;
+					
+					if (sx1272._preamblelength!=preamblelength)
+						sx1272.setPreambleLength(preamblelength);
+
+#ifdef LIMIT_DOWNLINK_TOA
+					// the packet may have been sent even when the send fails
+					sx1272.removeToA(toa);
+#endif
     				
     				if (!e)
     					document["status"].SetString("sent", document.GetAllocator());
@@ -1867,6 +2194,137 @@ xtoi(const char *hexstring)
 	return i;
 }
 
+#if defined DOWNLINK && defined INCLUDE_MIC_IN_DOWNLINK
+// compute the 4-byte MIC of a downlink payload sent in clear, as expected by the end-device:
+// MIC of the LoRaWAN-like frame MHDR | DevAddr | FCtrl | FCnt | FPort | encrypted payload
+// with FCnt=0 and Direction=0, the payload itself is not modified
+void computeDownlinkMIC(int addr, uint8_t* data, uint8_t len, uint8_t* mic) {
+
+	MIC_Context ctx;
+	unsigned char* appSKey=AppSkey;
+	unsigned char devAddr[4];
+	unsigned char header[9];
+	unsigned char cipher[256];
+	
+	// pick up a store updated by node_keys_tool since the last downlink
+	nodeKeyStore.reloadIfChanged();
+	
+	const nodeKeyRecord* r=nodeKeyStore.lookup(addr);
+	
+	if (!r || !(r->flags & NODE_KEY_FLAG_AES))
+		r=nodeKeyStore.lookup(0);
+	
+	if (r && (r->flags & NODE_KEY_FLAG_AES)) {
+		// K1/K2 are stored with the keys, no AES needed to set up the context
+		memcpy(ctx.Key, r->nwkSKey, 16);
+		memcpy(ctx.Key_K1, r->K1, 16);
+		memcpy(ctx.Key_K2, r->K2, 16);
+		appSKey=(unsigned char*)r->appSKey;
+	}
+	else
+		ctx=defaultMIC;
+	
+	devAddr[0]=(addr >> 24) & 0xFF;
+	devAddr[1]=(addr >> 16) & 0xFF;
+	devAddr[2]=(addr >> 8) & 0xFF;
+	devAddr[3]=addr & 0xFF;
+	
+	// unconfirmed data up, no ADR, FCnt=0, FPort=1
+	header[0]=0x40;
+	header[1]=devAddr[3];
+	header[2]=devAddr[2];
+	header[3]=devAddr[1];
+	header[4]=devAddr[0];
+	header[5]=0x00;
+	header[6]=0x00;
+	header[7]=0x00;
+	header[8]=0x01;
+	
+	memcpy(cipher, data, len);
+	Encrypt_Payload_Key(cipher, len, 0, 0x00, appSKey, devAddr);
+	
+	MIC_Start(&ctx, devAddr, sizeof(header)+len, 0, 0x00);
+	MIC_Update(&ctx, header, sizeof(header));
+	MIC_Update(&ctx, cipher, len);
+	MIC_Final(&ctx, mic);
+}
+#endif
+
+#ifndef ARDUINO
+// provide the sensor values already parsed, before the data, so that the post-processing stage
+// can hand them to the cloud scripts: ^d!;TC=235e-1;HU=60 for \!TC/23.5/HU/60
+void printSensorValues(uint8_t* data, uint8_t len) {
+
+	if (optRAW || (sx1272.packet_received.type & PKT_FLAG_DATA_ENCRYPTED))
+		return;
+	
+	sensorPayload sp;
+	// skip the 4-byte app key
+	uint8_t offset=(sx1272.packet_received.type & PKT_FLAG_DATA_WAPPKEY) ? 4 : 0;
+	uint8_t i=0;
+
+	if (len<=offset || parseSensorPayload(data+offset, len-offset, &sp)<=0)
+		return;
+
+	// a single word, e.g. the bytes of an image packet, parses as a field without value
+	while (i<sp.count && !sp.fields[i].numeric)
+		i++;
+
+	if (i==sp.count)
+		return;
+
+	formatSensorPayload(&sp, cmd, MAX_CMD_LENGTH);
+	PRINT_CSTSTR("%s","^d");
+	PRINT_STR("%s", cmd);
+	PRINTLN;
+}
+
+// return false if the counter of the received frame is not more recent than the last one of its sender
+// frames without a known header are always accepted
+bool checkFrameCounter() {
+
+	uint8_t* data=sx1272.packet_received.data;
+	uint8_t len=sx1272.getPayloadLength();
+	uint8_t kind;
+	uint32_t addr, fcnt;
+	
+	if (!optRAW) {
+		if ((sx1272.packet_received.type & PKT_TYPE_MASK)!=PKT_TYPE_DATA
+			&& (sx1272.packet_received.type & PKT_TYPE_MASK)!=PKT_TYPE_DATA_BIN)
+			return true;
+		
+		kind=FCNT_KIND_NATIVE;
+		addr=sx1272.packet_received.src;
+		fcnt=sx1272.packet_received.packnum;
+	}
+	// in raw mode, dissect the header as post_processing_gw.py does
+	// our header is dst(1B) | type(1B) | src(1B) | seq(1B)
+	else if (len>=4 && data[0]==loraAddr && ((data[1] & PKT_TYPE_MASK)==PKT_TYPE_DATA || (data[1] & PKT_TYPE_MASK)==PKT_TYPE_DATA_BIN)) {
+		kind=FCNT_KIND_NATIVE;
+		addr=data[2];
+		fcnt=data[3];
+	}
+	// LoRaWAN unconfirmed or confirmed data up: MHDR(1B) | DevAddr(4B) | FCtrl(1B) | FCnt(2B) | ... | MIC(4B)
+	else if (len>=12 && ((data[0] & 0xE0)==0x40 || (data[0] & 0xE0)==0x80)) {
+		kind=FCNT_KIND_LORAWAN;
+		addr=data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24);
+		fcnt=data[6] | (data[7] << 8);
+	}
+	else
+		return true;
+	
+	long last=frameCounterTable.lastCounter(kind, addr);
+	
+	if (frameCounterTable.check(kind, addr, fcnt))
+		return true;
+	
+	printf("^$Replayed frame dropped: src=%u seq=%u last=%ld\n", addr, fcnt, last);
+	FLUSHOUTPUT;
+	
+	return false;
+}
+#endif
+
 int main (int argc, char *argv[]){
 
   int opt=0;
@@ -1886,12 +2344,16 @@ int main (int argc, char *argv[]){
       {"ndl", no_argument, 0,    'j' },       
 #endif                            
       {"hex", no_argument, 0,    'k' },
+      {"fcnt", no_argument, 0,   'l' },
+      {"img", no_argument, 0,    'm' },
+      {"preview", required_argument, 0, 'n' },
+      {"imgformat", required_argument, 0, 'o' },
       {0, 0, 0,  0}
   };
   
   int long_index=0;
   
-  while ((opt = getopt_long(argc, argv,"a:bc:d:e:fg:h:i:jk", 
+  while ((opt = getopt_long(argc, argv,"a:bc:d:e:fg:h:i:jklmn:o:", 
                  long_options, &long_index )) != -1) {
       switch (opt) {
            case 'a' : loraMode = atoi(optarg);
@@ -1932,6 +2394,19 @@ int main (int argc, char *argv[]){
                break;    
 #endif
            case 'k' : optHEX=true;
+               break;
+           case 'l' : optFCNT=true;
+               break;
+           case 'm' : optIMG=true;
+               break;
+           case 'n' : optPreview=atoi(optarg);
+                      // in seconds
+               break;
+           case 'o' : if (!strcmp(optarg, "png"))
+                        optImgFormat=IMG_FORMAT_PNG;
+                      else if (!strcmp(optarg, "jpg"))
+                        optImgFormat=IMG_FORMAT_JPEG;
+                      // bmp
                break;                                                     
            //default: print_usage(); 
            //    exit(EXIT_FAILURE);
@@ -0,0 +1,137 @@
+#------------------------------------------------------------
+# Copyright 2026 Congduc Pham, University of Pau, France.
+#
+# Congduc.Pham@univ-pau.fr
+#
+# This file is part of the low-cost LoRa gateway developped at University of Pau
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with the program.  If not, see <http://www.gnu.org/licenses/>.
+#------------------------------------------------------------
+
+# read-only access to the per-node key store built by node_keys_tool
+# see NodeKeyStore.h for the file format
+
+import os
+import mmap
+import struct
+
+NODE_KEY_STORE_FILE="node_keys.bin"
+
+NODE_KEY_STORE_MAGIC=0x534B474C
+NODE_KEY_STORE_VERSION=1
+
+NODE_KEY_FLAG_USED=0x01
+NODE_KEY_FLAG_AES=0x02
+NODE_KEY_FLAG_LSC=0x04
+
+HEADER_SIZE=64
+RECORD_SIZE=96
+
+_store=None
+_store_ino=None
+_slot_bits=0
+
+def _open_store():
+	global _store, _store_ino, _slot_bits
+
+	try:
+		st=os.stat(NODE_KEY_STORE_FILE)
+	except OSError:
+		_store=None
+		return False
+
+	#node_keys_tool replaces the file, so a new inode means a new store
+	if _store is not None and st.st_ino==_store_ino:
+		return True
+
+	try:
+		f=open(NODE_KEY_STORE_FILE, "rb")
+		m=mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+		f.close()
+	except (IOError, ValueError, mmap.error):
+		_store=None
+		return False
+
+	magic, version, slot_bits, count=struct.unpack_from("<IIII", m, 0)
+
+	valid=magic==NODE_KEY_STORE_MAGIC and version==NODE_KEY_STORE_VERSION and slot_bits<=31 and len(m)>=HEADER_SIZE+(1<<slot_bits)*RECORD_SIZE and count<=(1<<slot_bits)/2
+
+	#_find() relies on the empty slots of a table at most half full, a corrupted table could have none
+	if valid:
+		used=0
+		for i in range(1<<slot_bits):
+			if struct.unpack_from("<I", m, HEADER_SIZE+i*RECORD_SIZE+4)[0] & NODE_KEY_FLAG_USED:
+				used+=1
+		valid=used==count
+
+	if not valid:
+		print "node_keys: %s is not a valid key store" % NODE_KEY_STORE_FILE
+		_store=None
+		return False
+
+	_store=m
+	_store_ino=st.st_ino
+	_slot_bits=slot_bits
+	return True
+
+def _hash(devaddr):
+	if _slot_bits==0:
+		return 0
+	return ((devaddr*2654435761) & 0xFFFFFFFF) >> (32-_slot_bits)
+
+def _find(devaddr):
+	mask=(1<<_slot_bits)-1
+	i=_hash(devaddr)
+
+	for probe in range(1<<_slot_bits):
+		offset=HEADER_SIZE+i*RECORD_SIZE
+		addr, flags=struct.unpack_from("<II", _store, offset)
+
+		if not (flags & NODE_KEY_FLAG_USED):
+			return None
+
+		if addr==devaddr:
+			return offset
+
+		i=(i+1) & mask
+
+	return None
+
+#return a dictionary with the keys of the device as lists of bytes, or None
+#if the device is not in the store, the entry of address 0 is returned if any
+def node_keys_lookup(devaddr):
+
+	if not _open_store():
+		return None
+
+	offset=_find(devaddr)
+
+	if offset is None:
+		offset=_find(0)
+
+	if offset is None:
+		return None
+
+	addr, flags=struct.unpack_from("<II", _store, offset)
+
+	keys={}
+
+	if flags & NODE_KEY_FLAG_AES:
+		keys['AppSKey']=list(bytearray(_store[offset+16:offset+32]))
+		keys['NwkSKey']=list(bytearray(_store[offset+32:offset+48]))
+
+	if flags & NODE_KEY_FLAG_LSC:
+		keys['LSCKey']=list(bytearray(_store[offset+80:offset+96]))
+
+	return keys
@@ -0,0 +1,315 @@
+/*
+ *  Update tool for the per-node key store (see NodeKeyStore.h)
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  > ./node_keys_tool build node_keys.txt node_keys.bin
+ *  > ./node_keys_tool set node_keys.bin 0x26011721 <AppSKey> <NwkSKey> [LSCKey]
+ *  > ./node_keys_tool del node_keys.bin 6
+ *  > ./node_keys_tool dump node_keys.bin
+ *
+ *  node_keys.txt has one line per device: <addr> <AppSKey> <NwkSKey> [LSCKey]
+ *    - addr is decimal or hex (0x...), keys are 32-character hex strings, msb first
+ *    - use - for a key that is not used by the device
+ *    - lines starting with # are comments
+ *    - address 0 is the default entry for devices that are not listed
+ *
+ *  The store is always written to a temporary file then renamed, so running
+ *  gateways never see a partially written store. build does not write the
+ *  store if a line of node_keys.txt is not valid. set and del take an exclusive
+ *  lock on <store>.lock for their read-modify-write.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#include "NodeKeyStore.h"
+#include "AES-128_V10.h"
+#include "Encrypt_V31.h"
+
+// required by Encrypt_V31.cpp, not used here
+unsigned char AppSkey[16];
+unsigned char NwkSkey[16];
+unsigned char DevAddr[4];
+
+bool parseKey(const char* hexstring, uint8_t* key) {
+
+  if (strlen(hexstring)!=32)
+    return false;
+
+  for (int i=0; i<16; i++) {
+    char hexbyte[3]={hexstring[2*i], hexstring[2*i+1], '\0'};
+
+    if (!isxdigit(hexbyte[0]) || !isxdigit(hexbyte[1]))
+      return false;
+
+    key[i]=(uint8_t)strtoul(hexbyte, NULL, 16);
+  }
+
+  return true;
+}
+
+// fill a record from the text fields, return false if a key is malformed
+bool makeRecord(nodeKeyRecord* r, uint32_t addr, const char* appskey, const char* nwkskey, const char* lsckey) {
+
+  memset(r, 0, sizeof(nodeKeyRecord));
+  r->devAddr=addr;
+  r->flags=NODE_KEY_FLAG_USED;
+
+  if (strcmp(appskey, "-") || strcmp(nwkskey, "-")) {
+
+    if (!parseKey(appskey, r->appSKey) || !parseKey(nwkskey, r->nwkSKey))
+      return false;
+
+    // derive the CMAC subkeys once so that readers never need to
+    Generate_Subkeys(r->nwkSKey, r->K1, r->K2);
+    r->flags|=NODE_KEY_FLAG_AES;
+  }
+
+  if (lsckey && strcmp(lsckey, "-")) {
+
+    if (!parseKey(lsckey, r->lscKey))
+      return false;
+
+    r->flags|=NODE_KEY_FLAG_LSC;
+  }
+
+  return true;
+}
+
+// copy all the entries of an existing store, the caller frees the array
+nodeKeyRecord* readStore(const char* path, uint32_t* n, uint32_t extra) {
+
+  NodeKeyStore store;
+  int e=store.open(path);
+
+  if (e==2) {
+    fprintf(stderr, "%s is not a valid key store\n", path);
+    exit(1);
+  }
+
+  nodeKeyRecord* records=(nodeKeyRecord*)malloc((store.count()+extra)*sizeof(nodeKeyRecord));
+  *n=0;
+
+  for (uint32_t i=0; i<store.slots(); i++)
+    if (store.slot(i)->flags & NODE_KEY_FLAG_USED)
+      records[(*n)++]=*store.slot(i);
+
+  return records;
+}
+
+int lockStore(const char* path) {
+
+  char lockPath[300];
+
+  snprintf(lockPath, sizeof(lockPath), "%s.lock", path);
+
+  int fd=open(lockPath, O_RDWR | O_CREAT, 0644);
+
+  if (fd<0 || flock(fd, LOCK_EX)<0) {
+    perror(lockPath);
+    exit(1);
+  }
+
+  return fd;
+}
+
+int build(const char* txtPath, const char* binPath) {
+
+  char line[200];
+  char addr[32], appskey[40], nwkskey[40], lsckey[40];
+  uint32_t n=0, size=1024;
+  int lineNumber=0, bad=0;
+
+  FILE* fp=fopen(txtPath, "r");
+
+  if (!fp) {
+    perror(txtPath);
+    return 1;
+  }
+
+  nodeKeyRecord* records=(nodeKeyRecord*)malloc(size*sizeof(nodeKeyRecord));
+
+  while (fgets(line, sizeof(line), fp)) {
+
+    lineNumber++;
+
+    int fields=sscanf(line, "%31s %39s %39s %39s", addr, appskey, nwkskey, lsckey);
+
+    if (fields<=0 || addr[0]=='#')
+      continue;
+
+    if (n==size) {
+      size*=2;
+      records=(nodeKeyRecord*)realloc(records, size*sizeof(nodeKeyRecord));
+    }
+
+    if (fields<3 || !makeRecord(&records[n], strtoul(addr, NULL, 0), appskey, nwkskey, fields==4 ? lsckey : NULL)) {
+      fprintf(stderr, "%s:%d: bad entry\n", txtPath, lineNumber);
+      bad++;
+      continue;
+    }
+
+    n++;
+  }
+
+  fclose(fp);
+
+  // the running gateways would lose the keys of the devices of the bad lines
+  if (bad) {
+    fprintf(stderr, "%d bad entries, %s is not written\n", bad, binPath);
+    free(records);
+    return 1;
+  }
+
+  int lockfd=lockStore(binPath);
+  int e=NodeKeyStore::write(binPath, records, n);
+  close(lockfd);
+
+  free(records);
+
+  if (e) {
+    perror(binPath);
+    return 1;
+  }
+
+  printf("%u entries written to %s\n", n, binPath);
+  return 0;
+}
+
+int set(const char* binPath, const char* addr, const char* appskey, const char* nwkskey, const char* lsckey) {
+
+  nodeKeyRecord r;
+  uint32_t n;
+
+  if (!makeRecord(&r, strtoul(addr, NULL, 0), appskey, nwkskey, lsckey)) {
+    fprintf(stderr, "bad key\n");
+    return 1;
+  }
+
+  int lockfd=lockStore(binPath);
+
+  nodeKeyRecord* records=readStore(binPath, &n, 1);
+  // NodeKeyStore::write() keeps the last record of a device
+  records[n++]=r;
+
+  int e=NodeKeyStore::write(binPath, records, n);
+
+  close(lockfd);
+  free(records);
+
+  if (e)
+    perror(binPath);
+
+  return e;
+}
+
+int del(const char* binPath, const char* addr) {
+
+  uint32_t n, k=0;
+  uint32_t devAddr=strtoul(addr, NULL, 0);
+
+  int lockfd=lockStore(binPath);
+
+  nodeKeyRecord* records=readStore(binPath, &n, 0);
+
+  for (uint32_t i=0; i<n; i++)
+    if (records[i].devAddr!=devAddr)
+      records[k++]=records[i];
+
+  int e=NodeKeyStore::write(binPath, records, k);
+
+  close(lockfd);
+  free(records);
+
+  if (e)
+    perror(binPath);
+
+  return e;
+}
+
+void printKey(const uint8_t* key) {
+  for (int i=0; i<16; i++)
+    printf("%02X", key[i]);
+}
+
+int dump(const char* binPath) {
+
+  NodeKeyStore store;
+
+  if (store.open(binPath)) {
+    fprintf(stderr, "cannot open key store %s\n", binPath);
+    return 1;
+  }
+
+  printf("# %u entries, %u slots\n", store.count(), store.slots());
+
+  for (uint32_t i=0; i<store.slots(); i++) {
+
+    const nodeKeyRecord* r=store.slot(i);
+
+    if (!(r->flags & NODE_KEY_FLAG_USED))
+      continue;
+
+    printf("0x%08X ", r->devAddr);
+
+    if (r->flags & NODE_KEY_FLAG_AES) {
+      printKey(r->appSKey);
+      printf(" ");
+      printKey(r->nwkSKey);
+    }
+    else
+      printf("- -");
+
+    if (r->flags & NODE_KEY_FLAG_LSC) {
+      printf(" ");
+      printKey(r->lscKey);
+    }
+
+    printf("\n");
+  }
+
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+  if (argc==4 && !strcmp(argv[1], "build"))
+    return build(argv[2], argv[3]);
+
+  if ((argc==6 || argc==7) && !strcmp(argv[1], "set"))
+    return set(argv[2], argv[3], argv[4], argv[5], argc==7 ? argv[6] : NULL);
+
+  if (argc==4 && !strcmp(argv[1], "del"))
+    return del(argv[2], argv[3]);
+
+  if (argc==3 && !strcmp(argv[1], "dump"))
+    return dump(argv[2]);
+
+  fprintf(stderr, "usage: %s build <keys.txt> <store>\n", argv[0]);
+  fprintf(stderr, "       %s set <store> <addr> <AppSKey|-> <NwkSKey|-> [LSCKey]\n", argv[0]);
+  fprintf(stderr, "       %s del <store> <addr>\n", argv[0]);
+  fprintf(stderr, "       %s dump <store>\n", argv[0]);
+
+  return 1;
+}
@@ -101,6 +101,7 @@ LORAWAN_HEADER_SIZE=13
 pdata="0,0,0,0,0,0,0,0"
 rdata="0,0,0,0"
 tdata="N/A"
+ddata=""
 
 short_info_1="N/A"
 short_info_2="N/A"
@@ -371,6 +372,8 @@ def check_downlink():
 	# - after reading downlink/downlink_post.txt, post_processing_gw.py deletes it
 	# - when a packet from device i is processed by post_processing_gw.py, it will check whether there is a queued message for i
 	# - if yes, then it generates a downlink/downlink.txt file with the queue message as content
+	# - a request with a "wor" key is for a device listening with wakeOnRadio() every "wor" ms, it is
+	#   written in downlink/downlink.txt right away as the device can be reached at any time
 	
 	if _verbose_downlink:	
 		print datetime.datetime.now()
@@ -394,7 +397,13 @@ def check_downlink():
 				print line_json
 				
 				if line_json["status"]=="send_request":
-					pending_downlink_requests.append(line)		
+					if "wor" in line_json:
+						print "post downlink: wake-on-radio request, write to "+_gw_downlink_file
+						f = open(os.path.expanduser(_gw_downlink_file),"a")
+						f.write(json.dumps(line_json)+'\n')
+						f.close()
+					else:
+						pending_downlink_requests.append(line)		
 	
 		#print pending_downlink_request
 		
@@ -616,9 +625,47 @@ imgsnA= {}
 qualityA = {}
 #association to get the cam id
 camidA = {}
+#association to get the last decoded image of a node and cam id, for the conditional replenishment
+lastImageA = {}
+#the preview of the image being received from each camera, see the ^v lines
+previewA = {}
 #global image seq number
 imgSN=0
 
+#bmp, or png or jpg for smaller files on the web pages, see ucam-images/web_image.h
+try:
+	_image_format = json_array["gateway_conf"]["image_format"]
+except KeyError:
+	_image_format = "bmp"
+
+#move a decoded image into the uploads folder of its node, it is then the last image of its camera
+#a preview replaces the previous preview of the same image and is removed with the image
+def move_decoded_image(node_id,cam_id,out,preview=False):
+	print "creating if needed the uploads/node_"+str(node_id)+" folder"
+	try:
+		os.mkdir(os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id)))
+	except OSError:
+		print "folder already exist"				 	 
+	print "moving decoded image file into " + os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id))
+	os.rename(os.path.expanduser("./"+out), os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id)+"/"+out))
+	
+	#the thumbnail of a png or jpg image
+	thumb=out[:-4]+"-thumb"+out[-4:]
+	
+	if (os.path.isfile(os.path.expanduser("./"+thumb))):
+		os.rename(os.path.expanduser("./"+thumb), os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id)+"/"+thumb))
+	
+	last_preview=previewA.pop((node_id,cam_id),None)
+	
+	if (preview):
+		previewA.update({(node_id,cam_id):os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id)+"/"+out)})
+	else:
+		lastImageA.update({(node_id,cam_id):os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id)+"/"+out)})
+		
+	if (last_preview!=None and last_preview!=previewA.get((node_id,cam_id)) and os.path.isfile(last_preview)):
+		os.remove(last_preview)
+	print "done"	
+
 def image_timeout():
 	#get the node which timer has expired first
 	#i.e. the one that received image packet earlier
@@ -635,8 +682,19 @@ def image_timeout():
 		' -src '+str(node_id)+\
 		' -camid '+str(camidA[node_id])+\
 		' -Q '+str(qualityA[node_id])+\
-		' -vflip'+\
-		' /home/pi/lora_gateway/ucam-images/128x128-test.bmp'
+		' -vflip'
+	
+	#also a png or jpg file and its thumbnail
+	if (_image_format!='bmp'):
+		cmd = cmd+' -web '+_image_format
+	
+	#the packets may only have the blocks that changed since the previous image of this camera
+	last_image=lastImageA.get((node_id,camidA[node_id]))
+	
+	if (last_image!=None and last_image.endswith('.bmp') and os.path.isfile(last_image)):
+		cmd = cmd+' -previous '+last_image
+		
+	cmd = cmd+' /home/pi/lora_gateway/ucam-images/128x128-test.bmp'
 	
 	print "decoding with command"
 	print cmd
@@ -655,14 +713,14 @@ def image_timeout():
 			out = out.replace('\r','')
 			out = out.replace('\n','')
 			print "producing file " + out
-			print "creating if needed the uploads/node_"+str(node_id)+" folder"
-			try:
-				os.mkdir(os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id)))
-			except OSError:
-				print "folder already exist"				 	 
-			print "moving decoded image file into " + os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id))
-			os.rename(os.path.expanduser("./"+out), os.path.expanduser(_web_folder_path+"images/uploads/node_"+str(node_id)+"/"+out))
-			print "done"	
+			
+			if (_image_format=='bmp'):
+				move_decoded_image(node_id,camidA[node_id],out)
+			else:
+				move_decoded_image(node_id,camidA[node_id],out[:-4]+"."+_image_format)
+				#the BMP file is not on the web pages, it is the previous image of the next image of this camera
+				os.rename(os.path.expanduser("./"+out), os.path.expanduser(_folder_path+"images/"+out))
+				lastImageA.update({(node_id,camidA[node_id]):os.path.expanduser(_folder_path+"images/"+out)})
 
 	except subprocess.CalledProcessError:
 		print "launching image decoding failed!"
@@ -793,9 +851,6 @@ if (_gw_downlink):
 	else:
 		print "post downlink: none existing downlink-post-queued.txt"			
 
-	print "Loading lib to compute downlink MIC"
-	from loraWAN import loraWAN_get_MIC
-
 	print "Starting thread to check for downlink requests every %d seconds" % _gw_downlink
 	sys.stdout.flush()
 	t_downlink = threading.Thread(target=downlink_target)
@@ -855,6 +910,16 @@ while True:
 	#	^$	indicates an output (debug or log purposes) from the gateway that should be logged in the (Dropbox) gateway.log file 
 	#		example: ^$Set LoRa mode 4
 	#
+	#	^d	indicates the numeric values of the next data, already parsed by the gateway (see SensorPayload.h)
+	#		^dprefix;name=value;... with value as integer[e-decimals], empty name for a single value
+	#		example: ^d!;TC=235e-1;HU=60 for \!TC/23.5/HU/60
+	#
+	#	^i	indicates an image decoded by the gateway (--img option, see ImageDecoder.h) ^isrc(%d),camid(%d),file
+	#		example: ^i6,0,ucam_0-node_0006-cam_0-Q20-P13-S1370.bmp
+	#
+	#	^v	indicates the preview of an image being received (--preview option) ^vsrc(%d),camid(%d),file
+	#		example: ^v6,0,ucam_0-node_0006-cam_0-Q20-preview.bmp
+	#
 	#	^l	indicates a ctrl LAS info ^lsrc(%d),type(%d)
 	#		type is 1 for DSP_REG, 2 for DSP_INIT, 3 for DSP_UPDT, 4 for DSP_DATA 
 	#		example: ^l3,4
@@ -894,6 +959,8 @@ while True:
 		
 		if (ch=='p'):		
 			pdata = sys.stdin.readline()
+			#a ^d line, if any, comes after ^p
+			ddata=""
 			print now.isoformat()
 			print "rcv ctrl pkt info (^p): "+pdata,
 			arr = map(int,pdata.split(','))
@@ -945,16 +1012,8 @@ while True:
 					print "post downlink: generate "+_gw_downlink_file+" from entry"
 					print downlink_request.replace('\n','')
 					
-					#generate the MIC corresponding to the clear data and the destination device address
-					#it is possible to have a broadcast address but since the only device that is listening 
-					#is the one that has sent a packet, there is little interest in doing so
-					#so currently, we use the sending device's address to compute the MIC
-					MIC=loraWAN_get_MIC(src,request_json["data"])
-					#add the 4 byte MIC information into the json line
-					request_json['MIC0']=hex(MIC[0])
-					request_json['MIC1']=hex(MIC[1])
-					request_json['MIC2']=hex(MIC[2])
-					request_json['MIC3']=hex(MIC[3])
+					#the 4-byte MIC is computed by the low-level gateway at send time
+					#with the keys of the destination device from node_keys.bin, built and updated with node_keys_tool
 					
 					downlink_json=[]
 					downlink_json.append(request_json)
@@ -1008,6 +1067,31 @@ while True:
 			else:
 				tdata = tdata+"+00:00"
 									
+		if (ch=='d'):
+			ddata = sys.stdin.readline()
+			print "rcv parsed values (^d): "+ddata,
+			
+		if (ch=='i'):
+			idata = sys.stdin.readline()
+			print "rcv decoded image (^i): "+idata,
+			arr = idata.replace('\n','').split(',')
+			#the gateway writes the file in the current folder
+			try:
+				move_decoded_image(int(arr[0]),int(arr[1]),arr[2])
+			except (OSError, IndexError, ValueError):
+				print "moving decoded image failed!"
+			sys.stdout.flush()
+			
+		if (ch=='v'):
+			vdata = sys.stdin.readline()
+			print "rcv image preview (^v): "+vdata,
+			arr = vdata.replace('\n','').split(',')
+			try:
+				move_decoded_image(int(arr[0]),int(arr[1]),arr[2],True)
+			except (OSError, IndexError, ValueError):
+				print "moving image preview failed!"
+			sys.stdout.flush()
+			
 		if (ch=='l'):
 			#TODO: LAS service	
 			print "not implemented yet"
@@ -1087,7 +1171,7 @@ while True:
 						cloud_script=_enabled_clouds[cloud_index]
 						print "uploading with "+cloud_script
 						sys.stdout.flush()
-						cmd_arg=cloud_script+" \""+ldata.replace('\n','').replace('\0','')+"\""+" \""+pdata.replace('\n','')+"\""+" \""+rdata.replace('\n','')+"\""+" \""+tdata.replace('\n','')+"\""+" \""+_gwid.replace('\n','')+"\""
+						cmd_arg=cloud_script+" \""+ldata.replace('\n','').replace('\0','')+"\""+" \""+pdata.replace('\n','')+"\""+" \""+rdata.replace('\n','')+"\""+" \""+tdata.replace('\n','')+"\""+" \""+_gwid.replace('\n','')+"\""+" \""+ddata.replace('\n','')+"\""
 					except UnicodeDecodeError, ude:
 						print ude
 					else:
@@ -1114,6 +1198,8 @@ while True:
 			print "invalid app key: discard data"
 			getAllLine()
 
+		#the ^d line only applies to this data line, the samples of a batch have no ^p line that would reset it
+		ddata=""
 		continue
 	
 	#handle low-level gateway data
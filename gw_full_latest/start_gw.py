@@ -92,6 +92,24 @@ def start_config_from_json() :
 			call_string_cpp += " --ndl"	
 	except KeyError:
 		pass
+
+	try:			
+		if gateway_json_array["gateway_conf"]["replay_check"] :
+			call_string_cpp += " --fcnt"
+	except KeyError:
+		pass
+
+	try:			
+		if gateway_json_array["gateway_conf"]["image_decoding"] :
+			call_string_cpp += " --img"
+			#in seconds, -1 for no preview
+			if gateway_json_array["gateway_conf"]["image_preview"] >= 0 :
+				call_string_cpp += " --preview "+str(gateway_json_array["gateway_conf"]["image_preview"])
+			#bmp, png or jpg
+			if gateway_json_array["gateway_conf"]["image_format"] != "bmp" :
+				call_string_cpp += " --imgformat "+gateway_json_array["gateway_conf"]["image_format"]
+	except KeyError:
+		pass
 			
 	print call_string_cpp+call_string_python+call_string_log_gw
 	#launch the commands
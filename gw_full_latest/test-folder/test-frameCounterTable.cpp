@@ -0,0 +1,339 @@
+/*
+ *  Correctness and speed test of FrameCounterTable.cpp
+ *
+ *  > g++ -O2 -I.. test-frameCounterTable.cpp ../FrameCounterTable.cpp -o test-frameCounterTable
+ *  > ./test-frameCounterTable
+ *
+ *  - 8-bit native and 16-bit LoRaWAN counters: wrap-around, duplicates and replays
+ *  - power loss: a child process accepts 1000 frames of 54 nodes then _exit()s without checkpoint,
+ *    the table file is then set back to its last checkpoint as if its pages had not been written,
+ *    and open() must find the last counter of each node from the log
+ *  - a table created while the log of a previous table exists must not replay it
+ *  - a full table still accepts the frames of the nodes it cannot keep
+ *  - the time of an accepted and of a rejected frame, with the bytes written to storage per accepted
+ *    frame from /proc/self/io if the kernel gives them
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "FrameCounterTable.h"
+
+#include "check.h"
+
+#define TABLE "test-frameCounterTable.bin"
+#define WAL TABLE ".wal"
+
+#define NODES 54
+#define FRAMES 1000
+
+double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+void removeTable() {
+  unlink(TABLE);
+  unlink(WAL);
+}
+
+void wrapAndDuplicates() {
+
+  FrameCounterTable table;
+
+  removeTable();
+  CHECK(table.open(TABLE)==0 && table.count()==0);
+
+  CHECK(table.lastCounter(FCNT_KIND_NATIVE, 5)==-1);
+  CHECK(table.check(FCNT_KIND_NATIVE, 5, 250));
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 250));
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 249));
+  CHECK(table.check(FCNT_KIND_NATIVE, 5, 251));
+  CHECK(table.check(FCNT_KIND_NATIVE, 5, 255));
+
+  // the 8-bit packnum wraps
+  CHECK(table.check(FCNT_KIND_NATIVE, 5, 0));
+  CHECK(table.lastCounter(FCNT_KIND_NATIVE, 5)==0);
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 0));
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 255));
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 200));
+
+  // ahead by less than half the range
+  CHECK(table.check(FCNT_KIND_NATIVE, 5, 127));
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 255));
+  CHECK(table.check(FCNT_KIND_NATIVE, 5, 0x100+128));
+  CHECK(table.lastCounter(FCNT_KIND_NATIVE, 5)==128);
+
+  // a rejected frame is not logged
+  uint32_t pending=table.pending();
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 128));
+  CHECK(table.pending()==pending);
+
+  // LoRaWAN counters of the same address are kept apart
+  CHECK(table.lastCounter(FCNT_KIND_LORAWAN, 5)==-1);
+  CHECK(table.check(FCNT_KIND_LORAWAN, 5, 0xFFFE));
+  CHECK(table.check(FCNT_KIND_LORAWAN, 5, 0xFFFF));
+  CHECK(table.check(FCNT_KIND_LORAWAN, 5, 0x10000));
+  CHECK(table.lastCounter(FCNT_KIND_LORAWAN, 5)==0);
+  CHECK(!table.check(FCNT_KIND_LORAWAN, 5, 0xFFFF));
+  CHECK(table.check(FCNT_KIND_LORAWAN, 5, 0x7FFF));
+  CHECK(!table.check(FCNT_KIND_LORAWAN, 5, 0xFFFF));
+  CHECK(table.lastCounter(FCNT_KIND_NATIVE, 5)==128);
+  CHECK(table.count()==2);
+
+  table.close();
+
+  CHECK(table.open(TABLE)==0 && table.count()==2 && table.pending()==0);
+  CHECK(table.lastCounter(FCNT_KIND_NATIVE, 5)==128 && table.lastCounter(FCNT_KIND_LORAWAN, 5)==0x7FFF);
+  CHECK(!table.check(FCNT_KIND_NATIVE, 5, 128));
+}
+
+// set the records of the table file to the counters of its checkpoint
+void loseTablePages(const long* counters) {
+
+  frameCounterTableHeader header;
+  frameCounterRecord r;
+  FILE* fp=fopen(TABLE, "r+b");
+
+  fread(&header, sizeof(header), 1, fp);
+  header.count=0;
+
+  for (uint32_t i=0; i < ((uint32_t)1 << FCNT_TABLE_SLOT_BITS); i++) {
+
+    long offset=sizeof(header)+i*sizeof(r);
+
+    fseek(fp, offset, SEEK_SET);
+    fread(&r, sizeof(r), 1, fp);
+
+    if (!r.kind)
+      continue;
+
+    if (counters[r.addr]<0)
+      memset(&r, 0, sizeof(r));
+    else {
+      r.fcnt=counters[r.addr];
+      header.count++;
+    }
+
+    fseek(fp, offset, SEEK_SET);
+    fwrite(&r, sizeof(r), 1, fp);
+  }
+
+  fseek(fp, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, fp);
+  fclose(fp);
+}
+
+void powerLoss() {
+
+  uint8_t node[FRAMES], fcnt[FRAMES];
+  bool accepted[FRAMES];
+  long next[NODES+1], last[NODES+1], checkpointed[NODES+1];
+  FrameCounterTable table;
+
+  // the frames of the nodes 1 to NODES, with some of them sent again
+  srand(1);
+  for (int n=0; n<=NODES; n++)
+    next[n]=rand() & 0xFF;
+
+  for (int i=0; i<FRAMES; i++) {
+    node[i]=1+rand()%NODES;
+    fcnt[i]=(rand()%20==0) ? next[node[i]]-1-rand()%3 : next[node[i]]++;
+  }
+
+  removeTable();
+
+  pid_t pid=fork();
+
+  if (pid==0) {
+    FrameCounterTable child;
+
+    if (child.open(TABLE))
+      _exit(2);
+
+    for (int i=0; i<FRAMES; i++)
+      child.check(FCNT_KIND_NATIVE, node[i], fcnt[i]);
+
+    // neither close() nor checkpoint()
+    _exit(0);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status)==0);
+
+  // the same frames give the accepted counters and their log sequence numbers
+  for (int n=0; n<=NODES; n++)
+    last[n]=-1;
+
+  int naccepted=0;
+
+  for (int i=0; i<FRAMES; i++) {
+    accepted[i]=last[node[i]]<0 || (((fcnt[i]-last[node[i]]) & 0xFF)!=0 && ((fcnt[i]-last[node[i]]) & 0xFF)<=127);
+    if (accepted[i]) {
+      last[node[i]]=fcnt[i];
+      naccepted++;
+    }
+  }
+
+  frameCounterTableHeader header;
+  FILE* fp=fopen(TABLE, "rb");
+  fread(&header, sizeof(header), 1, fp);
+  fclose(fp);
+
+  // check() has checkpointed before the log ring is full, the last records are only in the log
+  CHECK(header.checkpointSeq>0 && header.checkpointSeq<(uint32_t)naccepted &&
+        naccepted-header.checkpointSeq<FCNT_WAL_RECORDS);
+
+  for (int n=0; n<=NODES; n++)
+    checkpointed[n]=-1;
+
+  for (int i=0, seq=0; i<FRAMES; i++)
+    if (accepted[i] && ++seq<=(int)header.checkpointSeq)
+      checkpointed[node[i]]=fcnt[i];
+
+  loseTablePages(checkpointed);
+
+  CHECK(table.open(TABLE)==0);
+
+  int recovered=0, known=0;
+
+  for (int n=1; n<=NODES; n++) {
+    known+=last[n]>=0;
+    recovered+=last[n]>=0 && table.lastCounter(FCNT_KIND_NATIVE, n)==last[n];
+  }
+
+  CHECK(recovered==known && table.count()==(uint32_t)known);
+
+  for (int i=0; i<FRAMES; i++)
+    CHECK(!table.check(FCNT_KIND_NATIVE, node[i], fcnt[i]));
+
+  printf("power loss after %d accepted frames of %d: %d of %d nodes recovered, %d frames from the log\n",
+    naccepted, FRAMES, recovered, known, naccepted-header.checkpointSeq);
+}
+
+void staleLog() {
+
+  FrameCounterTable table;
+
+  removeTable();
+  CHECK(table.open(TABLE)==0);
+
+  for (int n=1; n<=10; n++)
+    CHECK(table.check(FCNT_KIND_NATIVE, n, 100));
+
+  // the log has records above the checkpoint of a new table
+  table.close();
+  unlink(TABLE);
+
+  CHECK(table.open(TABLE)==0 && table.count()==0);
+
+  for (int n=1; n<=10; n++)
+    CHECK(table.lastCounter(FCNT_KIND_NATIVE, n)==-1);
+
+  CHECK(table.check(FCNT_KIND_NATIVE, 1, 50));
+  table.close();
+
+  CHECK(table.open(TABLE)==0 && table.count()==1 && table.lastCounter(FCNT_KIND_NATIVE, 1)==50);
+  CHECK(table.lastCounter(FCNT_KIND_NATIVE, 2)==-1);
+}
+
+void fullTable() {
+
+  FrameCounterTable table;
+  uint32_t capacity=3*((uint32_t)1 << FCNT_TABLE_SLOT_BITS)/4;
+
+  removeTable();
+  CHECK(table.open(TABLE)==0);
+
+  for (uint32_t n=0; n<capacity; n++)
+    CHECK(table.check(FCNT_KIND_LORAWAN, 0x26010000+n, 1));
+
+  CHECK(table.count()==capacity);
+
+  // a node that does not fit is accepted but not kept
+  CHECK(table.check(FCNT_KIND_LORAWAN, 0x27000000, 1));
+  CHECK(table.check(FCNT_KIND_LORAWAN, 0x27000000, 1));
+  CHECK(table.lastCounter(FCNT_KIND_LORAWAN, 0x27000000)==-1 && table.count()==capacity);
+
+  CHECK(!table.check(FCNT_KIND_LORAWAN, 0x26010000, 1));
+  CHECK(table.check(FCNT_KIND_LORAWAN, 0x26010000+capacity-1, 2));
+
+  table.close();
+
+  CHECK(table.open(TABLE)==0 && table.count()==capacity);
+  CHECK(table.lastCounter(FCNT_KIND_LORAWAN, 0x26010000+capacity-1)==2);
+  CHECK(table.lastCounter(FCNT_KIND_LORAWAN, 0x27000000)==-1);
+}
+
+// bytes written to storage by the process, -1 if unknown
+long writeBytes() {
+
+  char line[100];
+  long bytes=-1;
+  FILE* fp=fopen("/proc/self/io", "r");
+
+  if (!fp)
+    return -1;
+
+  while (fgets(line, sizeof(line), fp))
+    sscanf(line, "write_bytes: %ld", &bytes);
+
+  fclose(fp);
+  return bytes;
+}
+
+void speed() {
+
+  FrameCounterTable table;
+
+  removeTable();
+  CHECK(table.open(TABLE)==0);
+
+  long bytes=writeBytes();
+  double t=now();
+
+  for (int i=0; i<FRAMES; i++)
+    CHECK(table.check(FCNT_KIND_NATIVE, 1+i%100, i/100));
+
+  double acceptTime=now()-t;
+  table.checkpoint();
+
+  if (bytes>=0)
+    bytes=writeBytes()-bytes;
+
+  int rejected=0;
+  t=now();
+
+  for (int k=0; k<1000; k++)
+    for (int i=0; i<FRAMES; i++)
+      rejected+=!table.check(FCNT_KIND_NATIVE, 1+i%100, i/100);
+
+  double rejectTime=now()-t;
+
+  CHECK(rejected==1000*FRAMES);
+
+  printf("accepted frame %8.1f us", acceptTime*1e6/FRAMES);
+  if (bytes>=0)
+    printf(", %.1f KB written with the checkpoints", bytes/1024.0/FRAMES);
+  printf("\nrejected frame %8.1f ns\n", rejectTime*1e9/(1000*FRAMES));
+}
+
+int main() {
+
+  wrapAndDuplicates();
+  powerLoss();
+  staleLog();
+  fullTable();
+  speed();
+
+  removeTable();
+
+  printf("%d failure(s)\n", failures);
+  return failures ? 1 : 0;
+}
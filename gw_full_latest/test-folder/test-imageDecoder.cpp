@@ -0,0 +1,889 @@
+/*
+ *  Correctness and speed test of ImageDecoder.cpp
+ *
+ *  > g++ -O2 ../ucam-images/decode_to_bmp.c -o decode_to_bmp
+ *  > g++ -O2 -I.. test-imageDecoder.cpp ../ImageDecoder.cpp -o test-imageDecoder
+ *  > ./test-imageDecoder
+ *
+ *  - the packets of ucam-images/test-Q20.dat are decoded by ImageDecoder and by the functions of
+ *    decode_to_bmp.c, all of them then with lost packets. The quantized coefficients of this
+ *    image are also packetized again with the changed blocks only, as progressive scans and with
+ *    parity packets. The pixels of both decoders may only differ by 1 (integer IDCT)
+ *  - several images from several nodes and cameras are received at the same time, each one must
+ *    give the same image as when it is received alone
+ *  - the previews of an image that is being received are the images of the packets received so far,
+ *    written no more than once every preview interval and only with new blocks
+ *  - the images/s of the flow of post_processing_gw.py (the .dat file then one decode_to_bmp
+ *    process per image), of decode_to_bmp.c in the same process and of ImageDecoder
+ *  - the CPU time per packet and per preview, then the time from the reception of a packet to a
+ *    BMP file with its blocks, for packets sent every DEFAULT_INTER_PKT_TIME of Arduino_LoRa_ucamII
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "ImageDecoder.h"
+
+// the decoder of decode_to_bmp
+namespace gw {
+#define main decode_to_bmp_main
+#include "../ucam-images/decode_to_bmp.c"
+#undef main
+}
+
+extern char **environ;
+
+#include "check.h"
+
+#define W IMG_WIDTH
+#define H IMG_HEIGHT
+#define MAX_PACKETS 64
+#define BLOCKS_PER_PACKET 20
+
+struct packet { uint16_t offset; int size; uint8_t data[IMG_MAX_PACKET_SIZE]; };
+
+struct stream { int n; packet p[MAX_PACKETS]; };
+
+char templateFile[PATH_MAX];
+char folder[PATH_MAX];
+
+gw::BMPImageStruct image;
+// quantized coefficients of test-Q20.dat, in the interleaved order of the blocks
+int coefs[IMG_BLOCKS][64];
+
+double now() {
+
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec+t.tv_nsec/1e9;
+}
+
+void writeDat(FILE* f, const stream* s, const bool* lost) {
+
+  for (int k=0; k<s->n; k++) {
+    if (lost && lost[k])
+      continue;
+
+    fprintf(f, "%04X %02X %02X ", s->p[k].size+2, s->p[k].offset >> 8, s->p[k].offset & 0xFF);
+
+    for (int x=0; x<s->p[k].size; x++)
+      fprintf(f, "%02X ", s->p[k].data[x]);
+  }
+}
+
+// decode_to_bmp, the pixels as written in the BMP file, previous for the changed blocks only
+void referenceDecode(const stream* s, const bool* lost, uint8_t pixels[H][W], uint8_t previous[H][W], int Q) {
+
+  FILE* dat=tmpfile();
+
+  writeDat(dat, s, lost);
+  rewind(dat);
+
+  gw::QTinitialization(Q);
+
+  for (int i=0; i<H; i++)
+    for (int j=0; j<W; j++)
+      image.data[i][j]=0.0;
+
+  memset(gw::receivedBlock, 0, IMG_BLOCKS*sizeof(bool));
+  gw::nbReceivedBlocks=0;
+  gw::replenishment=false;
+
+  FILE* dataFile=gw::FECdecoding(dat);
+
+  while (gw::JPEGdepacketization(&image, dataFile))
+    ;
+
+  if (dataFile!=dat)
+    fclose(dataFile);
+
+  fclose(dat);
+  gw::JPEGdecoding(&image, &image);
+
+  if (gw::replenishment && previous) {
+    gw::BMPImageStruct prev=image;
+
+    prev.data=gw::AllocateMemSpace(W, H);
+
+    for (int i=0; i<H; i++)
+      for (int j=0; j<W; j++)
+        prev.data[i][j]=previous[i][j];
+
+    gw::PatchImage(&image, &prev);
+
+    for (int i=0; i<H; i++)
+      free(prev.data[i]);
+
+    free(prev.data);
+  }
+
+  for (int i=0; i<H; i++)
+    for (int j=0; j<W; j++)
+      pixels[i][j]=(unsigned char)image.data[i][j];
+}
+
+// the data[row][col] of decode_to_bmp from a BMP file written without vflip
+bool readPixels(const char* file, uint8_t pixels[H][W]) {
+
+  FILE* f=fopen(file, "rb");
+  uint8_t header[1078];
+
+  if (!f)
+    return false;
+
+  bool ok=fread(header, sizeof(header), 1, f)==1;
+
+  for (int row=H-1; row>=0 && ok; row--)
+    ok=fread(pixels[row], W, 1, f)==1;
+
+  fclose(f);
+  return ok;
+}
+
+// the image packet as received by the gateway
+int radioPacket(const packet* p, uint16_t src, uint8_t cam, uint8_t seq, uint8_t Q, uint8_t* buf) {
+
+  buf[0]=0xFF;
+  buf[1]=0x50+cam;
+  buf[2]=src >> 8;
+  buf[3]=src & 0xFF;
+  buf[4]=seq;
+  buf[5]=Q;
+  buf[6]=p->size+2;
+  buf[7]=p->offset >> 8;
+  buf[8]=p->offset & 0xFF;
+  memcpy(buf+9, p->data, p->size);
+
+  return 9+p->size;
+}
+
+int decodeStream(ImageDecoder* decoder, const stream* s, const bool* lost, uint16_t src, uint8_t cam, uint8_t Q, imageDecoderResult* result) {
+
+  uint8_t buf[300];
+  int seq=0;
+
+  for (int k=0; k<s->n; k++, seq++)
+    if (!lost || !lost[k])
+      CHECK(decoder->addPacket(buf, radioPacket(&s->p[k], src, cam, seq, Q, buf), 0));
+
+  return decoder->nextImage(0, result, true);
+}
+
+// max difference of the pixels decoded by ImageDecoder and decode_to_bmp
+int compare(ImageDecoder* decoder, const stream* s, const bool* lost, uint16_t src, uint8_t cam, int Q,
+            uint8_t previous[H][W], uint8_t decoded[H][W], imageDecoderResult* result) {
+
+  static uint8_t reference[H][W];
+  char file[PATH_MAX];
+  int maxDiff=0;
+
+  referenceDecode(s, lost, reference, previous, Q);
+
+  if (!decodeStream(decoder, s, lost, src, cam, Q, result) || result->error)
+    return 256;
+
+  snprintf(file, sizeof(file), "%s/%s", folder, result->file);
+
+  if (!readPixels(file, decoded))
+    return 256;
+
+  unlink(file);
+
+  for (int i=0; i<H; i++)
+    for (int j=0; j<W; j++)
+      if (abs(decoded[i][j]-reference[i][j])>maxDiff)
+        maxDiff=abs(decoded[i][j]-reference[i][j]);
+
+  return maxDiff;
+}
+
+// the packetization of the sketch, with a fixed number of blocks per packet
+gw::opj_mqc_t mqobjet, *objet=&mqobjet;
+uint8_t buffer[MQC_NUMCTXS];
+
+void golomb(unsigned int value) {
+
+  for (unsigned int x=0; x<value/2; x++)
+    gw::mqc_encode(objet, 1);
+
+  gw::mqc_encode(objet, 0);
+  gw::mqc_encode(objet, value%2);
+}
+
+void beginPacket(stream* s, uint16_t offset) {
+
+  memset(buffer, 0, sizeof(buffer));
+  gw::mqc_init_enc(objet, buffer);
+  gw::mqc_resetstates(objet);
+  s->p[s->n].offset=offset;
+}
+
+void endPacket(stream* s, int blocks) {
+
+  packet* p=&s->p[s->n++];
+  int first=(p->offset >> 12 & 0x7) && (p->offset & 0x8000)==0 ? 1 : 0;
+
+  gw::mqc_flush(objet);
+  p->size=gw::mqc_numbytes(objet)+first;
+  memcpy(p->data+first, buffer, p->size-first);
+
+  // the number of blocks of a progressive packet
+  if (first)
+    p->data[0]=blocks;
+}
+
+// the coefficients first to last-1, K is not coded for the DC band
+void encodeBlock(const int* c, int first, int last) {
+
+  int K=last-1;
+
+  while (K>first && c[gw::ZigzagCoordinates[K].row*8+gw::ZigzagCoordinates[K].col]==0)
+    K--;
+
+  if (c[gw::ZigzagCoordinates[K].row*8+gw::ZigzagCoordinates[K].col]!=0 || first==0)
+    K++;
+
+  K-=first;
+
+  if (last-first>1)
+    golomb(K);
+
+  for (int x=first; x<first+K; x++) {
+    int v=c[gw::ZigzagCoordinates[x].row*8+gw::ZigzagCoordinates[x].col];
+
+    golomb(v>=0 ? 2*v : 2*abs(v)-1);
+  }
+}
+
+void wholeBlocks(stream* s, int c[IMG_BLOCKS][64]) {
+
+  s->n=0;
+
+  for (int b=0; b<IMG_BLOCKS; b+=BLOCKS_PER_PACKET) {
+    beginPacket(s, b);
+
+    for (int x=b; x<b+BLOCKS_PER_PACKET && x<IMG_BLOCKS; x++)
+      encodeBlock(c[x], 0, 64);
+
+    endPacket(s, 0);
+  }
+}
+
+// the changed blocks, each one after the number of unchanged blocks skipped and an end mark
+void changedBlocks(stream* s, int c[IMG_BLOCKS][64], const bool* changed) {
+
+  int inPacket=0, next=0;
+
+  s->n=0;
+
+  for (int b=0; b<IMG_BLOCKS; b++) {
+    if (!changed[b])
+      continue;
+
+    if (inPacket==0) {
+      beginPacket(s, b | 0x8000);
+      next=b;
+    }
+
+    golomb(b-next);
+    encodeBlock(c[b], 0, 64);
+    next=b+1;
+
+    if (++inPacket==BLOCKS_PER_PACKET) {
+      golomb(0);
+      golomb(0);
+      endPacket(s, 0);
+      inPacket=0;
+    }
+  }
+
+  if (inPacket) {
+    golomb(0);
+    golomb(0);
+    endPacket(s, 0);
+  }
+}
+
+void progressiveScans(stream* s, int c[IMG_BLOCKS][64]) {
+
+  s->n=0;
+
+  for (int scan=1; scan<=PROGRESSIVE_SCANS; scan++)
+    for (int b=0; b<IMG_BLOCKS; b+=2*BLOCKS_PER_PACKET) {
+      int n=0;
+
+      beginPacket(s, b | scan << 12);
+
+      for (int x=b; x<b+2*BLOCKS_PER_PACKET && x<IMG_BLOCKS; x++, n++)
+        encodeBlock(c[x], gw::ProgressiveBands[scan-1], gw::ProgressiveBands[scan]);
+
+      endPacket(s, n);
+    }
+}
+
+// k data packets then m parity packets, see packet_fec.h
+void parityPackets(stream* s, const stream* data, int k, int m) {
+
+  gw::FECinit();
+  s->n=0;
+
+  for (int g=0; g*k<data->n; g++) {
+    int count=data->n-g*k<k ? data->n-g*k : k;
+    int length=0;
+
+    for (int i=0; i<count; i++) {
+      s->p[s->n++]=data->p[g*k+i];
+
+      if (data->p[g*k+i].size+1>length)
+        length=data->p[g*k+i].size+1;
+    }
+
+    for (int j=0; j<m; j++) {
+      packet* p=&s->p[s->n++];
+
+      p->offset=0x7000 | j << 8 | g;
+      p->data[0]=count;
+
+      for (int i=0; i<count; i++) {
+        p->data[1+2*i]=data->p[g*k+i].offset >> 8;
+        p->data[2+2*i]=data->p[g*k+i].offset & 0xFF;
+      }
+
+      uint8_t* parity=p->data+1+2*count;
+
+      memset(parity, 0, length);
+
+      for (int i=0; i<count; i++) {
+        gw::FECPacketStruct v;
+
+        v.size=data->p[g*k+i].size;
+        memcpy(v.data, data->p[g*k+i].data, v.size);
+
+        for (int t=0; t<length; t++)
+          parity[t]^=gw::FECmul(gw::FECcoef(j, i), gw::FECvector(&v, t));
+      }
+
+      p->size=1+2*count+length;
+    }
+  }
+}
+
+void correctness(ImageDecoder* decoder) {
+
+  static stream dat, s, fec;
+  static uint8_t full[H][W], decoded[H][W], previous[H][W];
+  static int changed[IMG_BLOCKS][64];
+  imageDecoderResult result;
+  bool lost[MAX_PACKETS], isChanged[IMG_BLOCKS];
+  unsigned int size, hi, lo, byte;
+  FILE* f=fopen("../ucam-images/test-Q20.dat", "r");
+
+  CHECK(f!=NULL);
+
+  if (!f)
+    return;
+
+  dat.n=0;
+
+  while (dat.n<MAX_PACKETS && fscanf(f, "%4X %2X %2X", &size, &hi, &lo)==3) {
+    dat.p[dat.n].offset=hi << 8 | lo;
+    dat.p[dat.n].size=size-2;
+
+    for (unsigned int x=0; x<size-2 && fscanf(f, "%2X", &byte)==1; x++)
+      dat.p[dat.n].data[x]=byte;
+
+    dat.n++;
+  }
+
+  fclose(f);
+
+  // all the packets
+  CHECK(compare(decoder, &dat, NULL, 6, 0, 20, NULL, full, &result)<=1);
+  CHECK(result.npkt==dat.n && result.nbReceivedBlocks==IMG_BLOCKS && !result.replenishment);
+
+  // the quantized coefficients of the image, JPEGdecoding() transforms them in place
+  gw::QTinitialization(20);
+
+  for (int i=0; i<H; i++)
+    for (int j=0; j<W; j++)
+      image.data[i][j]=0.0;
+
+  FILE* tmp=tmpfile();
+
+  writeDat(tmp, &dat, NULL);
+  rewind(tmp);
+
+  while (gw::JPEGdepacketization(&image, tmp))
+    ;
+
+  fclose(tmp);
+
+  for (int b=0; b<IMG_BLOCKS; b++) {
+    int row=(b*8)/W*8, col=(b*8)%W;
+    int row_mix=((row*5)+(col*8))%W, col_mix=((row*8)+(col*13))%H;
+
+    for (int x=0; x<64; x++)
+      coefs[b][x]=(int)image.data[row_mix+x/8][col_mix+x%8];
+  }
+
+  // the same image from the packets made again
+  wholeBlocks(&s, coefs);
+  CHECK(compare(decoder, &s, NULL, 6, 0, 20, NULL, decoded, &result)<=1);
+  CHECK(memcmp(decoded, full, sizeof(full))==0);
+
+  // lost packets
+  for (int seed=1; seed<=20; seed++) {
+    srand(seed);
+
+    for (int k=0; k<dat.n; k++)
+      lost[k]=rand()%4==0;
+
+    CHECK(compare(decoder, &dat, lost, 6, 0, 20, NULL, decoded, &result)<=1);
+  }
+
+  // progressive scans, all of them then the first ones
+  progressiveScans(&s, coefs);
+  CHECK(compare(decoder, &s, NULL, 6, 0, 20, NULL, decoded, &result)<=1);
+  CHECK(memcmp(decoded, full, sizeof(full))==0);
+
+  for (int k=0; k<s.n; k++)
+    lost[k]=k>=s.n/3;
+
+  CHECK(compare(decoder, &s, lost, 6, 0, 20, NULL, decoded, &result)<=1);
+
+  // a first image of a camera, then only the changed blocks of the next one
+  CHECK(compare(decoder, &dat, NULL, 7, 1, 20, NULL, previous, &result)<=1);
+
+  for (int b=0; b<IMG_BLOCKS; b++) {
+    isChanged[b]=b%5==2 || (b>=100 && b<130);
+    memcpy(changed[b], coefs[b], sizeof(changed[b]));
+
+    if (isChanged[b])
+      changed[b][0]+=3;
+  }
+
+  changedBlocks(&s, changed, isChanged);
+  CHECK(compare(decoder, &s, NULL, 7, 1, 20, previous, decoded, &result)<=1);
+  CHECK(result.replenishment && result.nbReceivedBlocks==75);
+
+  // the unchanged blocks come from the previous image
+  CHECK(decoded[0][0]==previous[0][0]);
+
+  // parity packets, any 2 lost packets of a group of 8 are recovered
+  parityPackets(&fec, &dat, 8, 2);
+
+  for (int first=0; first<fec.n-1; first++) {
+    for (int k=0; k<fec.n; k++)
+      lost[k]=k==first || k==first+1;
+
+    CHECK(compare(decoder, &fec, lost, 6, 0, 20, NULL, decoded, &result)<=1);
+    CHECK(result.nbLostPackets==0);
+    CHECK(memcmp(decoded, full, sizeof(full))==0);
+  }
+
+  // 3 lost packets of a group
+  for (int k=0; k<fec.n; k++)
+    lost[k]=k<3;
+
+  CHECK(compare(decoder, &fec, lost, 6, 0, 20, NULL, decoded, &result)<=1);
+  CHECK(result.nbLostPackets==3 && result.nbRecoveredPackets==0);
+}
+
+// the packets of several images received at the same time, from nodes nodes and cams cameras
+// with more than IMG_MAX_IMAGES images, the oldest one is finished for a new one: no packet is lost
+void concurrent(ImageDecoder* decoder, const stream* s, int nodes, int cams, int images, bool check) {
+
+  uint8_t buf[300];
+  imageDecoderResult result;
+  static uint8_t alone[H][W], decoded[H][W];
+  char file[PATH_MAX];
+  int n=0, npkt=0;
+  bool alike=check && nodes*cams<=IMG_MAX_IMAGES;
+
+  if (check) {
+    CHECK(decodeStream(decoder, s, NULL, 1, 0, 20, &result));
+    snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+    CHECK(readPixels(file, alone));
+    unlink(file);
+  }
+
+  // each camera sends images one after the other, a packet of each camera in turn
+  for (int i=0; i<images/(nodes*cams); i++)
+    for (int k=0; k<s->n; k++)
+      for (int node=0; node<nodes; node++)
+        for (int cam=0; cam<cams; cam++) {
+          decoder->addPacket(buf, radioPacket(&s->p[k], 10+node, cam, k, 20, buf), i*1000+k);
+
+          while (decoder->nextImage(i*1000+k, &result)) {
+            snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+
+            if (alike) {
+              CHECK(result.npkt==s->n && result.nbReceivedBlocks==IMG_BLOCKS);
+              CHECK(readPixels(file, decoded) && memcmp(decoded, alone, sizeof(alone))==0);
+            }
+
+            CHECK(result.error==0);
+            unlink(file);
+            npkt+=result.npkt;
+            n++;
+          }
+        }
+
+  while (decoder->nextImage(0, &result, true)) {
+    snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+
+    if (alike)
+      CHECK(readPixels(file, decoded) && memcmp(decoded, alone, sizeof(alone))==0);
+
+    unlink(file);
+    npkt+=result.npkt;
+    n++;
+  }
+
+  CHECK(npkt==images/(nodes*cams)*nodes*cams*s->n);
+
+  if (alike)
+    CHECK(n==images/(nodes*cams)*nodes*cams);
+}
+
+// as image_timeout() of post_processing_gw.py: the .dat file, then decode_to_bmp
+double processPerImage(const stream* s, int images) {
+
+  char dat[PATH_MAX], bmp[PATH_MAX], cwd[PATH_MAX], decoder[PATH_MAX], sn[16];
+  double start=now();
+
+  if (!getcwd(cwd, sizeof(cwd)) || !realpath("decode_to_bmp", decoder)) {
+    printf("build decode_to_bmp first\n");
+    failures++;
+    return 0;
+  }
+
+  // decode_to_bmp writes in the current directory
+  if (chdir(folder))
+    return 0;
+
+  for (int i=0; i<images; i++) {
+    snprintf(dat, sizeof(dat), "ucam_%d-node_0006-cam_0-Q20.dat", i);
+    snprintf(sn, sizeof(sn), "%d", i);
+
+    FILE* f=fopen(dat, "w");
+
+    for (int k=0; k<s->n; k++) {
+      fprintf(f, "%04X ", s->p[k].size+2);
+      fprintf(f, "%02X %02X ", s->p[k].offset >> 8, s->p[k].offset & 0xFF);
+
+      for (int x=0; x<s->p[k].size; x++)
+        fprintf(f, "%02X ", s->p[k].data[x]);
+
+      fflush(f);
+    }
+
+    fclose(f);
+
+    const char* argv[]={decoder, "-received", dat, "-SN", sn, "-src", "6", "-camid", "0", "-Q", "20", "-vflip", templateFile, NULL};
+    pid_t pid;
+    int status;
+    posix_spawn_file_actions_t actions;
+
+    // the output of decode_to_bmp is not displayed
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+    if (posix_spawn(&pid, decoder, &actions, NULL, (char* const*)argv, environ)==0)
+      waitpid(pid, &status, 0);
+
+    posix_spawn_file_actions_destroy(&actions);
+
+    snprintf(bmp, sizeof(bmp), "ucam_%d-node_0006-cam_0-Q20-P%d-S%d.bmp", i, s->n, 0);
+    unlink(dat);
+  }
+
+  double t=now()-start;
+
+  // the BMP files
+  int written=0;
+
+  for (int i=0; i<images; i++) {
+    int total=0;
+
+    for (int k=0; k<s->n; k++)
+      total+=s->p[k].size;
+
+    snprintf(bmp, sizeof(bmp), "ucam_%d-node_0006-cam_0-Q20-P%d-S%d.bmp", i, s->n, total);
+    written+=unlink(bmp)==0;
+  }
+
+  CHECK(written==images);
+
+  if (chdir(cwd))
+    return 0;
+
+  return images/t;
+}
+
+// decode_to_bmp.c in the same process, from the .dat file
+double sameProcess(const stream* s, int images) {
+
+  static uint8_t pixels[H][W];
+  char bmp[PATH_MAX];
+  double start=now();
+
+  for (int i=0; i<images; i++) {
+    referenceDecode(s, NULL, pixels, NULL, 20);
+    snprintf(bmp, sizeof(bmp), "%s/ucam_%d.bmp", folder, i);
+    gw::WriteBitmapFile(bmp, &image, true);
+  }
+
+  double t=now()-start;
+
+  for (int i=0; i<images; i++) {
+    snprintf(bmp, sizeof(bmp), "%s/ucam_%d.bmp", folder, i);
+    unlink(bmp);
+  }
+
+  return images/t;
+}
+
+// packets sent every inter_binary_pkt ms by Arduino_LoRa_ucamII, lora_gateway waits for a packet
+// for MAX_TIMEOUT ms at most
+#define INTER_PKT_TIME 5515L
+#define MAX_TIMEOUT 10000L
+// Timer(90) of post_processing_gw.py, from the first packet
+#define POST_PROCESSING_TIMEOUT 90000L
+
+void previews(ImageDecoder* decoder, const stream* s) {
+
+  static ImageDecoder alone;
+  static uint8_t preview[H][W], decoded[H][W];
+  imageDecoderResult result, image;
+  uint8_t buf[300];
+  char file[PATH_MAX];
+  int n=0;
+
+  alone.setFolder(folder);
+  decoder->setPreview(5000);
+
+  for (int k=0; k<s->n; k++) {
+    decoder->addPacket(buf, radioPacket(&s->p[k], 20, 0, k, 20, buf), k*1000);
+    CHECK(!decoder->nextImage(k*1000, &image));
+
+    if (decoder->nextPreview(k*1000, &result)) {
+      n++;
+      CHECK(result.preview && result.error==0 && result.npkt==k+1);
+      snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+      CHECK(readPixels(file, preview));
+      unlink(file);
+
+      // the image of the packets received so far
+      for (int x=0; x<=k; x++)
+        alone.addPacket(buf, radioPacket(&s->p[x], 20, 0, x, 20, buf), 0);
+
+      CHECK(alone.nextImage(0, &image, true));
+      snprintf(file, sizeof(file), "%s/%s", folder, image.file);
+      CHECK(readPixels(file, decoded) && memcmp(decoded, preview, sizeof(preview))==0);
+      unlink(file);
+    }
+
+    // one preview, then none before 5s
+    CHECK(!decoder->nextPreview(k*1000, &result));
+  }
+
+  // at 0, 5 and 10s, then no new blocks
+  CHECK(n==3);
+  CHECK(decoder->nextPreview(s->n*1000+5000, &result));
+  snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+  unlink(file);
+  CHECK(!decoder->nextPreview(s->n*1000+10000, &result));
+
+  CHECK(decoder->nextImage(0, &image, true) && !image.preview && image.SN==result.SN);
+  snprintf(file, sizeof(file), "%s/%s", folder, image.file);
+  unlink(file);
+
+  decoder->setPreview(0);
+}
+
+// the time from the reception of each packet to the first BMP file with its blocks
+void latency(ImageDecoder* decoder, const stream* s, unsigned long preview, double* mean, double* max, int* snapshots) {
+
+  imageDecoderResult result;
+  uint8_t buf[300];
+  char file[PATH_MAX];
+  unsigned long shown[MAX_PACKETS];
+  int visible=0;
+  bool finished=false;
+
+  decoder->setPreview(preview);
+  *snapshots=0;
+
+  // lora_gateway calls nextPreview() and nextImage() after each packet or each MAX_TIMEOUT
+  for (unsigned long t=0; !finished; ) {
+    int k=t/INTER_PKT_TIME;
+
+    if (k<s->n && t==(unsigned long)k*INTER_PKT_TIME)
+      decoder->addPacket(buf, radioPacket(&s->p[k], 30, 0, k, 20, buf), t);
+
+    while (decoder->nextPreview(t, &result) || decoder->nextImage(t, &result)) {
+      for ( ; visible<result.npkt; visible++)
+        shown[visible]=t;
+
+      finished=!result.preview;
+      *snapshots+=result.preview;
+      snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+      unlink(file);
+    }
+
+    if ((t+MAX_TIMEOUT)/INTER_PKT_TIME>(unsigned long)k && k+1<s->n)
+      t=(k+1)*INTER_PKT_TIME;
+    else
+      t+=MAX_TIMEOUT;
+  }
+
+  *mean=0;
+  *max=0;
+
+  for (int k=0; k<s->n; k++) {
+    double d=(shown[k]-k*INTER_PKT_TIME)/1000.0;
+
+    *mean+=d/s->n;
+
+    if (d>*max)
+      *max=d;
+  }
+
+  decoder->setPreview(0);
+}
+
+void latencies(ImageDecoder* decoder, const stream* s) {
+
+  uint8_t buf[300];
+  imageDecoderResult result;
+  char file[PATH_MAX];
+  double mean=0, max=0;
+  int snapshots;
+  const int images=2000;
+
+  // CPU time, a preview after each packet
+  double start, addTime=0, previewTime=0, imageTime=0;
+
+  decoder->setPreview(1);
+
+  for (int i=0; i<images; i++) {
+    for (int k=0; k<s->n; k++) {
+      start=now();
+      decoder->addPacket(buf, radioPacket(&s->p[k], 40, 0, k, 20, buf), k*10);
+      addTime+=now()-start;
+
+      start=now();
+      CHECK(decoder->nextPreview(k*10, &result));
+      previewTime+=now()-start;
+      snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+      unlink(file);
+    }
+
+    start=now();
+    CHECK(decoder->nextImage(0, &result, true));
+    imageTime+=now()-start;
+    snprintf(file, sizeof(file), "%s/%s", folder, result.file);
+    unlink(file);
+  }
+
+  decoder->setPreview(0);
+
+  printf("%.1f us per packet, %.1f us per preview, %.1f us per image\n", 1e6*addTime/(images*s->n),
+         1e6*previewTime/(images*s->n), 1e6*imageTime/images);
+
+  // the last packet then 90s from the first packet with post_processing_gw.py
+  for (int k=0; k<s->n; k++) {
+    double d=(POST_PROCESSING_TIMEOUT-k*INTER_PKT_TIME)/1000.0;
+
+    mean+=d/s->n;
+
+    if (d>max)
+      max=d;
+  }
+
+  printf("packet every %.1fs, image in %.1fs\n", INTER_PKT_TIME/1000.0, (s->n-1)*INTER_PKT_TIME/1000.0);
+  printf("%-24s %10s %10s %10s\n", "", "previews", "mean (s)", "max (s)");
+  printf("%-24s %10d %10.1f %10.1f\n", "post_processing_gw.py", 0, mean, max);
+
+  latency(decoder, s, 0, &mean, &max, &snapshots);
+  printf("%-24s %10d %10.1f %10.1f\n", "--img", snapshots, mean, max);
+
+  // --preview 0 is a preview after each packet
+  unsigned long interval[]={ 0, 15, 30 };
+
+  for (int i=0; i<3; i++) {
+    char name[32];
+
+    latency(decoder, s, interval[i] ? interval[i]*1000 : 1, &mean, &max, &snapshots);
+    snprintf(name, sizeof(name), "--img --preview %lu", interval[i]);
+    printf("%-24s %10d %10.1f %10.1f\n", name, snapshots, mean, max);
+  }
+}
+
+int main() {
+
+  static stream dat;
+  char tmpl[]="/tmp/test-imageDecoder-XXXXXX";
+  ImageDecoder decoder;
+
+  if (!realpath("../ucam-images/128x128-test.bmp", templateFile) || gw::ReadBitmapFile(templateFile, &image) || !mkdtemp(tmpl)) {
+    printf("cannot read the BMP files\n");
+    return 1;
+  }
+
+  strcpy(folder, tmpl);
+  decoder.setFolder(folder);
+  gw::receivedBlock=(bool*)calloc(IMG_BLOCKS, sizeof(bool));
+
+  correctness(&decoder);
+
+  // test-Q20.dat for all the images
+  wholeBlocks(&dat, coefs);
+
+  concurrent(&decoder, &dat, 4, 2, 64, true);
+  // more images than IMG_MAX_IMAGES at the same time
+  concurrent(&decoder, &dat, 6, 2, 120, true);
+
+  previews(&decoder, &dat);
+
+  printf("%d failure(s)\n", failures);
+
+  const int images=200;
+  double ps=processPerImage(&dat, images);
+  double sp=sameProcess(&dat, images);
+  double start=now();
+
+  decoder.setVflip(true);
+  concurrent(&decoder, &dat, 4, 2, 8*images, false);
+
+  double id=8*images/(now()-start);
+
+  int total=0;
+
+  for (int k=0; k<dat.n; k++)
+    total+=dat.p[k].size;
+
+  printf("%d images of %d packets, %d bytes\n", images, dat.n, total);
+  printf("%-38s %8.1f images/s\n", ".dat file and decode_to_bmp process", ps);
+  printf("%-38s %8.1f images/s\n", "decode_to_bmp.c in the same process", sp);
+  printf("%-38s %8.1f images/s, x%.0f\n", "ImageDecoder, 8 images at the same time", id, id/ps);
+
+  decoder.setVflip(false);
+  latencies(&decoder, &dat);
+
+  rmdir(folder);
+
+  return failures ? 1 : 0;
+}
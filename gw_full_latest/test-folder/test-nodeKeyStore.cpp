@@ -0,0 +1,278 @@
+/*
+ *  Correctness and speed test of NodeKeyStore.cpp and node_keys_tool.cpp
+ *
+ *  > g++ -O2 -I.. test-nodeKeyStore.cpp ../NodeKeyStore.cpp ../AES-128_V10.cpp ../Encrypt_V31.cpp -o test-nodeKeyStore
+ *  > ./test-nodeKeyStore
+ *
+ *  - build, set and del of node_keys_tool are checked with lookup() and reloadIfChanged() of a
+ *    store opened before the update, a bad line of the text file must leave the store as it was
+ *  - corrupted stores (records all used, count above half the slots or not matching the used
+ *    records) must be rejected by open() and reloadIfChanged(), and a store corrupted in place
+ *    after open() must not make lookup() probe forever
+ *  - the time of write(), open() and lookup() is measured on a store of 100k devices
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+// build(), set() and del() of the update tool
+#define main node_keys_tool_main
+#include "../node_keys_tool.cpp"
+#undef main
+
+#include "check.h"
+
+#define STORE "test-nodeKeyStore.bin"
+#define KEYS "test-nodeKeyStore.txt"
+#define NODES 100000
+
+const char* appskey="2B7E151628AED2A6ABF7158809CF4F3C";
+const char* nwkskey="000102030405060708090A0B0C0D0E0F";
+const char* lsckey="FFEEDDCCBBAA99887766554433221100";
+
+double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+void writeText(const char* path, const char* text) {
+  FILE* fp=fopen(path, "w");
+  fputs(text, fp);
+  fclose(fp);
+}
+
+// write a store file with the header and usedSlots records in the first slots, not at their hash
+void writeRaw(const char* path, uint32_t slotBits, uint32_t count, uint32_t usedSlots) {
+
+  nodeKeyStoreHeader header;
+  nodeKeyRecord r;
+
+  memset(&header, 0, sizeof(header));
+  header.magic=NODE_KEY_STORE_MAGIC;
+  header.version=NODE_KEY_STORE_VERSION;
+  header.slotBits=slotBits;
+  header.count=count;
+
+  FILE* fp=fopen(path, "wb");
+  fwrite(&header, sizeof(header), 1, fp);
+
+  for (uint32_t i=0; i < ((uint32_t)1 << slotBits); i++) {
+    memset(&r, 0, sizeof(r));
+    if (i<usedSlots) {
+      r.devAddr=1000+i;
+      r.flags=NODE_KEY_FLAG_USED;
+    }
+    fwrite(&r, sizeof(r), 1, fp);
+  }
+
+  fclose(fp);
+}
+
+void toolCommands() {
+
+  NodeKeyStore store;
+  struct stat st;
+  uint8_t key[16], K1[16], K2[16];
+
+  CHECK(sizeof(nodeKeyStoreHeader)==64 && sizeof(nodeKeyRecord)==96);
+
+  unlink(STORE);
+  CHECK(store.open(STORE)==1);
+
+  writeText(KEYS, "# test\n0 - - FFEEDDCCBBAA99887766554433221100\n"
+                  "6 2B7E151628AED2A6ABF7158809CF4F3C 000102030405060708090A0B0C0D0E0F\n"
+                  "0x26011721 2B7E151628AED2A6ABF7158809CF4F3C 000102030405060708090A0B0C0D0E0F FFEEDDCCBBAA99887766554433221100\n");
+  CHECK(build(KEYS, STORE)==0);
+  CHECK(stat(STORE, &st)==0 && (st.st_mode & 0777)==0600);
+
+  CHECK(store.open(STORE)==0 && store.count()==3 && store.slots()==16);
+  CHECK(!store.reloadIfChanged());
+
+  const nodeKeyRecord* r=store.lookup(6);
+  CHECK(r && r->flags==(NODE_KEY_FLAG_USED | NODE_KEY_FLAG_AES));
+  parseKey(appskey, key);
+  CHECK(r && !memcmp(r->appSKey, key, 16));
+  parseKey(nwkskey, key);
+  CHECK(r && !memcmp(r->nwkSKey, key, 16));
+  Generate_Subkeys(key, K1, K2);
+  CHECK(r && !memcmp(r->K1, K1, 16) && !memcmp(r->K2, K2, 16));
+
+  r=store.lookup(0x26011721);
+  parseKey(lsckey, key);
+  CHECK(r && r->flags==(NODE_KEY_FLAG_USED | NODE_KEY_FLAG_AES | NODE_KEY_FLAG_LSC) && !memcmp(r->lscKey, key, 16));
+  r=store.lookup(0);
+  CHECK(r && r->flags==(NODE_KEY_FLAG_USED | NODE_KEY_FLAG_LSC));
+  CHECK(store.lookup(7)==NULL);
+
+  // the store is not replaced if a line is bad
+  writeText(KEYS, "6 2B7E151628AED2A6ABF7158809CF4F3C 000102030405060708090A0B0C0D0E0F\n7 2B7E15 -\n");
+  CHECK(build(KEYS, STORE)==1);
+  CHECK(!store.reloadIfChanged() && store.count()==3);
+
+  CHECK(set(STORE, "7", appskey, nwkskey, NULL)==0);
+  CHECK(store.reloadIfChanged() && store.count()==4 && store.lookup(7) && store.lookup(6));
+
+  // a device that is set again is replaced
+  CHECK(set(STORE, "7", "-", "-", lsckey)==0);
+  CHECK(store.reloadIfChanged() && store.count()==4);
+  r=store.lookup(7);
+  CHECK(r && r->flags==(NODE_KEY_FLAG_USED | NODE_KEY_FLAG_LSC));
+
+  CHECK(set(STORE, "8", "0011", nwkskey, NULL)==1);
+  CHECK(!store.reloadIfChanged());
+
+  CHECK(del(STORE, "6")==0);
+  CHECK(store.reloadIfChanged() && store.count()==3 && store.lookup(6)==NULL && store.lookup(7));
+  CHECK(stat(STORE, &st)==0 && (st.st_mode & 0777)==0600);
+
+  // enough devices to grow the table
+  for (int i=100; i<140; i++) {
+    char addr[16];
+    snprintf(addr, sizeof(addr), "%d", i);
+    CHECK(set(STORE, addr, appskey, nwkskey, NULL)==0);
+  }
+
+  CHECK(store.reloadIfChanged() && store.count()==43 && store.slots()==128);
+
+  for (int i=100; i<140; i++)
+    CHECK(store.lookup(i) && store.lookup(i)->devAddr==(uint32_t)i);
+
+  CHECK(store.lookup(140)==NULL);
+}
+
+void corruptedStores() {
+
+  NodeKeyStore store, valid;
+
+  // all the records are used, lookup() would never find an empty slot
+  writeRaw(STORE, 4, 16, 16);
+  CHECK(store.open(STORE)==2);
+  writeRaw(STORE, 4, 0, 16);
+  CHECK(store.open(STORE)==2);
+
+  // more than half full
+  writeRaw(STORE, 4, 9, 9);
+  CHECK(store.open(STORE)==2);
+
+  // count does not match the used records
+  writeRaw(STORE, 4, 3, 4);
+  CHECK(store.open(STORE)==2);
+  writeRaw(STORE, 4, 4, 3);
+  CHECK(store.open(STORE)==2);
+
+  // truncated
+  writeRaw(STORE, 4, 3, 3);
+  CHECK(truncate(STORE, sizeof(nodeKeyStoreHeader)+15*sizeof(nodeKeyRecord))==0);
+  CHECK(store.open(STORE)==2);
+
+  writeRaw(STORE, 4, 8, 8);
+  CHECK(store.open(STORE)==0 && store.count()==8);
+
+  // a corrupted store replacing a valid one is not used
+  CHECK(valid.open(STORE)==0);
+  writeRaw(STORE ".new", 4, 16, 16);
+  CHECK(rename(STORE ".new", STORE)==0);
+  CHECK(!valid.reloadIfChanged() && valid.count()==8);
+
+  // the store is changed in place after open(), the shared mapping sees all the records used
+  writeRaw(STORE, 4, 8, 8);
+  CHECK(valid.reloadIfChanged());
+
+  FILE* fp=fopen(STORE, "r+b");
+  nodeKeyRecord r;
+
+  memset(&r, 0, sizeof(r));
+  r.flags=NODE_KEY_FLAG_USED;
+
+  for (int i=8; i<16; i++) {
+    r.devAddr=2000+i;
+    fseek(fp, sizeof(nodeKeyStoreHeader)+i*sizeof(nodeKeyRecord), SEEK_SET);
+    fwrite(&r, sizeof(r), 1, fp);
+  }
+
+  fclose(fp);
+
+  // each probe start, all ending after the 16 slots
+  for (uint32_t addr=0; addr<100; addr++)
+    CHECK(valid.lookup(addr)==NULL);
+}
+
+void speed() {
+
+  NodeKeyStore store;
+  nodeKeyRecord* records=(nodeKeyRecord*)malloc(NODES*sizeof(nodeKeyRecord));
+  uint32_t* order=(uint32_t*)malloc(NODES*sizeof(uint32_t));
+
+  for (int i=0; i<NODES; i++) {
+    makeRecord(&records[i], 0x26010000+i, appskey, nwkskey, NULL);
+    order[i]=0x26010000+i;
+  }
+
+  // random order so that the records are not read in sequence
+  srand(1);
+  for (int i=NODES-1; i>0; i--) {
+    int j=rand()%(i+1);
+    uint32_t t=order[i];
+    order[i]=order[j];
+    order[j]=t;
+  }
+
+  double t=now();
+  CHECK(NodeKeyStore::write(STORE, records, NODES)==0);
+  double writeTime=now()-t;
+
+  t=now();
+  CHECK(store.open(STORE)==0);
+  double openTime=now()-t;
+
+  CHECK(store.count()==NODES);
+
+  int found=0;
+  t=now();
+  for (int k=0; k<10; k++)
+    for (int i=0; i<NODES; i++)
+      found+=store.lookup(order[i])!=NULL;
+  double hitTime=now()-t;
+
+  CHECK(found==10*NODES);
+
+  found=0;
+  t=now();
+  for (int k=0; k<10; k++)
+    for (int i=0; i<NODES; i++)
+      found+=store.lookup(order[i]+NODES)!=NULL;
+  double missTime=now()-t;
+
+  CHECK(found==0);
+
+  struct stat st;
+  stat(STORE, &st);
+
+  printf("%d devices, %u slots, %.1f MB\n", NODES, store.slots(), st.st_size/1e6);
+  printf("write()  %8.1f ms\n", writeTime*1e3);
+  printf("open()   %8.1f ms (warm page cache)\n", openTime*1e3);
+  printf("lookup() %8.0f ns hit, %.0f ns miss (random order)\n", hitTime*1e9/(10*NODES), missTime*1e9/(10*NODES));
+
+  free(records);
+  free(order);
+}
+
+int main() {
+
+  toolCommands();
+  corruptedStores();
+
+  speed();
+
+  unlink(STORE);
+  unlink(STORE ".lock");
+  unlink(KEYS);
+
+  printf("%d failure(s)\n", failures);
+
+  return failures ? 1 : 0;
+}
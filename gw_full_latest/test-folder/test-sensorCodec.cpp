@@ -0,0 +1,543 @@
+/*
+ *  Correctness test of SensorCodec.cpp, with the size and the time on air of its payloads
+ *
+ *  > g++ -O2 -I.. test-sensorCodec.cpp ../SensorCodec.cpp -o test-sensorCodec
+ *  > ./test-sensorCodec
+ *
+ *  - known fields are checked against their expected bytes and text
+ *  - random fields, from the schema or named, with random values and decimals, are encoded,
+ *    decoded and written as text, then compared to the generated fields
+ *  - every truncation of the encoded payloads must be rejected or give the complete fields only
+ *  - random bytes are decoded to check that the decoder always stays within the payload and the
+ *    text buffer (build with -fsanitize=address,undefined to be sure)
+ *  - random batches of 1 to 4 fields, with small or any changes and with samples in order or not,
+ *    are encoded, then each sample is decoded and compared to the generated values and ages
+ *  - malformed batches (counts, ages, a batch in a batch, trailing bytes, every truncation and
+ *    random bit changes) must be rejected or give valid text payloads
+ *  - the size of the text and binary payloads of the sketches, with their time on air, and the
+ *    time on air and the energy per reading of Arduino_LoRa_temp with BATCH_SAMPLES
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SensorCodec.h"
+
+#include "check.h"
+
+#define RUNS 1000000
+
+static const char* schema[]={ SENSOR_CODEC_SCHEMA };
+
+#define SCHEMA_SIZE (sizeof(schema)/sizeof(schema[0]))
+
+uint32_t random32() {
+  return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+// a value of 0 to 32 bits so that all the varint lengths are used
+int32_t randomValue() {
+  int bits=rand()%33;
+  uint32_t v=bits==32 ? random32() : random32() & (((uint32_t)1 << bits)-1);
+  return (rand() & 1) ? (int32_t)v : -(int32_t)v;
+}
+
+// the text of sensorCodecToText() for a field, computed with 64-bit integers
+int fieldText(char* text, bool first, const char* name, int32_t value, uint8_t decimals) {
+
+  long long a=llabs((long long)value), d=1;
+
+  for (uint8_t i=0; i<decimals; i++)
+    d*=10;
+
+  int n=sprintf(text, "%s%s/%s%lld", first ? "" : "/", name, value<0 ? "-" : "", a/d);
+
+  if (decimals)
+    n+=sprintf(text+n, ".%0*lld", decimals, a%d);
+
+  return n;
+}
+
+struct testField {
+  uint8_t id;
+  char name[SENSOR_CODEC_MAX_NAME_LENGTH+1];
+  int32_t value;
+  uint8_t decimals;
+};
+
+void randomField(testField* f) {
+
+  f->value=randomValue();
+  f->decimals=rand()%(SENSOR_CODEC_MAX_DECIMALS+1);
+
+  if (rand()%4) {
+    f->id=rand()%SCHEMA_SIZE;
+    strcpy(f->name, schema[f->id]);
+  }
+  else {
+    // printable characters without the separators of the text format
+    const char* chars="abcXYZ019_-.:@()";
+    int len=1+rand()%SENSOR_CODEC_MAX_NAME_LENGTH;
+
+    for (int i=0; i<len; i++)
+      f->name[i]=chars[rand()%strlen(chars)];
+    f->name[len]='\0';
+
+    // a name of the schema sent by name is still decoded with this name
+    f->id=SENSOR_CODEC_NAMED_FIELD;
+  }
+}
+
+bool validText(const char* text, int n) {
+
+  if (n<2 || (int)strlen(text)!=n || text[0]!='\\' || text[1]!='!')
+    return false;
+
+  for (int i=2; i<n; i++)
+    if (text[i]<=' ' || text[i]>'~' || text[i]=='#' || text[i]=='\\')
+      return false;
+
+  return true;
+}
+
+void knownFields() {
+
+  uint8_t buf[SENSOR_CODEC_MAX_FIELD_SIZE*4];
+  char text[200];
+  sensorCodecField f;
+  uint8_t n=0;
+
+  CHECK(sensorCodecFieldId("TC")==0 && sensorCodecFieldId("PH")==15);
+  CHECK(sensorCodecFieldId("XYZ")==SENSOR_CODEC_NAMED_FIELD && sensorCodecFieldId("")==SENSOR_CODEC_NAMED_FIELD);
+
+  // TC/23.51: id 0 with 2 decimals, zigzag 4702
+  n=sensorCodecPut(buf, 0, NULL, 2351, 2);
+  CHECK(n==3 && buf[0]==0x02 && buf[1]==0xDE && buf[2]==0x24);
+  CHECK(sensorCodecGet(buf, n, &f)==3 && f.id==0 && !strcmp(f.name, "TC") && f.value==2351 && f.decimals==2);
+  CHECK(sensorCodecToText(buf, n, text, sizeof(text))==10 && !strcmp(text, "\\!TC/23.51"));
+
+  n+=sensorCodecPut(buf+n, sensorCodecFieldId("HU"), "HU", 6012, 2);
+  n+=sensorCodecPut(buf+n, SENSOR_CODEC_NAMED_FIELD, "XYZ", -5, 4);
+  n+=sensorCodecPut(buf+n, sensorCodecFieldId("BAT"), "BAT", 0, 0);
+  CHECK(n==3+3+7+2 && buf[6]==((SENSOR_CODEC_NAMED_FIELD << 2) | 3) && buf[7]==4 && buf[8]==3 && !memcmp(buf+9, "XYZ", 3));
+  CHECK(sensorCodecToText(buf, n, text, sizeof(text))==37 && !strcmp(text, "\\!TC/23.51/HU/60.12/XYZ/-0.0005/BAT/0"));
+  CHECK(sensorCodecSamples(buf, n)==1);
+
+  // the text does not fit
+  CHECK(sensorCodecToText(buf, n, text, 37)==-1 && sensorCodecToText(buf, n, text, 38)==37);
+
+  n=sensorCodecPut(buf, 0, NULL, INT32_MIN, 9);
+  CHECK(n==7 && sensorCodecToText(buf, n, text, sizeof(text))>0 && !strcmp(text, "\\!TC/-2.147483648"));
+  n=sensorCodecPut(buf, 0, NULL, INT32_MAX, 0);
+  CHECK(n==6 && sensorCodecToText(buf, n, text, sizeof(text))>0 && !strcmp(text, "\\!TC/2147483647"));
+
+  // too many decimals, reserved id
+  CHECK(sensorCodecPut(buf, 0, NULL, 1, SENSOR_CODEC_MAX_DECIMALS+1)==0);
+  CHECK(sensorCodecPut(buf, SENSOR_CODEC_BATCH, NULL, 1, 0)==0);
+
+  // a long name is cut
+  n=sensorCodecPut(buf, SENSOR_CODEC_NAMED_FIELD, "ABCDEFGHIJKLMNOPQRST", 1, 0);
+  CHECK(n==3+SENSOR_CODEC_MAX_NAME_LENGTH && sensorCodecGet(buf, n, &f)==n && !strcmp(f.name, "ABCDEFGHIJKLMNO"));
+
+  // ids after the schema are sent by devices with a more recent schema
+  buf[0]=SCHEMA_SIZE << 2;
+  buf[1]=0;
+  CHECK(sensorCodecGet(buf, 2, &f)==-1 && sensorCodecToText(buf, 2, text, sizeof(text))==-1);
+
+  // 1 or 2 encoded decimals, a 5-byte varint above 32 bits
+  const uint8_t decimals[]={ 0x03, 0x02, 0x00 };
+  CHECK(sensorCodecGet(decimals, 3, &f)==-1);
+  const uint8_t overflow[]={ 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x1F };
+  CHECK(sensorCodecGet(overflow, 6, &f)==-1);
+  const uint8_t longVarint[]={ 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x8F, 0x00 };
+  CHECK(sensorCodecGet(longVarint, 7, &f)==-1);
+
+  // names that would break the text format
+  const uint8_t slash[]={ 0xFC, 2, 'A', '/', 0x00 };
+  const uint8_t empty[]={ 0xFC, 0, 0x00 };
+  const uint8_t space[]={ 0xFC, 2, 'A', ' ', 0x00 };
+  CHECK(sensorCodecGet(slash, 5, &f)==-1 && sensorCodecGet(empty, 3, &f)==-1 && sensorCodecGet(space, 5, &f)==-1);
+
+  CHECK(sensorCodecGet(buf, 0, &f)==-1 && sensorCodecToText(buf, 0, text, sizeof(text))==-1);
+}
+
+void roundTrips() {
+
+  uint8_t buf[255];
+  char text[1024], expected[1024];
+  testField fields[32];
+  sensorCodecField f;
+
+  for (int run=0; run<RUNS/10; run++) {
+
+    int m=1+rand()%8, n=0, e=2;
+
+    strcpy(expected, "\\!");
+
+    for (int j=0; j<m; j++) {
+
+      randomField(&fields[j]);
+
+      uint8_t r=sensorCodecPut(buf+n, fields[j].id, fields[j].name, fields[j].value, fields[j].decimals);
+
+      CHECK(r>0 && r<=SENSOR_CODEC_MAX_FIELD_SIZE);
+
+      CHECK(sensorCodecGet(buf+n, r, &f)==r);
+      CHECK(f.id==fields[j].id && !strcmp(f.name, fields[j].name) && f.value==fields[j].value && f.decimals==fields[j].decimals);
+
+      e+=fieldText(expected+e, j==0, fields[j].name, fields[j].value, fields[j].decimals);
+      n+=r;
+    }
+
+    int l=sensorCodecToText(buf, n, text, sizeof(text));
+
+    CHECK(l==e && !strcmp(text, expected) && validText(text, l));
+
+    // every truncation, an empty payload is not valid
+    for (int k=1; k<n; k++) {
+
+      int fieldEnd=0;
+
+      for (int j=0; j<m && fieldEnd<k; j++)
+        fieldEnd+=sensorCodecGet(buf+fieldEnd, n-fieldEnd, &f);
+
+      l=sensorCodecToText(buf, k, text, sizeof(text));
+
+      // k bytes are only valid if they end a field, the text is then the first fields
+      if (fieldEnd==k)
+        CHECK(l>2 && !strncmp(text, expected, l) && expected[l]=='/');
+      else
+        CHECK(l==-1);
+    }
+  }
+}
+
+void randomInput() {
+
+  uint8_t buf[255];
+  char text[1024];
+  sensorCodecField f;
+  int decoded=0;
+
+  for (int run=0; run<RUNS; run++) {
+
+    int len=rand()%40;
+
+    // mostly small ids and values that can be decoded
+    for (int i=0; i<len; i++)
+      buf[i]=(rand()%3) ? rand()%0x40 : rand();
+
+    int size=(run%10) ? (int)sizeof(text) : 1+rand()%20;
+    int l=sensorCodecToText(buf, len, text, size);
+
+    CHECK(l==-1 || (l<size && validText(text, l)));
+    decoded+=l>2;
+
+    int r=sensorCodecGet(buf, len, &f);
+
+    CHECK(r==-1 || (r>0 && r<=len && f.decimals<=SENSOR_CODEC_MAX_DECIMALS && strlen(f.name)<=SENSOR_CODEC_MAX_NAME_LENGTH));
+  }
+
+  // the random bytes are not all rejected by the first byte
+  CHECK(decoded>RUNS/100);
+}
+
+// time on air as SX1272::getToA() with an 8-symbol preamble, explicit header and CRC, CR4/5
+double toa(int pl, int sf, double bw) {
+
+  double ts=(1 << sf)/bw;
+  int de=(bw==125e3 && sf>=11) ? 1 : 0;
+  double tmp=ceil((8.0*pl-4*sf+28+16)/(4.0*(sf-2*de)))*5;
+
+  return ((8+4.25)+8+(tmp>0 ? tmp : 0))*ts*1000;
+}
+
+// the text of a sample with the fields and the values of each field
+int sampleText(char* text, const testField* fields, const int32_t* values, int m) {
+
+  int n=sprintf(text, "\\!");
+
+  for (int j=0; j<m; j++)
+    n+=fieldText(text+n, j==0, fields[j].name, values[j], fields[j].decimals);
+
+  return n;
+}
+
+#define MAX_SAMPLES 64
+
+void batchRoundTrips() {
+
+  uint8_t buf[SENSOR_CODEC_BATCH_SIZE+8];
+  char text[1024], expected[1024];
+  testField fields[SENSOR_CODEC_BATCH_MAX_FIELDS];
+  int32_t values[MAX_SAMPLES][SENSOR_CODEC_BATCH_MAX_FIELDS];
+  uint32_t times[MAX_SAMPLES];
+  sensorCodecBatch b;
+  int batches=0;
+
+  for (int run=0; run<RUNS/5; run++) {
+
+    int m=1+rand()%SENSOR_CODEC_BATCH_MAX_FIELDS, target=1+rand()%MAX_SAMPLES, n=0;
+    // small changes as for the sensors, or any change
+    bool small=rand()%4;
+    uint32_t time=random32()/2;
+    int complete=-1;
+
+    for (int j=0; j<m; j++)
+      randomField(&fields[j]);
+
+    sensorCodecBatchInit(&b);
+    CHECK(sensorCodecBatchEnd(&b, time, buf)==0);
+
+    while (n<target && complete<0) {
+
+      // the samples are usually in order, the clock of a device may also go back
+      if (n)
+        time=(rand()%20) ? time+rand()%4000 : time-rand()%100;
+
+      if (!sensorCodecBatchSample(&b, time)) {
+        CHECK(n && sensorCodecBatchFull(&b));
+        break;
+      }
+
+      // a sample taken before the previous one is given the time of the previous one
+      times[n]=(n && time<times[n-1]) ? times[n-1] : time;
+
+      for (int j=0; j<m; j++) {
+
+        values[n][j]=!n ? fields[j].value : small ? values[n-1][j]+rand()%11-5 : randomValue();
+
+        if (!sensorCodecBatchPut(&b, fields[j].id, fields[j].name, values[n][j], fields[j].decimals)) {
+          // only the first sample can lack room, for its complete fields
+          CHECK(n==0 && b.len+SENSOR_CODEC_MAX_FIELD_SIZE>SENSOR_CODEC_BATCH_SIZE);
+          complete=j;
+          break;
+        }
+      }
+
+      n++;
+    }
+
+    uint32_t end=(rand()%10) ? times[n-1]+rand()%1000 : times[n-1]-rand()%100;
+    uint8_t len=sensorCodecBatchEnd(&b, end, buf);
+
+    // the first sample has the fields that fit, the device does not send it
+    if (complete>=0) {
+      CHECK((len==0)==(complete==0));
+      continue;
+    }
+
+    // a field after the last one of the sample
+    if (n>1)
+      CHECK(!sensorCodecBatchPut(&b, fields[0].id, fields[0].name, 0, fields[0].decimals));
+
+    if (end<times[n-1])
+      end=times[n-1];
+
+    CHECK(len>3 && len<=SENSOR_CODEC_BATCH_SIZE+8);
+    CHECK(sensorCodecSamples(buf, len)==n);
+
+    for (int k=0; k<n; k++) {
+
+      uint32_t age;
+      int l=sensorCodecSampleToText(buf, len, k, text, sizeof(text), &age);
+      int e=sampleText(expected, fields, values[k], m);
+
+      CHECK(l==e && !strcmp(text, expected) && age==end-times[k]);
+    }
+
+    CHECK(sensorCodecToText(buf, len, text, sizeof(text))>0 && !strcmp(text, expected));
+    batches++;
+  }
+
+  // most of the batches fit
+  CHECK(batches>RUNS/10);
+}
+
+// the batch of n TC samples every 30 minutes, sent with the last one
+uint8_t temperatureBatch(uint8_t* buf, int n) {
+
+  sensorCodecBatch b;
+  int32_t value=2351;
+
+  sensorCodecBatchInit(&b);
+
+  for (int i=0; i<n; i++) {
+    CHECK(sensorCodecBatchSample(&b, 1000+i*1800));
+    CHECK(sensorCodecBatchPut(&b, sensorCodecFieldId("TC"), "TC", value, 2));
+    value+=rand()%21-10;
+  }
+
+  return sensorCodecBatchEnd(&b, 1000+(n-1)*1800, buf);
+}
+
+void malformedBatches() {
+
+  uint8_t buf[SENSOR_CODEC_BATCH_SIZE+8], bad[SENSOR_CODEC_BATCH_SIZE+9];
+  char text[1024];
+  uint32_t age;
+  sensorCodecBatch b;
+
+  // the encoder refuses the fields that would shift the next samples
+  sensorCodecBatchInit(&b);
+  CHECK(!sensorCodecBatchPut(&b, 0, "TC", 1, 0));
+  CHECK(sensorCodecBatchSample(&b, 10) && sensorCodecBatchEnd(&b, 10, buf)==0);
+  CHECK(sensorCodecBatchPut(&b, 0, "TC", 1, 0) && sensorCodecBatchPut(&b, 1, "HU", 2, 0));
+  CHECK(sensorCodecBatchSample(&b, 20) && sensorCodecBatchPut(&b, 0, "TC", 3, 0));
+  CHECK(!sensorCodecBatchSample(&b, 30) && sensorCodecBatchEnd(&b, 30, buf)==0);
+  CHECK(sensorCodecBatchPut(&b, 1, "HU", 4, 0) && !sensorCodecBatchPut(&b, 1, "HU", 4, 0));
+
+  uint8_t len=sensorCodecBatchEnd(&b, 30, buf);
+
+  CHECK(sensorCodecSamples(buf, len)==2);
+  CHECK(sensorCodecSampleToText(buf, len, 0, text, sizeof(text), &age)>0 && !strcmp(text, "\\!TC/1/HU/2") && age==20);
+  CHECK(sensorCodecSampleToText(buf, len, 1, text, sizeof(text), &age)>0 && !strcmp(text, "\\!TC/3/HU/4") && age==10);
+  CHECK(sensorCodecSampleToText(buf, len, 2, text, sizeof(text), &age)==-1);
+
+  sensorCodecBatchInit(&b);
+  CHECK(sensorCodecBatchSample(&b, 0));
+  for (int j=0; j<SENSOR_CODEC_BATCH_MAX_FIELDS; j++)
+    CHECK(sensorCodecBatchPut(&b, j, NULL, j, 0));
+  CHECK(!sensorCodecBatchPut(&b, 0, NULL, 0, 0));
+
+  // n, m and age
+  const uint8_t valid[]={ SENSOR_CODEC_BATCH << 2, 2, 1, 5, 0x00, 0x02, 5, 0x02 };
+  CHECK(sensorCodecSamples(valid, sizeof(valid))==2);
+  CHECK(sensorCodecSampleToText(valid, sizeof(valid), 1, text, sizeof(text), &age)>0 && !strcmp(text, "\\!TC/2") && age==0);
+
+  memcpy(bad, valid, sizeof(valid));
+  bad[1]=0;
+  CHECK(sensorCodecSamples(bad, sizeof(valid))==-1);
+  bad[1]=2;
+  bad[2]=0;
+  CHECK(sensorCodecSamples(bad, sizeof(valid))==-1);
+  bad[2]=SENSOR_CODEC_BATCH_MAX_FIELDS+1;
+  CHECK(sensorCodecSamples(bad, sizeof(valid))==-1);
+  bad[2]=1;
+
+  // a sample older than the first one
+  bad[6]=6;
+  CHECK(sensorCodecSamples(bad, sizeof(valid))==-1 && sensorCodecToText(bad, sizeof(valid), text, sizeof(text))==-1);
+  bad[6]=5;
+
+  // a batch in a batch
+  bad[4]=SENSOR_CODEC_BATCH << 2;
+  CHECK(sensorCodecSamples(bad, sizeof(valid))==-1);
+  bad[4]=0;
+
+  // the whole payload must be the batch
+  bad[sizeof(valid)]=0x02;
+  CHECK(sensorCodecSamples(bad, sizeof(valid)+1)==-1 && sensorCodecToText(bad, sizeof(valid)+1, text, sizeof(text))==-1);
+
+  for (int run=0; run<1000; run++) {
+
+    len=temperatureBatch(buf, 1+rand()%12);
+
+    for (int k=0; k<len; k++)
+      CHECK(sensorCodecSamples(buf, k)==-1 && sensorCodecToText(buf, k, text, sizeof(text))==-1);
+  }
+
+  // random changes of valid batches
+  int decoded=0;
+
+  for (int run=0; run<RUNS; run++) {
+
+    len=temperatureBatch(bad, 1+rand()%12);
+
+    for (int k=rand()%3; k>=0; k--)
+      bad[rand()%len]^=1 << (rand()%8);
+
+    int n=sensorCodecSamples(bad, len);
+
+    // the fields of a payload that is no longer a batch are only checked by sensorCodecSampleToText()
+    bool batch=bad[0]==(SENSOR_CODEC_BATCH << 2);
+
+    CHECK(n==-1 || n==(batch ? bad[1] : 1));
+
+    for (int k=0; k<n; k++) {
+      int l=sensorCodecSampleToText(bad, len, k, text, sizeof(text), &age);
+      CHECK((l==-1 && !batch) || (l>0 && validText(text, l)));
+    }
+
+    decoded+=n>0;
+  }
+
+  CHECK(decoded>RUNS/100);
+}
+
+// per reading of Arduino_LoRa_temp, with the 4-byte header, sent alone as text or in a batch
+void batchAirtime() {
+
+  uint8_t buf[SENSOR_CODEC_BATCH_SIZE+8];
+  const int samples[]={ 1, 3, 6, 10 };
+  // 90mA at 3.3V
+  const double watts=0.09*3.3;
+  double single=toa(4+strlen("\\!TC/23.51"), 12, 125e3);
+
+  printf("%-19s %5s %15s %5s %6s %14s\n", "TC every 30 min", "bytes", "SF12 ms/reading", "mJ", "", "SF7 ms/reading");
+
+  for (int i=0; i<4; i++) {
+
+    int n=samples[i];
+    int pl=4+(n==1 ? (int)strlen("\\!TC/23.51") : temperatureBatch(buf, n));
+    double ms=toa(pl, 12, 125e3)/n;
+
+    printf("%-19s %5d %15.0f %5.0f %5.0f%% %14.1f\n", n==1 ? "text, 1 per packet" : n==3 ? "batch of 3" : n==6 ? "batch of 6" : "batch of 10",
+      pl, ms, ms*watts, 100*(ms-single)/single, toa(pl, 7, 125e3)/n);
+  }
+}
+
+// text and binary payloads of the sketches, with the 4-byte header and the 4-byte app key
+void payloadSizes() {
+
+  const char* texts[]={ "TC/23.5", "TC/23.51/HU/60.12", "TC/23.51/HU/60.12/BAT/3.71/LUM/1023",
+                        "LM35/23.45/TMP36/22.80/TC1/23.10/HU1/60.20/TC2/23.30/HU2/59.80/DS/23.06" };
+  const char* labels[]={ texts[0], texts[1], texts[2], "the 7 sensors of Generic_Simple_MultiSensors" };
+  uint8_t buf[255];
+  char text[256], copy[256];
+
+  printf("%-44s %5s %4s %9s %5s %8s %5s\n", "bytes, ms on air at BW125", "text", "bin", "SF12 text", "bin", "SF7 text", "bin");
+
+  for (int i=0; i<4; i++) {
+
+    uint8_t n=0;
+
+    strcpy(copy, texts[i]);
+
+    for (char* name=strtok(copy, "/"); name; name=strtok(NULL, "/")) {
+
+      char* value=strtok(NULL, "/");
+      char* dot=strchr(value, '.');
+      uint8_t decimals=dot ? strlen(dot+1) : 0;
+
+      n+=sensorCodecPut(buf+n, sensorCodecFieldId(name), name, (int32_t)lround(atof(value)*pow(10, decimals)), decimals);
+    }
+
+    int l=sensorCodecToText(buf, n, text, sizeof(text));
+
+    CHECK(l>2 && !strcmp(text+2, texts[i]));
+
+    printf("%-44s %5d %4d %9.0f %5.0f %8.1f %5.1f\n", labels[i], l, n,
+      toa(8+l, 12, 125e3), toa(8+n, 12, 125e3), toa(8+l, 7, 125e3), toa(8+n, 7, 125e3));
+  }
+}
+
+int main() {
+
+  srand(1);
+
+  knownFields();
+  roundTrips();
+  randomInput();
+  batchRoundTrips();
+  malformedBatches();
+
+  printf("%d failure(s)\n", failures);
+
+  payloadSizes();
+  batchAirtime();
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/*
+ *  Correctness and speed test of SensorPayload.cpp
+ *
+ *  > g++ -O2 -I.. test-sensorPayload.cpp ../SensorPayload.cpp -o test-sensorPayload
+ *  > ./test-sensorPayload
+ *
+ *  - known payloads are checked against their expected fields
+ *  - random nomenclature/value payloads are generated, formatted as the end-devices do,
+ *    parsed and compared to the generated values
+ *  - random bytes and mutated payloads are parsed to check that the parser always stays
+ *    within the payload (build with -fsanitize=address to be sure)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "SensorPayload.h"
+
+#include "check.h"
+
+bool sameName(const sensorField* f, const char* name) {
+  return f->nameLen==strlen(name) && !memcmp(f->name, name, f->nameLen);
+}
+
+int parse(const char* s, sensorPayload* p) {
+  return parseSensorPayload((const uint8_t*)s, strlen(s), p);
+}
+
+void knownPayloads() {
+
+  sensorPayload p;
+  char buf[100];
+
+  CHECK(parse("\\!TC/23.5/HU/60", &p)==2);
+  CHECK(p.prefix=='!' && p.channel==NULL);
+  CHECK(sameName(&p.fields[0], "TC") && p.fields[0].numeric && p.fields[0].value==235 && p.fields[0].decimals==1);
+  CHECK(sameName(&p.fields[1], "HU") && p.fields[1].value==60 && p.fields[1].decimals==0);
+  formatSensorPayload(&p, buf, sizeof(buf));
+  CHECK(!strcmp(buf, "!;TC=235e-1;HU=60"));
+
+  CHECK(parse("\\&BC/9/LAT/43.31402/LGT/-0.36370/FXT/4180", &p)==4);
+  CHECK(p.prefix=='&' && p.fields[2].value==-36370 && p.fields[2].decimals==5);
+
+  CHECK(parse("\\!SGSH52UGPVAUYG3S#2#9.4", &p)==1);
+  CHECK(p.channelLen==16 && !memcmp(p.channel, "SGSH52UGPVAUYG3S", 16));
+  CHECK(p.fieldLen==1 && p.field[0]=='2');
+  CHECK(p.fields[0].nameLen==0 && p.fields[0].value==94);
+
+  CHECK(parse("\\!##TC/9.4/HU/85/DO/7", &p)==3 && p.channelLen==0 && p.fieldLen==0);
+  CHECK(parse("\\!2#9.4", &p)==1 && p.channelLen==1 && p.field==NULL);
+
+  CHECK(parse("\\$hello/world#1", &p)==0 && p.prefix=='$' && p.dataLen==13);
+
+  // as sent by the sketches with the string terminator
+  CHECK(parseSensorPayload((const uint8_t*)"\\!TC/-4.25\0garbage", 18, &p)==1 && p.fields[0].value==-425);
+
+  CHECK(parse("\\!TC/23.5/HU", &p)==-1);
+  CHECK(parse("\\!TC/1#2", &p)==-1);
+  CHECK(parse("\\!a#b#c#1", &p)==-1);
+  CHECK(parse("\\!", &p)==0);
+
+  CHECK(parse("\\!ST/open", &p)==1 && !p.fields[0].numeric);
+  CHECK(parse("\\!V/1234567890", &p)==1 && !p.fields[0].numeric);
+  CHECK(parse("\\!V/3.14159265358979", &p)==1 && p.fields[0].value==314159265 && p.fields[0].decimals==8);
+  CHECK(parse("\\!V/0.0000000001", &p)==1 && p.fields[0].value==0 && p.fields[0].decimals==9);
+}
+
+void randomPayloads(int n) {
+
+  char payload[256];
+  char names[SENSOR_PAYLOAD_MAX_FIELDS][8];
+  int32_t values[SENSOR_PAYLOAD_MAX_FIELDS];
+  uint8_t decimals[SENSOR_PAYLOAD_MAX_FIELDS];
+  sensorPayload p;
+
+  for (int t=0; t<n; t++) {
+
+    int nf=1+rand()%8;
+    int len=sprintf(payload, "\\!");
+
+    for (int i=0; i<nf; i++) {
+
+      int nl=1+rand()%4;
+
+      for (int j=0; j<nl; j++)
+        names[i][j]="ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"[rand()%36];
+      names[i][nl]='\0';
+
+      values[i]=rand()%2000001-1000000;
+      decimals[i]=rand()%4;
+
+      int32_t a=values[i]<0 ? -values[i] : values[i];
+      int32_t d=1;
+
+      for (int j=0; j<decimals[i]; j++)
+        d*=10;
+
+      len+=sprintf(payload+len, "%s%s/%s%d", i ? "/" : "", names[i], values[i]<0 ? "-" : "", a/d);
+
+      if (decimals[i])
+        len+=sprintf(payload+len, ".%0*d", decimals[i], a%d);
+    }
+
+    if (parseSensorPayload((const uint8_t*)payload, len, &p)!=nf) {
+      failures++;
+      printf("failed to parse %s\n", payload);
+      continue;
+    }
+
+    for (int i=0; i<nf; i++)
+      if (!sameName(&p.fields[i], names[i]) || !p.fields[i].numeric ||
+          p.fields[i].value!=values[i] || p.fields[i].decimals!=decimals[i]) {
+        failures++;
+        printf("wrong field %d in %s\n", i, payload);
+        break;
+      }
+  }
+}
+
+void checkBounds(const uint8_t* buf, uint8_t len, const sensorPayload* p) {
+
+  const char* begin=(const char*)buf;
+  const char* end=begin+len;
+
+  CHECK(p->count<=SENSOR_PAYLOAD_MAX_FIELDS);
+  CHECK(p->data>=begin && p->data+p->dataLen<=end);
+
+  for (uint8_t i=0; i<p->count; i++) {
+    CHECK(p->fields[i].name>=begin && p->fields[i].name+p->fields[i].nameLen<=end);
+    CHECK(p->fields[i].text>=begin && p->fields[i].text+p->fields[i].textLen<=end);
+  }
+}
+
+void randomBytes(int n) {
+
+  const char alphabet[]="\\!&$#/.-+0123456789TCHU\n";
+  sensorPayload p;
+  char out[100];
+
+  for (int t=0; t<n; t++) {
+
+    uint8_t len=rand()%256;
+    // exact size so that the address sanitizer sees any read past the end
+    uint8_t* buf=(uint8_t*)malloc(len ? len : 1);
+
+    for (int i=0; i<len; i++)
+      buf[i]=(rand()%4) ? alphabet[rand()%(sizeof(alphabet)-1)] : rand();
+
+    if (parseSensorPayload(buf, len, &p)>0) {
+      checkBounds(buf, len, &p);
+      CHECK(formatSensorPayload(&p, out, sizeof(out))<(int)sizeof(out));
+    }
+
+    free(buf);
+  }
+}
+
+int main() {
+
+  srand(1);
+
+  knownPayloads();
+  randomPayloads(100000);
+  randomBytes(1000000);
+
+  printf("%d failure(s)\n", failures);
+
+  const char* payload="\\!TC/23.5/HU/60/LW/0/BAT/3.71";
+  uint8_t len=strlen(payload);
+  sensorPayload p;
+  int n=5000000, total=0;
+
+  clock_t start=clock();
+
+  for (int i=0; i<n; i++)
+    total+=parseSensorPayload((const uint8_t*)payload, len, &p);
+
+  double elapsed=(double)(clock()-start)/CLOCKS_PER_SEC;
+
+  printf("%s: %.0f ns per payload, %.1f MB/s (%d)\n", payload, elapsed/n*1e9, (double)n*len/elapsed/1e6, total);
+
+  return failures ? 1 : 0;
+}
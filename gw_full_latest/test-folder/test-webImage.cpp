@@ -0,0 +1,555 @@
+/*
+ *  Test of the PNG and JPEG files of ucam-images/web_image.h
+ *
+ *  > g++ -O2 ../ucam-images/decode_to_bmp.c -o decode_to_bmp
+ *  > g++ -O2 -I.. test-webImage.cpp ../ImageDecoder.cpp -lz -ljpeg -o test-webImage
+ *  > ./test-webImage
+ *
+ *  zlib and libjpeg are only used by the test, to read the files back:
+ *  - the PNG files of the sample images, of a noise image, of a flat image and of an image that
+ *    is not a multiple of 8 give the same pixels, the JPEG files are read by libjpeg with a PSNR
+ *    of at least 30 dB at quality 90 for the sample images
+ *  - the thumbnails are the mean of 2x2 pixels
+ *  - ImageDecoder with setFormat() and decode_to_bmp -web write the same pixels as in their BMP
+ *    files, with or without vflip
+ *  - the bytes of each format and the CPU time of the encoder, then the time of ImageDecoder
+ *    to decode and write an image in each format
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <zlib.h>
+#include <jpeglib.h>
+
+#include "ImageDecoder.h"
+
+// the encoders, also in ImageDecoder.cpp
+namespace gw {
+#include "../ucam-images/web_image.h"
+}
+
+extern char **environ;
+
+#include "check.h"
+
+#define W IMG_WIDTH
+#define H IMG_HEIGHT
+#define MAX_PACKETS 64
+
+struct packet { uint16_t offset; int size; uint8_t data[IMG_MAX_PACKET_SIZE]; };
+
+char folder[PATH_MAX];
+int npackets=0;
+packet packets[MAX_PACKETS];
+
+double now() {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec+t.tv_nsec/1e9;
+}
+
+uint32_t read32(const uint8_t* p) {
+  return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+// the pixels of an 8-bit gray PNG file, the CRC of each chunk is checked
+bool readPNG(const uint8_t* data, int size, uint8_t* pixels, int* width, int* height) {
+
+  static const uint8_t signature[8]={137, 'P', 'N', 'G', 13, 10, 26, 10};
+  static uint8_t idat[1 << 20], raw[1 << 20];
+  int nidat=0;
+  bool end=false;
+
+  if (size<8 || memcmp(data, signature, 8))
+    return false;
+
+  for (int pos=8; pos+12<=size && !end; ) {
+    int n=read32(data+pos);
+
+    if (pos+12+n>size || crc32(0, data+pos+4, n+4)!=read32(data+pos+8+n))
+      return false;
+
+    if (!memcmp(data+pos+4, "IHDR", 4)) {
+      *width=read32(data+pos+8);
+      *height=read32(data+pos+12);
+
+      if (n!=13 || data[pos+16]!=8 || data[pos+17]!=0 || data[pos+20]!=0)
+        return false;
+    }
+    else if (!memcmp(data+pos+4, "IDAT", 4)) {
+      memcpy(idat+nidat, data+pos+8, n);
+      nidat+=n;
+    }
+    else if (!memcmp(data+pos+4, "IEND", 4))
+      end=pos+12+n==size;
+
+    pos+=12+n;
+  }
+
+  uLongf rawSize=sizeof(raw);
+
+  if (!end || uncompress(raw, &rawSize, idat, nidat)!=Z_OK || (int)rawSize!=(*width+1)**height)
+    return false;
+
+  for (int row=0; row<*height; row++) {
+    const uint8_t* line=raw+row*(*width+1);
+    uint8_t* cur=pixels+row**width;
+    const uint8_t* up=row ? cur-*width : NULL;
+
+    for (int x=0; x<*width; x++) {
+      int a=x ? cur[x-1] : 0, b=up ? up[x] : 0, c=(x && up) ? up[x-1] : 0, p=a+b-c;
+
+      switch (line[0]) {
+        case 0: cur[x]=line[1+x]; break;
+        case 1: cur[x]=line[1+x]+a; break;
+        case 2: cur[x]=line[1+x]+b; break;
+        case 3: cur[x]=line[1+x]+((a+b) >> 1); break;
+        case 4: cur[x]=line[1+x]+((abs(p-a)<=abs(p-b) && abs(p-a)<=abs(p-c)) ? a : (abs(p-b)<=abs(p-c) ? b : c)); break;
+        default: return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// the pixels of a baseline gray JPEG file, by libjpeg
+bool readJPEG(const uint8_t* data, int size, uint8_t* pixels, int* width, int* height) {
+
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+
+  cinfo.err=jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, (unsigned char*)data, size);
+
+  bool ok=jpeg_read_header(&cinfo, TRUE)==JPEG_HEADER_OK && cinfo.num_components==1 && !cinfo.progressive_mode;
+
+  if (ok) {
+    jpeg_start_decompress(&cinfo);
+    *width=cinfo.output_width;
+    *height=cinfo.output_height;
+
+    while (cinfo.output_scanline<cinfo.output_height) {
+      JSAMPROW row=pixels+cinfo.output_scanline**width;
+
+      jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+  }
+
+  jpeg_destroy_decompress(&cinfo);
+  return ok;
+}
+
+bool readFile(const char* file, uint8_t* data, int* size, int max) {
+
+  FILE* f=fopen(file, "rb");
+
+  if (!f)
+    return false;
+
+  *size=fread(data, 1, max, f);
+  fclose(f);
+  return true;
+}
+
+// the pixels of a BMP file from the top row of the image as displayed
+bool readBMP(const char* file, uint8_t pixels[H][W]) {
+
+  static uint8_t data[1078+W*H];
+  int size;
+
+  if (!readFile(file, data, &size, sizeof(data)) || size!=(int)sizeof(data))
+    return false;
+
+  for (int row=0; row<H; row++)
+    memcpy(pixels[row], data+1078+(H-1-row)*W, W);
+
+  return true;
+}
+
+double psnr(const uint8_t* a, const uint8_t* b, int n) {
+
+  double mse=0;
+
+  for (int i=0; i<n; i++)
+    mse+=(a[i]-b[i])*(a[i]-b[i]);
+
+  return mse ? 10*log10(255.0*255.0*n/mse) : 99.0;
+}
+
+struct encoded { int png, jpeg, pngThumb, jpegThumb; double pngTime, jpegTime; };
+
+// encode and read back the image and its thumbnail
+void roundTrip(const uint8_t* pixels, int width, int height, double minPsnr, encoded* e) {
+
+  static uint8_t decoded[W*H*4], thumbnail[W*H];
+  int w, h;
+
+  for (int format=WEB_IMAGE_PNG; format<=WEB_IMAGE_JPEG; format++)
+    for (int thumb=0; thumb<2; thumb++) {
+      int scale=thumb ? WEB_IMAGE_THUMBNAIL_SCALE : 1;
+      const uint8_t* source=pixels;
+      gw::WebImageBuffer out={NULL, 0, 0, 0, 0};
+
+      if (thumb) {
+        gw::WebThumbnail(pixels, width, height, scale, thumbnail);
+        source=thumbnail;
+
+        // the mean of the 2x2 pixels, rounded
+        int sum=pixels[0]+pixels[1]+pixels[width]+pixels[width+1];
+
+        CHECK(thumbnail[0]==(sum+2)/4);
+      }
+
+      double start=now();
+      int err=format==WEB_IMAGE_PNG ? gw::EncodePNG(&out, source, width/scale, height/scale)
+                                       : gw::EncodeJPEG(&out, source, width/scale, height/scale, 90);
+      double t=now()-start;
+
+      CHECK(err==0);
+
+      if (format==WEB_IMAGE_PNG) {
+        CHECK(readPNG(out.data, out.size, decoded, &w, &h));
+        CHECK(w==width/scale && h==height/scale);
+        CHECK(!memcmp(decoded, source, w*h));
+      }
+      else {
+        CHECK(readJPEG(out.data, out.size, decoded, &w, &h));
+        CHECK(w==width/scale && h==height/scale);
+        CHECK(psnr(decoded, source, w*h)>=minPsnr);
+      }
+
+      if (e) {
+        if (format==WEB_IMAGE_PNG) {
+          *(thumb ? &e->pngThumb : &e->png)=out.size;
+          e->pngTime+=t;
+        }
+        else {
+          *(thumb ? &e->jpegThumb : &e->jpeg)=out.size;
+          e->jpegTime+=t;
+        }
+      }
+
+      free(out.data);
+    }
+}
+
+void encoders() {
+
+  static uint8_t pixels[H*W*4];
+  unsigned int seed=1;
+
+  // noise, flat, a gradient that is not a multiple of 8
+  for (int i=0; i<H*W*4; i++)
+    pixels[i]=rand_r(&seed);
+
+  roundTrip(pixels, W*2, H*2, 0, NULL);
+
+  memset(pixels, 77, sizeof(pixels));
+  roundTrip(pixels, W, H, 40, NULL);
+
+  for (int row=0; row<45; row++)
+    for (int col=0; col<37; col++)
+      pixels[row*37+col]=row*5+col;
+
+  roundTrip(pixels, 37, 45, 30, NULL);
+}
+
+// a buffer after a failed realloc(): the bytes are counted, not written past the capacity
+void failedBuffer() {
+
+  uint8_t data[16];
+  gw::WebImageBuffer out;
+
+  memset(data, 0xA5, sizeof(data));
+  memset(&out, 0, sizeof(out));
+  out.data=data;
+  out.capacity=8;
+  out.size=out.capacity+1;
+
+  for (int i=0; i<4; i++)
+    gw::WebPutByte(&out, i);
+
+  CHECK(out.size==out.capacity+5);
+  for (int i=0; i<(int)sizeof(data); i++)
+    CHECK(data[i]==0xA5);
+}
+
+// the packets of test-Q20.dat
+void readDat() {
+
+  unsigned int size, hi, lo, byte;
+  FILE* f=fopen("../ucam-images/test-Q20.dat", "r");
+
+  CHECK(f!=NULL);
+
+  if (!f)
+    return;
+
+  while (npackets<MAX_PACKETS && fscanf(f, "%4X %2X %2X", &size, &hi, &lo)==3) {
+    packets[npackets].offset=hi << 8 | lo;
+    packets[npackets].size=size-2;
+
+    for (int x=0; x<(int)size-2 && fscanf(f, "%2X", &byte)==1; x++)
+      packets[npackets].data[x]=byte;
+
+    npackets++;
+  }
+
+  fclose(f);
+}
+
+// test-Q20.dat received by the gateway, the result of the image
+void receive(ImageDecoder* decoder, imageDecoderResult* result) {
+
+  uint8_t buf[IMG_HEADER_SIZE+2+IMG_MAX_PACKET_SIZE];
+
+  for (int k=0; k<npackets; k++) {
+    buf[0]=0xFF;
+    buf[1]=0x50;
+    buf[2]=0;
+    buf[3]=6;
+    buf[4]=k;
+    buf[5]=20;
+    buf[6]=packets[k].size+2;
+    buf[7]=packets[k].offset >> 8;
+    buf[8]=packets[k].offset & 0xFF;
+    memcpy(buf+9, packets[k].data, packets[k].size);
+    decoder->addPacket(buf, 9+packets[k].size, 1000+k);
+  }
+
+  CHECK(decoder->nextImage(0, result, true));
+  CHECK(result->error==0);
+}
+
+// ImageDecoder and decode_to_bmp in each format, the pixels of the BMP file
+void files(uint8_t q20[H][W]) {
+
+  static uint8_t bmp[H][W], decoded[W*H], data[1 << 16];
+  char path[PATH_MAX], thumb[PATH_MAX];
+  int size=0, w, h, npkt=0, totalsize=0;
+  ImageDecoder decoder;
+  imageDecoderResult result;
+
+  decoder.setFolder(folder);
+
+  for (int vflip=0; vflip<2; vflip++) {
+    decoder.setVflip(vflip);
+    decoder.setFormat(IMG_FORMAT_BMP);
+    receive(&decoder, &result);
+    snprintf(path, sizeof(path), "%s/%s", folder, result.file);
+    CHECK(readBMP(path, bmp));
+    unlink(path);
+
+    if (!vflip) {
+      memcpy(q20, bmp, sizeof(bmp));
+      npkt=result.npkt;
+      totalsize=result.totalsize;
+    }
+
+    for (int format=IMG_FORMAT_PNG; format<=IMG_FORMAT_JPEG; format++) {
+      decoder.setFormat(format);
+      receive(&decoder, &result);
+
+      snprintf(path, sizeof(path), "%s/%s", folder, result.file);
+      snprintf(thumb, sizeof(thumb), "%s/%.*s-thumb.%s", folder, (int)strlen(result.file)-4, result.file, format==IMG_FORMAT_PNG ? "png" : "jpg");
+      CHECK(strstr(result.file, format==IMG_FORMAT_PNG ? ".png" : ".jpg")!=NULL);
+
+      for (int t=0; t<2; t++) {
+        CHECK(readFile(t ? thumb : path, data, &size, sizeof(data)));
+
+        if (format==IMG_FORMAT_PNG) {
+          CHECK(readPNG(data, size, decoded, &w, &h));
+
+          if (!t)
+            CHECK(!memcmp(decoded, bmp, sizeof(bmp)));
+        }
+        else {
+          CHECK(readJPEG(data, size, decoded, &w, &h));
+
+          if (!t)
+            CHECK(psnr(decoded, bmp[0], W*H)>=30);
+        }
+
+        CHECK(w==W/(t ? WEB_IMAGE_THUMBNAIL_SCALE : 1));
+        unlink(t ? thumb : path);
+      }
+    }
+  }
+
+  // the preview has no thumbnail
+  decoder.setFormat(IMG_FORMAT_PNG);
+  decoder.setPreview(1);
+  receive(&decoder, &result);
+  snprintf(path, sizeof(path), "%s/%s", folder, result.file);
+  unlink(path);
+  snprintf(thumb, sizeof(thumb), "%s/%.*s-thumb.png", folder, (int)strlen(result.file)-4, result.file);
+  unlink(thumb);
+
+  for (int k=0; k<2; k++) {
+    uint8_t buf[9+IMG_MAX_PACKET_SIZE]={0xFF, 0x50, 0, 6, (uint8_t)k, 20, (uint8_t)(packets[k].size+2),
+                                        (uint8_t)(packets[k].offset >> 8), (uint8_t)(packets[k].offset & 0xFF)};
+
+    memcpy(buf+9, packets[k].data, packets[k].size);
+    decoder.addPacket(buf, 9+packets[k].size, 2000000+k);
+  }
+
+  CHECK(decoder.nextPreview(2000001, &result));
+  CHECK(strstr(result.file, "-preview.png")!=NULL);
+  snprintf(path, sizeof(path), "%s/%s", folder, result.file);
+  CHECK(readFile(path, data, &size, sizeof(data)) && readPNG(data, size, decoded, &w, &h));
+  unlink(path);
+  snprintf(thumb, sizeof(thumb), "%s/%.*s-thumb.png", folder, (int)strlen(result.file)-4, result.file);
+  CHECK(access(thumb, F_OK)!=0);
+
+  CHECK(decoder.nextImage(0, &result, true));
+  snprintf(path, sizeof(path), "%s/%s", folder, result.file);
+  unlink(path);
+  snprintf(thumb, sizeof(thumb), "%s/%.*s-thumb.png", folder, (int)strlen(result.file)-4, result.file);
+  unlink(thumb);
+
+  // decode_to_bmp -web, in the folder
+  char decoderPath[PATH_MAX], dat[PATH_MAX], original[PATH_MAX], cwd[PATH_MAX];
+
+  if (!getcwd(cwd, sizeof(cwd)) || !realpath("decode_to_bmp", decoderPath) || !realpath("../ucam-images/test-Q20.dat", dat) ||
+      !realpath("../ucam-images/128x128-test.bmp", original)) {
+    printf("build decode_to_bmp first\n");
+    failures++;
+    return;
+  }
+
+  if (chdir(folder))
+    return;
+
+  const char* web[]={"png", "jpg"};
+
+  for (int i=0; i<2; i++) {
+    const char* argv[]={decoderPath, "-received", dat, "-SN", "0", "-src", "6", "-camid", "0", "-Q", "20", "-vflip", "-web", web[i], original, NULL};
+    pid_t pid;
+    int status=-1;
+    posix_spawn_file_actions_t actions;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+    if (posix_spawn(&pid, decoderPath, &actions, NULL, (char* const*)argv, environ)==0)
+      waitpid(pid, &status, 0);
+
+    posix_spawn_file_actions_destroy(&actions);
+    CHECK(status==0);
+
+    snprintf(path, sizeof(path), "ucam_0-node_0006-cam_0-Q20-P%d-S%d.bmp", npkt, totalsize);
+    CHECK(readBMP(path, bmp));
+    unlink(path);
+
+    for (int t=0; t<2; t++) {
+      snprintf(path, sizeof(path), "ucam_0-node_0006-cam_0-Q20-P%d-S%d%s.%s", npkt, totalsize, t ? "-thumb" : "", web[i]);
+      CHECK(readFile(path, data, &size, sizeof(data)));
+      CHECK(i ? readJPEG(data, size, decoded, &w, &h) : readPNG(data, size, decoded, &w, &h));
+      CHECK(w==W/(t ? WEB_IMAGE_THUMBNAIL_SCALE : 1));
+
+      if (!t)
+        CHECK(i ? psnr(decoded, bmp[0], W*H)>=30 : !memcmp(decoded, bmp, sizeof(bmp)));
+
+      unlink(path);
+    }
+  }
+
+  if (chdir(cwd))
+    return;
+}
+
+// ImageDecoder, the ms to decode and write an image in each format
+void writeTimes() {
+
+  const int images=200;
+  const char* names[]={"BMP", "PNG", "JPEG"};
+  char path[PATH_MAX], thumb[PATH_MAX];
+  ImageDecoder decoder;
+  imageDecoderResult result;
+
+  decoder.setFolder(folder);
+  decoder.setVflip(true);
+  printf("%-28s %10s\n", "ImageDecoder", "us/image");
+
+  for (int format=IMG_FORMAT_BMP; format<=IMG_FORMAT_JPEG; format++) {
+    double start=now();
+
+    decoder.setFormat(format);
+
+    for (int i=0; i<images; i++) {
+      receive(&decoder, &result);
+      snprintf(path, sizeof(path), "%s/%s", folder, result.file);
+      snprintf(thumb, sizeof(thumb), "%s/%.*s-thumb.%s", folder, (int)strlen(result.file)-4, result.file, format==IMG_FORMAT_PNG ? "png" : "jpg");
+      unlink(path);
+      unlink(thumb);
+    }
+
+    printf("%-28s %10.1f\n", names[format], (now()-start)/images*1e6);
+  }
+}
+
+int main() {
+
+  const char* samples[]={"128x128-test.bmp", "128x128-test-neg.bmp", "lion-128x128.bmp"};
+  static uint8_t pixels[H][W];
+  char tmpl[]="/tmp/test-webImage-XXXXXX";
+  encoded e[4];
+
+  if (!mkdtemp(tmpl)) {
+    printf("cannot create the folder\n");
+    return 1;
+  }
+
+  strcpy(folder, tmpl);
+
+  encoders();
+  failedBuffer();
+  readDat();
+  files(pixels);
+
+  // test-Q20.dat decoded by the gateway, then the original images
+  for (int i=0; i<4; i++) {
+    char path[PATH_MAX];
+
+    memset(&e[i], 0, sizeof(encoded));
+
+    if (i) {
+      snprintf(path, sizeof(path), "../ucam-images/%s", samples[i-1]);
+      CHECK(readBMP(path, pixels));
+    }
+
+    // the encoding time of 100 images
+    for (int n=0; n<100; n++)
+      roundTrip(pixels[0], W, H, 30, &e[i]);
+  }
+
+  printf("%d failure(s)\n", failures);
+
+  printf("%-28s %8s %14s %14s %9s %9s\n", "bytes, thumbnail", "BMP", "PNG", "JPEG q90", "PNG us", "JPEG us");
+
+  for (int i=0; i<4; i++)
+    printf("%-28s %8d %8d %5d %8d %5d %9.1f %9.1f\n", i ? samples[i-1] : "test-Q20.dat decoded", 1078+W*H,
+           e[i].png, e[i].pngThumb, e[i].jpeg, e[i].jpegThumb, e[i].pngTime/100*1e6, e[i].jpegTime/100*1e6);
+
+  writeTimes();
+
+  rmdir(folder);
+
+  return failures ? 1 : 0;
+}
@@ -87,37 +87,37 @@ int ReadBitmapFile (char* FileName,  BMPImageStruct *Image)
 	if ((ImageFile = fopen (FileName,"r")) == NULL) return -1;
 
 	fread (Image->signature,2,1,ImageFile);		// signature codée sur 2 octets
-	fread (&entier32,sizeof (long),1,ImageFile);
-	Image->filesize = hex2dec(entier32, sizeof(long));	// taille totale du fichier, 4 octets
-	fread (&entier32,sizeof(long),1,ImageFile);		// reservé
-	fread (&entier32,sizeof(long),1,ImageFile);		// offset de début de l'image, 4 octets
-	Image->offset = hex2dec(entier32, sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// taille de l'entete, 4 octets
-	Image->headersize = hex2dec(entier32,sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// largeur de l'image, 4 octets
-	Image->imageHsize = hex2dec(entier32,sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// hauteur de l'image, 4 octets
-	Image->imageVsize = hex2dec(entier32,sizeof(long));
-	fread (&entier32,sizeof(short),1,ImageFile);		// nombre de plans (toujour =1), 2 octets
+	fread (&entier32,4,1,ImageFile);
+	Image->filesize = hex2dec(entier32, 4);	// taille totale du fichier, 4 octets
+	fread (&entier32,4,1,ImageFile);		// reservé
+	fread (&entier32,4,1,ImageFile);		// offset de début de l'image, 4 octets
+	Image->offset = hex2dec(entier32, 4);
+	fread (&entier32,4,1,ImageFile);		// taille de l'entete, 4 octets
+	Image->headersize = hex2dec(entier32,4);
+	fread (&entier32,4,1,ImageFile);		// largeur de l'image, 4 octets
+	Image->imageHsize = hex2dec(entier32,4);
+	fread (&entier32,4,1,ImageFile);		// hauteur de l'image, 4 octets
+	Image->imageVsize = hex2dec(entier32,4);
+	fread (&entier32,2,1,ImageFile);		// nombre de plans (toujour =1), 2 octets
 	Image->plans = hex2dec(entier32,2);
-	fread (&entier32,sizeof(short),1,ImageFile);		// nombre de bits par pixel, 2 octets
-	Image->bpp = hex2dec(entier32,sizeof(short));
-	fread (&entier32,sizeof(long),1,ImageFile);		// compression (0=rien), 4 octets
-	Image->compression = hex2dec(entier32,sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// taille de l'image, 4 octets
-	Image->imagesize = hex2dec(entier32,sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// résolution horizontale en pixels par mètre, 4 octets
-	Image->Hres = hex2dec (entier32,sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// résolution verticale, en pixels par mètre, 4 octets
-	Image->Vres = hex2dec (entier32,sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// nombre de couleurs utilisées (0=toutes), 4 octets
-	Image->colors = hex2dec (entier32,sizeof(long));
-	fread (&entier32,sizeof(long),1,ImageFile);		// nombre de couleurs importantes (0=toutes), 4 octets
-	Image->primarycolors = hex2dec (entier32,sizeof(long));
+	fread (&entier32,2,1,ImageFile);		// nombre de bits par pixel, 2 octets
+	Image->bpp = hex2dec(entier32,2);
+	fread (&entier32,4,1,ImageFile);		// compression (0=rien), 4 octets
+	Image->compression = hex2dec(entier32,4);
+	fread (&entier32,4,1,ImageFile);		// taille de l'image, 4 octets
+	Image->imagesize = hex2dec(entier32,4);
+	fread (&entier32,4,1,ImageFile);		// résolution horizontale en pixels par mètre, 4 octets
+	Image->Hres = hex2dec (entier32,4);
+	fread (&entier32,4,1,ImageFile);		// résolution verticale, en pixels par mètre, 4 octets
+	Image->Vres = hex2dec (entier32,4);
+	fread (&entier32,4,1,ImageFile);		// nombre de couleurs utilisées (0=toutes), 4 octets
+	Image->colors = hex2dec (entier32,4);
+	fread (&entier32,4,1,ImageFile);		// nombre de couleurs importantes (0=toutes), 4 octets
+	Image->primarycolors = hex2dec (entier32,4);
 
 	// si c'est une image 8 bpp, cette entête est suivie de la palette.
-	if ((Image->palette = (unsigned char *) malloc(sizeof(unsigned char) * Image->colors * sizeof(long)))==NULL) return -1;
-	for (int i = 0; i < Image->colors; i++) fread(&Image->palette[i*sizeof(long)],sizeof(long),1,ImageFile);
+	if ((Image->palette = (unsigned char *) malloc(sizeof(unsigned char) * Image->colors * 4))==NULL) return -1;
+	for (int i = 0; i < Image->colors; i++) fread(&Image->palette[i*4],4,1,ImageFile);
 
 	// après la palette, ce sont les données de l'image
 
@@ -143,37 +143,37 @@ int WriteBitmapFile (char* FileName,  BMPImageStruct *Image, bool vflip_flag=fal
 	if ((ImageFile = fopen (FileName,"w")) == NULL) return -1;
 
 	fwrite (Image->signature,2,1,ImageFile);		// signature codée sur 2 octets
-	dec2hex(Image->filesize, entier32, sizeof(long));	// taille totale du fichier, 4 octets
-	fwrite (&entier32,sizeof (long),1,ImageFile);
-	dec2hex(0, entier32, sizeof(long));
-	fwrite (&entier32,sizeof (long),1,ImageFile);
-	dec2hex(Image->offset, entier32, sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// offset de début de l'image, 4 octets
-	dec2hex(Image->headersize,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// taille de l'entete, 4 octets
-	dec2hex(Image->imageHsize,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// largeur de l'image, 4 octets
-	dec2hex(Image->imageVsize,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// hauteur de l'image, 4 octets
+	dec2hex(Image->filesize, entier32, 4);	// taille totale du fichier, 4 octets
+	fwrite (&entier32,4,1,ImageFile);
+	dec2hex(0, entier32, 4);
+	fwrite (&entier32,4,1,ImageFile);
+	dec2hex(Image->offset, entier32, 4);
+	fwrite (&entier32,4,1,ImageFile);		// offset de début de l'image, 4 octets
+	dec2hex(Image->headersize,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// taille de l'entete, 4 octets
+	dec2hex(Image->imageHsize,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// largeur de l'image, 4 octets
+	dec2hex(Image->imageVsize,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// hauteur de l'image, 4 octets
 	dec2hex(Image->plans,entier32,2);
-	fwrite (&entier32,sizeof(short),1,ImageFile);		// nombre de plans (toujour =1), 2 octets
-	dec2hex(Image->bpp,entier32,sizeof(short));
-	fwrite (&entier32,sizeof(short),1,ImageFile);		// nombre de bits par pixel, 2 octets
-	dec2hex(Image->compression,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// compression (0=rien), 4 octets
-	dec2hex(Image->imagesize,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// taille de l'image, 4 octets
-	dec2hex (Image->Hres,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// résolution horizontale en pixels par mètre, 4 octets
-	dec2hex (Image->Vres,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// résolution verticale, en pixels par mètre, 4 octets
-	dec2hex (Image->colors,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// nombre de couleurs utilisées (0=toutes), 4 octet 
-	dec2hex (Image->primarycolors,entier32,sizeof(long));
-	fwrite (&entier32,sizeof(long),1,ImageFile);		// nombre de couleurs importantes (0=toutes), 4 octets
+	fwrite (&entier32,2,1,ImageFile);		// nombre de plans (toujour =1), 2 octets
+	dec2hex(Image->bpp,entier32,2);
+	fwrite (&entier32,2,1,ImageFile);		// nombre de bits par pixel, 2 octets
+	dec2hex(Image->compression,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// compression (0=rien), 4 octets
+	dec2hex(Image->imagesize,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// taille de l'image, 4 octets
+	dec2hex (Image->Hres,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// résolution horizontale en pixels par mètre, 4 octets
+	dec2hex (Image->Vres,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// résolution verticale, en pixels par mètre, 4 octets
+	dec2hex (Image->colors,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// nombre de couleurs utilisées (0=toutes), 4 octet 
+	dec2hex (Image->primarycolors,entier32,4);
+	fwrite (&entier32,4,1,ImageFile);		// nombre de couleurs importantes (0=toutes), 4 octets
 		
 	// si c'est une image 8 bpp, cette entête est suivie de la palette.
-	for (int i = 0; i < Image->colors; i++) fwrite(&Image->palette[i*sizeof(long)],sizeof(long),1,ImageFile);
+	for (int i = 0; i < Image->colors; i++) fwrite(&Image->palette[i*4],4,1,ImageFile);
 
 	// après la palette, ce sont les données de l'image
 	if (vflip_flag==true) {
@@ -36,6 +36,12 @@ int SN=0;
 int srcAddr=0;
 int camid=0;
 
+// previous image of the same camera, for the conditional replenishment
+char* previousFile=NULL;
+
+// also write a PNG or JPEG file and its thumbnail for the web pages
+int webFormat=0;
+
 uint8_t str2hex(char* str)
 {
         int aux=0, aux2=0;
@@ -73,9 +79,24 @@ uint8_t str2hex(char* str)
 
 #include "bmp.h"
 #include "mqc.h"
+#include "web_image.h"
 
 #define CRAN_ENCODING_IMAGE_TYPE -1
 
+// bit 15 of the offset of the packets with the changed blocks only, each block is then
+// preceded by the number of blocks skipped since the previous one
+#define CR_PACKET_FLAG 0x8000
+
+// bits 12-14 of the offset of the progressive packets, scan n has the coefficients
+// ProgressiveBands[n-1] to ProgressiveBands[n]-1 in zig-zag order, the DC first
+#define PROGRESSIVE_SCANS 5
+int ProgressiveBands[PROGRESSIVE_SCANS+1]={0, 1, 6, 15, 28, 64};
+
+// blocks received, in the interleaved order
+bool *receivedBlock=NULL;
+int nbReceivedBlocks=0;
+bool replenishment=false;
+
 #define a4   1.38703984532215
 #define a7  -0.275899379282943
 #define a47  0.831469612302545
@@ -269,6 +290,14 @@ void JPEGdecoding(BMPImageStruct *InputImage , BMPImageStruct *OutputImage)
 }
 
 
+// the coefficients first to last-1 (zig-zag order) of the block at row_mix, col_mix, the
+// whole block when it is not progressive
+void CopyBlock(BMPImageStruct *OutputImage, int Block[8][8], unsigned int row_mix, unsigned int col_mix, unsigned int first, unsigned int last)
+{
+	for (unsigned int x=first; x<last; x++)
+		OutputImage->data[row_mix+ZigzagCoordinates[x].row][col_mix+ZigzagCoordinates[x].col]=(double) Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col];
+}
+
 int JPEGdepacketization(BMPImageStruct *OutputImage, FILE* TRACEFILE)
 {
 	int Block[8][8];
@@ -283,64 +312,111 @@ int JPEGdepacketization(BMPImageStruct *OutputImage, FILE* TRACEFILE)
 	fscanf(TRACEFILE, "%2X %2X", &row, &col);
 	BlockOffset = row * 256 + col;
 	packetsize -= 2;
+
+	bool skipping = (BlockOffset & CR_PACKET_FLAG) != 0;
+	unsigned int nblocks = OutputImage->imageHsize * OutputImage->imageVsize / 64;
+
+	if (skipping) {
+		replenishment = true;
+		BlockOffset &= ~CR_PACKET_FLAG;
+	}
+
+	// only one band of coefficients of the blocks, the others are kept
+	unsigned int scan = (BlockOffset >> 12) & 0x7;
+	unsigned int first = 0, last = 64;
+	int blocksInPacket = 0;
+
+	if (scan) {
+		if (scan > PROGRESSIVE_SCANS) return packetsize;
+		first = ProgressiveBands[scan-1];
+		last = ProgressiveBands[scan];
+		BlockOffset &= 0x0FFF;
+	}
 	
 	for (int x=0; x<packetsize; x++) fscanf(TRACEFILE, "%2X", &buffer[x]);
 	//packetcount++;
 	objet=&mqobjet;
-	mqc_init_dec(objet, buffer, packetsize);
+	// the progressive packets start with their number of blocks, the DC blocks are too small
+	// to find the last one with the number of bytes decoded
+	if (scan) {
+		blocksInPacket = buffer[0];
+		mqc_init_dec(objet, buffer+1, packetsize-1);
+	}
+	else
+		mqc_init_dec(objet, buffer, packetsize);
 	mqc_resetstates(objet);
 	
-   	while (mqc_numbytes(objet) < packetsize) {
+	// the packets with the changed blocks only are decoded up to their end mark
+   	while (scan ? blocksInPacket > 0 : (skipping || mqc_numbytes(objet) < packetsize)) {
+		// number of unchanged blocks
+		if (skipping) {
+			q=mqc_decode_unary(objet, nblocks);
+			r=mqc_decode(objet);
+			BlockOffset += q*2+r;
+		}
+		if (BlockOffset >= nblocks) return packetsize;
 		// On décode
-		q=0;
-		while(mqc_decode(objet)==1) q++;
+		if (last - first == 1) K=1;
+		else {
+		q=mqc_decode_unary(objet, ~0u);
 		r=mqc_decode(objet);
 		K=q*2+r;
-		for (int x=0; x<K; x++)
+		}
+		// end of the packet
+		if (skipping && (K == 0 || K > 64)) return packetsize;
+		if (K > last - first) return packetsize;
+		for (unsigned int x=first; x<first+K; x++)
 		{
-		q=0;
-		while(mqc_decode(objet)==1) q++;
+		q=mqc_decode_unary(objet, ~0u);
 		r=mqc_decode(objet);
 		index=q*2+r;
 		if ((index % 2) == 0)
 			{  Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=index / 2;	}
 		   else {  Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=0-((index+1) / 2);	}
 		}
-		for (int x=K; x<64; x++) Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=0;
+		for (unsigned int x=first+K; x<64; x++) Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=0;
 		// On copie le bloc décodé à sa place dans l'image
 		row = (BlockOffset * 8) / OutputImage->imageHsize * 8;
 		col = (BlockOffset * 8) % OutputImage->imageHsize;
 		row_mix = ((row * 5) + (col *  8)) % (OutputImage->imageHsize);
 		col_mix = ((row * 8) + (col * 13)) % (OutputImage->imageVsize);
-		for (int u=0; u<8; u++)
-		   for (int v=0; v<8; v++) OutputImage->data[row_mix+u][col_mix+v]=(double) Block[u][v];
+		CopyBlock(OutputImage, Block, row_mix, col_mix, first, last);
+		if (receivedBlock && !receivedBlock[BlockOffset]) {
+			receivedBlock[BlockOffset]=true;
+			nbReceivedBlocks++;
+		}
 		BlockOffset++;
+		blocksInPacket--;
    	}
 		
-   	if (BlockOffset != (OutputImage->imageHsize * OutputImage->imageVsize / 64)) {
-		q=0;
-		while((mqc_decode(objet)==1) && (q < 32)) q++;
+   	if (!scan && BlockOffset < nblocks) {
+		if (last - first == 1) K=1;
+		else {
+		q=mqc_decode_unary(objet, 32);
 		r=mqc_decode(objet);
 		K=q*2+r;
-		if (K > 64) return packetsize;
-		for (int x=0; x<K; x++)
+		}
+		if (K > last - first) return packetsize;
+		for (unsigned int x=first; x<first+K; x++)
 		{
-		q=0;
-		while((mqc_decode(objet)==1) && (q < 32)) q++;
+		q=mqc_decode_unary(objet, 32);
 		r=mqc_decode(objet);
 		index=q*2+r;
 		if ((index % 2) == 0)
 			{  Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=index / 2;	}
 		   else {  Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=0-((index+1) / 2);	}
 		}
-		for (int x=K; x<64; x++) Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=0;
+		for (unsigned int x=first+K; x<64; x++) Block[ZigzagCoordinates[x].row][ZigzagCoordinates[x].col]=0;
 		// On copie le bloc décodé à sa place dans l'image
 		row = (BlockOffset * 8) / OutputImage->imageHsize * 8;
 		col = (BlockOffset * 8) % OutputImage->imageHsize;
 		row_mix = ((row * 5) + (col *  8)) % (OutputImage->imageHsize);
 		col_mix = ((row * 8) + (col * 13)) % (OutputImage->imageVsize);
-		for (int u=0; u<8; u++)
-		   for (int v=0; v<8; v++) OutputImage->data[row_mix+u][col_mix+v]=(double) Block[u][v];
+		CopyBlock(OutputImage, Block, row_mix, col_mix, first, last);
+		if (receivedBlock && !receivedBlock[BlockOffset]) {
+			receivedBlock[BlockOffset]=true;
+			nbReceivedBlocks++;
+		}
 		BlockOffset++;
    	}
 
@@ -349,6 +425,277 @@ int JPEGdepacketization(BMPImageStruct *OutputImage, FILE* TRACEFILE)
 
 // end from CRAN
 
+// parity packets of a group of data packets, their offset is 0x7000 | j << 8 | group and their
+// data is k, the k offsets of the data packets and the Reed-Solomon parity of the vectors
+// [size, data...] of the data packets, see packet_fec.h of the uCam library
+#define FEC_PACKET_FLAG 0x7000
+#define FEC_MAX_PARITY 8
+#define FEC_MAX_PACKETS 512
+
+typedef struct {
+	unsigned int offset;
+	unsigned int size;
+	unsigned char data[MQC_NUMCTXS+1];
+} FECPacketStruct;
+
+uint8_t FECexp[512];
+uint8_t FEClog[256];
+int nbRecoveredPackets=0;
+int nbLostPackets=0;
+
+// GF(256) with x^8+x^4+x^3+x^2+1, as the node
+void FECinit()
+{
+	unsigned int x=1;
+
+	for (int i=0; i<255; i++) {
+		FECexp[i]=FECexp[i+255]=x;
+		FEClog[x]=i;
+		x<<=1;
+		if (x & 0x100) x^=0x11D;
+	}
+}
+
+uint8_t FECmul(uint8_t a, uint8_t b)
+{
+	if (a==0 || b==0) return 0;
+	return FECexp[FEClog[a]+FEClog[b]];
+}
+
+uint8_t FECinv(uint8_t a)
+{
+	return FECexp[255-FEClog[a]];
+}
+
+// Cauchy matrix
+uint8_t FECcoef(uint8_t j, uint8_t i)
+{
+	return FECinv((0x80+j)^i);
+}
+
+// byte t of the vector of a data packet
+uint8_t FECvector(FECPacketStruct *packet, unsigned int t)
+{
+	if (t==0) return packet->size;
+	return (t <= packet->size) ? packet->data[t-1] : 0;
+}
+
+// recovers the lost data packets of each group with its parity packets, the data packets
+// (received and recovered) are written in a temporary file for JPEGdepacketization()
+FILE* FECdecoding(FILE* theFile)
+{
+	static FECPacketStruct packets[FEC_MAX_PACKETS];
+	static uint8_t syndrome[FEC_MAX_PARITY][MQC_NUMCTXS+1];
+	uint8_t A[FEC_MAX_PARITY][FEC_MAX_PARITY];
+	int parity[FEC_MAX_PARITY], missing[FEC_MAX_PARITY], received[256];
+	bool groupDone[256];
+	unsigned int size, hi, lo, byte;
+	int npackets=0, ndata;
+	FILE* dataFile;
+
+	nbRecoveredPackets=0;
+	nbLostPackets=0;
+	FECinit();
+
+	while (npackets < FEC_MAX_PACKETS && fscanf(theFile, "%4X", &size)==1) {
+		if (fscanf(theFile, "%2X %2X", &hi, &lo)!=2 || size < 2 || size-2 > MQC_NUMCTXS) break;
+		packets[npackets].offset = hi*256+lo;
+		packets[npackets].size = size-2;
+		for (unsigned int x=0; x<size-2; x++) {
+			if (fscanf(theFile, "%2X", &byte)!=1) break;
+			packets[npackets].data[x] = byte;
+		}
+		npackets++;
+	}
+
+	ndata = npackets;
+
+	for (int g=0; g<256; g++) groupDone[g]=false;
+
+	for (int p=0; p<ndata; p++) {
+		if ((packets[p].offset & 0xF000) != FEC_PACKET_FLAG || groupDone[packets[p].offset & 0xFF]) continue;
+
+		int group = packets[p].offset & 0xFF;
+		int k = packets[p].data[0];
+		int length = packets[p].size-1-2*k;
+		int nparity = 0, nmissing = 0;
+
+		groupDone[group] = true;
+
+		if (length <= 0) continue;
+
+		// the parity packets of this group
+		for (int q=p; q<ndata && nparity<FEC_MAX_PARITY; q++)
+			if ((packets[q].offset & 0xF000) == FEC_PACKET_FLAG && (int)(packets[q].offset & 0xFF) == group && packets[q].size == packets[p].size)
+				parity[nparity++] = q;
+
+		// the data packets of the group that have been received
+		for (int i=0; i<k; i++) {
+			unsigned int offset = packets[p].data[1+2*i]*256+packets[p].data[2+2*i];
+
+			received[i] = -1;
+			for (int q=0; q<ndata; q++)
+				if (packets[q].offset == offset && (packets[q].offset & 0xF000) != FEC_PACKET_FLAG) received[i] = q;
+
+			if (received[i] < 0) {
+				if (nmissing < FEC_MAX_PARITY) missing[nmissing] = i;
+				nmissing++;
+			}
+		}
+
+		if (nmissing == 0) continue;
+
+		if (nmissing > nparity) {
+			fprintf(stderr, "FEC group %d: %d lost packets for %d parity packets\n", group, nmissing, nparity);
+			nbLostPackets += nmissing;
+			continue;
+		}
+
+		// the parity minus the received packets, for the first nmissing parity packets
+		for (int r=0; r<nmissing; r++) {
+			FECPacketStruct *P = &packets[parity[r]];
+			uint8_t j = (P->offset >> 8) & 0xF;
+
+			for (int t=0; t<length; t++) syndrome[r][t] = P->data[1+2*k+t];
+
+			for (int i=0; i<k; i++)
+				if (received[i] >= 0) {
+					uint8_t c = FECcoef(j, i);
+					for (int t=0; t<length; t++) syndrome[r][t] ^= FECmul(c, FECvector(&packets[received[i]], t));
+				}
+
+			for (int c=0; c<nmissing; c++) A[r][c] = FECcoef(j, missing[c]);
+		}
+
+		// Gauss-Jordan elimination, any square sub-matrix of the Cauchy matrix is invertible
+		for (int c=0; c<nmissing; c++) {
+			int pivot = c;
+
+			while (A[pivot][c] == 0) pivot++;
+
+			if (pivot != c) {
+				for (int x=0; x<nmissing; x++) { uint8_t tmp = A[c][x]; A[c][x] = A[pivot][x]; A[pivot][x] = tmp; }
+				for (int t=0; t<length; t++) { uint8_t tmp = syndrome[c][t]; syndrome[c][t] = syndrome[pivot][t]; syndrome[pivot][t] = tmp; }
+			}
+
+			uint8_t inv = FECinv(A[c][c]);
+
+			for (int x=0; x<nmissing; x++) A[c][x] = FECmul(A[c][x], inv);
+			for (int t=0; t<length; t++) syndrome[c][t] = FECmul(syndrome[c][t], inv);
+
+			for (int r=0; r<nmissing; r++)
+				if (r != c && A[r][c]) {
+					uint8_t f = A[r][c];
+					for (int x=0; x<nmissing; x++) A[r][x] ^= FECmul(f, A[c][x]);
+					for (int t=0; t<length; t++) syndrome[r][t] ^= FECmul(f, syndrome[c][t]);
+				}
+		}
+
+		for (int c=0; c<nmissing && npackets<FEC_MAX_PACKETS; c++) {
+			int i = missing[c];
+
+			if (syndrome[c][0] >= length) {
+				nbLostPackets++;
+				continue;
+			}
+
+			packets[npackets].offset = packets[p].data[1+2*i]*256+packets[p].data[2+2*i];
+			packets[npackets].size = syndrome[c][0];
+			memcpy(packets[npackets].data, &syndrome[c][1], syndrome[c][0]);
+			npackets++;
+			nbRecoveredPackets++;
+		}
+	}
+
+	dataFile = tmpfile();
+
+	if (dataFile == NULL) {
+		rewind(theFile);
+		return theFile;
+	}
+
+	// the recovered packets go back to their place, before the next received packet: the last
+	// block of a packet is decoded until the next packet overwrites it
+	for (int p=ndata+1; p<npackets; p++)
+		for (int q=p; q>ndata && packets[q].offset < packets[q-1].offset; q--) {
+			FECPacketStruct tmp = packets[q];
+			packets[q] = packets[q-1];
+			packets[q-1] = tmp;
+		}
+
+	for (int p=0, recovered=ndata; p<ndata || recovered<npackets; ) {
+		FECPacketStruct *P;
+
+		if (recovered < npackets && (p == ndata || ((packets[p].offset & 0xF000) != FEC_PACKET_FLAG && packets[recovered].offset < packets[p].offset)))
+			P = &packets[recovered++];
+		else
+			P = &packets[p++];
+
+		if ((P->offset & 0xF000) == FEC_PACKET_FLAG) continue;
+
+		fprintf(dataFile, "%04X %02X %02X ", P->size+2, P->offset >> 8, P->offset & 0xFF);
+		for (unsigned int x=0; x<P->size; x++) fprintf(dataFile, "%02X ", P->data[x]);
+	}
+
+	rewind(dataFile);
+	return dataFile;
+}
+
+// the blocks that have not been received are those of the previous image
+int PatchImage(BMPImageStruct *Image, BMPImageStruct *PreviousImage)
+{
+	unsigned int row, col, row_mix, col_mix;
+	int nblocks = Image->imageHsize * Image->imageVsize / 64;
+	int patched = 0;
+
+	if (PreviousImage->imageHsize != Image->imageHsize || PreviousImage->imageVsize != Image->imageVsize)
+		return -1;
+
+	for (int BlockOffset=0; BlockOffset<nblocks; BlockOffset++) {
+		if (receivedBlock[BlockOffset])
+			continue;
+		row = (BlockOffset * 8) / Image->imageHsize * 8;
+		col = (BlockOffset * 8) % Image->imageHsize;
+		row_mix = ((row * 5) + (col *  8)) % (Image->imageHsize);
+		col_mix = ((row * 8) + (col * 13)) % (Image->imageVsize);
+		for (int u=0; u<8; u++)
+		   for (int v=0; v<8; v++) Image->data[row_mix+u][col_mix+v]=PreviousImage->data[row_mix+u][col_mix+v];
+		patched++;
+	}
+
+	return patched;
+}
+
+
+// ucam_0-node_0006-cam_0-Q20-P38-S2046.png and ucam_0-node_0006-cam_0-Q20-P38-S2046-thumb.png
+int WriteWebImageFiles(char* bmpFile, BMPImageStruct *Image, bool vflip_flag)
+{
+	int width = Image->imageHsize, height = Image->imageVsize, scale = WEB_IMAGE_THUMBNAIL_SCALE;
+	uint8_t *pixels = (uint8_t*)malloc(width * height);
+	uint8_t *thumbnail = (uint8_t*)malloc((width/scale) * (height/scale));
+	char webFile[100];
+	int err = -1;
+
+	if (pixels && thumbnail) {
+		// from the top row, as displayed from the BMP file
+		for (int row=0; row<height; row++)
+			for (int col=0; col<width; col++)
+				pixels[row*width+col] = (unsigned char) Image->data[vflip_flag ? height-1-row : row][col];
+
+		sprintf(webFile, "%.*s.%s", (int)strlen(bmpFile)-4, bmpFile, WebImageExtension[webFormat]);
+		err = WriteWebImageFile(webFile, webFormat, pixels, width, height);
+
+		WebThumbnail(pixels, width, height, scale, thumbnail);
+		sprintf(webFile, "%.*s-thumb.%s", (int)strlen(bmpFile)-4, bmpFile, WebImageExtension[webFormat]);
+
+		if (!err)
+			err = WriteWebImageFile(webFile, webFormat, thumbnail, width/scale, height/scale);
+	}
+
+	free(pixels);
+	free(thumbnail);
+	return err;
+}
 
 void startDecodeImage(FILE* theFile, int Q, int SN, char* originalFile, int srcAddr, int camId) {
 
@@ -370,24 +717,62 @@ void startDecodeImage(FILE* theFile, int Q, int SN, char* originalFile, int srcA
             for (int i=0; i<OriginalImage.imageVsize; i++)
                     for (int j=0; j<OriginalImage.imageHsize; j++) OriginalImage.data[i][j]=0.0;
 
+            receivedBlock = (bool*)calloc(OriginalImage.imageHsize * OriginalImage.imageVsize / 64, sizeof(bool));
+            nbReceivedBlocks = 0;
+            replenishment = false;
+
+			// the lost packets that the parity packets give back
+			FILE* dataFile = FECdecoding(theFile);
+
+			if (nbRecoveredPackets || nbLostPackets)
+				fprintf(stderr, "FEC: %d packets recovered, %d packets lost\n", nbRecoveredPackets, nbLostPackets);
+
 			fprintf(stderr, "Start JPEGdepacketization\n");
 			
             // JPEG decoding
-            while ((psize=JPEGdepacketization(&OriginalImage, theFile))) {
+            while ((psize=JPEGdepacketization(&OriginalImage, dataFile))) {
 				totalsize+=psize;
   				npkt++;
 	    	}
 
+			if (dataFile != theFile) fclose(dataFile);
+
 			fprintf(stderr, "Start JPEGdecoding\n");
 			
             JPEGdecoding(&OriginalImage, &OriginalImage);
 
 	    	fprintf(stderr, "Encoded file size is %d, npkt is %d\n", totalsize, npkt);
 
+            // only the changed blocks have been sent
+            if (replenishment) {
+                    BMPImageStruct PreviousImage;
+
+                    fprintf(stderr, "Conditional replenishment, %d blocks received\n", nbReceivedBlocks);
+
+                    if (previousFile == NULL || ReadBitmapFile(previousFile, &PreviousImage))
+                            fprintf(stderr, "CANNOT read previous BMP file, the other blocks are missing\n");
+                    else {
+                            // the lines are read bottom-up
+                            if (vflip)
+                                    for (int i=0; i<PreviousImage.imageVsize/2; i++) {
+                                            double *tmp = PreviousImage.data[i];
+                                            PreviousImage.data[i] = PreviousImage.data[PreviousImage.imageVsize-1-i];
+                                            PreviousImage.data[PreviousImage.imageVsize-1-i] = tmp;
+                                    }
+
+                            if (PatchImage(&OriginalImage, &PreviousImage) < 0)
+                                    fprintf(stderr, "Previous BMP file has not the same size\n");
+                    }
+            }
+
             sprintf(bmpFile,"ucam_%d-node_%04X-cam_%d-Q%d-P%d-S%d.bmp", SN, srcAddr, camId, Q, npkt, totalsize);
 
             err = WriteBitmapFile(bmpFile, &OriginalImage, vflip);
 
+            // the BMP file is still written, it is the previous image of the next one
+            if (!err && webFormat && WriteWebImageFiles(bmpFile, &OriginalImage, vflip))
+                    fprintf(stderr, "CANNOT write the %s files of the image.\n", WebImageExtension[webFormat]);
+
             if (err) {
                     fprintf(stderr, "CANNOT write ucam BMP file from received encoded image.\n");
                     printf("error\n");
@@ -401,7 +786,7 @@ void startDecodeImage(FILE* theFile, int Q, int SN, char* originalFile, int srcA
 
 void * printERROR(char *argv[])
 {
-   fprintf(stderr, "USAGE:\t%s -vflip -original/-received -SN sn -src src -camid camid -Q q orig_image_file_name\n", argv[0]);
+   fprintf(stderr, "USAGE:\t%s -vflip -original/-received -SN sn -src src -camid camid -Q q -previous prev.bmp -web png/jpg orig_image_file_name\n", argv[0]);
    fprintf(stderr, "USAGE:\t-vflip, flip vertically the image\n");
    fprintf(stderr, "USAGE:\t-original img_file.dat, only decode the .dat file (produced by the encoder)\n");
    fprintf(stderr, "USAGE:\t-received img_file.dat, only decode the .dat file (previously received)\n");
@@ -409,6 +794,8 @@ void * printERROR(char *argv[])
    fprintf(stderr, "USAGE:\t-src src, use src as source node address\n"); 
    fprintf(stderr, "USAGE:\t-camid camid, use camid as camera id (index)\n");          
    fprintf(stderr, "USAGE:\t-Q 40, use 40 as Quality Factor, default is 50\n");
+   fprintf(stderr, "USAGE:\t-previous prev.bmp, the previous decoded image of this camera, for the blocks not sent\n");
+   fprintf(stderr, "USAGE:\t-web png, also write the image and its thumbnail as PNG (lossless) or jpg (baseline JPEG) files\n");
    fprintf(stderr, "USAGE:\t orig_image_file_name, give the original bmp file\n");
    return 0;
 }
@@ -460,6 +847,14 @@ int main(int argc, char *argv[]) {
         if (!strcmp(argv[arg], "-camid")) {
             camid=atoi(argv[arg+1]);
         }
+
+        if (!strcmp(argv[arg], "-previous")) {
+            previousFile=argv[arg+1];
+        }
+
+        if (!strcmp(argv[arg], "-web")) {
+            webFormat=!strcmp(argv[arg+1], "jpg") ? WEB_IMAGE_JPEG : WEB_IMAGE_PNG;
+        }
     }
 
 	originalFile=argv[argc-1];
@@ -490,4 +885,6 @@ int main(int argc, char *argv[]) {
 	startDecodeImage(pFile, qualityFactor, SN, originalFile, srcAddr, camid);
 
 	fclose(pFile);
+
+	return 0;
 }
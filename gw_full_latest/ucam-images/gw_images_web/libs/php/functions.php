@@ -3,14 +3,26 @@
 // Fonction de selection des fichiers suivant les extensions predeterminées avec $extensions
 function addphoto($dir,$extensions,$photos=array()){
 	
+	$addphoto = array();
 	foreach($extensions as $ext){
-		$addphoto = glob($dir . '/*.'.$ext); // selectionne les photos contenues du dossier
-		usort($addphoto, create_function('$a,$b', 'return filemtime($b) - filemtime($a);'));
-		$photos =  array_merge($photos, $addphoto); // ajoute les photos au tableau de resultats
+		foreach(glob($dir . '/*.'.$ext) as $filename){ // selectionne les photos contenues du dossier
+			// the thumbnails of the png and jpg images are displayed with their image
+			if (strpos($filename, '-thumb.') === false)
+				$addphoto[] = $filename;
+		}
 	}
+	// the most recent first, whatever their format
+	usort($addphoto, create_function('$a,$b', 'return filemtime($b) - filemtime($a);'));
+	$photos =  array_merge($photos, $addphoto); // ajoute les photos au tableau de resultats
 	return $photos;
 }
 
+// the thumbnail written with a png or jpg image, if any
+function thumbnail($filename){
+	$thumb = substr($filename, 0, strrpos($filename, '.')).'-thumb'.substr($filename, strrpos($filename, '.'));
+	return file_exists($thumb) ? $thumb : $filename;
+}
+
 // Fonction de parcours du dossier
 function scandir_through($dir,$extensions,$photos=array()){
 
@@ -58,7 +70,11 @@ function display_last_capture_for_all_nodes($main_dir, $extensions){
 function display_pic($filename){
 	echo '<td>';
 		echo date('F d Y h:i A',filemtime($filename)).'</br>';
-		echo '<img src="'.$filename.'" />';
+		// a link to the image from its thumbnail, for slow links
+		if (thumbnail($filename) != $filename)
+			echo '<a href="'.$filename.'"><img src="'.thumbnail($filename).'" /></a>';
+		else
+			echo '<img src="'.$filename.'" />';
 		//echo '<center><img src="'.$filename.'" /></center>';
 	echo '</td>';
 }
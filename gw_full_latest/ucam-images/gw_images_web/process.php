@@ -2,7 +2,7 @@
 include_once 'libs/php/functions.php';
 
 $main_dir = 'uploads/node_'; // main directory
-$extensions = array('bmp'); // picture extensions array: add or remove extensions
+$extensions = array('bmp','png','jpg'); // picture extensions array: add or remove extensions
 
 /*************************
  * Video node selection
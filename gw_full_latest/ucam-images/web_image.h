@@ -0,0 +1,713 @@
+/*
+ *  PNG and baseline JPEG files of the decoded images, without external library
+ *
+ *  Copyright (C) 2026 Congduc Pham
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *****************************************************************************
+ *
+ *  The 8-bit gray images are shown by the web pages of gw_images_web, that may be
+ *  read over a 3G link (see 3GDongle): they can be written as a PNG file, lossless
+ *  with the PNG filters and deflate with dynamic Huffman codes, or as a baseline JPEG
+ *  file with the standard tables, instead of a 17462-byte BMP file.
+ *
+ *  The pixels are given from the top row of the image. The file is written in a
+ *  temporary file that is then renamed, the web server never reads it partly written.
+ */
+
+#ifndef WEB_IMAGE_H
+#define WEB_IMAGE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define WEB_IMAGE_BMP             0
+#define WEB_IMAGE_PNG             1
+#define WEB_IMAGE_JPEG            2
+
+#define WEB_IMAGE_JPEG_QUALITY    90
+// the thumbnails are 1/WEB_IMAGE_THUMBNAIL_SCALE of the image
+#define WEB_IMAGE_THUMBNAIL_SCALE 2
+
+typedef struct {
+	uint8_t *data;
+	int size;
+	int capacity;
+	// the bits not written yet
+	uint32_t bits;
+	int nbits;
+} WebImageBuffer;
+
+static const char *WebImageExtension[3]={ "bmp", "png", "jpg" };
+
+static void WebPutByte(WebImageBuffer *out, uint8_t b)
+{
+	if (out->size >= out->capacity) {
+		uint8_t *data = out->size == out->capacity ? (uint8_t*)realloc(out->data, out->capacity ? 2*out->capacity : 4096) : NULL;
+
+		// after a failed realloc, the bytes are only counted and the encoding fails at the end
+		if (data == NULL) {
+			out->size++;
+			return;
+		}
+
+		out->data = data;
+		out->capacity = out->capacity ? 2*out->capacity : 4096;
+	}
+
+	out->data[out->size++] = b;
+}
+
+static void WebPut32(WebImageBuffer *out, uint32_t v)
+{
+	for (int b=24; b>=0; b-=8) WebPutByte(out, v >> b);
+}
+
+/*------------------------------- PNG ----------------------------------------*/
+
+static uint32_t WebCRCTable[256];
+
+static uint32_t WebCRC(const uint8_t *p, int n)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	if (WebCRCTable[1] == 0)
+		for (uint32_t i=0; i<256; i++) {
+			uint32_t c = i;
+
+			for (int k=0; k<8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			WebCRCTable[i] = c;
+		}
+
+	for (int i=0; i<n; i++) crc = WebCRCTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+// deflate writes the bits from the least significant one
+static void WebPutBits(WebImageBuffer *out, uint32_t value, int n)
+{
+	out->bits |= value << out->nbits;
+	out->nbits += n;
+
+	while (out->nbits >= 8) {
+		WebPutByte(out, out->bits & 0xFF);
+		out->bits >>= 8;
+		out->nbits -= 8;
+	}
+}
+
+// the Huffman codes are written from their most significant bit
+static void WebPutCode(WebImageBuffer *out, uint32_t code, int length)
+{
+	uint32_t reversed = 0;
+
+	for (int i=0; i<length; i++) reversed |= ((code >> i) & 1) << (length-1-i);
+	WebPutBits(out, reversed, length);
+}
+
+// the lengths of a Huffman code of at most limit bits, at least 2 symbols have a code
+static void WebHuffmanLengths(const uint32_t *frequencies, int n, int limit, uint8_t *lengths)
+{
+	uint32_t freq[2*288], weight[2*288];
+	int parent[2*288];
+	bool active[2*288];
+
+	for (int i=0; i<n; i++) freq[i] = frequencies[i];
+
+	for (int used=0, i=0; i<n && used<2; i++)
+		if (freq[i] || i >= n-2+used) {
+			if (!freq[i]) freq[i] = 1;
+			used++;
+		}
+
+	while (true) {
+		int nodes = n, maxLength = 0;
+
+		for (int i=0; i<n; i++) {
+			weight[i] = freq[i];
+			active[i] = freq[i] != 0;
+			parent[i] = -1;
+		}
+
+		while (true) {
+			int a = -1, b = -1;
+
+			for (int i=0; i<nodes; i++)
+				if (active[i]) {
+					if (a < 0 || weight[i] < weight[a]) { b = a; a = i; }
+					else if (b < 0 || weight[i] < weight[b]) b = i;
+				}
+
+			if (b < 0) break;
+
+			weight[nodes] = weight[a] + weight[b];
+			active[nodes] = true;
+			parent[nodes] = -1;
+			active[a] = active[b] = false;
+			parent[a] = parent[b] = nodes++;
+		}
+
+		for (int i=0; i<n; i++) {
+			lengths[i] = 0;
+
+			if (freq[i])
+				for (int p=parent[i]; p>=0; p=parent[p]) lengths[i]++;
+
+			if (lengths[i] > maxLength) maxLength = lengths[i];
+		}
+
+		if (maxLength <= limit) return;
+
+		// flatter frequencies, a shorter tree
+		for (int i=0; i<n; i++)
+			if (freq[i]) freq[i] = (freq[i] >> 1) | 1;
+	}
+}
+
+static void WebHuffmanCodes(const uint8_t *lengths, int n, uint16_t *codes)
+{
+	int count[16] = {0}, next[16];
+
+	for (int i=0; i<n; i++) count[lengths[i]]++;
+	count[0] = 0;
+	next[0] = 0;
+
+	for (int bits=1, code=0; bits<16; bits++) {
+		code = (code + count[bits-1]) << 1;
+		next[bits] = code;
+	}
+
+	for (int i=0; i<n; i++)
+		if (lengths[i]) codes[i] = next[lengths[i]]++;
+}
+
+static const uint16_t WebLengthBase[29]={3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const uint8_t WebLengthExtra[29]={0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+static const uint16_t WebDistanceBase[30]={1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const uint8_t WebDistanceExtra[30]={0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+static const uint8_t WebCodeLengthOrder[19]={16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+
+#define WEB_HASH_BITS   12
+#define WEB_MAX_CHAIN   64
+#define WEB_WINDOW      32768
+
+// a zlib stream of data: one deflate block with dynamic Huffman codes, LZ77 with hash chains
+static int WebDeflate(WebImageBuffer *out, const uint8_t *data, int n)
+{
+	// a literal, or length-3 << 16 | distance
+	uint32_t *tokens = (uint32_t*)malloc(n * sizeof(uint32_t) + 1);
+	int *prev = (int*)malloc(n * sizeof(int) + 1);
+	int head[1 << WEB_HASH_BITS];
+	int ntokens = 0;
+	uint32_t litFreq[286] = {0}, distFreq[30] = {0};
+
+	if (tokens == NULL || prev == NULL) {
+		free(tokens);
+		free(prev);
+		return -1;
+	}
+
+	for (int i=0; i<(1 << WEB_HASH_BITS); i++) head[i] = -1;
+
+	for (int pos=0; pos<n; ) {
+		int bestLength = 0, bestDistance = 0;
+
+		if (pos+3 <= n) {
+			int h = ((data[pos] << 8) ^ (data[pos+1] << 4) ^ data[pos+2]) & ((1 << WEB_HASH_BITS)-1);
+			int chain = 0;
+
+			for (int cand=head[h]; cand>=0 && pos-cand<=WEB_WINDOW && chain<WEB_MAX_CHAIN; cand=prev[cand], chain++) {
+				int length = 0;
+
+				while (length < 258 && pos+length < n && data[cand+length] == data[pos+length]) length++;
+
+				if (length > bestLength) {
+					bestLength = length;
+					bestDistance = pos-cand;
+
+					if (length == 258) break;
+				}
+			}
+		}
+
+		int step = bestLength >= 3 ? bestLength : 1;
+
+		if (bestLength >= 3) {
+			int code = 0, dcode = 0;
+
+			while (code < 28 && WebLengthBase[code+1] <= bestLength) code++;
+			while (dcode < 29 && WebDistanceBase[dcode+1] <= bestDistance) dcode++;
+			litFreq[257+code]++;
+			distFreq[dcode]++;
+			tokens[ntokens++] = (bestLength-3) << 16 | bestDistance;
+		}
+		else {
+			litFreq[data[pos]]++;
+			tokens[ntokens++] = 0x80000000 | data[pos];
+		}
+
+		// all the positions of a match are in the hash chains
+		for (int i=0; i<step; i++, pos++)
+			if (pos+3 <= n) {
+				int h = ((data[pos] << 8) ^ (data[pos+1] << 4) ^ data[pos+2]) & ((1 << WEB_HASH_BITS)-1);
+
+				prev[pos] = head[h];
+				head[h] = pos;
+			}
+	}
+
+	litFreq[256]++;
+
+	uint8_t lengths[286+30], litLengths[286], distLengths[30], clLengths[19];
+	uint16_t litCodes[286], distCodes[30], clCodes[19];
+	uint32_t clFreq[19] = {0};
+	// the code lengths with the run lengths 16, 17 and 18, value | extra << 8
+	uint16_t cl[286+30];
+	int ncl = 0, nlit = 286, ndist = 30, nclen = 19;
+
+	WebHuffmanLengths(litFreq, 286, 15, litLengths);
+	WebHuffmanLengths(distFreq, 30, 15, distLengths);
+	WebHuffmanCodes(litLengths, 286, litCodes);
+	WebHuffmanCodes(distLengths, 30, distCodes);
+
+	while (nlit > 257 && litLengths[nlit-1] == 0) nlit--;
+	while (ndist > 1 && distLengths[ndist-1] == 0) ndist--;
+
+	memcpy(lengths, litLengths, nlit);
+	memcpy(lengths+nlit, distLengths, ndist);
+
+	for (int i=0; i<nlit+ndist; ) {
+		int run = 1;
+
+		while (i+run < nlit+ndist && lengths[i+run] == lengths[i]) run++;
+
+		if (lengths[i] == 0 && run >= 3) {
+			if (run > 138) run = 138;
+			cl[ncl++] = run >= 11 ? 18 | (run-11) << 8 : 17 | (run-3) << 8;
+		}
+		else if (lengths[i] != 0 && run >= 4) {
+			if (run > 7) run = 7;
+			cl[ncl++] = lengths[i];
+			cl[ncl++] = 16 | (run-4) << 8;
+		}
+		else
+			run = 1, cl[ncl++] = lengths[i];
+
+		i += run;
+	}
+
+	for (int i=0; i<ncl; i++) clFreq[cl[i] & 0xFF]++;
+
+	WebHuffmanLengths(clFreq, 19, 7, clLengths);
+	WebHuffmanCodes(clLengths, 19, clCodes);
+
+	while (nclen > 4 && clLengths[WebCodeLengthOrder[nclen-1]] == 0) nclen--;
+
+	// zlib header, deflate with the default compression level
+	WebPutByte(out, 0x78);
+	WebPutByte(out, 0x9C);
+
+	// the last block, dynamic Huffman codes
+	WebPutBits(out, 1, 1);
+	WebPutBits(out, 2, 2);
+	WebPutBits(out, nlit-257, 5);
+	WebPutBits(out, ndist-1, 5);
+	WebPutBits(out, nclen-4, 4);
+
+	for (int i=0; i<nclen; i++) WebPutBits(out, clLengths[WebCodeLengthOrder[i]], 3);
+
+	for (int i=0; i<ncl; i++) {
+		int symbol = cl[i] & 0xFF;
+
+		WebPutCode(out, clCodes[symbol], clLengths[symbol]);
+
+		if (symbol >= 16) WebPutBits(out, cl[i] >> 8, symbol == 16 ? 2 : (symbol == 17 ? 3 : 7));
+	}
+
+	for (int i=0; i<ntokens; i++) {
+		if (tokens[i] & 0x80000000) {
+			WebPutCode(out, litCodes[tokens[i] & 0xFF], litLengths[tokens[i] & 0xFF]);
+			continue;
+		}
+
+		int length = (tokens[i] >> 16) + 3, distance = tokens[i] & 0xFFFF;
+		int code = 0, dcode = 0;
+
+		while (code < 28 && WebLengthBase[code+1] <= length) code++;
+		while (dcode < 29 && WebDistanceBase[dcode+1] <= distance) dcode++;
+
+		WebPutCode(out, litCodes[257+code], litLengths[257+code]);
+		WebPutBits(out, length-WebLengthBase[code], WebLengthExtra[code]);
+		WebPutCode(out, distCodes[dcode], distLengths[dcode]);
+		WebPutBits(out, distance-WebDistanceBase[dcode], WebDistanceExtra[dcode]);
+	}
+
+	WebPutCode(out, litCodes[256], litLengths[256]);
+
+	if (out->nbits) WebPutBits(out, 0, 8-out->nbits);
+
+	uint32_t a = 1, b = 0;
+
+	for (int i=0; i<n; i++) {
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+
+	WebPut32(out, b << 16 | a);
+
+	free(tokens);
+	free(prev);
+	return 0;
+}
+
+static void WebChunk(WebImageBuffer *out, const char *type, const uint8_t *data, int n)
+{
+	WebPut32(out, n);
+
+	int start = out->size;
+
+	for (int i=0; i<4; i++) WebPutByte(out, type[i]);
+	for (int i=0; i<n; i++) WebPutByte(out, data[i]);
+
+	WebPut32(out, out->size <= out->capacity ? WebCRC(out->data+start, n+4) : 0);
+}
+
+// each row gets the filter with the smallest sum of the differences, as libpng
+int EncodePNG(WebImageBuffer *out, const uint8_t *pixels, int width, int height)
+{
+	static const uint8_t signature[8]={137, 'P', 'N', 'G', 13, 10, 26, 10};
+	uint8_t header[13];
+	uint8_t *filtered = (uint8_t*)malloc((width+1) * height);
+	uint8_t *candidate = (uint8_t*)malloc(width);
+	WebImageBuffer idat = {NULL, 0, 0, 0, 0};
+
+	if (filtered == NULL || candidate == NULL) {
+		free(filtered);
+		free(candidate);
+		return -1;
+	}
+
+	for (int row=0; row<height; row++) {
+		const uint8_t *cur = pixels + row*width;
+		const uint8_t *up = row ? cur-width : NULL;
+		uint8_t *dst = filtered + row*(width+1);
+		unsigned int best = 0xFFFFFFFF;
+
+		for (int filter=0; filter<5; filter++) {
+			unsigned int sum = 0;
+
+			for (int x=0; x<width; x++) {
+				int a = x ? cur[x-1] : 0, b = up ? up[x] : 0, c = (x && up) ? up[x-1] : 0;
+				int predictor = 0;
+
+				if (filter == 1) predictor = a;
+				else if (filter == 2) predictor = b;
+				else if (filter == 3) predictor = (a + b) >> 1;
+				else if (filter == 4) {
+					int p = a + b - c, pa = abs(p-a), pb = abs(p-b), pc = abs(p-c);
+
+					predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+				}
+
+				candidate[x] = cur[x] - predictor;
+				sum += abs((int8_t)candidate[x]);
+			}
+
+			if (sum < best) {
+				best = sum;
+				dst[0] = filter;
+				memcpy(dst+1, candidate, width);
+			}
+		}
+	}
+
+	int err = WebDeflate(&idat, filtered, (width+1) * height);
+
+	header[0] = width >> 24; header[1] = width >> 16; header[2] = width >> 8; header[3] = width;
+	header[4] = height >> 24; header[5] = height >> 16; header[6] = height >> 8; header[7] = height;
+	// 8-bit gray, deflate, adaptive filtering, no interlace
+	header[8] = 8; header[9] = 0; header[10] = 0; header[11] = 0; header[12] = 0;
+
+	for (int i=0; i<8; i++) WebPutByte(out, signature[i]);
+
+	WebChunk(out, "IHDR", header, 13);
+	WebChunk(out, "IDAT", idat.data, idat.size);
+	WebChunk(out, "IEND", NULL, 0);
+
+	if (idat.size > idat.capacity) err = -1;
+
+	free(idat.data);
+	free(filtered);
+	free(candidate);
+	return err;
+}
+
+/*------------------------------- JPEG ----------------------------------------*/
+
+// natural index of the zig-zag order
+static const uint8_t WebZigzag[64]={
+	 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+static const uint8_t WebLuminanceTable[64]={
+	16, 11, 10, 16,  24,  40,  51,  61,
+	12, 12, 14, 19,  26,  58,  60,  55,
+	14, 13, 16, 24,  40,  57,  69,  56,
+	14, 17, 22, 29,  51,  87,  80,  62,
+	18, 22, 37, 56,  68, 109, 103,  77,
+	24, 35, 55, 64,  81, 104, 113,  92,
+	49, 64, 78, 87, 103, 121, 120, 101,
+	72, 92, 95, 98, 112, 100, 103,  99};
+
+// the luminance Huffman tables of the JPEG standard, Annex K
+static const uint8_t WebDCBits[16]={0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t WebDCValues[12]={0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+static const uint8_t WebACBits[16]={0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+static const uint8_t WebACValues[162]={
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+	0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+	0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+	0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+	0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+	0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+	0xF9, 0xFA};
+
+// the code and the length of each symbol, Annex C
+static void WebJPEGCodes(const uint8_t *bits, const uint8_t *values, uint16_t *codes, uint8_t *lengths)
+{
+	int code = 0, k = 0;
+
+	for (int length=1; length<=16; length++) {
+		for (int i=0; i<bits[length-1]; i++, k++) {
+			codes[values[k]] = code++;
+			lengths[values[k]] = length;
+		}
+
+		code <<= 1;
+	}
+}
+
+// JPEG writes the bits from the most significant one, a 0xFF byte is followed by 0x00
+static void WebPutJPEGBits(WebImageBuffer *out, uint32_t value, int n)
+{
+	out->bits = out->bits << n | (value & ((1 << n)-1));
+	out->nbits += n;
+
+	while (out->nbits >= 8) {
+		uint8_t b = out->bits >> (out->nbits-8);
+
+		WebPutByte(out, b);
+
+		if (b == 0xFF) WebPutByte(out, 0);
+
+		out->nbits -= 8;
+	}
+}
+
+static void WebMarker(WebImageBuffer *out, uint8_t marker, int length)
+{
+	WebPutByte(out, 0xFF);
+	WebPutByte(out, marker);
+
+	if (length) {
+		WebPutByte(out, length >> 8);
+		WebPutByte(out, length & 0xFF);
+	}
+}
+
+// the quality is that of the IJG library, 1 to 100
+int EncodeJPEG(WebImageBuffer *out, const uint8_t *pixels, int width, int height, int quality)
+{
+	uint8_t qt[64];
+	uint16_t dcCodes[12], acCodes[256];
+	uint8_t dcLengths[12], acLengths[256];
+	double C[8][8];
+	int scale, previousDC = 0;
+
+	if (quality < 1) quality = 1;
+	if (quality > 100) quality = 100;
+
+	scale = quality < 50 ? 5000/quality : 200-2*quality;
+
+	for (int i=0; i<64; i++) {
+		int q = (WebLuminanceTable[i]*scale + 50) / 100;
+
+		qt[i] = q < 1 ? 1 : (q > 255 ? 255 : q);
+	}
+
+	for (int u=0; u<8; u++)
+		for (int x=0; x<8; x++)
+			C[u][x] = (u ? 0.5 : sqrt(0.125)) * cos((2*x+1)*u*M_PI/16);
+
+	WebJPEGCodes(WebDCBits, WebDCValues, dcCodes, dcLengths);
+	WebJPEGCodes(WebACBits, WebACValues, acCodes, acLengths);
+
+	WebMarker(out, 0xD8, 0);
+
+	// JFIF 1.01, no density, no thumbnail
+	static const uint8_t jfif[14]={'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+
+	WebMarker(out, 0xE0, 16);
+	for (int i=0; i<14; i++) WebPutByte(out, jfif[i]);
+
+	WebMarker(out, 0xDB, 67);
+	WebPutByte(out, 0);
+	for (int i=0; i<64; i++) WebPutByte(out, qt[WebZigzag[i]]);
+
+	// baseline, 8 bits, 1 component without subsampling
+	WebMarker(out, 0xC0, 11);
+	WebPutByte(out, 8);
+	WebPutByte(out, height >> 8);
+	WebPutByte(out, height & 0xFF);
+	WebPutByte(out, width >> 8);
+	WebPutByte(out, width & 0xFF);
+	WebPutByte(out, 1);
+	WebPutByte(out, 1);
+	WebPutByte(out, 0x11);
+	WebPutByte(out, 0);
+
+	WebMarker(out, 0xC4, 2+17+12+17+162);
+	WebPutByte(out, 0x00);
+	for (int i=0; i<16; i++) WebPutByte(out, WebDCBits[i]);
+	for (int i=0; i<12; i++) WebPutByte(out, WebDCValues[i]);
+	WebPutByte(out, 0x10);
+	for (int i=0; i<16; i++) WebPutByte(out, WebACBits[i]);
+	for (int i=0; i<162; i++) WebPutByte(out, WebACValues[i]);
+
+	WebMarker(out, 0xDA, 8);
+	WebPutByte(out, 1);
+	WebPutByte(out, 1);
+	WebPutByte(out, 0x00);
+	WebPutByte(out, 0);
+	WebPutByte(out, 63);
+	WebPutByte(out, 0);
+
+	out->bits = 0;
+	out->nbits = 0;
+
+	for (int by=0; by<height; by+=8)
+		for (int bx=0; bx<width; bx+=8) {
+			double block[8][8], tmp[8][8];
+			int coefs[64];
+
+			// the last row and column are repeated in an incomplete block
+			for (int y=0; y<8; y++)
+				for (int x=0; x<8; x++) {
+					int row = by+y < height ? by+y : height-1, col = bx+x < width ? bx+x : width-1;
+
+					block[y][x] = pixels[row*width+col] - 128.0;
+				}
+
+			for (int y=0; y<8; y++)
+				for (int u=0; u<8; u++) {
+					tmp[y][u] = 0;
+					for (int x=0; x<8; x++) tmp[y][u] += C[u][x] * block[y][x];
+				}
+
+			for (int v=0; v<8; v++)
+				for (int u=0; u<8; u++) {
+					double s = 0;
+
+					for (int y=0; y<8; y++) s += C[v][y] * tmp[y][u];
+					coefs[v*8+u] = (int)lround(s / qt[v*8+u]);
+				}
+
+			for (int k=0, run=0; k<64; k++) {
+				int value = coefs[WebZigzag[k]];
+
+				if (k == 0) {
+					value -= previousDC;
+					previousDC = coefs[0];
+				}
+				else if (value == 0) {
+					run++;
+
+					if (k == 63) WebPutJPEGBits(out, acCodes[0x00], acLengths[0x00]);
+					continue;
+				}
+
+				int magnitude = value < 0 ? -value : value, size = 0;
+
+				while (magnitude >> size) size++;
+
+				if (k == 0)
+					WebPutJPEGBits(out, dcCodes[size], dcLengths[size]);
+				else {
+					for ( ; run > 15; run -= 16) WebPutJPEGBits(out, acCodes[0xF0], acLengths[0xF0]);
+					WebPutJPEGBits(out, acCodes[run << 4 | size], acLengths[run << 4 | size]);
+					run = 0;
+				}
+
+				if (size) WebPutJPEGBits(out, value < 0 ? value-1 : value, size);
+			}
+		}
+
+	// padded with 1 bits
+	if (out->nbits) WebPutJPEGBits(out, 0x7F, 8-out->nbits);
+
+	WebMarker(out, 0xD9, 0);
+
+	return out->size > out->capacity ? -1 : 0;
+}
+
+/*------------------------------- files ----------------------------------------*/
+
+// the mean of the scale x scale pixels
+void WebThumbnail(const uint8_t *pixels, int width, int height, int scale, uint8_t *thumbnail)
+{
+	for (int row=0; row<height/scale; row++)
+		for (int col=0; col<width/scale; col++) {
+			int sum = 0;
+
+			for (int y=0; y<scale; y++)
+				for (int x=0; x<scale; x++) sum += pixels[(row*scale+y)*width+col*scale+x];
+
+			thumbnail[row*(width/scale)+col] = (sum + scale*scale/2) / (scale*scale);
+		}
+}
+
+int WriteWebImageFile(const char *FileName, int format, const uint8_t *pixels, int width, int height, int quality=WEB_IMAGE_JPEG_QUALITY)
+{
+	WebImageBuffer out = {NULL, 0, 0, 0, 0};
+	char tmpName[256];
+	int err = format == WEB_IMAGE_PNG ? EncodePNG(&out, pixels, width, height) : EncodeJPEG(&out, pixels, width, height, quality);
+	FILE *f = NULL;
+
+	snprintf(tmpName, sizeof(tmpName), "%s.tmp", FileName);
+
+	if (!err && (f = fopen(tmpName, "wb")) == NULL) err = -1;
+
+	if (f) {
+		if (fwrite(out.data, out.size, 1, f) != 1) err = -1;
+		if (fclose(f) != 0) err = -1;
+		if (!err && rename(tmpName, FileName) != 0) err = -1;
+		if (err) remove(tmpName);
+	}
+
+	free(out.data);
+	return err;
+}
+
+#endif